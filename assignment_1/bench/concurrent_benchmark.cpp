@@ -0,0 +1,99 @@
+#include "ConcurrentHashTable.h"
+#include "PerformanceTimer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief A small, fast pseudo random generator so the benchmark measures the table, not rand().
+ */
+struct XorShift {
+    uint64_t state;
+    explicit XorShift(uint64_t seed) : state(seed * 0x9e3779b97f4a7c15ULL + 1) {}
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+/**
+ * @brief Measures ConcurrentHashTable read throughput while one writer keeps ingesting.
+ * 
+ * For every reader thread count, the table is prefilled with half of the key space, then the
+ * readers look up random keys while a single writer increments random keys of the whole key
+ * space, so about half of its writes insert new keys and trigger incremental migrations.
+ * 
+ * Usage: concurrent_benchmark [milliseconds per run] [reader thread counts...]
+ * 
+ * @return int Returns 0 on successful execution.
+ */
+int main(int argc, char** argv) {
+    int duration_ms = argc > 1 ? atoi(argv[1]) : 500;
+    vector<int> thread_counts;
+    for (int i = 2; i < argc; ++i) thread_counts.push_back(atoi(argv[i]));
+    if (thread_counts.empty()) thread_counts = {1, 4, 16, 32};
+
+    const int key_space = 1 << 20;
+    vector<string> keys(key_space);
+    for (int i = 0; i < key_space; ++i) keys[i] = "word" + to_string(i);
+
+    cout << "hardware threads: " << thread::hardware_concurrency() << ", " << duration_ms << " ms per run" << endl;
+    for (int readers : thread_counts) {
+        ConcurrentHashTable table(1024);
+        for (int i = 0; i < key_space; i += 2) table.increment(keys[i]);
+
+        atomic<bool> running(true);
+        atomic<long long> reads(0);
+        atomic<long long> hits(0);
+        long long writes = 0;
+
+        vector<thread> threads;
+        for (int t = 0; t < readers; ++t) {
+            threads.emplace_back([&, t]() {
+                XorShift random(t + 1);
+                long long local_reads = 0;
+                long long local_hits = 0;
+                int value;
+                while (running.load(memory_order_relaxed)) {
+                    for (int i = 0; i < 256; ++i) {
+                        local_hits += table.try_get(keys[random.next() & (key_space - 1)], value);
+                    }
+                    local_reads += 256;
+                }
+                reads += local_reads;
+                hits += local_hits;
+            });
+        }
+        threads.emplace_back([&]() {
+            XorShift random(12345);
+            while (running.load(memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i) {
+                    table.increment(keys[random.next() & (key_space - 1)]);
+                }
+                writes += 256;
+            }
+        });
+
+        PerformanceTimer timer;
+        timer.start();
+        this_thread::sleep_for(chrono::milliseconds(duration_ms));
+        running = false;
+        for (thread& t : threads) t.join();
+        double seconds = timer.stop() / 1000.0;
+
+        cout << readers << " reader threads: " << reads / seconds / 1e6 << " M reads/s ("
+             << reads / seconds / 1e6 / readers << " per thread, hit rate "
+             << (reads ? 100.0 * hits / reads : 0.0) << "%), writer " << writes / seconds / 1e6
+             << " M increments/s, final size " << table.get_stats().first << "/" << table.get_stats().second << endl;
+    }
+    return 0;
+}
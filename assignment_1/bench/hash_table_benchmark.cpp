@@ -0,0 +1,550 @@
+#include "FrozenHashTable.h"
+#include "HashTable.h"
+#include "TextProcessor.h"
+#include "WordTokenizer.h"
+#include <absl/container/flat_hash_map.h>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief The number of slots of the presized tables, so that a load factor maps to a key count.
+ */
+static const int CAPACITY = 1 << 17;
+
+/**
+ * @brief The number of precomputed lookups cycled through by the lookup benchmarks.
+ */
+static const size_t LOOKUP_COUNT = 1 << 20;
+
+/**
+ * @brief The distributions lookups are drawn from.
+ */
+enum Distribution {
+    UNIFORM = 0,  ///< Every inserted key is equally likely.
+    ZIPFIAN = 1   ///< The k-th most popular key is requested with probability proportional to 1 / k.
+};
+
+/**
+ * @brief A small, fast pseudo random generator so the benchmark measures the table, not rand().
+ */
+struct XorShift {
+    uint64_t state;
+    explicit XorShift(uint64_t seed) : state(seed * 0x9e3779b97f4a7c15ULL + 1) {}
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+/**
+ * @brief Generates distinct random keys that look like words of a few letters to a dozen.
+ *
+ * @param count The number of keys.
+ * @param seed The seed; different seeds give disjoint key sets.
+ * @return The keys.
+ */
+static vector<string> make_keys(size_t count, uint64_t seed) {
+    vector<string> keys;
+    keys.reserve(count);
+    XorShift random(seed);
+    for (size_t i = 0; i < count; ++i) {
+        string key(1, static_cast<char>('a' + seed % 26));
+        uint64_t bits = random.next();
+        for (int letters = 3 + static_cast<int>(bits % 10); letters > 0; --letters) {
+            bits = bits / 26 + random.next() % 7;
+            key.push_back(static_cast<char>('a' + bits % 26));
+        }
+        key += to_string(i);
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+/**
+ * @brief Draws key indexes from a distribution.
+ *
+ * @param distribution The distribution.
+ * @param key_count The number of keys drawn from.
+ * @param count The number of indexes.
+ * @return The indexes, in the order they are looked up.
+ */
+static vector<uint32_t> make_lookups(Distribution distribution, size_t key_count, size_t count) {
+    vector<uint32_t> lookups(count);
+    XorShift random(42);
+    if (distribution == UNIFORM) {
+        for (uint32_t& index : lookups) index = static_cast<uint32_t>(random.next() % key_count);
+        return lookups;
+    }
+
+    // Invert the cumulative Zipf distribution (s = 1) by binary search
+    vector<double> cumulative(key_count);
+    double total = 0.0;
+    for (size_t k = 0; k < key_count; ++k) {
+        total += 1.0 / static_cast<double>(k + 1);
+        cumulative[k] = total;
+    }
+    for (uint32_t& index : lookups) {
+        double target = total * static_cast<double>(random.next() >> 11) / static_cast<double>(1ULL << 53);
+        size_t rank = lower_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin();
+        index = static_cast<uint32_t>(min(rank, key_count - 1));
+    }
+    return lookups;
+}
+
+/**
+ * @brief The book the text benchmarks read: $BENCHMARK_BOOK, or the copy main downloads.
+ *
+ * @return The path of the book.
+ */
+static string book_path() {
+    const char* path = getenv("BENCHMARK_BOOK");
+    return path ? path : "data/gutenberg_98-0.txt";
+}
+
+/**
+ * @brief Returns the tokens of the book in text order, tokenized once per process.
+ *
+ * @return The tokens, empty if the book cannot be read.
+ */
+static const vector<string>& book_tokens() {
+    static const vector<string> tokens = []() {
+        vector<string> result;
+        InputSource input(book_path());
+        WordTokenizer tokenizer;
+        auto collect = [&result](string_view token) { result.emplace_back(token); };
+        input.for_each_chunk([&](const char* data, size_t length) { tokenizer.feed(data, length, collect); });
+        tokenizer.finish(collect);
+        return result;
+    }();
+    return tokens;
+}
+
+/**
+ * @brief The word count table under test.
+ */
+struct HashTableAdapter {
+    HashTable table;
+    HashTableAdapter(int capacity, double max_load_factor) : table(capacity, max_load_factor) {}
+    void insert(const string& key, int value) { table.insert(key, value); }
+    void count(const string& key) { table.increment(key); }
+    bool contains(const string& key) const { return table.try_get(key) != nullptr; }
+    void erase(const string& key) { table.remove(key); }
+    double load_factor() const { return table.load_factor(); }
+};
+
+/**
+ * @brief The standard library baseline: one heap node per element, chained buckets.
+ */
+struct UnorderedMapAdapter {
+    unordered_map<string, int> table;
+    UnorderedMapAdapter(int capacity, double max_load_factor) {
+        table.max_load_factor(static_cast<float>(max_load_factor));
+        table.rehash(capacity);
+    }
+    void insert(const string& key, int value) { table[key] = value; }
+    void count(const string& key) { ++table[key]; }
+    bool contains(const string& key) const { return table.find(key) != table.end(); }
+    void erase(const string& key) { table.erase(key); }
+    double load_factor() const { return table.load_factor(); }
+};
+
+/**
+ * @brief The abseil SwissTable baseline. Its maximum load factor is fixed at 7/8, so only the
+ * capacity is requested.
+ */
+struct AbseilAdapter {
+    absl::flat_hash_map<string, int> table;
+    AbseilAdapter(int capacity, double) { table.reserve(static_cast<size_t>(capacity * 0.875)); }
+    void insert(const string& key, int value) { table[key] = value; }
+    void count(const string& key) { ++table[key]; }
+    bool contains(const string& key) const { return table.find(key) != table.end(); }
+    void erase(const string& key) { table.erase(key); }
+    double load_factor() const { return static_cast<double>(table.size()) / table.bucket_count(); }
+};
+
+/**
+ * @brief The maximum load factor of presized tables, above every load factor benchmarked, so
+ * lookups run at exactly the requested load.
+ */
+static const double PRESIZED_MAX_LOAD_FACTOR = 0.95;
+
+/**
+ * @brief Fills a presized table to a load factor.
+ *
+ * @param table The table.
+ * @param keys The keys; the first load_percent percent of CAPACITY are inserted.
+ * @param load_percent The load factor, in percent.
+ * @return The number of keys inserted.
+ */
+template <class Table>
+static size_t fill(Table& table, const vector<string>& keys, int64_t load_percent) {
+    size_t count = static_cast<size_t>(CAPACITY) * load_percent / 100;
+    for (size_t i = 0; i < count; ++i) table.insert(keys[i], static_cast<int>(i));
+    return count;
+}
+
+/**
+ * @brief Inserts keys into a presized table up to a load factor. Arg: load factor in percent.
+ */
+template <class Table>
+static void BM_Insert(benchmark::State& state) {
+    const vector<string> keys = make_keys(CAPACITY, 1);
+    size_t count = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        unique_ptr<Table> table(new Table(CAPACITY, PRESIZED_MAX_LOAD_FACTOR));
+        state.ResumeTiming();
+        count = fill(*table, keys, state.range(0));
+        state.PauseTiming();
+        table.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+/**
+ * @brief Inserts keys into a table that starts small and resizes on the way. Arg: key count.
+ */
+template <class Table>
+static void BM_InsertGrowing(benchmark::State& state) {
+    const vector<string> keys = make_keys(state.range(0), 2);
+    for (auto _ : state) {
+        Table table(16, 0.7);
+        for (size_t i = 0; i < keys.size(); ++i) table.insert(keys[i], static_cast<int>(i));
+        benchmark::DoNotOptimize(table);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+/**
+ * @brief Looks up keys that are present. Args: distribution, load factor in percent.
+ */
+template <class Table>
+static void BM_LookupHit(benchmark::State& state) {
+    const vector<string> keys = make_keys(CAPACITY, 3);
+    Table table(CAPACITY, PRESIZED_MAX_LOAD_FACTOR);
+    size_t count = fill(table, keys, state.range(1));
+    const vector<uint32_t> lookups = make_lookups(static_cast<Distribution>(state.range(0)), count, LOOKUP_COUNT);
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.contains(keys[lookups[next]]));
+        next = (next + 1) & (LOOKUP_COUNT - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["load"] = table.load_factor();
+}
+
+/**
+ * @brief Looks up uniformly drawn keys one at a time with try_get or PREFETCHED_LOOKUPS at a time
+ * with get_batch. Args: key count, batched (0 or 1).
+ *
+ * With 2^23 keys the table (about 400 MB with its keys) is far larger than the last level
+ * cache, and most lookups miss it.
+ */
+static void BM_LookupBatched(benchmark::State& state) {
+    const size_t PREFETCHED_LOOKUPS = 256;
+    const vector<string> keys = make_keys(state.range(0), 4);
+    HashTable table(16);
+    for (size_t i = 0; i < keys.size(); ++i) table.insert(keys[i], static_cast<int>(i));
+    const vector<uint32_t> lookups = make_lookups(UNIFORM, keys.size(), LOOKUP_COUNT);
+    // Queries lie in order in memory, like tokens of a text, so only the table is accessed at random
+    string query_bytes;
+    for (uint32_t index : lookups) query_bytes += keys[index];
+    vector<string_view> queries(lookups.size());
+    for (size_t i = 0, offset = 0; i < lookups.size(); offset += keys[lookups[i]].size(), ++i) {
+        queries[i] = string_view(query_bytes.data() + offset, keys[lookups[i]].size());
+    }
+    const int* results[PREFETCHED_LOOKUPS];
+    const bool batched = state.range(1) != 0;
+    size_t next = 0;
+    for (auto _ : state) {
+        if (batched) {
+            table.get_batch(queries.data() + next, PREFETCHED_LOOKUPS, results);
+        } else {
+            for (size_t i = 0; i < PREFETCHED_LOOKUPS; ++i) results[i] = table.try_get(queries[next + i]);
+        }
+        benchmark::DoNotOptimize(results);
+        next = (next + PREFETCHED_LOOKUPS) & (LOOKUP_COUNT - 1);
+    }
+    state.SetItemsProcessed(state.iterations() * PREFETCHED_LOOKUPS);
+}
+
+/**
+ * @brief Looks up keys that are absent. Arg: load factor in percent.
+ */
+template <class Table>
+static void BM_LookupMiss(benchmark::State& state) {
+    const vector<string> keys = make_keys(CAPACITY, 4);
+    const vector<string> missing = make_keys(LOOKUP_COUNT, 5);
+    Table table(CAPACITY, PRESIZED_MAX_LOAD_FACTOR);
+    fill(table, keys, state.range(0));
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.contains(missing[next]));
+        next = (next + 1) & (LOOKUP_COUNT - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["load"] = table.load_factor();
+}
+
+/**
+ * @brief Removes the oldest key and inserts a new one, keeping the load factor steady while
+ * tombstones accumulate. Arg: load factor in percent.
+ */
+template <class Table>
+static void BM_RemoveChurn(benchmark::State& state) {
+    const vector<string> keys = make_keys(CAPACITY + LOOKUP_COUNT, 6);
+    Table table(CAPACITY, PRESIZED_MAX_LOAD_FACTOR);
+    size_t count = fill(table, keys, state.range(0));
+    size_t oldest = 0;
+    for (auto _ : state) {
+        table.erase(keys[oldest]);
+        table.insert(keys[oldest + count], 1);
+        if (++oldest + count == keys.size()) {
+            state.PauseTiming();
+            for (size_t i = oldest; i < oldest + count; ++i) table.erase(keys[i]);
+            oldest = 0;
+            fill(table, keys, state.range(0));
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief Finds the number of keys at which a table growing from 16 slots resizes.
+ *
+ * Every table type resizes at its own thresholds, which show as a drop of the load factor.
+ *
+ * @param keys The keys to insert.
+ * @param min_count The smallest acceptable number of keys before the resize.
+ * @return The number of keys held just before the first resize at or after min_count keys, or 0
+ * if the keys run out first.
+ */
+template <class Table>
+static size_t find_resize_point(const vector<string>& keys, size_t min_count) {
+    Table table(16, 0.7);
+    double load = 0.0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        table.insert(keys[i], 1);
+        if (table.load_factor() < load && i >= min_count) return i;
+        load = table.load_factor();
+    }
+    return 0;
+}
+
+/**
+ * @brief Measures one resize: the insertion that crosses the load factor limit of a table.
+ * Arg: the minimum key count before the resize.
+ */
+template <class Table>
+static void BM_Resize(benchmark::State& state) {
+    const vector<string> keys = make_keys(state.range(0) * 3, 7);
+    size_t count = find_resize_point<Table>(keys, state.range(0));
+    if (count == 0) {
+        state.SkipWithError("no resize found");
+        return;
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        unique_ptr<Table> table(new Table(16, 0.7));
+        for (size_t i = 0; i < count; ++i) table->insert(keys[i], 1);
+        state.ResumeTiming();
+        table->insert(keys[count], 1);
+        state.PauseTiming();
+        table.reset();
+        state.ResumeTiming();
+    }
+    state.counters["keys"] = static_cast<double>(count);
+}
+
+/**
+ * @brief Counts the tokens of the book, already tokenized, into an empty table.
+ */
+template <class Table>
+static void BM_CountBookTokens(benchmark::State& state) {
+    const vector<string>& tokens = book_tokens();
+    if (tokens.empty()) {
+        state.SkipWithError("book not found; run hash_table_program first or set BENCHMARK_BOOK");
+        return;
+    }
+    for (auto _ : state) {
+        Table table(5000, 0.7);
+        for (const string& token : tokens) table.count(token);
+        benchmark::DoNotOptimize(table);
+    }
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+
+/**
+ * @brief Looks up the tokens of the book, in text order, in the table of its distinct words.
+ */
+template <class Table>
+static void BM_LookupBookTokens(benchmark::State& state) {
+    const vector<string>& tokens = book_tokens();
+    if (tokens.empty()) {
+        state.SkipWithError("book not found; run hash_table_program first or set BENCHMARK_BOOK");
+        return;
+    }
+    Table table(5000, 0.7);
+    for (const string& token : tokens) table.count(token);
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.contains(tokens[next]));
+        if (++next == tokens.size()) next = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief Looks up the book's tokens, in book order, in the frozen snapshot of the counted table.
+ */
+static void BM_FrozenLookupBookTokens(benchmark::State& state) {
+    const vector<string>& tokens = book_tokens();
+    if (tokens.empty()) {
+        state.SkipWithError("book not found; run hash_table_program first or set BENCHMARK_BOOK");
+        return;
+    }
+    HashTable table(5000, 0.7);
+    for (const string& token : tokens) table.increment(token);
+    FrozenHashTable frozen(table);
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(frozen.try_get(tokens[next]));
+        if (++next == tokens.size()) next = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief std::hash of std::string_view, made transparent so tables can use it like StringHash.
+ */
+struct StdStringHash {
+    typedef void is_transparent;
+    size_t operator()(string_view key) const { return hash<string_view>()(key); }
+};
+
+/**
+ * @brief Hashes the book's tokens, in book order, with a string hash functor.
+ */
+template <class Hash>
+static void BM_HashBookTokens(benchmark::State& state) {
+    const vector<string>& tokens = book_tokens();
+    if (tokens.empty()) {
+        state.SkipWithError("book not found; run hash_table_program first or set BENCHMARK_BOOK");
+        return;
+    }
+    Hash hasher;
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hasher(tokens[next]));
+        if (++next == tokens.size()) next = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief Counts the book's tokens in a HashTable with a given string hash, growing from empty.
+ */
+template <class Hash>
+static void BM_CountBookTokensWithHash(benchmark::State& state) {
+    const vector<string>& tokens = book_tokens();
+    if (tokens.empty()) {
+        state.SkipWithError("book not found; run hash_table_program first or set BENCHMARK_BOOK");
+        return;
+    }
+    for (auto _ : state) {
+        BasicHashTable<string, int, Hash> table(16);
+        for (const string& token : tokens) table.increment(token);
+        benchmark::DoNotOptimize(table.get_stats());
+    }
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+
+/**
+ * @brief Reads, tokenizes and counts the book end to end with TextProcessor::extract_words.
+ * Arg: thread count.
+ */
+static void BM_ExtractWords(benchmark::State& state) {
+    InputSource probe(book_path());
+    if (!probe.is_open() || probe.size() == 0) {
+        state.SkipWithError("book not found; run hash_table_program first or set BENCHMARK_BOOK");
+        return;
+    }
+    TextProcessor text_processor;
+    for (auto _ : state) {
+        HashTable table(5000);
+        text_processor.extract_words(book_path(), table, static_cast<int>(state.range(0)));
+        benchmark::DoNotOptimize(table);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(probe.size()));
+}
+
+/**
+ * @brief Registers a benchmark for the table under test and both baselines.
+ */
+#define BENCHMARK_TABLES(benchmark_template, arguments)                      \
+    BENCHMARK_TEMPLATE(benchmark_template, HashTableAdapter) arguments;     \
+    BENCHMARK_TEMPLATE(benchmark_template, UnorderedMapAdapter) arguments;  \
+    BENCHMARK_TEMPLATE(benchmark_template, AbseilAdapter) arguments
+
+BENCHMARK_TABLES(BM_Insert, ->ArgName("load")->Arg(50)->Arg(70)->Arg(90));
+BENCHMARK_TABLES(BM_InsertGrowing, ->ArgName("keys")->Arg(1 << 12)->Arg(1 << 16)->Arg(1 << 20));
+BENCHMARK_TABLES(BM_LookupHit, ->ArgNames({"zipf", "load"})->ArgsProduct({{UNIFORM, ZIPFIAN}, {25, 50, 70, 90}}));
+BENCHMARK(BM_LookupBatched)->ArgNames({"keys", "batched"})->ArgsProduct({{1 << 16, 1 << 23}, {0, 1}});
+BENCHMARK_TABLES(BM_LookupMiss, ->ArgName("load")->Arg(25)->Arg(50)->Arg(70)->Arg(90));
+BENCHMARK_TABLES(BM_RemoveChurn, ->ArgName("load")->Arg(50)->Arg(70)->Arg(90));
+BENCHMARK_TABLES(BM_Resize, ->ArgName("keys")->Arg(1 << 12)->Arg(1 << 16)->Arg(1 << 19)->Unit(benchmark::kMicrosecond));
+BENCHMARK_TABLES(BM_CountBookTokens, ->Unit(benchmark::kMillisecond));
+BENCHMARK_TABLES(BM_LookupBookTokens, );
+BENCHMARK(BM_FrozenLookupBookTokens);
+
+#define BENCHMARK_HASHES(benchmark_template, arguments)                             \
+    BENCHMARK_TEMPLATE(benchmark_template, StdStringHash) arguments;               \
+    BENCHMARK_TEMPLATE(benchmark_template, StringHash) arguments;                  \
+    BENCHMARK_TEMPLATE(benchmark_template, BasicStringHash<Xxh3Hash>) arguments;   \
+    BENCHMARK_TEMPLATE(benchmark_template, BasicStringHash<Crc32cHash>) arguments; \
+    BENCHMARK_TEMPLATE(benchmark_template, SeededStringHash) arguments
+
+BENCHMARK_HASHES(BM_HashBookTokens, );
+BENCHMARK_HASHES(BM_CountBookTokensWithHash, ->Unit(benchmark::kMillisecond));
+BENCHMARK(BM_ExtractWords)->ArgName("threads")->Arg(1)->Arg(max(2u, thread::hardware_concurrency()))
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/**
+ * @brief Runs the benchmarks with the table's progress messages silenced.
+ *
+ * The tables print a line on every resize and extract_words prints a summary; those go to
+ * std::cout, which is disabled here, while the results are reported through the original
+ * output stream. Pass --benchmark_out=<file> --benchmark_out_format=json to keep the results.
+ *
+ * @return int Returns 0 on successful execution.
+ */
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    ostream results(cout.rdbuf());
+    cout.rdbuf(nullptr);
+
+    benchmark::ConsoleReporter reporter;
+    reporter.SetOutputStream(&results);
+    reporter.SetErrorStream(&cerr);
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+    return 0;
+}
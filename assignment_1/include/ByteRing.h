@@ -0,0 +1,121 @@
+#ifndef BYTERING_H
+#define BYTERING_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class ByteRing
+ * @brief A bounded byte queue between one producer thread and one consumer thread.
+ *
+ * The producer copies data in with write(), which blocks while the ring is full, so a fast
+ * producer (e.g. a network transfer) is throttled to the pace of the consumer instead of
+ * buffering without limit. The consumer reads without copying: read() returns a view of the
+ * oldest contiguous bytes, which stay valid until they are released with consume().
+ *
+ * Either side can end the exchange: the producer calls close() after the last write, and the
+ * consumer calls abort() if it gives up, which makes every further write fail.
+ */
+class ByteRing {
+public:
+    /**
+     * @brief Creates an empty ring.
+     *
+     * @param capacity The number of bytes the ring holds.
+     */
+    explicit ByteRing(size_t capacity) : buffer(capacity), begin(0), size(0), closed(false), aborted(false) {}
+
+    ByteRing(const ByteRing&) = delete;
+    ByteRing& operator=(const ByteRing&) = delete;
+
+    /**
+     * @brief Appends bytes, waiting for the consumer whenever the ring is full. Producer only.
+     *
+     * @param data The bytes.
+     * @param length The number of bytes.
+     * @return False if the consumer aborted, in which case the bytes are dropped.
+     */
+    bool write(const char* data, size_t length) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (length > 0) {
+            writable.wait(lock, [this]() { return size < buffer.size() || aborted; });
+            if (aborted) {
+                return false;
+            }
+            size_t end = (begin + size) % buffer.size();
+            size_t count = std::min({length, buffer.size() - size, buffer.size() - end});
+            // The consumer never touches free space, so the copy can run unlocked
+            lock.unlock();
+            std::memcpy(buffer.data() + end, data, count);
+            lock.lock();
+            size += count;
+            data += count;
+            length -= count;
+            readable.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Signals that no more bytes will be written. Producer only.
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        readable.notify_one();
+    }
+
+    /**
+     * @brief Returns the oldest bytes, waiting until some are available. Consumer only.
+     *
+     * @param data Receives a pointer to the bytes, valid until they are consumed.
+     * @return The number of contiguous bytes available, or 0 once the ring is closed and empty.
+     */
+    size_t read(const char*& data) {
+        std::unique_lock<std::mutex> lock(mutex);
+        readable.wait(lock, [this]() { return size > 0 || closed || aborted; });
+        if (size == 0 || aborted) {
+            return 0;
+        }
+        data = buffer.data() + begin;
+        return std::min(size, buffer.size() - begin);
+    }
+
+    /**
+     * @brief Releases bytes returned by read(), making room for the producer. Consumer only.
+     *
+     * @param length The number of bytes to release, at most what read() returned.
+     */
+    void consume(size_t length) {
+        std::lock_guard<std::mutex> lock(mutex);
+        begin = (begin + length) % buffer.size();
+        size -= length;
+        writable.notify_one();
+    }
+
+    /**
+     * @brief Stops the exchange from the consumer side; pending and further writes fail.
+     */
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+        writable.notify_one();
+        readable.notify_one();
+    }
+
+private:
+    std::vector<char> buffer;            ///< The storage.
+    size_t begin;                        ///< The offset of the oldest byte.
+    size_t size;                         ///< The number of bytes stored.
+    bool closed;                         ///< The producer has written its last byte.
+    bool aborted;                        ///< The consumer has given up.
+    std::mutex mutex;                    ///< Guards the fields above.
+    std::condition_variable readable;    ///< Signalled when bytes arrive or the ring is closed.
+    std::condition_variable writable;    ///< Signalled when bytes are released or the ring is aborted.
+};
+
+#endif // BYTERING_H
@@ -0,0 +1,316 @@
+#ifndef CONCURRENTHASHTABLE_H
+#define CONCURRENTHASHTABLE_H
+
+#include "HashFunctions.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ConcurrentHashTable
+ * @brief A word count hash table that serves lock-free reads while a writer keeps inserting.
+ *
+ * Writers (insert, increment, remove) are serialized by a mutex; readers (get, try_get) never
+ * take a lock and never wait. Every slot is an atomic pointer to an immutable entry holding the
+ * key, its hash and an atomic value, so a reader either sees a fully constructed entry or none.
+ *
+ * Resizing is incremental: once the load factor limit is reached, a table twice as large is
+ * chained behind the current one and every subsequent write moves a small batch of entries
+ * into it. A moved slot is marked as such in the old table only after the entry is visible in
+ * the new one, and readers search the chain from old to new, so a key stays reachable during
+ * the entire migration and no operation ever waits for a full rehash.
+ *
+ * Removed entries and migrated tables may still be in use by readers, so they are retired
+ * rather than freed, and reclaimed with epochs while readers keep running. Every reader counts
+ * itself in one of two counters, chosen by the parity of the epoch it starts in, spread over
+ * cache-line-sized shards. The writer advances the epoch after retiring memory, so later readers
+ * count in the other counter and can no longer reach it; once the counters of the old parity
+ * drain to zero, the memory is freed. Readers never wait for the writer, and the writer never
+ * waits for readers: it checks the counters every RECLAIM_INTERVAL writes.
+ */
+class ConcurrentHashTable {
+public:
+    /**
+     * @brief Constructs a new concurrent hash table.
+     *
+     * @param size The initial size of the hash table, rounded up to the next power of two.
+     * @param max_load_factor The fraction of used slots (0, 1) above which the table is migrated
+     * to a larger one.
+     * @throw invalid_argument if any parameter is out of range.
+     */
+    explicit ConcurrentHashTable(int size, double max_load_factor = 0.7);
+
+    /**
+     * @brief Destroys the table and all retired memory.
+     */
+    ~ConcurrentHashTable();
+
+    ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+    ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+    /**
+     * @brief Inserts a key-value pair into the hash table.
+     *
+     * If the key already exists, its value is updated.
+     *
+     * @param key The key to be inserted.
+     * @param value The value associated with the key.
+     */
+    void insert(std::string_view key, int value);
+
+    /**
+     * @brief Adds a delta to the value associated with a key, inserting the key if it is missing.
+     *
+     * @param key The key whose value is incremented.
+     * @param delta The amount added to the value; a missing key starts from 0.
+     * @return The value associated with the key after the increment.
+     */
+    int increment(std::string_view key, int delta = 1);
+
+    /**
+     * @brief Removes a key-value pair from the hash table.
+     *
+     * @param key The key to be removed.
+     * @throw invalid_argument if the key is not found.
+     */
+    void remove(std::string_view key);
+
+    /**
+     * @brief Retrieves the value associated with a key. Never blocks.
+     *
+     * @param key The key to search for.
+     * @return The value associated with the key.
+     * @throw invalid_argument if the key is not found.
+     */
+    int get(std::string_view key) const;
+
+    /**
+     * @brief Retrieves the value associated with a key without throwing. Never blocks.
+     *
+     * @param key The key to search for.
+     * @param value Receives the value if the key is found.
+     * @return True if the key is found, otherwise false.
+     */
+    bool try_get(std::string_view key, int& value) const;
+
+    /**
+     * @brief Returns statistics about the hash table.
+     *
+     * @return A pair containing the number of elements and the size of the current table.
+     */
+    std::pair<int, int> get_stats() const;
+
+    /**
+     * @brief Frees the removed entries and migrated tables no reader can still hold.
+     *
+     * Writes already do this every RECLAIM_INTERVAL writes; may be called at any time.
+     */
+    void collect_garbage();
+
+private:
+    /**
+     * @struct Entry
+     * @brief An element of the table. Only its value changes after it is published.
+     */
+    struct Entry {
+        Entry(std::string_view key, size_t key_hash, int value) : key_hash(key_hash), key(key), value(value) {}
+
+        const size_t key_hash;   ///< The full hash of the key, compared before the key itself.
+        const std::string key;   ///< The key.
+        std::atomic<int> value;  ///< The value associated with the key.
+    };
+
+    /**
+     * @struct Table
+     * @brief One generation of the slot array.
+     */
+    struct Table {
+        explicit Table(int size);
+
+        const int size;                                ///< The number of slots, a power of two.
+        int used;                                      ///< Slots holding an entry or a tombstone (writer only).
+        const std::unique_ptr<std::atomic<Entry*>[]> slots;  ///< The slots.
+        std::atomic<Table*> next;                      ///< The table being migrated to, if any.
+    };
+
+    /**
+     * @brief Slot marker for a removed entry; probing continues past it.
+     */
+    static Entry* const TOMBSTONE;
+
+    /**
+     * @brief Slot marker for an entry that was moved to the next table; probing continues past it.
+     */
+    static Entry* const MOVED;
+
+    /**
+     * @struct ReaderShard
+     * @brief Counts the readers of a group of threads, by the parity of the epoch they started in.
+     */
+    struct alignas(64) ReaderShard {
+        std::atomic<long> active[2] = {{0}, {0}};  ///< The readers inside the table, per parity.
+    };
+
+    /**
+     * @class ReadGuard
+     * @brief Counts a reader as active in the current epoch for its lifetime.
+     */
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ConcurrentHashTable& table);
+        ~ReadGuard();
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        std::atomic<long>* counter;  ///< The counter of the reader's shard and epoch parity.
+    };
+
+    /**
+     * @brief The number of old slots moved to the next table on every write during a migration.
+     */
+    static constexpr int MIGRATION_BATCH = 64;
+
+    /**
+     * @brief The number of reader shards; threads beyond it share shards.
+     */
+    static constexpr int READER_SHARDS = 64;
+
+    /**
+     * @brief The number of writes between two attempts to reclaim retired memory.
+     */
+    static constexpr int RECLAIM_INTERVAL = 64;
+
+    /**
+     * @brief Tells whether a slot value points to an entry rather than being empty or a marker.
+     *
+     * @param entry The slot value.
+     * @return True if the slot holds an entry.
+     */
+    static bool is_entry(const Entry* entry);
+
+    /**
+     * @brief Searches one table for a key.
+     *
+     * @param table The table to search.
+     * @param key The key to search for.
+     * @param key_hash The full hash of the key.
+     * @return The index of the slot holding the key, or -1 if it is not in this table.
+     */
+    static int find_in(const Table* table, std::string_view key, size_t key_hash);
+
+    /**
+     * @brief Searches the chain of tables for a key, as readers do.
+     *
+     * @param key The key to search for.
+     * @param key_hash The full hash of the key.
+     * @return The entry holding the key, or nullptr if it is not found.
+     */
+    Entry* find_entry(std::string_view key, size_t key_hash) const;
+
+    /**
+     * @brief Stores an entry in the first free slot of its probe sequence. Writer only.
+     *
+     * @param table The table to store the entry in.
+     * @param entry The entry to publish.
+     */
+    static void place(Table* table, Entry* entry);
+
+    /**
+     * @brief Moves the next batch of entries to the table being migrated to. Writer only.
+     *
+     * @param count The number of old slots to process.
+     */
+    void migrate(int count);
+
+    /**
+     * @brief Returns the table new keys go to, starting a migration first if it is too full. Writer only.
+     *
+     * @return The newest table of the chain.
+     */
+    Table* table_for_insert();
+
+    /**
+     * @brief Frees the memory retired before the last epoch change if its readers are gone, then
+     * starts a new epoch for the memory retired since. Never waits. Writer only.
+     */
+    void reclaim();
+
+    /**
+     * @brief Counts a write and reclaims retired memory every RECLAIM_INTERVAL writes. Writer only.
+     */
+    void maybe_reclaim();
+
+    /**
+     * @brief The table readers start searching from; the one being migrated from, if any.
+     */
+    std::atomic<Table*> current;
+
+    /**
+     * @brief The number of elements in the table.
+     */
+    std::atomic<int> elements_count;
+
+    /**
+     * @brief The load factor above which the table is migrated to a larger one.
+     */
+    const double max_load_factor;
+
+    /**
+     * @brief The next slot of the current table to move during a migration. Writer only.
+     */
+    int migration_cursor;
+
+    /**
+     * @brief Serializes writers.
+     */
+    std::mutex write_mutex;
+
+    /**
+     * @brief Removed entries that readers may still hold, retired in the current epoch.
+     */
+    std::vector<Entry*> retired_entries;
+
+    /**
+     * @brief Migrated tables that readers may still be searching, retired in the current epoch.
+     */
+    std::vector<Table*> retired_tables;
+
+    /**
+     * @brief Entries retired before the last epoch change, freed once its readers are gone.
+     */
+    std::vector<Entry*> expiring_entries;
+
+    /**
+     * @brief Tables retired before the last epoch change, freed once its readers are gone.
+     */
+    std::vector<Table*> expiring_tables;
+
+    /**
+     * @brief The writes since the last attempt to reclaim retired memory. Writer only.
+     */
+    int writes_since_reclaim;
+
+    /**
+     * @brief The current epoch; readers count themselves by its parity.
+     */
+    std::atomic<uint64_t> epoch;
+
+    /**
+     * @brief The reader counters.
+     */
+    mutable ReaderShard readers[READER_SHARDS];
+
+    /**
+     * @brief The hash functor.
+     */
+    StringHash hasher;
+};
+
+#endif // CONCURRENTHASHTABLE_H
@@ -0,0 +1,135 @@
+#ifndef CONTROLGROUP_H
+#define CONTROLGROUP_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @class ControlGroup
+ * @brief A group of consecutive hash table control bytes that is matched in one go.
+ *
+ * A control byte is either EMPTY (-128), DELETED (-2) or the 7-bit fingerprint of the key held
+ * by the slot (0..127). The group compares all of its bytes against a value at once and returns
+ * a bit mask of the matching positions: 32 bytes per step with AVX2, 16 with SSE2, and 8 with a
+ * portable SWAR fallback on other targets.
+ */
+class ControlGroup {
+public:
+#if defined(__AVX2__)
+    typedef uint32_t Mask;
+    static constexpr int WIDTH = 32;   ///< The number of control bytes per group.
+    static constexpr int SHIFT = 0;    ///< log2 of the mask bits used per control byte.
+#elif defined(__SSE2__)
+    typedef uint32_t Mask;
+    static constexpr int WIDTH = 16;
+    static constexpr int SHIFT = 0;
+#else
+    typedef uint64_t Mask;
+    static constexpr int WIDTH = 8;
+    static constexpr int SHIFT = 3;
+#endif
+
+    static constexpr int8_t EMPTY = -128;   ///< Control byte of a never used slot.
+    static constexpr int8_t DELETED = -2;   ///< Control byte of a tombstone.
+
+    /**
+     * @brief Loads WIDTH control bytes starting at the given position (no alignment required).
+     *
+     * @param pos Pointer to the first control byte of the group.
+     */
+    explicit ControlGroup(const int8_t* pos) {
+#if defined(__AVX2__)
+        ctrl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+#elif defined(__SSE2__)
+        ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+#else
+        std::memcpy(&ctrl, pos, sizeof(ctrl));
+#endif
+    }
+
+    /**
+     * @brief Returns the positions whose control byte equals a fingerprint.
+     *
+     * The portable fallback may report a false positive next to a true match, which callers
+     * filter out when they compare the keys.
+     *
+     * @param tag The fingerprint to match, in the range [0, 127].
+     * @return A mask with the bits of the matching positions set.
+     */
+    Mask match(int8_t tag) const {
+#if defined(__AVX2__)
+        return static_cast<Mask>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(tag), ctrl)));
+#elif defined(__SSE2__)
+        return static_cast<Mask>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl)));
+#else
+        const uint64_t x = ctrl ^ (LSBS * static_cast<uint8_t>(tag));
+        return (x - LSBS) & ~x & MSBS;
+#endif
+    }
+
+    /**
+     * @brief Returns the positions holding an EMPTY control byte.
+     *
+     * @return A mask with the bits of the empty positions set.
+     */
+    Mask match_empty() const {
+#if defined(__AVX2__) || defined(__SSE2__)
+        return match(EMPTY);
+#else
+        // EMPTY is the only control byte with the high bit set and bit 1 clear
+        return ctrl & ~(ctrl << 6) & MSBS;
+#endif
+    }
+
+    /**
+     * @brief Returns the positions holding a DELETED control byte.
+     *
+     * @return A mask with the bits of the tombstone positions set.
+     */
+    Mask match_deleted() const {
+#if defined(__AVX2__) || defined(__SSE2__)
+        return match(DELETED);
+#else
+        // Both markers have the high bit set; only DELETED also has bit 1 set
+        return ctrl & (ctrl << 6) & MSBS;
+#endif
+    }
+
+    /**
+     * @brief Converts the lowest set bit of a non-zero mask into a position within the group.
+     *
+     * @param mask A non-zero mask returned by one of the match functions.
+     * @return The position in [0, WIDTH) of the first match.
+     */
+    static int lowest(Mask mask) {
+        return (sizeof(Mask) == 8 ? __builtin_ctzll(mask) : __builtin_ctz(static_cast<uint32_t>(mask))) >> SHIFT;
+    }
+
+    /**
+     * @brief Returns the bits of a mask that come before the first set bit of another mask.
+     *
+     * @param mask The mask to filter.
+     * @param limit A mask whose lowest set bit marks the end of the range; 0 keeps everything.
+     * @return The bits of mask below the lowest set bit of limit.
+     */
+    static Mask below(Mask mask, Mask limit) {
+        return limit ? mask & ((limit & (~limit + 1)) - 1) : mask;
+    }
+
+private:
+#if defined(__AVX2__)
+    __m256i ctrl;
+#elif defined(__SSE2__)
+    __m128i ctrl;
+#else
+    static constexpr uint64_t LSBS = 0x0101010101010101ULL;
+    static constexpr uint64_t MSBS = 0x8080808080808080ULL;
+    uint64_t ctrl;
+#endif
+};
+
+#endif // CONTROLGROUP_H
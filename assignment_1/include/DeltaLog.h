@@ -0,0 +1,482 @@
+#ifndef DELTALOG_H
+#define DELTALOG_H
+
+#include "HashFunctions.h"
+#include "SnapshotFormat.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief The current version of the delta log format.
+ */
+constexpr uint32_t DELTA_LOG_VERSION = 3;
+
+/**
+ * @brief The magic bytes identifying a delta log.
+ */
+constexpr char DELTA_LOG_MAGIC[8] = {'D', 'W', 'F', 'D', 'L', 'O', 'G', '\0'};
+
+/**
+ * @class BasicDeltaLog
+ * @brief An append-only log of the changes made to a hash table since its last snapshot.
+ *
+ * The log records absolute changes (a key now maps to a value, or a key was removed) followed
+ * by commit records naming the input prefix the table covers after the changes. Replaying the
+ * log on the snapshot it was started from, or on a newer snapshot that already contains some of
+ * the changes, gives the same table, so a crash while compacting the log into a new snapshot
+ * loses nothing. Changes after the last commit belong to an interrupted batch: they are ignored,
+ * and cut off the file before the next batch is appended so they never join it.
+ *
+ * The file starts with a header following the SnapshotFormat.h conventions; each record is
+ * an operation byte, the key (uint32 length and bytes for std::string keys, raw bytes otherwise)
+ * and, for insertions, the raw value. A commit record ends with the size of its batch in bytes,
+ * itself included in a CRC32-C of the whole batch, so a batch torn or damaged anywhere is
+ * detected rather than replayed.
+ *
+ * @tparam Key The key type of the table: std::string or a trivially copyable type.
+ * @tparam Value The mapped type, which must be trivially copyable.
+ */
+template <class Key, class Value>
+class BasicDeltaLog {
+    static_assert(std::is_trivially_copyable<Value>::value, "Only trivially copyable values can be logged");
+    static_assert(std::is_same<Key, std::string>::value || std::is_trivially_copyable<Key>::value,
+                  "Only std::string or trivially copyable keys can be logged");
+
+    static constexpr bool STRING_KEYS = std::is_same<Key, std::string>::value;
+
+public:
+    /**
+     * @brief The longest std::string key a log holds; longer lengths on replay mean a torn batch.
+     */
+    static constexpr uint32_t MAX_KEY_LENGTH = 1 << 16;
+
+    /**
+     * @struct Commit
+     * @brief The input prefix a table covers after a batch of changes.
+     */
+    struct Commit {
+        uint64_t length;       ///< The number of input bytes processed.
+        std::string checksum;  ///< The checksum of those bytes.
+        std::string stamp;     ///< A cheap identity of the input that spares hashing it, or empty.
+    };
+
+    /**
+     * @brief Creates a log bound to a file; nothing is written until the first change.
+     *
+     * @param filename The name of the log file.
+     */
+    explicit BasicDeltaLog(const std::string& filename) : filename(filename) {}
+
+    /**
+     * @brief Appends the insertion or update of a key.
+     *
+     * @param key The key, or anything convertible to it (std::string_view for string keys).
+     * @param value The value the key maps to after the change.
+     * @throw length_error if a string key is longer than MAX_KEY_LENGTH.
+     */
+    template <class K>
+    void log_insert(const K& key, const Value& value) {
+        check_key(key);
+        open_for_append();
+        char op = INSERT;
+        write_bytes(&op, sizeof(op));
+        write_key(key);
+        write_bytes(&value, sizeof(value));
+    }
+
+    /**
+     * @brief Appends the removal of a key.
+     *
+     * @param key The removed key.
+     * @throw length_error if a string key is longer than MAX_KEY_LENGTH.
+     */
+    template <class K>
+    void log_remove(const K& key) {
+        check_key(key);
+        open_for_append();
+        char op = REMOVE;
+        write_bytes(&op, sizeof(op));
+        write_key(key);
+    }
+
+    /**
+     * @brief Appends a commit record and syncs the log to disk, making the preceding changes durable.
+     *
+     * @param commit The input prefix the table covers from now on.
+     * @throw runtime_error if the log cannot be written or synced.
+     */
+    void log_commit(const Commit& commit) {
+        open_for_append();
+        char op = COMMIT;
+        write_bytes(&op, sizeof(op));
+        write_bytes(&commit.length, sizeof(commit.length));
+        write_string(commit.checksum);
+        write_string(commit.stamp);
+        uint64_t size = batch_size;
+        write_bytes(&size, sizeof(size));
+        out.write(reinterpret_cast<const char*>(&batch_crc), sizeof(batch_crc));
+        batch_size = 0;
+        batch_crc = 0;
+        out.flush();
+        if (!out || !sync()) {
+            throw std::runtime_error("Could not write delta log " + filename);
+        }
+    }
+
+    /**
+     * @brief Empties the log, once its changes are part of a snapshot.
+     *
+     * @throw runtime_error if the log cannot be written.
+     */
+    void reset() {
+        if (out.is_open()) out.close();
+        out.open(filename, std::ios::binary | std::ios::trunc);
+        write_header();
+        batch_size = 0;
+        batch_crc = 0;
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Could not write delta log " + filename);
+        }
+    }
+
+    /**
+     * @brief Returns the size of the log file.
+     *
+     * @return The size in bytes, or 0 if the log does not exist.
+     */
+    uint64_t size_on_disk() {
+        if (out.is_open()) out.flush();
+        std::ifstream in(filename, std::ios::binary | std::ios::ate);
+        return in.is_open() ? static_cast<uint64_t>(in.tellg()) : 0;
+    }
+
+    /**
+     * @brief Finds the last commit of the log without applying anything.
+     *
+     * @param commit Receives the last commit, if any.
+     * @return True if the log holds at least one commit.
+     */
+    bool last_commit(Commit& commit) const {
+        uint64_t end;
+        return scan([](const Record&) {}, commit, end);
+    }
+
+    /**
+     * @brief Applies every committed change of the log to a table.
+     *
+     * @param table The table, loaded from the snapshot the log was started from or a newer one.
+     * @param commit Receives the last commit, if any.
+     * @return True if the log holds at least one commit.
+     */
+    template <class Table>
+    bool replay(Table& table, Commit& commit) const {
+        uint64_t end;
+        return scan([&table](const Record& record) {
+            if (record.op == INSERT) {
+                table.insert(record.key, record.value);
+            } else if (table.try_get(record.key)) {
+                table.remove(record.key);
+            }
+        }, commit, end);
+    }
+
+private:
+    static constexpr char INSERT = 1;  ///< A key maps to a value.
+    static constexpr char REMOVE = 2;  ///< A key was removed.
+    static constexpr char COMMIT = 3;  ///< The preceding changes cover an input prefix.
+
+    /**
+     * @struct Record
+     * @brief A change read back from the log.
+     */
+    struct Record {
+        char op;      ///< INSERT or REMOVE.
+        Key key;      ///< The key.
+        Value value;  ///< The value, for insertions.
+    };
+
+    /**
+     * @struct Reader
+     * @brief Reads the records of a batch, keeping the size and CRC32-C of the bytes read so far.
+     */
+    struct Reader {
+        std::istream& in;   ///< The log, positioned after the header.
+        uint64_t size = 0;  ///< The number of bytes of the batch read so far.
+        uint32_t crc = 0;   ///< The CRC32-C of those bytes.
+
+        /**
+         * @brief Reads bytes of the batch.
+         *
+         * @param data Receives the bytes.
+         * @param length The number of bytes.
+         * @return False if the log ends first.
+         */
+        bool read(void* data, size_t length) {
+            if (!in.read(static_cast<char*>(data), length)) return false;
+            size += length;
+            crc = Crc32cHash::checksum(crc, data, length);
+            return true;
+        }
+    };
+
+    /**
+     * @brief Opens the log for appending. A missing or unreadable log is started afresh; the
+     * changes of an interrupted batch, or anything torn after the last commit, are cut off first.
+     *
+     * @throw runtime_error if the log cannot be truncated or written.
+     */
+    void open_for_append() {
+        if (out.is_open()) return;
+        Commit commit;
+        uint64_t end;
+        scan([](const Record&) {}, commit, end);
+        if (end == 0) {
+            reset();
+            return;
+        }
+        if (!truncate(end)) {
+            throw std::runtime_error("Could not truncate delta log " + filename);
+        }
+        out.open(filename, std::ios::binary | std::ios::app);
+        batch_size = 0;
+        batch_crc = 0;
+    }
+
+    /**
+     * @brief Cuts the log file to a size and syncs it, unless it already has that size.
+     *
+     * @param size The new size in bytes.
+     * @return False if the file cannot be opened, truncated or synced.
+     */
+    bool truncate(uint64_t size) const {
+        int fd = ::open(filename.c_str(), O_WRONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat status;
+        bool truncated = fstat(fd, &status) == 0 &&
+                         (static_cast<uint64_t>(status.st_size) == size ||
+                          (ftruncate(fd, static_cast<off_t>(size)) == 0 && fsync(fd) == 0));
+        ::close(fd);
+        return truncated;
+    }
+
+    /**
+     * @brief Flushes the flushed log file from the page cache to disk.
+     *
+     * @return False if the file cannot be opened or synced.
+     */
+    bool sync() const {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        bool synced = fsync(fd) == 0;
+        ::close(fd);
+        return synced;
+    }
+
+    /**
+     * @brief Writes bytes of the current batch, adding them to its size and CRC32-C.
+     *
+     * @param data The bytes.
+     * @param length The number of bytes.
+     */
+    void write_bytes(const void* data, size_t length) {
+        out.write(static_cast<const char*>(data), length);
+        batch_size += length;
+        batch_crc = Crc32cHash::checksum(batch_crc, data, length);
+    }
+
+    /**
+     * @brief Writes a short string of a commit record: uint32 length and bytes.
+     *
+     * @param text The string.
+     */
+    void write_string(const std::string& text) {
+        uint32_t length = static_cast<uint32_t>(text.size());
+        write_bytes(&length, sizeof(length));
+        write_bytes(text.data(), length);
+    }
+
+    /**
+     * @brief Reads a short string of a commit record.
+     *
+     * @param reader The batch to read from.
+     * @param text Receives the string.
+     * @return True on success, false if the log ends or the length is implausible.
+     */
+    static bool read_string(Reader& reader, std::string& text) {
+        uint32_t length;
+        if (!reader.read(&length, sizeof(length)) || length > 1024) return false;
+        text.resize(length);
+        return reader.read(&text[0], length);
+    }
+
+    /**
+     * @brief Reads and validates the log header.
+     *
+     * @param in The stream to read from, positioned at the start of the log.
+     * @return True if the log was written with this format, byte order, key type and value type.
+     */
+    static bool read_header(std::istream& in) {
+        SnapshotHeader header;
+        return in.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+               std::equal(header.magic, header.magic + sizeof(header.magic), DELTA_LOG_MAGIC) &&
+               header.version == DELTA_LOG_VERSION && header.byte_order == SNAPSHOT_BYTE_ORDER_MARK &&
+               header.key_size == (STRING_KEYS ? 0 : sizeof(Key)) && header.value_size == sizeof(Value);
+    }
+
+    /**
+     * @brief Writes the log header.
+     */
+    void write_header() {
+        SnapshotHeader header = {};
+        std::copy(DELTA_LOG_MAGIC, DELTA_LOG_MAGIC + sizeof(header.magic), header.magic);
+        header.version = DELTA_LOG_VERSION;
+        header.byte_order = SNAPSHOT_BYTE_ORDER_MARK;
+        header.header_size = sizeof(SnapshotHeader);
+        header.key_size = STRING_KEYS ? 0 : sizeof(Key);
+        header.value_size = sizeof(Value);
+        header.first = -1;
+        header.last = -1;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    /**
+     * @brief Throws if a string key is too long to be replayed, before any of its record is written.
+     *
+     * @param key The key.
+     */
+    template <class K>
+    void check_key(const K& key) const {
+        if constexpr (STRING_KEYS) {
+            if (std::string_view(key).size() > MAX_KEY_LENGTH) {
+                throw std::length_error("Key too long for delta log " + filename);
+            }
+        }
+    }
+
+    /**
+     * @brief Writes a key.
+     *
+     * @param key The key.
+     */
+    template <class K>
+    void write_key(const K& key) {
+        if constexpr (STRING_KEYS) {
+            std::string_view bytes(key);
+            uint32_t length = static_cast<uint32_t>(bytes.size());
+            write_bytes(&length, sizeof(length));
+            write_bytes(bytes.data(), length);
+        } else {
+            Key raw(key);
+            write_bytes(&raw, sizeof(raw));
+        }
+    }
+
+    /**
+     * @brief Reads a key.
+     *
+     * @param reader The batch to read from.
+     * @param key Receives the key.
+     * @param file_size The size of the log, which a string key must not run past.
+     * @return True on success, false if the log ends or the length is implausible.
+     */
+    static bool read_key(Reader& reader, Key& key, [[maybe_unused]] uint64_t file_size) {
+        if constexpr (STRING_KEYS) {
+            uint32_t length;
+            if (!reader.read(&length, sizeof(length)) || length > MAX_KEY_LENGTH ||
+                length > file_size - static_cast<uint64_t>(reader.in.tellg())) {
+                return false;
+            }
+            key.resize(length);
+            return reader.read(&key[0], length);
+        } else {
+            return reader.read(&key, sizeof(key));
+        }
+    }
+
+    /**
+     * @brief Reads the log and passes the changes of every committed batch to a function.
+     *
+     * Reading stops at the end of the file, at the first torn or unknown record, or at a batch
+     * whose size or CRC32-C does not match its commit record.
+     *
+     * @param apply Called with every committed change, in order.
+     * @param commit Receives the last commit, if any.
+     * @param end Receives the offset just past the last commit, the header size if there is none,
+     *            or 0 if the log is missing or unreadable.
+     * @return True if the log holds at least one commit.
+     */
+    template <class Apply>
+    bool scan(Apply apply, Commit& commit, uint64_t& end) const {
+        end = 0;
+        std::ifstream in(filename, std::ios::binary);
+        if (!in.is_open() || !read_header(in)) {
+            return false;
+        }
+        std::streampos start = in.tellg();
+        in.seekg(0, std::ios::end);
+        uint64_t file_size = static_cast<uint64_t>(in.tellg());
+        in.seekg(start);
+        end = static_cast<uint64_t>(start);
+
+        bool committed = false;
+        std::vector<Record> batch;
+        Record record;
+        Reader reader{in};
+        while (reader.read(&record.op, sizeof(record.op))) {
+            if (record.op == COMMIT) {
+                Commit next;
+                if (!reader.read(&next.length, sizeof(next.length)) || !read_string(reader, next.checksum) ||
+                    !read_string(reader, next.stamp)) {
+                    break;
+                }
+                uint64_t size = reader.size;
+                uint64_t logged_size;
+                if (!reader.read(&logged_size, sizeof(logged_size)) || logged_size != size) break;
+                uint32_t crc = reader.crc;
+                uint32_t logged_crc;
+                if (!in.read(reinterpret_cast<char*>(&logged_crc), sizeof(logged_crc)) || logged_crc != crc) break;
+
+                for (const Record& change : batch) apply(change);
+                batch.clear();
+                commit = next;
+                committed = true;
+                end = static_cast<uint64_t>(in.tellg());
+                reader.size = 0;
+                reader.crc = 0;
+            } else if (record.op == INSERT || record.op == REMOVE) {
+                if (!read_key(reader, record.key, file_size)) break;
+                if (record.op == INSERT && !reader.read(&record.value, sizeof(record.value))) break;
+                batch.push_back(record);
+            } else {
+                break;
+            }
+        }
+        return committed;
+    }
+
+    std::string filename;     ///< The name of the log file.
+    std::ofstream out;        ///< The log opened for appending, once something is written.
+    uint64_t batch_size = 0;  ///< The bytes written since the last commit.
+    uint32_t batch_crc = 0;   ///< The CRC32-C of those bytes.
+};
+
+/**
+ * @brief The delta log of the word count table.
+ */
+typedef BasicDeltaLog<std::string, int> DeltaLog;
+
+#endif // DELTALOG_H
@@ -0,0 +1,110 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief The content hash algorithms a checksum file can record.
+ */
+enum class FingerprintAlgorithm {
+    MD5,   ///< MD5 through OpenSSL, as written by earlier versions.
+    XXH64  ///< The 64-bit xxHash, several times faster than MD5 and the default.
+};
+
+/**
+ * @class Fingerprint
+ * @brief An incremental content hash with a selectable algorithm.
+ *
+ * Checksums are formatted as "<algorithm>:<hexadecimal digest>", e.g. "xxh64:ef46db3751d8e999",
+ * so a checksum file always tells which algorithm produced it. The fingerprint only detects
+ * changes to the input, it is not meant to resist deliberate collisions.
+ */
+class Fingerprint {
+public:
+    /**
+     * @brief Starts hashing with the given algorithm.
+     *
+     * @param algorithm The hash algorithm.
+     */
+    explicit Fingerprint(FingerprintAlgorithm algorithm = FingerprintAlgorithm::XXH64);
+
+    /**
+     * @brief Destroys the hash state.
+     */
+    ~Fingerprint();
+
+    Fingerprint(const Fingerprint&) = delete;
+    Fingerprint& operator=(const Fingerprint&) = delete;
+
+    /**
+     * @brief Hashes the next bytes of the input.
+     *
+     * @param data The bytes.
+     * @param length The number of bytes.
+     */
+    void update(const char* data, size_t length);
+
+    /**
+     * @brief Returns the digest of the bytes hashed so far; hashing can continue afterwards.
+     *
+     * @return The digest as a zero-padded hexadecimal string.
+     */
+    std::string hex_digest() const;
+
+    /**
+     * @brief Returns the checksum of the bytes hashed so far; hashing can continue afterwards.
+     *
+     * @return The checksum as "<algorithm>:<hexadecimal digest>".
+     */
+    std::string checksum() const;
+
+    /**
+     * @brief Returns the algorithm in use.
+     *
+     * @return The hash algorithm.
+     */
+    FingerprintAlgorithm algorithm() const;
+
+    /**
+     * @brief Returns the name of an algorithm as recorded in checksums.
+     *
+     * @param algorithm The hash algorithm.
+     * @return "md5" or "xxh64".
+     */
+    static const char* name(FingerprintAlgorithm algorithm);
+
+    /**
+     * @brief Finds the algorithm that produced a checksum.
+     *
+     * @param checksum A checksum as returned by checksum().
+     * @param algorithm Receives the algorithm named by the checksum.
+     * @return False if the checksum names no known algorithm, e.g. a bare digest.
+     */
+    static bool parse(const std::string& checksum, FingerprintAlgorithm& algorithm);
+
+    /**
+     * @brief Hashes a buffer in one call.
+     *
+     * @param data The bytes.
+     * @param length The number of bytes.
+     * @return The 64-bit xxHash of the bytes.
+     */
+    static uint64_t xxh64(const char* data, size_t length);
+
+private:
+    /**
+     * @struct State
+     * @brief The state of the running algorithm.
+     */
+    struct State;
+
+    /**
+     * @brief The running hash state.
+     */
+    std::unique_ptr<State> state;
+};
+
+#endif // FINGERPRINT_H
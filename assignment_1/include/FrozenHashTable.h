@@ -0,0 +1,350 @@
+#ifndef FROZENHASHTABLE_H
+#define FROZENHASHTABLE_H
+
+#include "HashTable.h"
+#include "KeyStorage.h"
+#include "PerfectHash.h"
+#include "SnapshotFormat.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @class BasicFrozenHashTable
+ * @brief A read-only hash table over a hash table snapshot, queried in place.
+ *
+ * The snapshot written by BasicHashTable::save_to_file places every entry at the slot that a
+ * minimal perfect hash function of its key assigns, so a lookup hashes the key once, reads the
+ * bucket's pilot and one slot, and compares one key. There is no probing, no control byte and no
+ * empty slot. Opening a snapshot maps the file and checks that its slots reference valid keys;
+ * nothing is rebuilt or copied, and pages are only read as lookups touch them, so a large table
+ * is ready to serve at once. A frozen table can also be built from a table that is in memory.
+ *
+ * The Hash and KeyEqual functors must be those of the table the snapshot was written from;
+ * opening a snapshot checks that its first key hashes to its own slot.
+ *
+ * @tparam Key The key type: std::string or a trivially copyable type.
+ * @tparam Value The mapped type, which must be trivially copyable.
+ * @tparam Hash The hash functor.
+ * @tparam KeyEqual The equality functor.
+ */
+template <class Key, class Value,
+          class Hash = typename DefaultHash<Key>::type,
+          class KeyEqual = typename DefaultKeyEqual<Key>::type>
+class BasicFrozenHashTable {
+    static_assert(std::is_trivially_copyable<Value>::value, "Only trivially copyable values can be frozen");
+
+    static constexpr bool IS_TRANSPARENT = IsTransparent<Hash>::value && IsTransparent<KeyEqual>::value;
+
+    template <class K>
+    using LookupKey = typename std::conditional<IS_TRANSPARENT, K, Key>::type;
+
+    typedef KeyStorage<Key> Storage;
+
+public:
+    typedef typename Storage::View KeyView;  ///< std::string_view for std::string keys.
+
+    /**
+     * @brief Creates an empty frozen table.
+     *
+     * @param hasher The hash functor snapshots to be opened were saved with, e.g. with their seed.
+     * @param key_equal The equality functor.
+     */
+    explicit BasicFrozenHashTable(const Hash& hasher = Hash(), const KeyEqual& key_equal = KeyEqual())
+        : mapping(nullptr), mapping_size(0), data(nullptr), data_size(0), slots(nullptr), blob(nullptr), count(0),
+          first(-1), last(-1), hasher(hasher), key_equal(key_equal) {}
+
+    /**
+     * @brief Freezes the current contents of a table.
+     *
+     * @param table The table; later changes to it are not reflected.
+     * @throw runtime_error if no perfect hash function is found for the keys.
+     */
+    explicit BasicFrozenHashTable(const BasicHashTable<Key, Value, Hash, KeyEqual>& table)
+        : BasicFrozenHashTable(table.hash_function(), table.key_eq()) {
+        std::ostringstream out;
+        table.save(out);
+        std::string bytes = out.str();
+        // uint64_t words keep every section aligned
+        image.resize((bytes.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        std::memcpy(image.data(), bytes.data(), bytes.size());
+        if (!attach(reinterpret_cast<const char*>(image.data()), bytes.size())) {
+            throw std::runtime_error("Frozen hash table could not read its own snapshot");
+        }
+    }
+
+    ~BasicFrozenHashTable() { unmap(); }
+
+    BasicFrozenHashTable(const BasicFrozenHashTable&) = delete;
+    BasicFrozenHashTable& operator=(const BasicFrozenHashTable&) = delete;
+
+    BasicFrozenHashTable(BasicFrozenHashTable&& other) noexcept
+        : BasicFrozenHashTable(other.hasher, other.key_equal) {
+        swap(other);
+    }
+
+    BasicFrozenHashTable& operator=(BasicFrozenHashTable&& other) noexcept {
+        BasicFrozenHashTable moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    /**
+     * @brief Maps a snapshot written by BasicHashTable::save_to_file.
+     *
+     * @param filename The name of the snapshot file.
+     * @return True if the snapshot was opened; otherwise the table is left unchanged.
+     */
+    bool open(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        void* address = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+
+        BasicFrozenHashTable opened(hasher, key_equal);
+        opened.mapping = static_cast<const char*>(address);
+        opened.mapping_size = static_cast<size_t>(info.st_size);
+        if (!opened.attach(opened.mapping, opened.mapping_size)) {
+            std::cerr << "Not a valid hash table snapshot: " << filename << std::endl;
+            return false;
+        }
+        // Lookups touch the file at random
+        madvise(address, opened.mapping_size, MADV_RANDOM);
+        swap(opened);
+        return true;
+    }
+
+    /**
+     * @brief Writes the frozen table to a file, in the format of BasicHashTable::save_to_file.
+     *
+     * @param filename The name of the file.
+     * @throw runtime_error if the file cannot be written.
+     */
+    void save_to_file(const std::string& filename) const {
+        std::ofstream file(filename, std::ios::binary);
+        file.write(data, data_size);
+        if (!file) {
+            throw std::runtime_error("Could not write frozen hash table to " + filename);
+        }
+    }
+
+    /**
+     * @brief Retrieves the value associated with a key without throwing.
+     *
+     * @param key The key to search for.
+     * @return A pointer to the value, valid as long as the table, or nullptr if the key is not found.
+     */
+    template <class K>
+    const Value* try_get(const K& key) const {
+        if (count == 0) {
+            return nullptr;
+        }
+        const LookupKey<K>& lookup_key = key;
+        const Slot& slot = slots[function(hasher(lookup_key))];
+        return key_equal(Storage::view_in_blob(blob, slot.key), lookup_key) ? &slot.value : nullptr;
+    }
+
+    /**
+     * @brief Retrieves the value associated with a key.
+     *
+     * @param key The key to search for.
+     * @return The value associated with the key.
+     * @throw invalid_argument if the key is not found.
+     */
+    template <class K>
+    Value get(const K& key) const {
+        const Value* value = try_get(key);
+        if (!value) {
+            throw std::invalid_argument("Key not found");
+        }
+        return *value;
+    }
+
+    /**
+     * @brief Calls a function on every element, in slot order.
+     *
+     * @param visit Called with the key (a std::string_view for std::string keys) and the value.
+     */
+    template <class F>
+    void for_each(F visit) const {
+        for (uint64_t i = 0; i < count; ++i) {
+            visit(Storage::view_in_blob(blob, slots[i].key), slots[i].value);
+        }
+    }
+
+    /**
+     * @brief Returns the first inserted key-value pair of the frozen table.
+     *
+     * @return A pair containing the first inserted key and its value.
+     * @throw runtime_error if the table is empty.
+     */
+    std::pair<KeyView, Value> get_first() const { return element(first); }
+
+    /**
+     * @brief Returns the last inserted key-value pair of the frozen table.
+     *
+     * @return A pair containing the last inserted key and its value.
+     * @throw runtime_error if the table is empty.
+     */
+    std::pair<KeyView, Value> get_last() const { return element(last); }
+
+    /**
+     * @brief Returns the number of elements.
+     */
+    size_t size() const { return static_cast<size_t>(count); }
+
+    /**
+     * @brief Tells whether the table serves a memory-mapped snapshot rather than an in-memory copy.
+     */
+    bool is_mapped() const { return mapping != nullptr; }
+
+private:
+    /**
+     * @struct Slot
+     * @brief A slot record of the snapshot, laid out like BasicHashTable::SavedSlot.
+     */
+    struct Slot {
+        typename Storage::Ref key;  ///< The key, or the location of its bytes in the key blob.
+        Value value;                ///< The value associated with the key.
+    };
+
+    /**
+     * @brief Validates a snapshot image and points the table's sections into it.
+     *
+     * @param image The snapshot, aligned to SNAPSHOT_ALIGNMENT.
+     * @param image_size The size of the snapshot in bytes.
+     * @return True if the image is a valid snapshot of this key and value type.
+     */
+    bool attach(const char* image, size_t image_size) {
+        SnapshotHeader header;
+        PerfectHashHeader perfect_hash_header;
+        if (image_size < sizeof(header) + sizeof(perfect_hash_header)) return false;
+        std::memcpy(&header, image, sizeof(header));
+        std::memcpy(&perfect_hash_header, image + sizeof(header), sizeof(perfect_hash_header));
+        if (!std::equal(header.magic, header.magic + sizeof(header.magic), HASH_TABLE_SNAPSHOT_MAGIC) ||
+            header.version != HASH_TABLE_SNAPSHOT_VERSION || header.byte_order != SNAPSHOT_BYTE_ORDER_MARK ||
+            header.header_size != sizeof(SnapshotHeader) || header.key_size != Storage::SNAPSHOT_KEY_SIZE ||
+            header.value_size != sizeof(Value) || perfect_hash_header.slot_size != sizeof(Slot) ||
+            header.count > image_size / sizeof(Slot) || header.key_bytes > image_size ||
+            perfect_hash_header.bucket_count != PerfectHash::bucket_count_for(header.count) ||
+            header.first >= static_cast<int64_t>(header.count) || header.last >= static_cast<int64_t>(header.count)) {
+            return false;
+        }
+
+        uint64_t offset = sizeof(header) + sizeof(perfect_hash_header);
+        uint64_t pilots_offset = offset;
+        offset += perfect_hash_header.bucket_count * sizeof(uint32_t);
+        offset += snapshot_padding(offset);
+        uint64_t slots_offset = offset;
+        offset += header.count * sizeof(Slot);
+        offset += snapshot_padding(offset);
+        uint64_t blob_offset = offset;
+        if (blob_offset + header.key_bytes > image_size) return false;
+
+        const Slot* image_slots = reinterpret_cast<const Slot*>(image + slots_offset);
+        for (uint64_t i = 0; i < header.count; ++i) {
+            if (!Storage::fits_blob(image_slots[i].key, header.key_bytes)) return false;
+        }
+
+        // A snapshot saved with another hash, e.g. another seed, would silently miss every key
+        PerfectHash image_function(perfect_hash_header.seed, perfect_hash_header.bucket_count, header.count,
+                                   reinterpret_cast<const uint32_t*>(image + pilots_offset));
+        if (header.first >= 0 &&
+            image_function(hasher(Storage::view_in_blob(image + blob_offset, image_slots[header.first].key))) !=
+                static_cast<uint64_t>(header.first)) {
+            return false;
+        }
+
+        data = image;
+        data_size = image_size;
+        function = image_function;
+        slots = image_slots;
+        blob = image + blob_offset;
+        count = header.count;
+        first = header.first;
+        last = header.last;
+        return true;
+    }
+
+    /**
+     * @brief Returns the element of a slot.
+     *
+     * @throw runtime_error if the slot is -1, i.e. the table is empty.
+     */
+    std::pair<KeyView, Value> element(int64_t index) const {
+        if (index < 0) {
+            throw std::runtime_error("Hash table is empty");
+        }
+        return std::pair<KeyView, Value>(Storage::view_in_blob(blob, slots[index].key), slots[index].value);
+    }
+
+    /**
+     * @brief Releases the mapping, if any.
+     */
+    void unmap() {
+        if (mapping != nullptr) {
+            munmap(const_cast<char*>(mapping), mapping_size);
+            mapping = nullptr;
+        }
+    }
+
+    /**
+     * @brief Exchanges the contents of two frozen tables.
+     */
+    void swap(BasicFrozenHashTable& other) noexcept {
+        std::swap(image, other.image);
+        std::swap(mapping, other.mapping);
+        std::swap(mapping_size, other.mapping_size);
+        std::swap(data, other.data);
+        std::swap(data_size, other.data_size);
+        std::swap(function, other.function);
+        std::swap(slots, other.slots);
+        std::swap(blob, other.blob);
+        std::swap(count, other.count);
+        std::swap(first, other.first);
+        std::swap(last, other.last);
+        std::swap(hasher, other.hasher);
+        std::swap(key_equal, other.key_equal);
+    }
+
+    std::vector<uint64_t> image;  ///< The snapshot of a table frozen in memory.
+    const char* mapping;          ///< The mapped snapshot file, if opened from a file.
+    size_t mapping_size;          ///< The size of the mapping.
+    const char* data;             ///< The snapshot in use: the image or the mapping.
+    size_t data_size;             ///< The size of the snapshot in use.
+    PerfectHash function;         ///< Maps every key to its slot.
+    const Slot* slots;            ///< The slot section.
+    const char* blob;             ///< The key blob section.
+    uint64_t count;               ///< The number of elements and slots.
+    int64_t first;                ///< The slot of the first inserted element, or -1.
+    int64_t last;                 ///< The slot of the last inserted element, or -1.
+    Hash hasher;                  ///< The hash functor of the source table.
+    KeyEqual key_equal;           ///< The equality functor of the source table.
+};
+
+/**
+ * @brief The frozen word count table.
+ */
+typedef BasicFrozenHashTable<std::string, int> FrozenHashTable;
+
+#endif // FROZENHASHTABLE_H
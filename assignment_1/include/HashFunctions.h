@@ -0,0 +1,717 @@
+#ifndef HASHFUNCTIONS_H
+#define HASHFUNCTIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+/**
+ * @brief Reads 8 bytes in little-endian order, the order the hash algorithms are defined in.
+ */
+inline uint64_t hash_read64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+/**
+ * @brief Reads 4 bytes in little-endian order.
+ */
+inline uint32_t hash_read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+/**
+ * @brief Multiplies two 64-bit values into 128 bits and returns the low and high halves.
+ */
+inline void hash_multiply(uint64_t& low, uint64_t& high) {
+    unsigned __int128 product = static_cast<unsigned __int128>(low) * high;
+    low = static_cast<uint64_t>(product);
+    high = static_cast<uint64_t>(product >> 64);
+}
+
+/**
+ * @brief Multiplies two 64-bit values into 128 bits and folds the halves together with xor.
+ */
+inline uint64_t hash_multiply_fold(uint64_t a, uint64_t b) {
+    hash_multiply(a, b);
+    return a ^ b;
+}
+
+/**
+ * @struct WyHash
+ * @brief The wyhash string hash (final version 4).
+ *
+ * Short keys, which are most words, take two overlapping reads and two 64x64->128 bit
+ * multiplications; longer keys are consumed 48 bytes at a time in three independent lanes.
+ */
+struct WyHash {
+    /**
+     * @brief Hashes a byte string.
+     *
+     * @param data The bytes.
+     * @param length The number of bytes.
+     * @param seed The seed; 0 for the unseeded hash.
+     * @return The 64-bit hash.
+     */
+    static uint64_t hash(const void* data, size_t length, uint64_t seed) {
+        static const uint64_t secret[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL,
+                                           0x4d5a2da51de1aa47ULL};
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        seed ^= hash_multiply_fold(seed ^ secret[0], secret[1]);
+        uint64_t a;
+        uint64_t b;
+        if (length <= 16) {
+            if (length >= 4) {
+                const size_t middle = (length >> 3) << 2;
+                a = (static_cast<uint64_t>(hash_read32(p)) << 32) | hash_read32(p + middle);
+                b = (static_cast<uint64_t>(hash_read32(p + length - 4)) << 32) | hash_read32(p + length - 4 - middle);
+            } else if (length > 0) {
+                a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[length >> 1]) << 8) | p[length - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t remaining = length;
+            if (remaining >= 48) {
+                uint64_t lane1 = seed;
+                uint64_t lane2 = seed;
+                do {
+                    seed = hash_multiply_fold(hash_read64(p) ^ secret[1], hash_read64(p + 8) ^ seed);
+                    lane1 = hash_multiply_fold(hash_read64(p + 16) ^ secret[2], hash_read64(p + 24) ^ lane1);
+                    lane2 = hash_multiply_fold(hash_read64(p + 32) ^ secret[3], hash_read64(p + 40) ^ lane2);
+                    p += 48;
+                    remaining -= 48;
+                } while (remaining >= 48);
+                seed ^= lane1 ^ lane2;
+            }
+            while (remaining > 16) {
+                seed = hash_multiply_fold(hash_read64(p) ^ secret[1], hash_read64(p + 8) ^ seed);
+                p += 16;
+                remaining -= 16;
+            }
+            a = hash_read64(p + remaining - 16);
+            b = hash_read64(p + remaining - 8);
+        }
+        a ^= secret[1];
+        b ^= seed;
+        hash_multiply(a, b);
+        return hash_multiply_fold(a ^ secret[0] ^ length, b ^ secret[1]);
+    }
+};
+
+/**
+ * @brief The primes of the xxHash family, shared by Xxh64Hash and Xxh3Hash.
+ */
+constexpr uint64_t XXH_PRIME32_1 = 0x9e3779b1U;
+constexpr uint64_t XXH_PRIME32_2 = 0x85ebca77U;
+constexpr uint64_t XXH_PRIME32_3 = 0xc2b2ae3dU;
+constexpr uint64_t XXH_PRIME64_1 = 0x9e3779b185ebca87ULL;
+constexpr uint64_t XXH_PRIME64_2 = 0xc2b2ae3d27d4eb4fULL;
+constexpr uint64_t XXH_PRIME64_3 = 0x165667b19e3779f9ULL;
+constexpr uint64_t XXH_PRIME64_4 = 0x85ebca77c2b2ae63ULL;
+constexpr uint64_t XXH_PRIME64_5 = 0x27d4eb2f165667c5ULL;
+
+/**
+ * @brief Rotates a 64-bit value left.
+ */
+inline uint64_t hash_rotate(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+/**
+ * @brief The final mix of XXH64, also used by XXH3 for keys of up to 3 bytes.
+ */
+inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+/**
+ * @struct Xxh64Hash
+ * @brief The 64-bit XXH64 hash of xxHash, one-shot or streaming.
+ *
+ * Input is consumed in 32-byte stripes by four independent accumulators, which keeps several
+ * multiplications in flight. The streaming State is what Fingerprint hashes files with; the
+ * one-shot hash() makes XXH64 usable as a string hash policy too, although Xxh3Hash is faster
+ * on short keys.
+ */
+struct Xxh64Hash {
+    /**
+     * @struct State
+     * @brief The streaming state; bytes that do not fill a stripe are buffered until the next update.
+     */
+    struct State {
+        /**
+         * @brief Starts hashing.
+         *
+         * @param seed The seed; 0 for the unseeded hash.
+         */
+        explicit State(uint64_t seed = 0)
+            : accumulators{seed + XXH_PRIME64_1 + XXH_PRIME64_2, seed + XXH_PRIME64_2, seed, seed - XXH_PRIME64_1},
+              seed(seed) {}
+
+        /**
+         * @brief Hashes the next bytes of the input.
+         *
+         * @param data The bytes.
+         * @param length The number of bytes.
+         */
+        void update(const void* data, size_t length) {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            total_length += length;
+            if (buffered + length < sizeof(buffer)) {
+                if (length > 0) std::memcpy(buffer + buffered, p, length);
+                buffered += length;
+                return;
+            }
+            const uint8_t* end = p + length;
+            if (buffered > 0) {
+                size_t fill = sizeof(buffer) - buffered;
+                std::memcpy(buffer + buffered, p, fill);
+                consume(buffer, buffer + sizeof(buffer));
+                p += fill;
+                buffered = 0;
+            }
+            p = consume(p, end);
+            buffered = static_cast<size_t>(end - p);
+            if (buffered > 0) std::memcpy(buffer, p, buffered);
+        }
+
+        /**
+         * @brief Returns the hash of the bytes consumed so far; hashing can continue afterwards.
+         *
+         * @return The hash, equal to XXH64(data, length, seed).
+         */
+        uint64_t digest() const {
+            uint64_t hash;
+            if (total_length >= 32) {
+                hash = hash_rotate(accumulators[0], 1) + hash_rotate(accumulators[1], 7) +
+                       hash_rotate(accumulators[2], 12) + hash_rotate(accumulators[3], 18);
+                for (uint64_t accumulator : accumulators) {
+                    hash ^= round(0, accumulator);
+                    hash = hash * XXH_PRIME64_1 + XXH_PRIME64_4;
+                }
+            } else {
+                hash = seed + XXH_PRIME64_5;
+            }
+            hash += total_length;
+
+            const uint8_t* p = buffer;
+            const uint8_t* end = buffer + buffered;
+            for (; p + 8 <= end; p += 8) {
+                hash ^= round(0, hash_read64(p));
+                hash = hash_rotate(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+            }
+            if (p + 4 <= end) {
+                hash ^= static_cast<uint64_t>(hash_read32(p)) * XXH_PRIME64_1;
+                hash = hash_rotate(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+                p += 4;
+            }
+            for (; p < end; ++p) {
+                hash ^= static_cast<uint64_t>(*p) * XXH_PRIME64_5;
+                hash = hash_rotate(hash, 11) * XXH_PRIME64_1;
+            }
+            return xxh64_avalanche(hash);
+        }
+
+    private:
+        /**
+         * @brief Consumes whole stripes.
+         *
+         * @param p The first stripe.
+         * @param end The end of the input.
+         * @return The end of the consumed stripes.
+         */
+        const uint8_t* consume(const uint8_t* p, const uint8_t* end) {
+            uint64_t v1 = accumulators[0], v2 = accumulators[1], v3 = accumulators[2], v4 = accumulators[3];
+            for (; end - p >= 32; p += 32) {
+                v1 = round(v1, hash_read64(p));
+                v2 = round(v2, hash_read64(p + 8));
+                v3 = round(v3, hash_read64(p + 16));
+                v4 = round(v4, hash_read64(p + 24));
+            }
+            accumulators[0] = v1;
+            accumulators[1] = v2;
+            accumulators[2] = v3;
+            accumulators[3] = v4;
+            return p;
+        }
+
+        uint64_t accumulators[4];  ///< The four lanes of the stripes.
+        uint64_t seed;             ///< The seed, used again for short inputs.
+        uint64_t total_length = 0; ///< The number of bytes hashed.
+        uint8_t buffer[32];        ///< The bytes of an incomplete stripe.
+        size_t buffered = 0;       ///< The number of bytes in the buffer.
+    };
+
+    /**
+     * @brief Hashes a byte string.
+     *
+     * @param data The bytes.
+     * @param length The number of bytes.
+     * @param seed The seed; 0 for the unseeded hash.
+     * @return The 64-bit hash, equal to XXH64(data, length, seed).
+     */
+    static uint64_t hash(const void* data, size_t length, uint64_t seed) {
+        State state(seed);
+        state.update(data, length);
+        return state.digest();
+    }
+
+private:
+    /**
+     * @brief Mixes one 8-byte lane into an accumulator.
+     */
+    static uint64_t round(uint64_t accumulator, uint64_t lane) {
+        accumulator += lane * XXH_PRIME64_2;
+        return hash_rotate(accumulator, 31) * XXH_PRIME64_1;
+    }
+};
+
+/**
+ * @struct Xxh3Hash
+ * @brief The 64-bit XXH3 string hash of xxHash 0.8, with a seed.
+ *
+ * Keys of up to 16 bytes are hashed with one or two reads and a single multiplication, keys of
+ * up to 240 bytes with one 128-bit multiplication per 16 bytes, and longer keys with XXH3's
+ * striped accumulator loop, written here in its portable scalar form.
+ */
+struct Xxh3Hash {
+    /**
+     * @brief Hashes a byte string.
+     *
+     * @param data The bytes.
+     * @param length The number of bytes.
+     * @param seed The seed; 0 for the unseeded hash.
+     * @return The 64-bit hash, equal to XXH3_64bits_withSeed(data, length, seed).
+     */
+    static uint64_t hash(const void* data, size_t length, uint64_t seed) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        const uint8_t* secret = SECRET;
+        if (length <= 16) {
+            if (length > 8) {
+                uint64_t low = hash_read64(p) ^ ((hash_read64(secret + 24) ^ hash_read64(secret + 32)) + seed);
+                uint64_t high = hash_read64(p + length - 8) ^ ((hash_read64(secret + 40) ^ hash_read64(secret + 48)) - seed);
+                return avalanche(length + __builtin_bswap64(low) + high + hash_multiply_fold(low, high));
+            }
+            if (length >= 4) {
+                seed ^= static_cast<uint64_t>(__builtin_bswap32(static_cast<uint32_t>(seed))) << 32;
+                uint64_t input = hash_read32(p + length - 4) + (static_cast<uint64_t>(hash_read32(p)) << 32);
+                uint64_t keyed = input ^ ((hash_read64(secret + 8) ^ hash_read64(secret + 16)) - seed);
+                keyed ^= hash_rotate(keyed, 49) ^ hash_rotate(keyed, 24);
+                keyed *= 0x9fb21c651e98df25ULL;
+                keyed ^= (keyed >> 35) + length;
+                keyed *= 0x9fb21c651e98df25ULL;
+                return keyed ^ (keyed >> 28);
+            }
+            if (length > 0) {
+                uint32_t combined = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[length >> 1]) << 24) |
+                                    p[length - 1] | (static_cast<uint32_t>(length) << 8);
+                return xxh64_avalanche(combined ^ ((hash_read32(secret) ^ hash_read32(secret + 4)) + seed));
+            }
+            return xxh64_avalanche(seed ^ hash_read64(secret + 56) ^ hash_read64(secret + 64));
+        }
+        if (length <= 128) {
+            uint64_t acc = length * XXH_PRIME64_1;
+            if (length > 32) {
+                if (length > 64) {
+                    if (length > 96) {
+                        acc += mix16(p + 48, secret + 96, seed);
+                        acc += mix16(p + length - 64, secret + 112, seed);
+                    }
+                    acc += mix16(p + 32, secret + 64, seed);
+                    acc += mix16(p + length - 48, secret + 80, seed);
+                }
+                acc += mix16(p + 16, secret + 32, seed);
+                acc += mix16(p + length - 32, secret + 48, seed);
+            }
+            acc += mix16(p, secret, seed);
+            acc += mix16(p + length - 16, secret + 16, seed);
+            return avalanche(acc);
+        }
+        if (length <= 240) {
+            uint64_t acc = length * XXH_PRIME64_1;
+            for (size_t i = 0; i < 8; ++i) {
+                acc += mix16(p + 16 * i, secret + 16 * i, seed);
+            }
+            acc = avalanche(acc);
+            uint64_t acc_end = mix16(p + length - 16, secret + 136 - 17, seed);
+            for (size_t i = 8; i < length / 16; ++i) {
+                acc_end += mix16(p + 16 * i, secret + 16 * (i - 8) + 3, seed);
+            }
+            return avalanche(acc + acc_end);
+        }
+        return hash_long(p, length, seed);
+    }
+
+private:
+    static constexpr size_t SECRET_SIZE = 192;
+    static constexpr size_t STRIPE_LENGTH = 64;
+
+    /**
+     * @brief The default secret of XXH3.
+     */
+    static constexpr uint8_t SECRET[SECRET_SIZE] = {
+        0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+        0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+        0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+        0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+        0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+        0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+        0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+        0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+        0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+        0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+        0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+        0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+    };
+
+    static uint64_t avalanche(uint64_t h) {
+        h ^= h >> 37;
+        h *= 0x165667919e3779f9ULL;
+        return h ^ (h >> 32);
+    }
+
+    static uint64_t mix16(const uint8_t* p, const uint8_t* secret, uint64_t seed) {
+        return hash_multiply_fold(hash_read64(p) ^ (hash_read64(secret) + seed),
+                                  hash_read64(p + 8) ^ (hash_read64(secret + 8) - seed));
+    }
+
+    /**
+     * @brief Adds one 64-byte stripe into the eight accumulators.
+     */
+    static void accumulate(uint64_t* acc, const uint8_t* p, const uint8_t* secret) {
+        for (size_t lane = 0; lane < 8; ++lane) {
+            uint64_t value = hash_read64(p + 8 * lane);
+            uint64_t keyed = value ^ hash_read64(secret + 8 * lane);
+            acc[lane ^ 1] += value;
+            acc[lane] += (keyed & 0xffffffffULL) * (keyed >> 32);
+        }
+    }
+
+    /**
+     * @brief Hashes keys longer than 240 bytes: blocks of 16 stripes, each followed by a scramble.
+     */
+    static uint64_t hash_long(const uint8_t* p, size_t length, uint64_t seed) {
+        uint8_t seeded_secret[SECRET_SIZE];
+        for (size_t i = 0; i < SECRET_SIZE; i += 16) {
+            uint64_t low = hash_read64(SECRET + i) + seed;
+            uint64_t high = hash_read64(SECRET + i + 8) - seed;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            low = __builtin_bswap64(low);
+            high = __builtin_bswap64(high);
+#endif
+            std::memcpy(seeded_secret + i, &low, sizeof(low));
+            std::memcpy(seeded_secret + i + 8, &high, sizeof(high));
+        }
+        const uint8_t* secret = seeded_secret;
+
+        uint64_t acc[8] = {XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3, XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1};
+        const size_t stripes_per_block = (SECRET_SIZE - STRIPE_LENGTH) / 8;
+        const size_t block_length = STRIPE_LENGTH * stripes_per_block;
+        const size_t blocks = (length - 1) / block_length;
+        for (size_t block = 0; block < blocks; ++block) {
+            for (size_t stripe = 0; stripe < stripes_per_block; ++stripe) {
+                accumulate(acc, p + block * block_length + stripe * STRIPE_LENGTH, secret + stripe * 8);
+            }
+            for (size_t lane = 0; lane < 8; ++lane) {
+                uint64_t scrambled = acc[lane] ^ (acc[lane] >> 47);
+                scrambled ^= hash_read64(secret + SECRET_SIZE - STRIPE_LENGTH + 8 * lane);
+                acc[lane] = scrambled * XXH_PRIME32_1;
+            }
+        }
+        const size_t stripes = ((length - 1) - block_length * blocks) / STRIPE_LENGTH;
+        for (size_t stripe = 0; stripe < stripes; ++stripe) {
+            accumulate(acc, p + blocks * block_length + stripe * STRIPE_LENGTH, secret + stripe * 8);
+        }
+        accumulate(acc, p + length - STRIPE_LENGTH, secret + SECRET_SIZE - STRIPE_LENGTH - 7);
+
+        uint64_t result = length * XXH_PRIME64_1;
+        for (size_t i = 0; i < 4; ++i) {
+            result += hash_multiply_fold(acc[2 * i] ^ hash_read64(secret + 11 + 16 * i),
+                                         acc[2 * i + 1] ^ hash_read64(secret + 11 + 16 * i + 8));
+        }
+        return avalanche(result);
+    }
+};
+
+/**
+ * @struct Crc32cHash
+ * @brief A string hash built on the CRC32-C checksum, computed by the SSE4.2 crc32 instruction.
+ *
+ * Each 8-byte word costs one instruction of 3 cycles latency. Without SSE4.2 (build with
+ * `make ARCH_FLAGS=-msse4.2`) the same checksum is computed from a table, much more slowly.
+ * The 32-bit checksum is multiplied into 64 bits so that the control byte fingerprint, taken
+ * from the top bits, depends on every byte. CRC is linear: seeding it does not defend against
+ * chosen keys, so it suits trusted input only. With 32 bits of entropy, a few hundred thousand
+ * keys already collide, so tables hashed with it cannot be saved (see IsSnapshotHash).
+ */
+struct Crc32cHash {
+    /**
+     * @brief Hashes a byte string.
+     *
+     * @param data The bytes.
+     * @param length The number of bytes.
+     * @param seed The seed, of which the low 32 bits are used; 0 for the unseeded hash.
+     * @return The 64-bit hash.
+     */
+    static uint64_t hash(const void* data, size_t length, uint64_t seed) {
+        return static_cast<uint64_t>(checksum(static_cast<uint32_t>(seed), data, length)) * 0x9e3779b97f4a7c15ULL;
+    }
+
+    /**
+     * @brief Computes the CRC32-C checksum of a byte string, continuing a previous checksum.
+     *
+     * @param crc The checksum of the preceding bytes; 0 to start.
+     * @param data The bytes.
+     * @param length The number of bytes.
+     * @return The checksum of the preceding bytes followed by these.
+     */
+    static uint32_t checksum(uint32_t crc, const void* data, size_t length) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+#if defined(__SSE4_2__)
+        uint64_t word_crc = crc;
+        for (; length >= 8; p += 8, length -= 8) {
+            word_crc = _mm_crc32_u64(word_crc, hash_read64(p));
+        }
+        crc = static_cast<uint32_t>(word_crc);
+        for (; length > 0; ++p, --length) {
+            crc = _mm_crc32_u8(crc, *p);
+        }
+#else
+        const uint32_t* table = crc32c_table();
+        for (; length > 0; ++p, --length) {
+            crc = table[(crc ^ *p) & 0xff] ^ (crc >> 8);
+        }
+#endif
+        return ~crc;
+    }
+
+private:
+#if !defined(__SSE4_2__)
+    /**
+     * @brief Returns the byte-at-a-time table of the reflected Castagnoli polynomial.
+     */
+    static const uint32_t* crc32c_table() {
+        static const struct Table {
+            uint32_t entries[256];
+            Table() {
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t crc = i;
+                    for (int bit = 0; bit < 8; ++bit) {
+                        crc = (crc >> 1) ^ (0x82f63b78U & (0U - (crc & 1)));
+                    }
+                    entries[i] = crc;
+                }
+            }
+        } table;
+        return table.entries;
+    }
+#endif
+};
+
+/**
+ * @struct BasicStringHash
+ * @brief A transparent hash for string keys over a byte string hash policy.
+ *
+ * Accepts std::string, std::string_view and C strings alike, so a table keyed by std::string
+ * can be queried without materializing a std::string. The policy is one of WyHash, Xxh3Hash,
+ * Xxh64Hash and Crc32cHash, or any type with the same static `hash(data, length, seed)` function.
+ *
+ * The unseeded hash is an empty type whose seed is the constant 0, folded into the policy at
+ * compile time. BasicStringHash<Policy, true> carries a seed, random by default, so that keys
+ * chosen to collide cannot be prepared in advance (HashDoS). The tables only store the functor,
+ * so the seed is the only cost of seeding. Snapshots of a seeded table can be loaded with the
+ * same or a different seed, but only opened as a frozen table with the seed they were saved with.
+ *
+ * @tparam Policy The byte string hash.
+ * @tparam Seeded Whether the hash carries a seed.
+ */
+template <class Policy, bool Seeded = false>
+struct BasicStringHash {
+    typedef void is_transparent;  ///< Enables heterogeneous lookup.
+
+    /**
+     * @brief Hashes the bytes of a string.
+     *
+     * @param key The string to hash.
+     * @return The hash value of the string.
+     */
+    size_t operator()(std::string_view key) const {
+        return static_cast<size_t>(Policy::hash(key.data(), key.size(), 0));
+    }
+};
+
+template <class Policy>
+struct BasicStringHash<Policy, true> {
+    typedef void is_transparent;  ///< Enables heterogeneous lookup.
+
+    /**
+     * @brief Creates a hash with a random seed.
+     */
+    BasicStringHash() : seed((static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()()) {}
+
+    /**
+     * @brief Creates a hash with a given seed, e.g. to reproduce a table's layout.
+     *
+     * @param seed The seed.
+     */
+    explicit BasicStringHash(uint64_t seed) : seed(seed) {}
+
+    /**
+     * @brief Hashes the bytes of a string.
+     *
+     * @param key The string to hash.
+     * @return The hash value of the string.
+     */
+    size_t operator()(std::string_view key) const {
+        return static_cast<size_t>(Policy::hash(key.data(), key.size(), seed));
+    }
+
+    /**
+     * @brief Returns the seed.
+     */
+    uint64_t get_seed() const { return seed; }
+
+private:
+    uint64_t seed;  ///< Mixed into every hash.
+};
+
+/**
+ * @brief The default hash of string keys.
+ */
+typedef BasicStringHash<WyHash> StringHash;
+
+/**
+ * @brief A string hash with a random seed, for tables fed untrusted keys.
+ */
+typedef BasicStringHash<WyHash, true> SeededStringHash;
+
+/**
+ * @struct StringEqual
+ * @brief A transparent equality predicate for string keys.
+ */
+struct StringEqual {
+    typedef void is_transparent;  ///< Enables heterogeneous lookup.
+
+    /**
+     * @brief Compares two strings byte by byte.
+     *
+     * @param lhs The first string.
+     * @param rhs The second string.
+     * @return True if both strings hold the same bytes.
+     */
+    bool operator()(std::string_view lhs, std::string_view rhs) const {
+        return lhs == rhs;
+    }
+};
+
+/**
+ * @struct IntegerHash
+ * @brief A hash for integral and enum keys that mixes all bits.
+ *
+ * std::hash is the identity for integers, which would leave the top bits used for control byte
+ * fingerprints empty for small keys. The splitmix64 finalizer spreads every input bit over the
+ * whole hash.
+ */
+template <class Key>
+struct IntegerHash {
+    /**
+     * @brief Hashes an integer key.
+     *
+     * @param key The key to hash.
+     * @return The mixed hash value of the key.
+     */
+    size_t operator()(Key key) const {
+        uint64_t x = static_cast<uint64_t>(key);
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return static_cast<size_t>(x);
+    }
+};
+
+/**
+ * @struct DefaultHash
+ * @brief Selects the default hash of a key type: std::hash unless a better choice exists.
+ */
+template <class Key, class Enable = void>
+struct DefaultHash {
+    typedef std::hash<Key> type;
+};
+
+template <>
+struct DefaultHash<std::string> {
+    typedef StringHash type;
+};
+
+template <class Key>
+struct DefaultHash<Key, typename std::enable_if<std::is_integral<Key>::value || std::is_enum<Key>::value>::type> {
+    typedef IntegerHash<Key> type;
+};
+
+/**
+ * @struct DefaultKeyEqual
+ * @brief Selects the default equality predicate of a key type.
+ */
+template <class Key>
+struct DefaultKeyEqual {
+    typedef std::equal_to<Key> type;
+};
+
+template <>
+struct DefaultKeyEqual<std::string> {
+    typedef StringEqual type;
+};
+
+/**
+ * @struct IsTransparent
+ * @brief Detects whether a hash or equality functor supports heterogeneous lookup.
+ */
+template <class T, class Enable = void>
+struct IsTransparent : std::false_type {};
+
+template <class T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
+
+/**
+ * @struct IsSnapshotHash
+ * @brief Detects whether a hash functor can build the perfect hash of a hash table snapshot.
+ *
+ * The perfect hash function needs distinct hashes for every key. A hash with only 32 bits of
+ * entropy, such as CRC32-C, maps two of about 80k keys to the same value by the birthday bound,
+ * and a snapshot of a large table could never be written, so saving such a table is rejected at
+ * compile time instead.
+ */
+template <class Hash>
+struct IsSnapshotHash : std::true_type {};
+
+template <bool Seeded>
+struct IsSnapshotHash<BasicStringHash<Crc32cHash, Seeded>> : std::false_type {};
+
+#endif // HASHFUNCTIONS_H
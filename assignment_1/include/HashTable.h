@@ -1,28 +1,220 @@
 #ifndef HASHTABLE_H
 #define HASHTABLE_H
 
+#include "ControlGroup.h"
+#include "HashFunctions.h"
+#include "KeyStorage.h"
+#include "PerfectHash.h"
+#include "SnapshotFormat.h"
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 using namespace std;
 
 /**
- * @class HashTable
- * @brief A class to represent a hash table with linear probing for collision resolution.
+ * @class BasicHashTable
+ * @brief A class template to represent a hash table with linear probing for collision resolution.
  * 
  * This class provides functionality for basic hash table operations like insertion,
  * deletion, and retrieval of key-value pairs. It also supports saving and loading
- * the hash table to/from a file and resizing when the table becomes full.
+ * the hash table to/from a file and resizing once the load factor exceeds a configurable limit.
+ * 
+ * The capacity is always a power of two so that a slot index can be computed with a mask
+ * instead of a modulo.
+ * 
+ * The table is laid out as a structure of arrays: a dense array of one control byte per slot
+ * holding a 7-bit hash fingerprint (or the empty/tombstone markers), and a parallel array of
+ * compact slots. A probe first compares the fingerprint, so most non-matching slots are rejected
+ * without touching the slot or the key. Probing compares a whole ControlGroup of fingerprints at
+ * a time (32 with AVX2, 16 with SSE2, 8 with the portable fallback), so the capacity is never
+ * smaller than one group.
+ * 
+ * Keys are kept by a KeyStorage selected at compile time: std::string keys live in a single
+ * contiguous arena, trivially copyable keys are stored inline in the slot. When both Hash and
+ * KeyEqual define is_transparent (the default for std::string keys), every lookup accepts any
+ * type they accept, e.g. std::string_view or a C string, without constructing a Key.
+ * 
+ * Slots of keys kept outside the slot cache the low 32 bits of the key hash. Resizing then
+ * never reads or rehashes a key, and a fingerprint match whose cached hash differs is rejected
+ * before the key is compared. The string hash is selected by the Hash parameter, e.g.
+ * BasicStringHash<Xxh3Hash> or the seeded SeededStringHash; the default is wyhash.
+ * 
+ * @tparam Key The key type: std::string or a trivially copyable type.
+ * @tparam Value The mapped type; must be trivially copyable to save or load the table.
+ * @tparam Hash The hash functor. For std::string keys it must accept std::string_view.
+ * @tparam KeyEqual The equality functor. For std::string keys it must accept std::string_view.
  */
-class HashTable {
+template <class Key, class Value,
+          class Hash = typename DefaultHash<Key>::type,
+          class KeyEqual = typename DefaultKeyEqual<Key>::type>
+class BasicHashTable {
+    /**
+     * @brief True if lookups may use other types than Key.
+     */
+    static constexpr bool IS_TRANSPARENT = IsTransparent<Hash>::value && IsTransparent<KeyEqual>::value;
+
+    /**
+     * @brief The type a lookup argument of type K is passed as: K itself for transparent
+     * functors, otherwise it is converted to Key.
+     */
+    template <class K>
+    using LookupKey = typename std::conditional<IS_TRANSPARENT, K, Key>::type;
+
 public:
     /**
-     * @brief Constructs a new HashTable object.
+     * @brief How keys are presented by iterators and for_each: std::string_view for std::string
+     * keys, otherwise a const reference to the key.
+     */
+    typedef typename KeyStorage<Key>::View KeyView;
+
+    /**
+     * @class const_iterator
+     * @brief A forward iterator over the elements, in slot order.
      * 
-     * @param size The initial size of the hash table.
+     * Dereferencing yields a pair of views into the table, so iterating copies neither keys
+     * nor values. Iterators and the views they yield are invalidated by any modification.
      */
-    HashTable(int size);
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<KeyView, const Value&> value_type;  ///< The key and the value of an element.
+        typedef value_type reference;
+        typedef std::ptrdiff_t difference_type;
+
+        /**
+         * @struct pointer
+         * @brief Holds the element so that it->first and it->second work.
+         */
+        struct pointer {
+            value_type element;  ///< The element pointed to.
+            const value_type* operator->() const { return &element; }
+        };
+
+        /**
+         * @brief Creates an iterator that compares equal to no element.
+         */
+        const_iterator() : table(nullptr), index(0) {}
+
+        /**
+         * @brief Returns the element.
+         * 
+         * @return The key and the value of the element.
+         */
+        reference operator*() const { return value_type(key(), value()); }
+
+        /**
+         * @brief Gives access to the key and the value as it->first and it->second.
+         * 
+         * @return A proxy holding the element.
+         */
+        pointer operator->() const { return pointer{**this}; }
+
+        /**
+         * @brief Returns the key of the element.
+         * 
+         * @return The key, valid until the table is modified.
+         */
+        KeyView key() const { return table->keys.view(table->slots[index].key); }
+
+        /**
+         * @brief Returns the value of the element.
+         * 
+         * @return The value, valid until the table is modified.
+         */
+        const Value& value() const { return table->slots[index].value; }
+
+        /**
+         * @brief Advances to the next element.
+         * 
+         * @return This iterator.
+         */
+        const_iterator& operator++() {
+            ++index;
+            skip_free_slots();
+            return *this;
+        }
+
+        /**
+         * @brief Advances to the next element.
+         * 
+         * @return A copy of the iterator before it advanced.
+         */
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator& other) const { return index == other.index && table == other.table; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class BasicHashTable;
+
+        /**
+         * @brief Creates an iterator at the first element at or after a slot.
+         * 
+         * @param table The table.
+         * @param index The slot to start from.
+         */
+        const_iterator(const BasicHashTable* table, int index) : table(table), index(index) { skip_free_slots(); }
+
+        /**
+         * @brief Moves forward to the next slot holding an element, or to the end.
+         */
+        void skip_free_slots() {
+            while (index < table->size && table->ctrl[index] < 0) ++index;
+        }
+
+        const BasicHashTable* table;  ///< The table iterated over.
+        int index;                    ///< The current slot, or the table size at the end.
+    };
+
+    /**
+     * @struct ProbeStats
+     * @brief Histograms describing how well the keys are spread over the slots.
+     */
+    struct ProbeStats {
+        /**
+         * @brief probe_lengths[d] is the number of elements stored d slots after their home slot,
+         * i.e. found after probing d + 1 slots.
+         */
+        std::vector<int> probe_lengths;
+
+        /**
+         * @brief cluster_sizes[n] is the number of maximal runs of n consecutive non-empty slots
+         * (elements and tombstones), which a miss has to probe through.
+         */
+        std::vector<int> cluster_sizes;
+
+        /**
+         * @brief The average number of slots probed to find an element.
+         */
+        double average_probe_length;
+    };
+
+    /**
+     * @brief Constructs a new hash table.
+     * 
+     * @param size The initial size of the hash table, rounded up to the next power of two (and at
+     * least ControlGroup::WIDTH).
+     * @param max_load_factor The fraction of occupied slots (0, 1] above which the table grows.
+     * @param growth_factor The multiplier (> 1) applied to the capacity on every resize.
+     * @param max_tombstone_factor The fraction of slots (0, 1] holding tombstones above which
+     * the table is compacted.
+     * @param hasher The hash functor.
+     * @param key_equal The equality functor.
+     * @throw invalid_argument if any parameter is out of range.
+     */
+    BasicHashTable(int size, double max_load_factor = 0.7, double growth_factor = 2.0,
+                   double max_tombstone_factor = 0.25, const Hash& hasher = Hash(),
+                   const KeyEqual& key_equal = KeyEqual());
 
     /**
      * @brief Inserts a key-value pair into the hash table.
@@ -32,15 +224,43 @@ public:
      * @param key The key to be inserted.
      * @param value The value associated with the key.
      */
-    void insert(const string& key, int value);
+    template <class K>
+    void insert(const K& key, const Value& value);
+
+    /**
+     * @brief Adds a delta to the value associated with a key, inserting the key if it is missing.
+     * 
+     * The key is hashed and probed only once, which makes this the preferred way to count
+     * occurrences.
+     * 
+     * @param key The key whose value is incremented.
+     * @param delta The amount added to the value; a missing key starts from Value().
+     * @return The value associated with the key after the increment.
+     */
+    template <class K>
+    Value increment(const K& key, const Value& delta = Value(1));
+
+    /**
+     * @brief Returns a reference to the value associated with a key, inserting it if it is missing.
+     * 
+     * @param key The key to search for or insert.
+     * @param default_value The value stored if the key is inserted.
+     * @return A reference to the stored value, valid until the next insertion.
+     */
+    template <class K>
+    Value& find_or_insert(const K& key, const Value& default_value = Value());
 
     /**
      * @brief Removes a key-value pair from the hash table.
      * 
+     * The slot is marked as a tombstone so that other keys stay reachable; tombstones are
+     * purged once they exceed the configured fraction of slots.
+     * 
      * @param key The key to be removed.
      * @throw invalid_argument if the key is not found.
      */
-    void remove(const string& key);
+    template <class K>
+    void remove(const K& key);
 
     /**
      * @brief Retrieves the value associated with a key.
@@ -49,7 +269,123 @@ public:
      * @return The value associated with the key.
      * @throw invalid_argument if the key is not found.
      */
-    int get(const string& key) const;
+    template <class K>
+    Value get(const K& key) const;
+
+    /**
+     * @brief Retrieves the value associated with a key without throwing.
+     * 
+     * @param key The key to search for.
+     * @return A pointer to the stored value, or nullptr if the key is not found. The pointer is
+     * valid until the next insertion or removal.
+     */
+    template <class K>
+    const Value* try_get(const K& key) const;
+
+    /**
+     * @brief Inserts or updates a batch of key-value pairs, as insert() would one after another.
+     * 
+     * Keys are hashed PREFETCH_BATCH at a time and the home slot of each is prefetched before
+     * any of them is probed, so the cache misses of a batch overlap instead of following each
+     * other. This pays off once the table outgrows the cache.
+     * 
+     * @param keys The keys.
+     * @param values The value of every key.
+     * @param count The number of keys.
+     */
+    template <class K>
+    void insert_batch(const K* keys, const Value* values, size_t count);
+
+    /**
+     * @brief Adds a delta to the values of a batch of keys, as increment() would one after another.
+     * 
+     * The keys are hashed and prefetched like in insert_batch(); a key that occurs several times
+     * is incremented several times, and new keys are inserted in batch order.
+     * 
+     * @param keys The keys.
+     * @param count The number of keys.
+     * @param delta The amount added to the value of every key.
+     */
+    template <class K>
+    void increment_batch(const K* keys, size_t count, const Value& delta = Value(1));
+
+    /**
+     * @brief Looks up a batch of keys, as try_get() would one after another.
+     * 
+     * The keys are hashed and prefetched like in insert_batch().
+     * 
+     * @param keys The keys.
+     * @param count The number of keys.
+     * @param results Receives for every key a pointer to its value, or nullptr if it is not found.
+     * The pointers are valid until the next insertion or removal.
+     */
+    template <class K>
+    void get_batch(const K* keys, size_t count, const Value** results) const;
+
+    /**
+     * @brief Calls a function on every element, in insertion order for std::string keys and in
+     * slot order otherwise.
+     * 
+     * @param visit Called with the key (a std::string_view for std::string keys) and the value,
+     * both valid during the call. It must not modify the table.
+     */
+    template <class F>
+    void for_each(F visit) const;
+
+    /**
+     * @brief Returns an iterator to the first element, in slot order.
+     * 
+     * @return An iterator to the first element, or end() if the table is empty.
+     */
+    const_iterator begin() const;
+
+    /**
+     * @brief Returns the iterator past the last element.
+     * 
+     * @return The end iterator.
+     */
+    const_iterator end() const;
+
+    /**
+     * @brief Returns the elements with the largest values, largest first.
+     * 
+     * Only a compact index of the elements' slots is sorted, with a bounded partial sort, and only
+     * the returned elements are copied. Ties are broken by insertion order for std::string keys and
+     * by slot order otherwise. Passing the number of elements gives a full dump ordered by value.
+     * 
+     * @param n The maximum number of elements to return.
+     * @return At most n elements, ordered by decreasing value.
+     */
+    std::vector<pair<Key, Value>> top_k(size_t n) const;
+
+    /**
+     * @brief Returns iterators to all elements, sorted by a comparison of the elements.
+     * 
+     * @param less Called with two const_iterator::value_type elements; returns true if the first
+     * must be listed before the second, e.g. comparing their keys for an alphabetical dump.
+     * @return One iterator per element, in the requested order; invalidated by any modification.
+     */
+    template <class Compare>
+    std::vector<const_iterator> sorted(Compare less) const;
+
+    /**
+     * @brief Measures probe lengths and cluster sizes; takes time linear in the capacity.
+     * 
+     * @return The probe length and cluster size histograms.
+     */
+    ProbeStats get_probe_stats() const;
+
+    /**
+     * @brief Adds every element of another table to this one, summing the values of common keys.
+     * 
+     * Keys missing from this table are inserted in the other table's insertion order (std::string
+     * keys; other keys are visited in slot order). Merging tables that counted consecutive parts
+     * of an input, in input order, therefore yields the same first and last inserted elements as
+     * counting the whole input sequentially.
+     * 
+     * @param other The table to merge into this one.
+     */
+    void merge(const BasicHashTable& other);
 
     /**
      * @brief Returns the last inserted key-value pair.
@@ -57,7 +393,7 @@ public:
      * @return A pair containing the last inserted key and its value.
      * @throw runtime_error if the hash table is empty.
      */
-    pair<string, int> get_last() const;
+    pair<Key, Value> get_last() const;
 
     /**
      * @brief Returns the first inserted key-value pair.
@@ -65,23 +401,61 @@ public:
      * @return A pair containing the first inserted key and its value.
      * @throw runtime_error if the hash table is empty.
      */
-    pair<string, int> get_first() const;
+    pair<Key, Value> get_first() const;
 
     /**
-     * @brief Returns statistics about the hash table.
+     * @brief Returns statistics about the hash table in constant time.
      * 
      * @return A pair containing the number of occupied slots and the total size of the table.
      */
     pair<int, int> get_stats() const;
 
+    /**
+     * @brief Returns the current load factor of the hash table.
+     * 
+     * @return The number of elements divided by the number of slots.
+     */
+    double load_factor() const;
+
+    /**
+     * @brief Returns the hash functor, e.g. to freeze the table with the same seed.
+     * 
+     * @return A copy of the hash functor.
+     */
+    Hash hash_function() const;
+
+    /**
+     * @brief Returns the equality functor.
+     * 
+     * @return A copy of the equality functor.
+     */
+    KeyEqual key_eq() const;
+
+    /**
+     * @brief Returns an empty table with the capacity, resize parameters and functors of this one.
+     * 
+     * @return The empty table.
+     */
+    BasicHashTable empty_copy() const;
+
     /**
      * @brief Saves the current hash table to a file.
      * 
      * @param filename The name of the file to save the table.
-     * @throw runtime_error if the file cannot be opened.
+     * @throw runtime_error if the file cannot be opened or written.
      */
     void save_to_file(const string& filename) const;
 
+    /**
+     * @brief Writes a snapshot of the hash table, in the format of save_to_file, to a stream.
+     * 
+     * The snapshot is a frozen table: BasicFrozenHashTable can open it and query it in place.
+     * 
+     * @param out The stream to write to; the caller checks it for errors.
+     * @throw runtime_error if no perfect hash function is found for the keys.
+     */
+    void save(std::ostream& out) const;
+
     /**
      * @brief Loads the hash table from a file.
      * 
@@ -91,61 +465,292 @@ public:
     bool load_from_file(const string& filename);
 
 private:
+    typedef KeyStorage<Key> Storage;
+    typedef typename Storage::Ref KeyRef;
+
+    /**
+     * @brief Control byte marking a slot that has never held an element since the last rehash.
+     * 
+     * Probing stops at the first empty slot.
+     */
+    static constexpr int8_t EMPTY = ControlGroup::EMPTY;
+
+    /**
+     * @brief Control byte marking a slot whose element was removed (tombstone).
+     */
+    static constexpr int8_t DELETED = ControlGroup::DELETED;
+
+    /**
+     * @brief The number of keys of a batch operation hashed and prefetched ahead of probing.
+     * 
+     * Enough to keep the core's dozen or so outstanding cache misses busy, few enough that the
+     * prefetched lines are still cached when their key is probed.
+     */
+    static constexpr size_t PREFETCH_BATCH = 16;
+
+    /**
+     * @brief The number of seeds tried when building the perfect hash function of a snapshot.
+     */
+    static constexpr uint64_t PERFECT_HASH_ATTEMPTS = 8;
+
     /**
-     * @brief Resizes the hash table when it becomes full.
+     * @brief True if slots cache the hash of their key, i.e. rehashing would read the key storage.
      * 
-     * The table size is increased by a fixed amount and all existing keys are rehashed.
+     * 32 bits locate a key in any table, whose capacity is at most 2^30; the fingerprint is
+     * already kept in the control byte.
+     */
+    static constexpr bool CACHES_HASH = Storage::CACHES_HASH;
+
+    /**
+     * @struct CachedHash
+     * @brief The cached low 32 bits of the hash of a slot's key.
+     */
+    struct CachedHash {
+        uint32_t key_hash;  ///< The low 32 bits of the key hash.
+    };
+
+    /**
+     * @struct NoCachedHash
+     * @brief Takes no space in the slot, as an empty base.
+     */
+    struct NoCachedHash {};
+
+    /**
+     * @struct Slot
+     * @brief The payload of an occupied slot.
+     * 
+     * For std::string keys the slot only references the key bytes in the arena and caches the
+     * key hash, so the slot array stays compact (16 bytes for int values) and resizing never
+     * touches the arena.
+     */
+    struct Slot : std::conditional<CACHES_HASH, CachedHash, NoCachedHash>::type {
+        KeyRef key;   ///< The key, or its location in the key storage.
+        Value value;  ///< The value associated with the key.
+    };
+
+    /**
+     * @struct SavedSlot
+     * @brief A slot as written to a snapshot: hashes are not saved, as the hash may be seeded.
+     */
+    struct SavedSlot {
+        KeyRef key;   ///< The location of the key in the key blob, or the key itself.
+        Value value;  ///< The value associated with the key.
+    };
+
+    /**
+     * @brief Resizes the hash table once the load factor limit is reached.
+     * 
+     * The table size is multiplied by the growth factor (rounded up to a power of two)
+     * and all existing keys are rehashed.
      */
     void resize();
 
     /**
-     * @brief Computes the hash value for a given key.
+     * @brief Purges all tombstones by rehashing the live elements in place.
+     */
+    void compact();
+
+    /**
+     * @brief Rehashes all live elements into a fresh table with the given number of slots.
      * 
-     * @param key The key to hash.
-     * @param table_size The size of the table.
-     * @return The hash value (index) for the key.
+     * @param new_size The number of slots of the new table, which must be a power of two.
+     */
+    void rehash(int new_size);
+
+    /**
+     * @brief Finds the slot holding a key, or the free slot where it would be inserted.
+     * 
+     * @param key The key to search for.
+     * @param key_hash The full hash of the key.
+     * @param found Set to true if the key is present, false otherwise.
+     * @return The index of the slot holding the key, or of the first free slot on its probe sequence.
+     * @throw overflow_error if the table is full and the key is not present.
+     */
+    template <class K>
+    int find_slot(const K& key, size_t key_hash, bool& found) const;
+
+    /**
+     * @brief Hashes a batch of keys, prefetches their home slots and visits them in order.
+     * 
+     * @param batch The keys.
+     * @param count The number of keys.
+     * @param visit Called with the index of every key in the batch, the key as a LookupKey and
+     * its hash.
      */
-    int hash(const string& key, int table_size) const;
+    template <class K, class Visit>
+    void for_each_prefetched(const K* batch, size_t count, Visit visit) const;
+
+    /**
+     * @brief Finds the slot holding a key, inserting the key with a default value if it is missing.
+     * 
+     * @param key The key to search for or insert.
+     * @param key_hash The full hash of the key.
+     * @param default_value The value stored if the key is inserted.
+     * @return The index of the slot holding the key.
+     */
+    template <class K>
+    int find_or_insert_slot(const K& key, size_t key_hash, const Value& default_value);
+
+    /**
+     * @brief Extracts the initial slot index from a full hash value.
+     * 
+     * @param key_hash The full hash of the key.
+     * @param table_size The size of the table, which must be a power of two.
+     * @return The slot index at which probing starts.
+     */
+    static int slot_index(size_t key_hash, int table_size);
+
+    /**
+     * @brief Extracts the 7-bit fingerprint stored in the control byte from a full hash value.
+     * 
+     * @param key_hash The full hash of the key.
+     * @return The fingerprint, in the range [0, 127].
+     */
+    static int8_t fingerprint(size_t key_hash);
+
+    /**
+     * @brief Fills a slot, caching the key hash if slots cache it.
+     * 
+     * @param slot The slot.
+     * @param key The key reference.
+     * @param value The value.
+     * @param key_hash The full hash of the key.
+     */
+    static void fill_slot(Slot& slot, const KeyRef& key, const Value& value, size_t key_hash);
+
+    /**
+     * @brief Checks a slot's cached hash against a key hash; always true without a cache.
+     * 
+     * @param slot An occupied slot.
+     * @param key_hash The full hash of the key searched for.
+     * @return False only if the slot's key certainly differs.
+     */
+    static bool may_hold(const Slot& slot, size_t key_hash);
+
+    /**
+     * @brief Returns the hash of the key in an occupied slot, enough to compute its slot index.
+     * 
+     * @param index The slot.
+     * @return The cached low 32 bits of the hash, or the hash recomputed from the key.
+     */
+    size_t slot_hash(int index) const;
+
+    /**
+     * @brief Rounds a requested size up to the next power of two.
+     * 
+     * @param size The requested size.
+     * @return The smallest power of two that is greater than or equal to size (at least 1).
+     * @throw overflow_error if the result does not fit into an int.
+     */
+    static int round_up_to_power_of_two(int size);
+
+    /**
+     * @brief Recomputes the element count at which the next resize is triggered.
+     */
+    void update_resize_threshold();
 
     /**
      * @brief Resolves hash collisions using linear probing.
      * 
      * @param index The starting index of the probe.
      * @param table_size The size of the table.
-     * @param table_occupied The vector indicating whether a slot is occupied.
+     * @param table_ctrl The control bytes of the table, including the mirrored tail.
      * @return The next available index for insertion.
      */
-    int linear_probe(int index, int table_size, const vector<char>& table_occupied) const;
+    int linear_probe(int index, int table_size, const vector<int8_t>& table_ctrl) const;
+
+    /**
+     * @brief Sets the control byte of a slot, keeping the mirrored tail in sync.
+     * 
+     * @param table_ctrl The control bytes of the table.
+     * @param table_size The size of the table.
+     * @param index The slot whose control byte is set.
+     * @param value The new control byte.
+     */
+    static void set_ctrl(vector<int8_t>& table_ctrl, int table_size, int index, int8_t value);
+
+    /**
+     * @brief One control byte per slot: EMPTY, DELETED, or the 7-bit fingerprint of the key.
+     * 
+     * The first ControlGroup::WIDTH bytes are mirrored after the last slot so that any group
+     * can be loaded with a single unaligned read.
+     */
+    vector<int8_t> ctrl;
+
+    /**
+     * @brief The slot payloads, parallel to the control bytes.
+     */
+    vector<Slot> slots;
 
-    /** 
-     * @brief The hash table storing key-value pairs.
+    /**
+     * @brief The storage the slots' key references point into.
+     */
+    Storage keys;
+
+    /**
+     * @brief The hash functor.
      */
-    vector<pair<string, int>> table;
+    Hash hasher;
 
-    /** 
-     * @brief Vector indicating which slots are occupied.
+    /**
+     * @brief The equality functor.
      */
-    vector<char> occupied;
+    KeyEqual key_equal;
 
-    /** 
+    /**
      * @brief The index of the first inserted element.
      */
     int first_index;
 
-    /** 
+    /**
      * @brief The index of the last inserted element.
      */
     int last_index;
 
-    /** 
+    /**
      * @brief The current size of the hash table.
      */
     int size;
 
-    /** 
+    /**
      * @brief The current number of elements in the hash table.
      */
     int elements_count;
+
+    /**
+     * @brief The current number of tombstones left behind by removals.
+     */
+    int tombstone_count;
+
+    /**
+     * @brief The load factor above which the table is resized.
+     */
+    double max_load_factor;
+
+    /**
+     * @brief The multiplier applied to the table size on every resize.
+     */
+    double growth_factor;
+
+    /**
+     * @brief The fraction of slots holding tombstones above which the table is compacted.
+     */
+    double max_tombstone_factor;
+
+    /**
+     * @brief The used slot count (elements and tombstones) at which the next insertion triggers a resize.
+     */
+    int resize_threshold;
 };
 
+/**
+ * @brief The word count table: std::string keys with int values.
+ */
+typedef BasicHashTable<std::string, int> HashTable;
+
+#include "HashTable.tpp"
+
+// The word count table is instantiated once, in HashTable.cpp
+extern template class BasicHashTable<std::string, int>;
+
 #endif
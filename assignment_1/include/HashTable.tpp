@@ -0,0 +1,1056 @@
+// Implementation of the BasicHashTable class template, included by HashTable.h.
+
+#include "PerformanceTimer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <iostream>
+
+/**
+ * @brief Constructs a new hash table with a specified size and growth policy.
+ * 
+ * @param size The initial size of the hash table, rounded up to the next power of two.
+ * @param max_load_factor The fraction of occupied slots (0, 1] above which the table grows.
+ * @param growth_factor The multiplier (> 1) applied to the capacity on every resize.
+ * @param max_tombstone_factor The fraction of slots (0, 1] holding tombstones above which the
+ * table is compacted.
+ * @param hasher The hash functor.
+ * @param key_equal The equality functor.
+ * @throw invalid_argument if any parameter is out of range.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+BasicHashTable<Key, Value, Hash, KeyEqual>::BasicHashTable(int size, double max_load_factor, double growth_factor,
+                                                    double max_tombstone_factor, const Hash& hasher,
+                                                    const KeyEqual& key_equal)
+    : hasher(hasher), key_equal(key_equal), first_index(-1), last_index(-1), size(0), elements_count(0), tombstone_count(0),
+      max_load_factor(max_load_factor), growth_factor(growth_factor),
+      max_tombstone_factor(max_tombstone_factor), resize_threshold(0) {
+    if (size <= 0) {
+        throw std::invalid_argument("HashTable size must be positive");
+    }
+    if (!(max_load_factor > 0.0 && max_load_factor <= 1.0)) {
+        throw std::invalid_argument("HashTable max_load_factor must be in (0, 1]");
+    }
+    if (!(growth_factor > 1.0)) {
+        throw std::invalid_argument("HashTable growth_factor must be greater than 1");
+    }
+    if (!(max_tombstone_factor > 0.0 && max_tombstone_factor <= 1.0)) {
+        throw std::invalid_argument("HashTable max_tombstone_factor must be in (0, 1]");
+    }
+    // A group of control bytes must never wrap around more than once
+    this->size = round_up_to_power_of_two(std::max(size, static_cast<int>(ControlGroup::WIDTH)));
+    ctrl.assign(this->size + ControlGroup::WIDTH, EMPTY);
+    slots.assign(this->size, Slot());
+    update_resize_threshold();
+}
+
+/**
+ * @brief Rounds a requested size up to the next power of two.
+ * 
+ * @param size The requested size.
+ * @return The smallest power of two that is greater than or equal to size (at least 1).
+ * @throw overflow_error if the result does not fit into an int.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+int BasicHashTable<Key, Value, Hash, KeyEqual>::round_up_to_power_of_two(int size) {
+    const int max_power = 1 << 30;
+    if (size > max_power) {
+        throw std::overflow_error("HashTable size exceeds the maximum capacity");
+    }
+    int capacity = 1;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+/**
+ * @brief Recomputes the used slot count at which the next resize is triggered.
+ * 
+ * Both live elements and tombstones count as used, and at least one slot is always kept
+ * empty so that probing is guaranteed to terminate.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::update_resize_threshold() {
+    resize_threshold = static_cast<int>(max_load_factor * size);
+    if (resize_threshold >= size) {
+        resize_threshold = size - 1;
+    }
+}
+
+/**
+ * @brief Extracts the initial slot index from a full hash value.
+ * 
+ * @param key_hash The full hash of the key.
+ * @param table_size The size of the hash table, which must be a power of two.
+ * @return The slot index at which probing starts.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+int BasicHashTable<Key, Value, Hash, KeyEqual>::slot_index(size_t key_hash, int table_size) {
+    return static_cast<int>(key_hash & static_cast<size_t>(table_size - 1));
+}
+
+/**
+ * @brief Extracts the 7-bit fingerprint stored in the control byte from a full hash value.
+ * 
+ * The top bits are used so that the fingerprint is independent of the slot index.
+ * 
+ * @param key_hash The full hash of the key.
+ * @return The fingerprint, in the range [0, 127].
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+int8_t BasicHashTable<Key, Value, Hash, KeyEqual>::fingerprint(size_t key_hash) {
+    return static_cast<int8_t>(key_hash >> (std::numeric_limits<size_t>::digits - 7));
+}
+
+/**
+ * @brief Fills a slot, caching the key hash if slots cache it.
+ * 
+ * @param slot The slot.
+ * @param key The key reference.
+ * @param value The value.
+ * @param key_hash The full hash of the key.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::fill_slot(Slot& slot, const KeyRef& key, const Value& value, size_t key_hash) {
+    slot.key = key;
+    slot.value = value;
+    if constexpr (CACHES_HASH) {
+        slot.key_hash = static_cast<uint32_t>(key_hash);
+    }
+}
+
+/**
+ * @brief Checks a slot's cached hash against a key hash; always true without a cache.
+ * 
+ * @param slot An occupied slot.
+ * @param key_hash The full hash of the key searched for.
+ * @return False only if the slot's key certainly differs.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+bool BasicHashTable<Key, Value, Hash, KeyEqual>::may_hold(const Slot& slot, size_t key_hash) {
+    if constexpr (CACHES_HASH) {
+        return slot.key_hash == static_cast<uint32_t>(key_hash);
+    } else {
+        return true;
+    }
+}
+
+/**
+ * @brief Returns the hash of the key in an occupied slot, enough to compute its slot index.
+ * 
+ * @param index The slot.
+ * @return The cached low 32 bits of the hash, or the hash recomputed from the key.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+size_t BasicHashTable<Key, Value, Hash, KeyEqual>::slot_hash(int index) const {
+    if constexpr (CACHES_HASH) {
+        return slots[index].key_hash;
+    } else {
+        return hasher(keys.view(slots[index].key));
+    }
+}
+
+/**
+ * @brief Linear probing to resolve collisions.
+ * 
+ * The control bytes are scanned a whole group at a time, starting at the given index.
+ * 
+ * @param index The current index.
+ * @param table_size The size of the hash table.
+ * @param table_ctrl The control bytes of the hash table, including the mirrored tail.
+ * @return The next available index.
+ * @throw overflow_error if the table is full and no available slot is found.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+int BasicHashTable<Key, Value, Hash, KeyEqual>::linear_probe(int index, int table_size, const std::vector<int8_t>& table_ctrl) const {
+    for (int probed = 0; probed < table_size; probed += ControlGroup::WIDTH) {
+        ControlGroup group(table_ctrl.data() + index);
+        ControlGroup::Mask empty = group.match_empty();
+        if (empty) {
+            return (index + ControlGroup::lowest(empty)) & (table_size - 1);
+        }
+        index = (index + ControlGroup::WIDTH) & (table_size - 1);
+    }
+    throw std::overflow_error("HashTable is full during probing");
+}
+
+/**
+ * @brief Sets the control byte of a slot, keeping the mirrored tail in sync.
+ * 
+ * The first ControlGroup::WIDTH control bytes are copied after the last slot so that a group
+ * starting near the end of the table can be loaded without wrapping around.
+ * 
+ * @param table_ctrl The control bytes of the table.
+ * @param table_size The size of the table.
+ * @param index The slot whose control byte is set.
+ * @param value The new control byte.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::set_ctrl(std::vector<int8_t>& table_ctrl, int table_size, int index, int8_t value) {
+    table_ctrl[index] = value;
+    if (index < ControlGroup::WIDTH) {
+        table_ctrl[table_size + index] = value;
+    }
+}
+
+/**
+ * @brief Finds the slot holding a key, or the free slot where it would be inserted.
+ * 
+ * A single probe sequence is walked a group of control bytes at a time until either the key or
+ * an empty slot is found. All fingerprints of a group are compared at once, so slots that do
+ * not match are rejected without touching them; only on a fingerprint match are the slot and
+ * the key bytes compared. Tombstones are skipped, but the first one seen is returned as the
+ * insertion slot so that deleted slots get reused.
+ * 
+ * @param key The key to search for.
+ * @param key_hash The full hash of the key.
+ * @param found Set to true if the key is present, false otherwise.
+ * @return The index of the slot holding the key, or of the first free slot on its probe sequence.
+ * @throw overflow_error if the table is full and the key is not present.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+int BasicHashTable<Key, Value, Hash, KeyEqual>::find_slot(const K& key, size_t key_hash, bool& found) const {
+    const int8_t tag = fingerprint(key_hash);
+    const int mask = size - 1;
+    int index = slot_index(key_hash, size);
+    int first_tombstone = -1;
+
+    for (int probed = 0; probed < size; probed += ControlGroup::WIDTH) {
+        ControlGroup group(ctrl.data() + index);
+
+        for (ControlGroup::Mask match = group.match(tag); match; match &= match - 1) {
+            int candidate = (index + ControlGroup::lowest(match)) & mask;
+            if (may_hold(slots[candidate], key_hash) && key_equal(keys.view(slots[candidate].key), key)) {
+                found = true;
+                return candidate;
+            }
+        }
+
+        // Only tombstones before the first empty slot lie on the probe sequence
+        ControlGroup::Mask empty = group.match_empty();
+        if (first_tombstone == -1) {
+            ControlGroup::Mask deleted = ControlGroup::below(group.match_deleted(), empty);
+            if (deleted) {
+                first_tombstone = (index + ControlGroup::lowest(deleted)) & mask;
+            }
+        }
+        if (empty) {
+            found = false;
+            return first_tombstone != -1 ? first_tombstone : (index + ControlGroup::lowest(empty)) & mask;
+        }
+        index = (index + ControlGroup::WIDTH) & mask;
+    }
+    if (first_tombstone != -1) {
+        found = false;
+        return first_tombstone;
+    }
+    throw std::overflow_error("HashTable is full");
+}
+
+/**
+ * @brief Finds the slot holding a key, inserting the key with a default value if it is missing.
+ * 
+ * The table is only resized when a new key has to be inserted, in which case the probe is
+ * repeated on the resized table.
+ * 
+ * @param key The key to search for or insert.
+ * @param key_hash The full hash of the key.
+ * @param default_value The value stored if the key is inserted.
+ * @return The index of the slot holding the key.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+int BasicHashTable<Key, Value, Hash, KeyEqual>::find_or_insert_slot(const K& key, size_t key_hash,
+                                                                    const Value& default_value) {
+    bool found;
+    int index = find_slot(key, key_hash, found);
+    if (found) {
+        return index;
+    }
+
+    if (ctrl[index] == DELETED) {
+        // Reusing a tombstone does not consume an empty slot
+        tombstone_count--;
+    } else if (elements_count + tombstone_count >= resize_threshold) {
+        // Grow once the load factor limit is reached, or just purge tombstones if they
+        // account for most of the used slots
+        if (elements_count * 2 >= resize_threshold) {
+            resize();
+        } else {
+            compact();
+        }
+        index = find_slot(key, key_hash, found);
+    }
+
+    // Insert new entry
+    fill_slot(slots[index], keys.store(key), default_value, key_hash);
+    set_ctrl(ctrl, size, index, fingerprint(key_hash));
+    elements_count++;
+    if (first_index == -1) {
+        first_index = index;
+    }
+    last_index = index;
+    return index;
+}
+
+/**
+ * @brief Inserts a key-value pair into the hash table.
+ * 
+ * @param key The key to be inserted.
+ * @param value The value associated with the key.
+ * @throw overflow_error if the table is full.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::insert(const K& key, const Value& value) {
+    PERF_SCOPE("hash_table.insert");
+    const LookupKey<K>& lookup_key = key;
+    int index = find_or_insert_slot(lookup_key, hasher(lookup_key), value);
+    // Update existing entry
+    slots[index].value = value;
+}
+
+/**
+ * @brief Adds a delta to the value associated with a key, inserting the key if it is missing.
+ * 
+ * @param key The key whose value is incremented.
+ * @param delta The amount added to the value; a missing key starts from Value().
+ * @return The value associated with the key after the increment.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+Value BasicHashTable<Key, Value, Hash, KeyEqual>::increment(const K& key, const Value& delta) {
+    PERF_SCOPE("hash_table.increment");
+    const LookupKey<K>& lookup_key = key;
+    int index = find_or_insert_slot(lookup_key, hasher(lookup_key), Value());
+    slots[index].value += delta;
+    return slots[index].value;
+}
+
+/**
+ * @brief Returns a reference to the value associated with a key, inserting it if it is missing.
+ * 
+ * @param key The key to search for or insert.
+ * @param default_value The value stored if the key is inserted.
+ * @return A reference to the stored value, valid until the next insertion.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+Value& BasicHashTable<Key, Value, Hash, KeyEqual>::find_or_insert(const K& key, const Value& default_value) {
+    const LookupKey<K>& lookup_key = key;
+    return slots[find_or_insert_slot(lookup_key, hasher(lookup_key), default_value)].value;
+}
+
+/**
+ * @brief Removes a key-value pair from the hash table.
+ * 
+ * The slot is turned into a tombstone so that keys further along the probe sequence stay
+ * reachable. Once tombstones exceed the configured fraction of slots, the table is compacted.
+ * 
+ * @param key The key to be removed.
+ * @throw invalid_argument if the key is not found.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::remove(const K& key) {
+    const LookupKey<K>& lookup_key = key;
+    bool found;
+    int index = find_slot(lookup_key, hasher(lookup_key), found);
+    if (!found) {
+        throw std::invalid_argument("Key not found");
+    }
+
+    // Arena key bytes stay in place until the next rehash reclaims them
+    set_ctrl(ctrl, size, index, DELETED);
+    keys.release(slots[index].key);
+    slots[index] = Slot();
+    elements_count--;
+    tombstone_count++;
+    if (index == first_index) first_index = -1;
+    if (index == last_index) last_index = -1;
+
+    if (tombstone_count > max_tombstone_factor * size) {
+        compact();
+    }
+}
+
+/**
+ * @brief Retrieves the value associated with a key without throwing.
+ * 
+ * @param key The key to search for.
+ * @return A pointer to the stored value, or nullptr if the key is not found. The pointer is
+ * valid until the next insertion or removal.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+const Value* BasicHashTable<Key, Value, Hash, KeyEqual>::try_get(const K& key) const {
+    PERF_SCOPE("hash_table.get");
+    const LookupKey<K>& lookup_key = key;
+    bool found;
+    int index = find_slot(lookup_key, hasher(lookup_key), found);
+    return found ? &slots[index].value : nullptr;
+}
+
+/**
+ * @brief Retrieves the value associated with a key.
+ * 
+ * @param key The key to search for.
+ * @return The value associated with the key.
+ * @throw invalid_argument if the key is not found.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+Value BasicHashTable<Key, Value, Hash, KeyEqual>::get(const K& key) const {
+    const Value* value = try_get(key);
+    if (!value) {
+        throw std::invalid_argument("Key not found");
+    }
+    return *value;
+}
+
+/**
+ * @brief Hashes a batch of keys, prefetches their home slots and visits them in order.
+ * 
+ * A group of PREFETCH_BATCH keys is hashed first, and the control bytes and slot at the home
+ * index of each are prefetched. For tables with cached hashes the stored key of the first
+ * fingerprint match is prefetched next, and only then is every key of the group visited. A
+ * visit may resize the table, in which case the later prefetches of the group were wasted but
+ * the hashes stay valid.
+ * 
+ * @param batch The keys.
+ * @param count The number of keys.
+ * @param visit Called with the index of every key in the batch, the key as a LookupKey and
+ * its hash.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K, class Visit>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::for_each_prefetched(const K* batch, size_t count, Visit visit) const {
+    size_t key_hashes[PREFETCH_BATCH];
+    for (size_t begin = 0; begin < count; begin += PREFETCH_BATCH) {
+        const size_t end = std::min(count, begin + PREFETCH_BATCH);
+        for (size_t i = begin; i < end; ++i) {
+            const LookupKey<K>& lookup_key = batch[i];
+            key_hashes[i - begin] = hasher(lookup_key);
+            const int index = slot_index(key_hashes[i - begin], size);
+            __builtin_prefetch(ctrl.data() + index);
+            __builtin_prefetch(slots.data() + index);
+        }
+        // The keys of the first fingerprint matches are the next misses; start them together too
+        if constexpr (CACHES_HASH) {
+            for (size_t i = begin; i < end; ++i) {
+                const int index = slot_index(key_hashes[i - begin], size);
+                ControlGroup::Mask match = ControlGroup(ctrl.data() + index).match(fingerprint(key_hashes[i - begin]));
+                if (match) {
+                    keys.prefetch(slots[(index + ControlGroup::lowest(match)) & (size - 1)].key);
+                }
+            }
+        }
+        for (size_t i = begin; i < end; ++i) {
+            visit(i, static_cast<const LookupKey<K>&>(batch[i]), key_hashes[i - begin]);
+        }
+    }
+}
+
+/**
+ * @brief Inserts or updates a batch of key-value pairs, as insert() would one after another.
+ * 
+ * @param keys The keys.
+ * @param values The value of every key.
+ * @param count The number of keys.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::insert_batch(const K* keys, const Value* values, size_t count) {
+    PERF_SCOPE("hash_table.insert_batch");
+    for_each_prefetched(keys, count, [this, values](size_t i, const auto& key, size_t key_hash) {
+        slots[find_or_insert_slot(key, key_hash, values[i])].value = values[i];
+    });
+}
+
+/**
+ * @brief Adds a delta to the values of a batch of keys, as increment() would one after another.
+ * 
+ * @param keys The keys.
+ * @param count The number of keys.
+ * @param delta The amount added to the value of every key.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::increment_batch(const K* keys, size_t count, const Value& delta) {
+    PERF_SCOPE("hash_table.increment_batch");
+    for_each_prefetched(keys, count, [this, &delta](size_t, const auto& key, size_t key_hash) {
+        slots[find_or_insert_slot(key, key_hash, Value())].value += delta;
+    });
+}
+
+/**
+ * @brief Looks up a batch of keys, as try_get() would one after another.
+ * 
+ * @param keys The keys.
+ * @param count The number of keys.
+ * @param results Receives for every key a pointer to its value, or nullptr if it is not found.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class K>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::get_batch(const K* keys, size_t count, const Value** results) const {
+    PERF_SCOPE("hash_table.get_batch");
+    for_each_prefetched(keys, count, [this, results](size_t i, const auto& key, size_t key_hash) {
+        bool found;
+        int index = find_slot(key, key_hash, found);
+        results[i] = found ? &slots[index].value : nullptr;
+    });
+}
+
+/**
+ * @brief Calls a function on every element, in insertion order for std::string keys and in
+ * slot order otherwise.
+ * 
+ * @param visit Called with the key and the value of every element.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class F>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::for_each(F visit) const {
+    std::vector<int> live;
+    live.reserve(elements_count);
+    for (int i = 0; i < size; ++i) {
+        if (ctrl[i] >= 0) live.push_back(i);
+    }
+
+    // The key storage knows the order in which keys were inserted
+    std::stable_sort(live.begin(), live.end(), [this](int a, int b) {
+        return keys.inserted_before(slots[a].key, slots[b].key);
+    });
+    for (int i : live) {
+        visit(keys.view(slots[i].key), slots[i].value);
+    }
+}
+
+/**
+ * @brief Adds every element of another table to this one, summing the values of common keys.
+ * 
+ * @param other The table to merge into this one.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::merge(const BasicHashTable& other) {
+    other.for_each([this](typename Storage::View key, const Value& value) {
+        increment(key, value);
+    });
+}
+
+/**
+ * @brief Returns an iterator to the first element, in slot order.
+ * 
+ * @return An iterator to the first element, or end() if the table is empty.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+typename BasicHashTable<Key, Value, Hash, KeyEqual>::const_iterator
+BasicHashTable<Key, Value, Hash, KeyEqual>::begin() const {
+    return const_iterator(this, 0);
+}
+
+/**
+ * @brief Returns the iterator past the last element.
+ * 
+ * @return The end iterator.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+typename BasicHashTable<Key, Value, Hash, KeyEqual>::const_iterator
+BasicHashTable<Key, Value, Hash, KeyEqual>::end() const {
+    return const_iterator(this, size);
+}
+
+/**
+ * @brief Returns the elements with the largest values, largest first.
+ * 
+ * partial_sort keeps a heap of the n best candidates, so the cost is O(elements * log n) and
+ * only the 4-byte slot indices are moved around.
+ * 
+ * @param n The maximum number of elements to return.
+ * @return At most n elements, ordered by decreasing value.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+std::vector<std::pair<Key, Value>> BasicHashTable<Key, Value, Hash, KeyEqual>::top_k(size_t n) const {
+    std::vector<int> live;
+    live.reserve(elements_count);
+    for (int i = 0; i < size; ++i) {
+        if (ctrl[i] >= 0) live.push_back(i);
+    }
+
+    size_t count = std::min(n, live.size());
+    std::partial_sort(live.begin(), live.begin() + count, live.end(), [this](int a, int b) {
+        if (slots[b].value < slots[a].value) return true;
+        if (slots[a].value < slots[b].value) return false;
+        if (keys.inserted_before(slots[a].key, slots[b].key)) return true;
+        if (keys.inserted_before(slots[b].key, slots[a].key)) return false;
+        return a < b;
+    });
+
+    std::vector<std::pair<Key, Value>> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        result.emplace_back(keys.materialize(slots[live[i]].key), slots[live[i]].value);
+    }
+    return result;
+}
+
+/**
+ * @brief Returns iterators to all elements, sorted by a comparison of the elements.
+ * 
+ * @param less Returns true if its first element must be listed before its second.
+ * @return One iterator per element, in the requested order.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+template <class Compare>
+std::vector<typename BasicHashTable<Key, Value, Hash, KeyEqual>::const_iterator>
+BasicHashTable<Key, Value, Hash, KeyEqual>::sorted(Compare less) const {
+    std::vector<const_iterator> result;
+    result.reserve(elements_count);
+    for (const_iterator it = begin(); it != end(); ++it) {
+        result.push_back(it);
+    }
+    std::sort(result.begin(), result.end(), [&less](const const_iterator& a, const const_iterator& b) {
+        return less(*a, *b);
+    });
+    return result;
+}
+
+/**
+ * @brief Measures probe lengths and cluster sizes.
+ * 
+ * The probe length of an element is its distance from its home slot. A cluster is a maximal run
+ * of non-empty slots; runs wrap around the end of the table, so counting starts after an empty
+ * slot.
+ * 
+ * @return The probe length and cluster size histograms.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+typename BasicHashTable<Key, Value, Hash, KeyEqual>::ProbeStats
+BasicHashTable<Key, Value, Hash, KeyEqual>::get_probe_stats() const {
+    ProbeStats stats;
+    stats.average_probe_length = 0.0;
+    int mask = size - 1;
+    long long total_probes = 0;
+    for (int i = 0; i < size; ++i) {
+        if (ctrl[i] < 0) continue;
+        int distance = (i - slot_index(slot_hash(i), size)) & mask;
+        if (distance >= static_cast<int>(stats.probe_lengths.size())) {
+            stats.probe_lengths.resize(distance + 1, 0);
+        }
+        stats.probe_lengths[distance]++;
+        total_probes += distance + 1;
+    }
+    if (elements_count > 0) {
+        stats.average_probe_length = static_cast<double>(total_probes) / elements_count;
+    }
+
+    int start = 0;
+    while (start < size && ctrl[start] != EMPTY) ++start;
+    if (start == size) {
+        // No empty slot at all: the whole table is one cluster
+        stats.cluster_sizes.assign(size + 1, 0);
+        stats.cluster_sizes[size] = 1;
+        return stats;
+    }
+    int run = 0;
+    for (int step = 1; step <= size; ++step) {
+        int i = (start + step) & mask;
+        if (ctrl[i] != EMPTY) {
+            ++run;
+            continue;
+        }
+        if (run > 0) {
+            if (run >= static_cast<int>(stats.cluster_sizes.size())) {
+                stats.cluster_sizes.resize(run + 1, 0);
+            }
+            stats.cluster_sizes[run]++;
+        }
+        run = 0;
+    }
+    return stats;
+}
+
+/**
+ * @brief Gets statistics about the hash table.
+ * 
+ * Every slot holding an element is counted by elements_count, so no scan is needed.
+ * 
+ * @return A pair containing the number of occupied slots and the size of the table.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+std::pair<int, int> BasicHashTable<Key, Value, Hash, KeyEqual>::get_stats() const {
+    return {elements_count, size};
+}
+
+/**
+ * @brief Gets the current load factor of the hash table.
+ * 
+ * @return The number of elements divided by the number of slots.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+double BasicHashTable<Key, Value, Hash, KeyEqual>::load_factor() const {
+    return static_cast<double>(elements_count) / size;
+}
+
+/**
+ * @brief Returns the hash functor, e.g. to freeze the table with the same seed.
+ * 
+ * @return A copy of the hash functor.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+Hash BasicHashTable<Key, Value, Hash, KeyEqual>::hash_function() const {
+    return hasher;
+}
+
+/**
+ * @brief Returns the equality functor.
+ * 
+ * @return A copy of the equality functor.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+KeyEqual BasicHashTable<Key, Value, Hash, KeyEqual>::key_eq() const {
+    return key_equal;
+}
+
+/**
+ * @brief Returns an empty table with the capacity, resize parameters and functors of this one.
+ * 
+ * @return The empty table.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+BasicHashTable<Key, Value, Hash, KeyEqual> BasicHashTable<Key, Value, Hash, KeyEqual>::empty_copy() const {
+    return BasicHashTable(size, max_load_factor, growth_factor, max_tombstone_factor, hasher, key_equal);
+}
+
+/**
+ * @brief Retrieves the last inserted key-value pair.
+ * 
+ * @return A pair containing the last inserted key and its value.
+ * @throw runtime_error if the hash table is empty.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+std::pair<Key, Value> BasicHashTable<Key, Value, Hash, KeyEqual>::get_last() const {
+    if (last_index == -1) throw std::runtime_error("HashTable is empty");
+    return {keys.materialize(slots[last_index].key), slots[last_index].value};
+}
+
+/**
+ * @brief Retrieves the first inserted key-value pair.
+ * 
+ * @return A pair containing the first inserted key and its value.
+ * @throw runtime_error if the hash table is empty.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+std::pair<Key, Value> BasicHashTable<Key, Value, Hash, KeyEqual>::get_first() const {
+    if (first_index == -1) throw std::runtime_error("HashTable is empty");
+    return {keys.materialize(slots[first_index].key), slots[first_index].value};
+}
+
+/**
+ * @brief Resizes the hash table once the load factor limit is reached.
+ * 
+ * The table size is multiplied by the growth factor and rounded up to the next power of two,
+ * so that the total rehashing cost stays linear in the number of insertions. All existing
+ * keys are rehashed.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::resize() {
+    PERF_COUNT("hash_table.resizes", 1);
+    PerformanceTimer timer;
+    timer.start();
+
+    int new_size = round_up_to_power_of_two(static_cast<int>(std::ceil(size * growth_factor)));
+    if (new_size <= size) {
+        new_size = round_up_to_power_of_two(size + 1);
+    }
+    rehash(new_size);
+
+    double time_taken = timer.stop();
+    std::cout << "HashTable resized to " << size << " slots in " << time_taken << " ms." << std::endl;
+}
+
+/**
+ * @brief Purges all tombstones by rehashing the live elements into a table of the same size.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::compact() {
+    PerformanceTimer timer;
+    timer.start();
+
+    int purged = tombstone_count;
+    rehash(size);
+
+    double time_taken = timer.stop();
+    std::cout << "HashTable compacted, purged " << purged << " tombstones in " << time_taken << " ms." << std::endl;
+}
+
+/**
+ * @brief Rehashes all live elements into a fresh table with the given number of slots.
+ * 
+ * Keys stay in their storage, so only the control bytes and the compact slots are rebuilt. Once
+ * removed keys account for more than half of a string key arena, the arena is rebuilt as well,
+ * keeping the live keys in insertion order.
+ * 
+ * @param new_size The number of slots of the new table, which must be a power of two.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::rehash(int new_size) {
+    if (keys.wants_compaction()) {
+        std::vector<KeyRef*> live;
+        live.reserve(elements_count);
+        for (int i = 0; i < size; ++i) {
+            if (ctrl[i] >= 0) live.push_back(&slots[i].key);
+        }
+        keys.compact(live);
+    }
+
+    std::vector<int8_t> new_ctrl(new_size + ControlGroup::WIDTH, EMPTY);
+    std::vector<Slot> new_slots(new_size, Slot());
+
+    int new_first_index = -1;
+    int new_last_index = -1;
+
+    // Rehash all existing keys into the new table
+    for (int i = 0; i < size; ++i) {
+        if (ctrl[i] >= 0) {
+            int new_index = linear_probe(slot_index(slot_hash(i), new_size), new_size, new_ctrl);
+            new_slots[new_index] = std::move(slots[i]);
+            set_ctrl(new_ctrl, new_size, new_index, ctrl[i]);
+
+            // Update new_first_index and new_last_index accordingly
+            if (i == first_index) {
+                new_first_index = new_index;  // Track the new index for the first inserted element
+            }
+            if (i == last_index) {
+                new_last_index = new_index;  // Track the new index for the last inserted element
+            }
+        }
+    }
+
+    // Replace old table with new table
+    ctrl = std::move(new_ctrl);
+    slots = std::move(new_slots);
+    size = new_size;
+    tombstone_count = 0;
+    update_resize_threshold();
+
+    // Update the first and last index in the resized table
+    first_index = new_first_index;
+    last_index = new_last_index;
+}
+
+/**
+ * @brief Saves the hash table to a file.
+ * 
+ * @param filename The name of the file where the hash table will be saved.
+ * @throw runtime_error if the file cannot be opened or written.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::save_to_file(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file to save hash table");
+    }
+
+    std::cout << "Saving hash table to file..." << std::endl;
+    save(file);
+    if (!file) {
+        throw std::runtime_error("Could not write hash table to file");
+    }
+    std::cout << "Hash table saved with " << elements_count << " elements." << std::endl;
+    file.close();
+}
+
+/**
+ * @brief Writes a snapshot of the hash table to a stream.
+ * 
+ * The snapshot holds only the live entries, as a frozen table: a minimal perfect hash function
+ * is built over the keys and every entry is written to the slot it assigns, so that
+ * BasicFrozenHashTable can query a memory-mapped snapshot in place. The key blob keeps std::string
+ * keys in insertion order. Every section is written with a single call; see SnapshotFormat.h for
+ * the layout.
+ * 
+ * @param out The stream to write to.
+ * @throw runtime_error if no perfect hash function is found, i.e. the hash functor maps two keys
+ * to the same value.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+void BasicHashTable<Key, Value, Hash, KeyEqual>::save(std::ostream& out) const {
+    static_assert(std::is_trivially_copyable<Value>::value, "Only trivially copyable values can be saved");
+    static_assert(IsSnapshotHash<Hash>::value, "A 32-bit hash cannot build the perfect hash of a snapshot");
+
+    std::vector<int> live;
+    live.reserve(elements_count);
+    for (int i = 0; i < size; ++i) {
+        if (ctrl[i] >= 0) live.push_back(i);
+    }
+    std::stable_sort(live.begin(), live.end(), [this](int a, int b) {
+        return keys.inserted_before(slots[a].key, slots[b].key);
+    });
+
+    std::vector<KeyRef> refs(live.size());
+    std::vector<size_t> key_hashes(live.size());
+    for (size_t i = 0; i < live.size(); ++i) {
+        refs[i] = slots[live[i]].key;
+        key_hashes[i] = hasher(keys.view(refs[i]));
+    }
+
+    // A failed seed is unlikely; a few independent attempts rule out bad luck
+    std::vector<uint32_t> pilots;
+    uint64_t seed = 0;
+    while (!PerfectHash::build(key_hashes, seed, pilots)) {
+        if (++seed == PERFECT_HASH_ATTEMPTS) {
+            throw std::runtime_error("Could not build the perfect hash of the hash table snapshot");
+        }
+    }
+    PerfectHash function(seed, pilots.size(), live.size(), pilots.data());
+
+    SnapshotHeader header = {};
+    std::copy(HASH_TABLE_SNAPSHOT_MAGIC, HASH_TABLE_SNAPSHOT_MAGIC + sizeof(header.magic), header.magic);
+    header.version = HASH_TABLE_SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER_MARK;
+    header.header_size = sizeof(SnapshotHeader);
+    header.key_size = Storage::SNAPSHOT_KEY_SIZE;
+    header.value_size = sizeof(Value);
+    header.capacity = size;
+    header.count = live.size();
+    header.key_bytes = keys.blob_size(refs);
+    header.first = -1;
+    header.last = -1;
+
+    PerfectHashHeader perfect_hash_header = {};
+    perfect_hash_header.seed = seed;
+    perfect_hash_header.bucket_count = pilots.size();
+    perfect_hash_header.slot_size = sizeof(SavedSlot);
+
+    std::vector<KeyRef> relocated = keys.relocate(refs);
+    std::vector<SavedSlot> frozen_slots(live.size(), SavedSlot());
+    for (size_t i = 0; i < live.size(); ++i) {
+        uint64_t position = function(key_hashes[i]);
+        frozen_slots[position] = SavedSlot{relocated[i], slots[live[i]].value};
+        if (live[i] == first_index) header.first = position;
+        if (live[i] == last_index) header.last = position;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&perfect_hash_header), sizeof(perfect_hash_header));
+    uint64_t offset = sizeof(header) + sizeof(perfect_hash_header);
+    out.write(reinterpret_cast<const char*>(pilots.data()), pilots.size() * sizeof(uint32_t));
+    offset = write_snapshot_padding(out, offset + pilots.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(frozen_slots.data()), frozen_slots.size() * sizeof(SavedSlot));
+    offset = write_snapshot_padding(out, offset + frozen_slots.size() * sizeof(SavedSlot));
+    keys.save_blob(out, refs, offset);
+}
+
+/**
+ * @brief Loads the hash table from a file.
+ * 
+ * The slots and the key blob of the snapshot are each read with one bulk read, the key blob
+ * straight into the key storage, and the table is rebuilt by hashing each key into a table that
+ * is already large enough; no key is compared or copied individually. The perfect hash function
+ * is not needed here, so a snapshot stays loadable if the hash functor changes. The table is left
+ * untouched if the file is missing, truncated or was written with another format, byte order,
+ * key type or value type.
+ * 
+ * Keys are inserted in slot order; since the key blob keeps std::string keys in insertion order,
+ * the loaded table still knows which key was inserted before which.
+ * 
+ * @param filename The name of the file to load the hash table from.
+ * @return True if the hash table was loaded successfully, otherwise false.
+ */
+template <class Key, class Value, class Hash, class KeyEqual>
+bool BasicHashTable<Key, Value, Hash, KeyEqual>::load_from_file(const std::string& filename) {
+    static_assert(std::is_trivially_copyable<Value>::value, "Only trivially copyable values can be loaded");
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;  // File doesn't exist
+    }
+    uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    std::cout << "Loading hash table from file..." << std::endl;
+
+    SnapshotHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || !std::equal(header.magic, header.magic + sizeof(header.magic), HASH_TABLE_SNAPSHOT_MAGIC)) {
+        std::cerr << "Not a hash table snapshot: " << filename << std::endl;
+        return false;
+    }
+    if (header.version != HASH_TABLE_SNAPSHOT_VERSION || header.byte_order != SNAPSHOT_BYTE_ORDER_MARK ||
+        header.header_size != sizeof(SnapshotHeader)) {
+        std::cerr << "Unsupported hash table snapshot version or byte order." << std::endl;
+        return false;
+    }
+    PerfectHashHeader perfect_hash_header;
+    file.read(reinterpret_cast<char*>(&perfect_hash_header), sizeof(perfect_hash_header));
+    if (!file || header.key_size != Storage::SNAPSHOT_KEY_SIZE || header.value_size != sizeof(Value) ||
+        perfect_hash_header.slot_size != sizeof(SavedSlot)) {
+        std::cerr << "Hash table snapshot key or value type does not match." << std::endl;
+        return false;
+    }
+
+    // Reject counts that the file cannot hold before allocating anything
+    if (header.count > file_size / sizeof(SavedSlot) || header.key_bytes > file_size ||
+        perfect_hash_header.bucket_count != PerfectHash::bucket_count_for(header.count) ||
+        header.count > static_cast<uint64_t>(std::numeric_limits<int>::max() / 2) ||
+        (header.first >= static_cast<int64_t>(header.count)) || (header.last >= static_cast<int64_t>(header.count))) {
+        std::cerr << "Hash table snapshot is corrupt." << std::endl;
+        return false;
+    }
+
+    // Keep the saved capacity, growing it if the entries would not fit under the load limit
+    int new_size = round_up_to_power_of_two(static_cast<int>(std::min<uint64_t>(
+        std::max<uint64_t>(header.capacity, ControlGroup::WIDTH), 1 << 30)));
+    while (header.count + 1 > max_load_factor * new_size) {
+        new_size = round_up_to_power_of_two(new_size + 1);
+    }
+
+    // The pilots only serve frozen lookups
+    uint64_t offset = sizeof(header) + sizeof(perfect_hash_header);
+    uint64_t pilot_bytes = perfect_hash_header.bucket_count * sizeof(uint32_t);
+    file.ignore(pilot_bytes);
+    offset = skip_snapshot_padding(file, offset + pilot_bytes);
+
+    std::vector<SavedSlot> saved_slots(header.count);
+    file.read(reinterpret_cast<char*>(saved_slots.data()), saved_slots.size() * sizeof(SavedSlot));
+    offset = skip_snapshot_padding(file, offset + saved_slots.size() * sizeof(SavedSlot));
+    Storage new_keys;
+    if (!file || !new_keys.load_blob(file, header.key_bytes, offset)) {
+        std::cerr << "Error reading hash table snapshot." << std::endl;
+        return false;
+    }
+
+    std::vector<int8_t> new_ctrl(new_size + ControlGroup::WIDTH, EMPTY);
+    std::vector<Slot> new_slots(new_size, Slot());
+    int new_first_index = -1;
+    int new_last_index = -1;
+    for (size_t i = 0; i < saved_slots.size(); ++i) {
+        if (!Storage::fits_blob(saved_slots[i].key, header.key_bytes)) {
+            std::cerr << "Hash table snapshot is corrupt." << std::endl;
+            return false;
+        }
+        size_t key_hash = hasher(new_keys.view(saved_slots[i].key));
+        int index = linear_probe(slot_index(key_hash, new_size), new_size, new_ctrl);
+        fill_slot(new_slots[index], saved_slots[i].key, saved_slots[i].value, key_hash);
+        set_ctrl(new_ctrl, new_size, index, fingerprint(key_hash));
+        if (static_cast<int64_t>(i) == header.first) new_first_index = index;
+        if (static_cast<int64_t>(i) == header.last) new_last_index = index;
+    }
+
+    ctrl = std::move(new_ctrl);
+    slots = std::move(new_slots);
+    keys = std::move(new_keys);
+    size = new_size;
+    elements_count = static_cast<int>(header.count);
+    tombstone_count = 0;
+    first_index = new_first_index;
+    last_index = new_last_index;
+    update_resize_threshold();
+    std::cout << "Hash table loaded with " << elements_count << " elements." << std::endl;
+
+    file.close();
+    return true;
+}
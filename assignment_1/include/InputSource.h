@@ -0,0 +1,134 @@
+#ifndef INPUTSOURCE_H
+#define INPUTSOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class InputSource
+ * @brief A read-only input file delivered in chunks, memory-mapped when possible.
+ * 
+ * Regular files are mapped with mmap and advised for sequential access, so chunks are plain views
+ * into the page cache and no data is copied. Anything that cannot be mapped, such as a pipe or a
+ * FIFO, is streamed with read() into a single reusable buffer instead.
+ * 
+ * Consumers that need several views of the same data (e.g. a checksum and a tokenizer) should
+ * process each chunk fully before asking for the next one, so the input is only touched once.
+ */
+class InputSource {
+public:
+    /**
+     * @brief The number of bytes delivered per chunk; small enough to stay in cache while
+     * several consumers process it.
+     */
+    static constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+    /**
+     * @brief Opens an input file.
+     * 
+     * @param path The path of the file to read.
+     */
+    explicit InputSource(const std::string& path);
+
+    /**
+     * @brief Unmaps and closes the file.
+     */
+    ~InputSource();
+
+    InputSource(const InputSource&) = delete;
+    InputSource& operator=(const InputSource&) = delete;
+
+    /**
+     * @brief Tells whether the file was opened successfully.
+     * 
+     * @return True if chunks can be read.
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Tells whether the file is memory-mapped, and can therefore be rewound.
+     * 
+     * @return True if the file is memory-mapped.
+     */
+    bool is_mapped() const;
+
+    /**
+     * @brief Returns the next chunk of the input.
+     * 
+     * @param data Receives a pointer to the chunk, valid until the next call.
+     * @return The number of bytes in the chunk, or 0 at the end of the input.
+     * @throw runtime_error if reading from a streamed input fails.
+     */
+    size_t next(const char*& data);
+
+    /**
+     * @brief Restarts a memory-mapped input from its first byte.
+     * 
+     * @return True on success, false if the input is streamed and cannot be read again.
+     */
+    bool rewind();
+
+    /**
+     * @brief Returns the size of the input.
+     * 
+     * @return The size of the file if it is memory-mapped, otherwise the number of bytes read so far.
+     */
+    uint64_t size() const;
+
+    /**
+     * @brief Consumes the rest of a memory-mapped input in one piece.
+     * 
+     * @param data Receives a pointer to the remaining bytes, valid as long as the input.
+     * @return The number of remaining bytes, or 0 if the input is streamed or exhausted.
+     */
+    size_t take_remaining(const char*& data);
+
+    /**
+     * @brief Calls a function on every remaining chunk of the input.
+     * 
+     * @param consume Called with the pointer to and length of each chunk.
+     */
+    template <class Consumer>
+    void for_each_chunk(Consumer consume) {
+        const char* data;
+        size_t length;
+        while ((length = next(data)) != 0) {
+            consume(data, length);
+        }
+    }
+
+private:
+    /**
+     * @brief The file descriptor, or -1 if the file could not be opened.
+     */
+    int fd;
+
+    /**
+     * @brief The start of the mapping, or nullptr if the input is streamed.
+     */
+    const char* mapping;
+
+    /**
+     * @brief The size of the mapping in bytes.
+     */
+    size_t mapping_size;
+
+    /**
+     * @brief The offset of the next chunk in the mapping.
+     */
+    size_t position;
+
+    /**
+     * @brief The number of bytes read from a streamed input.
+     */
+    uint64_t streamed_size;
+
+    /**
+     * @brief The buffer chunks of a streamed input are read into.
+     */
+    std::vector<char> buffer;
+};
+
+#endif // INPUTSOURCE_H
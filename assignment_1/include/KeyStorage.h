@@ -0,0 +1,375 @@
+#ifndef KEYSTORAGE_H
+#define KEYSTORAGE_H
+
+#include "SnapshotFormat.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class KeyStorage
+ * @brief Compile-time selected storage for the keys of a BasicHashTable.
+ *
+ * Every slot of the table holds a KeyStorage::Ref, and the storage turns it back into a
+ * KeyStorage::View that the hash and equality functors operate on. Two specializations exist:
+ * trivially copyable keys are stored inline in the slot and copied as raw bytes, and
+ * std::string keys are stored in a contiguous byte arena that the slot only references.
+ * Other key types are rejected at compile time.
+ *
+ * @tparam Key The key type of the table.
+ */
+template <class Key, bool TriviallyCopyable = std::is_trivially_copyable<Key>::value>
+class KeyStorage {
+    static_assert(TriviallyCopyable, "HashTable keys must be std::string or trivially copyable");
+};
+
+/**
+ * @brief Inline storage for trivially copyable keys such as integers.
+ *
+ * The key is the reference itself, so no extra memory is touched when comparing keys and the
+ * string machinery is skipped entirely.
+ */
+template <class Key>
+class KeyStorage<Key, true> {
+public:
+    typedef Key Ref;          ///< What a slot stores.
+    typedef const Key& View;  ///< What the hash and equality functors see.
+
+    /**
+     * @brief Returns the key referenced by a slot.
+     *
+     * @param ref The reference stored in the slot.
+     * @return The key.
+     */
+    View view(const Ref& ref) const { return ref; }
+
+    /**
+     * @brief Prefetches the key of a slot; nothing to do, the key is in the slot.
+     */
+    void prefetch(const Ref&) const {}
+
+    /**
+     * @brief Stores a key.
+     *
+     * @param key The key, or a value convertible to it.
+     * @return The reference to keep in the slot.
+     */
+    template <class K>
+    Ref store(const K& key) { return Key(key); }
+
+    /**
+     * @brief Tells whether a key was stored before another one.
+     *
+     * @return Always false, since inline keys carry no insertion order.
+     */
+    bool inserted_before(const Ref&, const Ref&) const { return false; }
+
+    /**
+     * @brief Marks a stored key as no longer used. Inline keys need no bookkeeping.
+     */
+    void release(const Ref&) {}
+
+    /**
+     * @brief Tells whether enough storage is wasted to justify a compaction.
+     *
+     * @return Always false, since inline keys never waste storage.
+     */
+    bool wants_compaction() const { return false; }
+
+    /**
+     * @brief Rebuilds the storage from the live references. Inline keys need no compaction.
+     */
+    void compact(std::vector<Ref*>&) {}
+
+    /**
+     * @brief Drops all stored keys.
+     */
+    void clear() {}
+
+    /**
+     * @brief Returns a copy of the key referenced by a slot.
+     *
+     * @param ref The reference stored in the slot.
+     * @return The key.
+     */
+    Key materialize(const Ref& ref) const { return ref; }
+
+    /**
+     * @brief The key size recorded in a snapshot: keys are stored inline.
+     */
+    static constexpr uint32_t SNAPSHOT_KEY_SIZE = sizeof(Key);
+
+    /**
+     * @brief Slots need not cache key hashes: the key sits in the slot and hashes cheaply.
+     */
+    static constexpr bool CACHES_HASH = false;
+
+    /**
+     * @brief Returns the size of the key blob a snapshot of the given keys needs.
+     *
+     * @return Always 0, since inline keys are stored in the snapshot's slots.
+     */
+    uint64_t blob_size(const std::vector<Ref>&) const { return 0; }
+
+    /**
+     * @brief Returns the references the given keys have in a snapshot's key blob.
+     *
+     * @param refs The keys to save.
+     * @return The keys themselves.
+     */
+    std::vector<Ref> relocate(const std::vector<Ref>& refs) const { return refs; }
+
+    /**
+     * @brief Writes the key blob section of a snapshot. Inline keys have none.
+     *
+     * @param offset The offset of the section in the file.
+     * @return The offset, unchanged.
+     */
+    uint64_t save_blob(std::ostream&, const std::vector<Ref>&, uint64_t offset) const { return offset; }
+
+    /**
+     * @brief Reads the key blob section of a snapshot. Inline keys have none.
+     *
+     * @param key_bytes The size of the key blob, which must be 0.
+     * @return True if the snapshot has no key blob.
+     */
+    bool load_blob(std::istream&, uint64_t key_bytes, uint64_t&) { return key_bytes == 0; }
+
+    /**
+     * @brief Returns a key of a snapshot's slot section, e.g. of a memory-mapped snapshot.
+     *
+     * @param ref The reference stored in the slot.
+     * @return The key.
+     */
+    static View view_in_blob(const char*, const Ref& ref) { return ref; }
+
+    /**
+     * @brief Tells whether a reference read from a snapshot lies within its key blob.
+     *
+     * @return Always true, since inline keys do not reference the blob.
+     */
+    static bool fits_blob(const Ref&, uint64_t) { return true; }
+};
+
+/**
+ * @brief Arena storage for std::string keys.
+ *
+ * The bytes of all keys are appended to one contiguous arena in insertion order, and a slot
+ * only keeps the offset and length of its key. Keys are viewed as std::string_view, which is
+ * what the transparent StringHash and StringEqual functors operate on, so lookups by
+ * std::string_view or C string never allocate.
+ */
+template <>
+class KeyStorage<std::string, false> {
+public:
+    /**
+     * @struct Ref
+     * @brief The location of a key in the arena.
+     */
+    struct Ref {
+        uint32_t offset;  ///< The offset of the key bytes in the arena.
+        uint32_t length;  ///< The length of the key in bytes.
+    };
+    typedef std::string_view View;  ///< What the hash and equality functors see.
+
+    KeyStorage() : dead_bytes(0) {}
+
+    /**
+     * @brief Returns the key referenced by a slot.
+     *
+     * @param ref The reference stored in the slot.
+     * @return A view of the key bytes inside the arena.
+     */
+    View view(const Ref& ref) const {
+        return View(arena.data() + ref.offset, ref.length);
+    }
+
+    /**
+     * @brief Starts loading the first cache line of a key's bytes.
+     *
+     * @param ref The reference stored in the slot.
+     */
+    void prefetch(const Ref& ref) const { __builtin_prefetch(arena.data() + ref.offset); }
+
+    /**
+     * @brief Appends a key to the arena.
+     *
+     * @param key The key, or anything convertible to std::string_view.
+     * @return The reference to keep in the slot.
+     * @throw overflow_error if the arena would exceed 4 GiB.
+     */
+    template <class K>
+    Ref store(const K& key) {
+        View bytes(key);
+        if (arena.size() + bytes.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::overflow_error("HashTable key arena exceeds 4 GiB");
+        }
+        Ref ref{static_cast<uint32_t>(arena.size()), static_cast<uint32_t>(bytes.size())};
+        arena.insert(arena.end(), bytes.begin(), bytes.end());
+        return ref;
+    }
+
+    /**
+     * @brief Tells whether a key was stored before another one.
+     *
+     * @param a The reference of the first key.
+     * @param b The reference of the second key.
+     * @return True if a was stored before b, since the arena preserves insertion order.
+     */
+    bool inserted_before(const Ref& a, const Ref& b) const { return a.offset < b.offset; }
+
+    /**
+     * @brief Marks the bytes of a removed key as dead; they are reclaimed by compact().
+     *
+     * @param ref The reference of the removed key.
+     */
+    void release(const Ref& ref) { dead_bytes += ref.length; }
+
+    /**
+     * @brief Tells whether enough storage is wasted to justify a compaction.
+     *
+     * @return True once removed keys account for more than half of the arena.
+     */
+    bool wants_compaction() const { return dead_bytes * 2 > arena.size(); }
+
+    /**
+     * @brief Rebuilds the arena from the live references, keeping them in insertion order.
+     *
+     * @param live Pointers to the references of all live keys; they are updated in place.
+     */
+    void compact(std::vector<Ref*>& live) {
+        std::sort(live.begin(), live.end(), [](const Ref* a, const Ref* b) {
+            return a->offset < b->offset;
+        });
+        std::vector<char> new_arena;
+        new_arena.reserve(arena.size() - dead_bytes);
+        for (Ref* ref : live) {
+            uint32_t new_offset = static_cast<uint32_t>(new_arena.size());
+            new_arena.insert(new_arena.end(), arena.begin() + ref->offset,
+                             arena.begin() + ref->offset + ref->length);
+            ref->offset = new_offset;
+        }
+        arena = std::move(new_arena);
+        dead_bytes = 0;
+    }
+
+    /**
+     * @brief Drops all stored keys.
+     */
+    void clear() {
+        arena.clear();
+        dead_bytes = 0;
+    }
+
+    /**
+     * @brief Returns a copy of the key referenced by a slot.
+     *
+     * @param ref The reference stored in the slot.
+     * @return The key as a std::string.
+     */
+    std::string materialize(const Ref& ref) const { return std::string(view(ref)); }
+
+    /**
+     * @brief The key size recorded in a snapshot: keys are stored in the key blob.
+     */
+    static constexpr uint32_t SNAPSHOT_KEY_SIZE = 0;
+
+    /**
+     * @brief Slots cache key hashes, so that a rehash does not read and hash every key again.
+     */
+    static constexpr bool CACHES_HASH = true;
+
+    /**
+     * @brief Returns the size of the key blob a snapshot of the given keys needs.
+     *
+     * @param refs The keys to save.
+     * @return The total length of the keys.
+     */
+    uint64_t blob_size(const std::vector<Ref>& refs) const {
+        uint64_t bytes = 0;
+        for (const Ref& ref : refs) bytes += ref.length;
+        return bytes;
+    }
+
+    /**
+     * @brief Returns the references the given keys have in a snapshot's key blob, which holds
+     * their bytes back to back in the given order.
+     *
+     * @param refs The keys to save, in blob order.
+     * @return The references into the blob, in the same order.
+     */
+    std::vector<Ref> relocate(const std::vector<Ref>& refs) const {
+        std::vector<Ref> relocated(refs.size());
+        uint32_t offset = 0;
+        for (size_t i = 0; i < refs.size(); ++i) {
+            relocated[i] = Ref{offset, refs[i].length};
+            offset += refs[i].length;
+        }
+        return relocated;
+    }
+
+    /**
+     * @brief Writes the key blob section of a snapshot, as laid out by relocate().
+     *
+     * @param out The stream to write to.
+     * @param refs The keys to save, in blob order.
+     * @param offset The offset of the section in the file.
+     * @return The aligned offset following the section.
+     */
+    uint64_t save_blob(std::ostream& out, const std::vector<Ref>& refs, uint64_t offset) const {
+        for (const Ref& ref : refs) {
+            out.write(arena.data() + ref.offset, ref.length);
+            offset += ref.length;
+        }
+        return write_snapshot_padding(out, offset);
+    }
+
+    /**
+     * @brief Reads the key blob section of a snapshot straight into the arena, replacing its keys.
+     *
+     * @param in The stream to read from.
+     * @param key_bytes The size of the key blob.
+     * @param offset The offset of the section in the file; advanced past the section.
+     * @return True on success, false if the stream is truncated or the blob too large.
+     */
+    bool load_blob(std::istream& in, uint64_t key_bytes, uint64_t& offset) {
+        if (key_bytes > std::numeric_limits<uint32_t>::max()) return false;
+        arena.resize(key_bytes);
+        dead_bytes = 0;
+        in.read(arena.data(), key_bytes);
+        offset = skip_snapshot_padding(in, offset + key_bytes);
+        return static_cast<bool>(in);
+    }
+
+    /**
+     * @brief Returns a key of a snapshot's slot section, e.g. of a memory-mapped snapshot.
+     *
+     * @param blob The key blob of the snapshot.
+     * @param ref The reference stored in the slot.
+     * @return A view of the key bytes inside the blob.
+     */
+    static View view_in_blob(const char* blob, const Ref& ref) { return View(blob + ref.offset, ref.length); }
+
+    /**
+     * @brief Tells whether a reference read from a snapshot lies within its key blob.
+     *
+     * @param ref The reference.
+     * @param key_bytes The size of the key blob.
+     * @return True if the key bytes are inside the blob.
+     */
+    static bool fits_blob(const Ref& ref, uint64_t key_bytes) {
+        return static_cast<uint64_t>(ref.offset) + ref.length <= key_bytes;
+    }
+
+private:
+    std::vector<char> arena;  ///< The bytes of all keys, in insertion order.
+    size_t dead_bytes;        ///< The number of arena bytes belonging to removed keys.
+};
+
+#endif // KEYSTORAGE_H
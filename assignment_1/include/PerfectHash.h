@@ -0,0 +1,193 @@
+#ifndef PERFECTHASH_H
+#define PERFECTHASH_H
+
+#include "HashFunctions.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class PerfectHash
+ * @brief A minimal perfect hash function over a fixed set of keys, built PTHash style.
+ *
+ * The keys are spread over buckets of about KEYS_PER_BUCKET keys, skewed so that 60% of the
+ * keys fall into the first 30% of the buckets. Every bucket is given a pilot: the smallest number
+ * that, mixed into the hashes of the bucket's keys, sends each of them to a free slot.
+ * Buckets are placed largest first, while the slots are still mostly free. The n keys end up on
+ * exactly n slots, and evaluating the function costs two mixes of the key hash, one pilot read
+ * and one multiplication.
+ *
+ * The function only views the pilots, so they can live in a memory-mapped snapshot.
+ */
+class PerfectHash {
+public:
+    /**
+     * @brief The average number of keys per bucket, i.e. about 8 bits of pilot per key.
+     */
+    static constexpr uint64_t KEYS_PER_BUCKET = 4;
+
+    /**
+     * @brief Creates the function of an empty key set.
+     */
+    PerfectHash() : PerfectHash(0, 1, 0, nullptr) {}
+
+    /**
+     * @brief Creates a function from its parameters, e.g. as read from a snapshot.
+     *
+     * @param seed The seed the pilots were found with.
+     * @param bucket_count The number of buckets, bucket_count_for(slot_count).
+     * @param slot_count The number of keys and slots.
+     * @param pilots The pilot of every bucket; must outlive the function.
+     */
+    PerfectHash(uint64_t seed, uint64_t bucket_count, uint64_t slot_count, const uint32_t* pilots)
+        : seed(seed), bucket_count(bucket_count), slot_count(slot_count), pilots(pilots),
+          dense_buckets(bucket_count > 1 ? std::max<uint64_t>(1, bucket_count * 3 / 10) : bucket_count) {}
+
+    /**
+     * @brief Returns the slot of a key of the set; any other key yields an arbitrary slot.
+     *
+     * @param key_hash The hash of the key computed by the table's hash functor.
+     * @return The slot, in [0, slot_count). The key set must not be empty.
+     */
+    uint64_t operator()(size_t key_hash) const {
+        uint64_t hash = mix(key_hash);
+        return position(hash, pilots[bucket(hash)]);
+    }
+
+    /**
+     * @brief Returns the number of buckets, and therefore pilots, used for a number of keys.
+     *
+     * @param slot_count The number of keys.
+     * @return The number of buckets, at least 1.
+     */
+    static uint64_t bucket_count_for(uint64_t slot_count) {
+        return std::max<uint64_t>(1, (slot_count + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET);
+    }
+
+    /**
+     * @brief Searches the pilots of a minimal perfect hash function over a set of key hashes.
+     *
+     * @param key_hashes The hashes of the keys, computed by the table's hash functor.
+     * @param seed The seed; another seed gives an independent attempt.
+     * @param pilots Receives bucket_count_for(key_hashes.size()) pilots.
+     * @return False if two keys have the same hash or some bucket found no pilot with this seed.
+     */
+    static bool build(const std::vector<size_t>& key_hashes, uint64_t seed, std::vector<uint32_t>& pilots) {
+        uint64_t slot_count = key_hashes.size();
+        uint64_t bucket_count = bucket_count_for(slot_count);
+        PerfectHash function(seed, bucket_count, slot_count, nullptr);
+
+        // Group the mixed hashes by bucket with a counting sort
+        std::vector<uint64_t> hashes(slot_count);
+        std::vector<uint32_t> bucket_begin(bucket_count + 1, 0);
+        for (size_t i = 0; i < slot_count; ++i) {
+            hashes[i] = function.mix(key_hashes[i]);
+            ++bucket_begin[function.bucket(hashes[i]) + 1];
+        }
+        for (uint64_t b = 0; b < bucket_count; ++b) bucket_begin[b + 1] += bucket_begin[b];
+        std::vector<uint64_t> grouped(slot_count);
+        std::vector<uint32_t> fill(bucket_begin.begin(), bucket_begin.end() - 1);
+        for (uint64_t hash : hashes) grouped[fill[function.bucket(hash)]++] = hash;
+
+        // Keys with equal hashes would share every slot, whatever the pilot
+        size_t largest = 0;
+        for (uint64_t b = 0; b < bucket_count; ++b) {
+            std::sort(grouped.begin() + bucket_begin[b], grouped.begin() + bucket_begin[b + 1]);
+            if (std::adjacent_find(grouped.begin() + bucket_begin[b], grouped.begin() + bucket_begin[b + 1]) !=
+                grouped.begin() + bucket_begin[b + 1]) {
+                return false;
+            }
+            largest = std::max<size_t>(largest, bucket_begin[b + 1] - bucket_begin[b]);
+        }
+
+        // Place the buckets from the largest to the smallest, again with a counting sort
+        std::vector<uint32_t> size_begin(largest + 2, 0);
+        for (uint64_t b = 0; b < bucket_count; ++b) ++size_begin[largest - (bucket_begin[b + 1] - bucket_begin[b]) + 1];
+        for (size_t s = 0; s <= largest; ++s) size_begin[s + 1] += size_begin[s];
+        std::vector<uint32_t> order(bucket_count);
+        for (uint64_t b = 0; b < bucket_count; ++b) {
+            order[size_begin[largest - (bucket_begin[b + 1] - bucket_begin[b])]++] = static_cast<uint32_t>(b);
+        }
+
+        // The last buckets need about slot_count attempts to hit one of the few free slots
+        const uint64_t max_pilot = std::min<uint64_t>(UINT32_MAX, std::max<uint64_t>(1 << 16, 32 * slot_count));
+        std::vector<uint64_t> taken((slot_count + 63) / 64, 0);
+        std::vector<uint64_t> placed;
+        pilots.assign(bucket_count, 0);
+        for (uint32_t b : order) {
+            if (bucket_begin[b] == bucket_begin[b + 1]) break;  // Only empty buckets remain
+            uint64_t pilot = 0;
+            for (;; ++pilot) {
+                if (pilot > max_pilot) return false;
+                placed.clear();
+                for (uint32_t i = bucket_begin[b]; i < bucket_begin[b + 1]; ++i) {
+                    uint64_t slot = function.position(grouped[i], static_cast<uint32_t>(pilot));
+                    if (taken[slot / 64] & (1ULL << (slot % 64))) break;
+                    taken[slot / 64] |= 1ULL << (slot % 64);
+                    placed.push_back(slot);
+                }
+                if (placed.size() == bucket_begin[b + 1] - bucket_begin[b]) break;
+                for (uint64_t slot : placed) taken[slot / 64] &= ~(1ULL << (slot % 64));
+            }
+            pilots[b] = static_cast<uint32_t>(pilot);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns the seed, to be saved with the pilots.
+     */
+    uint64_t get_seed() const { return seed; }
+
+    /**
+     * @brief Returns the number of buckets, and therefore pilots.
+     */
+    uint64_t get_bucket_count() const { return bucket_count; }
+
+private:
+    /**
+     * @brief Mixes a key hash with the seed, so that every attempt sees independent hashes.
+     */
+    uint64_t mix(size_t key_hash) const {
+        return IntegerHash<uint64_t>()(static_cast<uint64_t>(key_hash) ^ seed);
+    }
+
+    /**
+     * @brief Returns the bucket of a mixed hash: the low half picks the dense or the sparse
+     * buckets, the high half the bucket among them.
+     */
+    uint64_t bucket(uint64_t hash) const {
+        uint64_t selector = hash & 0xffffffffULL;
+        uint64_t high = hash >> 32;
+        if (selector < SKEW_THRESHOLD || dense_buckets == bucket_count) {
+            return (high * dense_buckets) >> 32;
+        }
+        return dense_buckets + ((high * (bucket_count - dense_buckets)) >> 32);
+    }
+
+    /**
+     * @brief Returns the slot a pilot sends a mixed hash to.
+     *
+     * The displaced hash is mixed again before its high bits select the slot: the keys of a
+     * bucket share the high half of their hash, and a plain xor would keep any two keys whose
+     * high bits agree on the same slot whatever the pilot.
+     */
+    uint64_t position(uint64_t hash, uint32_t pilot) const {
+        uint64_t displaced = IntegerHash<uint64_t>()(hash ^ (pilot * 0x9e3779b97f4a7c15ULL));
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(displaced) * slot_count) >> 64);
+    }
+
+    /**
+     * @brief 60% of the 32-bit selectors, which send their key to the dense buckets.
+     */
+    static constexpr uint64_t SKEW_THRESHOLD = 0x99999999ULL;
+
+    uint64_t seed;           ///< The seed mixed into every key hash.
+    uint64_t bucket_count;   ///< The number of buckets and pilots.
+    uint64_t slot_count;     ///< The number of keys and slots.
+    const uint32_t* pilots;  ///< The pilot of every bucket.
+    uint64_t dense_buckets;  ///< The number of buckets receiving 60% of the keys.
+};
+
+#endif // PERFECTHASH_H
@@ -0,0 +1,117 @@
+#ifndef SNAPSHOTFORMAT_H
+#define SNAPSHOTFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+/**
+ * @file SnapshotFormat.h
+ * @brief Conventions shared by the binary snapshot files.
+ *
+ * A snapshot starts with a fixed-size header of explicitly sized fields, followed by sections
+ * that each start at a multiple of SNAPSHOT_ALIGNMENT bytes from the start of the file, so a
+ * memory-mapped snapshot can be used in place and a loader only needs one bulk read per section.
+ * Numbers are stored in the byte order of the producer, which the header records; a loader on
+ * a machine with a different byte order rejects the file instead of misreading it.
+ */
+
+/**
+ * @brief The value of SnapshotHeader::byte_order as written by the producer.
+ */
+constexpr uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+
+/**
+ * @brief The alignment of every section, in bytes.
+ */
+constexpr size_t SNAPSHOT_ALIGNMENT = 8;
+
+/**
+ * @brief The current version of the hash table snapshot format.
+ */
+constexpr uint32_t HASH_TABLE_SNAPSHOT_VERSION = 2;
+
+/**
+ * @brief The magic bytes identifying a hash table snapshot.
+ */
+constexpr char HASH_TABLE_SNAPSHOT_MAGIC[8] = {'D', 'W', 'F', 'H', 'T', 'B', 'L', '\0'};
+
+/**
+ * @struct SnapshotHeader
+ * @brief The header of a hash table snapshot.
+ *
+ * Version 2 stores the entries as a frozen table that can be queried in place: the header is
+ * followed by a PerfectHashHeader, the pilots of the minimal perfect hash function over the keys
+ * (bucket_count uint32), the slots (count records of a key, or for string keys the offset and
+ * length of its bytes in the key blob, and a value), each at the position the function assigns
+ * to its key, and the key blob (key_bytes bytes, string keys only), which holds the keys in
+ * insertion order. first and last are slot positions.
+ */
+struct SnapshotHeader {
+    char magic[8];         ///< HASH_TABLE_SNAPSHOT_MAGIC.
+    uint32_t version;      ///< HASH_TABLE_SNAPSHOT_VERSION.
+    uint32_t byte_order;   ///< SNAPSHOT_BYTE_ORDER_MARK in the producer's byte order.
+    uint32_t header_size;  ///< sizeof(SnapshotHeader), the offset of the first section.
+    uint32_t key_size;     ///< The size of an inline key, or 0 for keys stored in the key blob.
+    uint32_t value_size;   ///< The size of a value.
+    uint32_t reserved;     ///< Always 0.
+    uint64_t capacity;     ///< The number of slots of the saved table.
+    uint64_t count;        ///< The number of entries.
+    uint64_t key_bytes;    ///< The size of the key blob.
+    int64_t first;         ///< The position of the first inserted entry, or -1.
+    int64_t last;          ///< The position of the last inserted entry, or -1.
+};
+
+static_assert(sizeof(SnapshotHeader) % SNAPSHOT_ALIGNMENT == 0, "Snapshot sections must stay aligned");
+
+/**
+ * @struct PerfectHashHeader
+ * @brief The parameters of the perfect hash function of a hash table snapshot (see PerfectHash.h).
+ */
+struct PerfectHashHeader {
+    uint64_t seed;          ///< The seed the pilots were found with.
+    uint64_t bucket_count;  ///< The number of pilots.
+    uint32_t slot_size;     ///< The size of a slot record, which depends on the key and value types.
+    uint32_t reserved;      ///< Always 0.
+};
+
+static_assert(sizeof(PerfectHashHeader) % SNAPSHOT_ALIGNMENT == 0, "Snapshot sections must stay aligned");
+
+/**
+ * @brief Returns the number of padding bytes that align a section ending at the given offset.
+ *
+ * @param offset The offset from the start of the file.
+ * @return The number of zero bytes to insert before the next section.
+ */
+inline size_t snapshot_padding(uint64_t offset) {
+    return static_cast<size_t>((SNAPSHOT_ALIGNMENT - offset % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT);
+}
+
+/**
+ * @brief Writes the padding that aligns the next section.
+ *
+ * @param out The stream to write to.
+ * @param offset The offset of the end of the previous section.
+ * @return The aligned offset of the next section.
+ */
+inline uint64_t write_snapshot_padding(std::ostream& out, uint64_t offset) {
+    static const char zeros[SNAPSHOT_ALIGNMENT] = {};
+    size_t padding = snapshot_padding(offset);
+    out.write(zeros, padding);
+    return offset + padding;
+}
+
+/**
+ * @brief Skips the padding that aligns the next section.
+ *
+ * @param in The stream to read from.
+ * @param offset The offset of the end of the previous section.
+ * @return The aligned offset of the next section.
+ */
+inline uint64_t skip_snapshot_padding(std::istream& in, uint64_t offset) {
+    size_t padding = snapshot_padding(offset);
+    in.ignore(padding);
+    return offset + padding;
+}
+
+#endif // SNAPSHOTFORMAT_H
@@ -1,15 +1,22 @@
 #ifndef TEXTPROCESSOR_H
 #define TEXTPROCESSOR_H
 
+#include <cstdint>
 #include <string>
+#include <thread>
+#include "DeltaLog.h"
+#include "Fingerprint.h"
 #include "HashTable.h"
+#include "InputSource.h"
+
+class ByteRing;
 
 /**
  * @class TextProcessor
  * @brief A class that processes text files, including downloading, cleaning, and extracting words.
  * 
  * This class provides various methods for downloading text files, extracting words,
- * calculating checksums (MD5), and interacting with a hash table for word storage.
+ * calculating checksums (xxHash or MD5), and interacting with a hash table for word storage.
  */
 class TextProcessor {
 public:
@@ -17,24 +24,64 @@ public:
      * @brief Constructs a new TextProcessor object.
      * 
      * Initializes a new instance of the TextProcessor class.
+     * 
+     * @param algorithm The hash algorithm of the checksums process_file records.
+     */
+    explicit TextProcessor(FingerprintAlgorithm algorithm = FingerprintAlgorithm::XXH64);
+
+    /**
+     * @brief Destroys the TextProcessor, waiting for a background compaction to finish.
      */
-    TextProcessor();
+    ~TextProcessor();
     
     /**
      * @brief Downloads a book from a given URL and saves it to a specified file path.
      * 
+     * If the book was downloaded before, the request is conditional (If-None-Match /
+     * If-Modified-Since) and an unchanged book is not transferred again.
+     * 
+     * @param url The URL to download the book from.
+     * @param output_path The file path where the downloaded book will be saved.
+     * @return True if a new copy was saved, false if the saved copy is current or the download failed.
+     */
+    bool download_book(const std::string& url, const std::string& output_path);
+
+    /**
+     * @brief Downloads a book and counts its words while it arrives, then saves the table for future runs.
+     * 
+     * The body is written to output_path and, through a bounded ring buffer, hashed and tokenized on a
+     * second thread as the transfer progresses, so the file is never read back. If the book did not
+     * change since the last download or cannot be downloaded, the saved copy is processed with
+     * process_file instead.
+     * 
      * @param url The URL to download the book from.
      * @param output_path The file path where the downloaded book will be saved.
+     * @param hash_table The hash table to be populated or loaded.
+     * @param hash_file The path to the file that stores the checksum of the previously processed file.
+     * @param thread_count The number of threads counting words when the saved copy is processed.
      */
-    void download_book(const std::string& url, const std::string& output_path);
+    void download_and_process(const std::string& url, const std::string& output_path, HashTable& hash_table,
+                              const std::string& hash_file, int thread_count = 1);
 
     /**
      * @brief Extracts words from a file and inserts them into the provided hash table.
      * 
      * @param file_path The path to the file from which to extract words.
      * @param hash_table The hash table to store the extracted words.
+     * @param thread_count The number of threads counting words; more than one splits the file on
+     * word boundaries, counts every part into its own table and merges them in file order.
      */
-    void extract_words(const std::string& file_path, HashTable& hash_table);
+    void extract_words(const std::string& file_path, HashTable& hash_table, int thread_count = 1);
+
+    /**
+     * @brief Extracts the words of the remaining input and inserts them into the provided hash table.
+     * 
+     * @param input The input to read.
+     * @param hash_table The hash table to store the extracted words.
+     * @param thread_count The number of threads counting words; only a memory-mapped input is
+     * counted in parallel.
+     */
+    void extract_words(InputSource& input, HashTable& hash_table, int thread_count = 1);
 
     /**
      * @brief Computes the MD5 checksum of a given file.
@@ -44,15 +91,63 @@ public:
      */
     std::string compute_md5(const std::string& filename);
 
+    /**
+     * @brief Computes the MD5 checksum of the remaining input.
+     * 
+     * @param input The input to read.
+     * @return A string representing the MD5 checksum of the input.
+     */
+    std::string compute_md5(InputSource& input);
+
+    /**
+     * @brief Computes the checksum of the remaining input with the configured algorithm.
+     * 
+     * @param input The input to read.
+     * @return The checksum as "<algorithm>:<digest>".
+     */
+    std::string compute_checksum(InputSource& input);
+
+    /**
+     * @brief Computes the checksums of a prefix of the remaining input and of the whole input in one pass.
+     * 
+     * @param input The input to read.
+     * @param algorithm The hash algorithm to use.
+     * @param prefix_length The length of the prefix.
+     * @param prefix_checksum Receives the checksum of the first prefix_length bytes, or is left empty if the
+     * input is shorter.
+     * @return The checksum of the whole input as "<algorithm>:<digest>".
+     */
+    std::string compute_checksum(InputSource& input, FingerprintAlgorithm algorithm, uint64_t prefix_length,
+                                 std::string& prefix_checksum);
+
+    /**
+     * @brief Computes the checksum of the remaining input and extracts its words in a single pass.
+     * 
+     * @param input The input to read.
+     * @param hash_table The hash table to store the extracted words.
+     * @param thread_count The number of threads counting words; only a memory-mapped input is
+     * counted in parallel.
+     * @return The checksum of the input as "<algorithm>:<digest>", with the configured algorithm.
+     */
+    std::string compute_checksum_and_extract_words(InputSource& input, HashTable& hash_table, int thread_count = 1);
+
     /**
      * @brief Processes the file by comparing its checksum with an existing one, then either loads a previously
      * saved hash table or processes the file and rebuilds the hash table.
      * 
+     * If the file's size, modification time and a sample of its blocks are unchanged, the saved table
+     * is loaded without hashing the file. Otherwise the file is read once: without a saved checksum it
+     * is hashed and tokenized in a single pass, otherwise it is hashed first and, on a mismatch,
+     * tokenized from the same memory mapping. If the file only grew since the table was saved, the
+     * saved table and its delta log are loaded and only the appended text is counted.
+     * 
      * @param hash_table The hash table to be populated or loaded.
      * @param file_path The path to the text file being processed.
      * @param hash_file The path to the file that stores the checksum of the previously processed file.
+     * @param thread_count The number of threads counting words.
      */
-    void process_file(HashTable& hash_table, const std::string& file_path, const std::string& hash_file);
+    void process_file(HashTable& hash_table, const std::string& file_path, const std::string& hash_file,
+                      int thread_count = 1);
 
     /**
      * @brief Checks if a directory exists.
@@ -77,17 +172,63 @@ public:
      */
     std::string clean_text(const std::string& text);
     
+    /**
+     * @brief Waits until a background compaction started by process_file has finished.
+     */
+    void wait_for_compaction();
+
 private:
+    /**
+     * @brief Saves a copy of the table as the new snapshot on a background thread, then empties the delta log.
+     * 
+     * @param hash_table The table to snapshot.
+     * @param saved The input prefix the table covers.
+     * @param hash_file The path to the checksum file.
+     */
+    void start_compaction(const HashTable& hash_table, const DeltaLog::Commit& saved, const std::string& hash_file);
+
+    /**
+     * @brief The thread running a background compaction, if any.
+     */
+    std::thread compaction_thread;
+
+    /**
+     * @brief The hash algorithm of new checksums.
+     */
+    FingerprintAlgorithm algorithm;
+
+    /**
+     * @brief Downloads a book with a conditional GET, optionally passing the body on as it arrives.
+     * 
+     * @param url The URL to download the book from.
+     * @param output_path The file path where the downloaded book will be saved.
+     * @param ring If not null, receives a copy of the body.
+     * @return True if a new copy was saved, false if the saved copy is current.
+     * @throw runtime_error if the transfer fails; the saved copy is then left untouched.
+     */
+    bool fetch_book(const std::string& url, const std::string& output_path, ByteRing* ring);
+
     /**
      * @brief Callback function to handle data writing during download.
      * 
      * @param ptr Pointer to the data received.
      * @param size Size of each data chunk.
      * @param nmemb Number of chunks.
-     * @param stream Output file stream.
-     * @return The number of bytes written.
+     * @param userdata The download in progress.
+     * @return The number of bytes written, or 0 to abort the transfer.
+     */
+    static size_t write_data(void* ptr, size_t size, size_t nmemb, void* userdata);
+
+    /**
+     * @brief Callback function recording the cache validators of a response during download.
+     * 
+     * @param buffer One header line, not null-terminated.
+     * @param size Always 1.
+     * @param nitems The length of the line.
+     * @param userdata The download in progress.
+     * @return The number of bytes handled.
      */
-    static size_t write_data(void* ptr, size_t size, size_t nmemb, FILE* stream);
+    static size_t header_data(char* buffer, size_t size, size_t nitems, void* userdata);
 };
 
 #endif // TEXTPROCESSOR_H
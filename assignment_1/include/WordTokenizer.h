@@ -0,0 +1,186 @@
+#ifndef WORDTOKENIZER_H
+#define WORDTOKENIZER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @class WordTokenizer
+ * @brief An incremental, allocation-free ASCII word tokenizer.
+ * 
+ * Text is fed in arbitrary chunks. A token is a maximal run of ASCII letters and digits,
+ * lower-cased and handed to a sink as a std::string_view, so no per-token string is ever built.
+ * This matches the former pipeline of splitting on whitespace, replacing every character
+ * outside [a-zA-Z0-9] with a space and lower-casing.
+ * 
+ * The input is never written to, so it may be a read-only memory mapping: a token that is
+ * already lower case is viewed where it lies, and only a token containing upper case letters,
+ * or one that straddles two chunks, is copied into a reusable scratch buffer.
+ * 
+ * The tokenizer also counts whitespace separated words, which is what the text processor
+ * reports as the number of processed words.
+ */
+class WordTokenizer {
+public:
+    WordTokenizer() : in_word(false), words(0) {
+        partial.reserve(64);
+        lowered.reserve(64);
+    }
+
+    /**
+     * @brief Tokenizes a chunk of text.
+     * 
+     * @param data The chunk.
+     * @param length The number of bytes in the chunk.
+     * @param sink Called with a lower case std::string_view for every complete token. The view is
+     * only valid during the call.
+     */
+    template <class Sink>
+    void feed(const char* data, size_t length, Sink& sink) {
+        const char* const end = data + length;
+        const char* p = data;
+
+        // Finish a token carried over from the previous chunk
+        if (!partial.empty()) {
+            while (p != end && (CLASSES[static_cast<unsigned char>(*p)] & WORD)) {
+                partial.push_back(to_lower(*p));
+                ++p;
+            }
+            if (p == end) {
+                count_words(data, end);
+                return;
+            }
+            sink(std::string_view(partial));
+            partial.clear();
+        }
+
+        while (p != end) {
+            // Skip separators
+            while (p != end && !(CLASSES[static_cast<unsigned char>(*p)] & WORD)) ++p;
+            const char* start = p;
+            uint8_t classes = 0;
+            while (p != end && (CLASSES[static_cast<unsigned char>(*p)] & WORD)) {
+                classes |= CLASSES[static_cast<unsigned char>(*p)];
+                ++p;
+            }
+            if (p == start) break;
+            if (p == end) {
+                // The token may continue in the next chunk
+                lower_into(partial, start, p);
+                break;
+            }
+            if (classes & UPPER) {
+                lower_into(lowered, start, p);
+                sink(std::string_view(lowered));
+            } else {
+                sink(std::string_view(start, p - start));
+            }
+        }
+        count_words(data, end);
+    }
+
+    /**
+     * @brief Flushes the last token once the input is exhausted.
+     * 
+     * @param sink Called with the pending token, if any.
+     */
+    template <class Sink>
+    void finish(Sink& sink) {
+        if (!partial.empty()) {
+            sink(std::string_view(partial));
+            partial.clear();
+        }
+    }
+
+    /**
+     * @brief Returns the number of whitespace separated words seen so far.
+     * 
+     * @return The word count.
+     */
+    size_t word_count() const { return words; }
+
+    /**
+     * @brief Tells whether a byte belongs to a token.
+     * 
+     * @param c The byte to classify.
+     * @return True for ASCII letters and digits.
+     */
+    static bool is_word_char(char c) { return CLASSES[static_cast<unsigned char>(c)] & WORD; }
+
+    /**
+     * @brief Tells whether a byte separates whitespace delimited words.
+     * 
+     * @param c The byte to classify.
+     * @return True for space, \\t, \\n, \\v, \\f and \\r.
+     */
+    static bool is_space(char c) { return CLASSES[static_cast<unsigned char>(c)] & SPACE; }
+
+private:
+    static constexpr uint8_t WORD = 1;   ///< ASCII letter or digit.
+    static constexpr uint8_t SPACE = 2;  ///< ASCII whitespace.
+    static constexpr uint8_t UPPER = 4;  ///< ASCII upper case letter.
+
+    /**
+     * @brief Builds the byte classification table.
+     * 
+     * @return The class bits of every byte value.
+     */
+    static constexpr std::array<uint8_t, 256> make_classes() {
+        std::array<uint8_t, 256> classes{};
+        for (int c = '0'; c <= '9'; ++c) classes[c] = WORD;
+        for (int c = 'a'; c <= 'z'; ++c) classes[c] = WORD;
+        for (int c = 'A'; c <= 'Z'; ++c) classes[c] = WORD | UPPER;
+        for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) classes[static_cast<unsigned char>(c)] = SPACE;
+        return classes;
+    }
+
+    static const std::array<uint8_t, 256> CLASSES;  ///< The class bits of every byte value.
+
+    /**
+     * @brief Lower-cases an ASCII letter, leaving every other byte alone.
+     * 
+     * @param c The byte to convert.
+     * @return The lower-cased byte.
+     */
+    static char to_lower(char c) {
+        return (CLASSES[static_cast<unsigned char>(c)] & UPPER) ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    /**
+     * @brief Replaces the contents of a buffer with the lower-cased bytes of a range.
+     * 
+     * @param out The buffer to fill.
+     * @param first The start of the range.
+     * @param last The end of the range.
+     */
+    static void lower_into(std::string& out, const char* first, const char* last) {
+        out.clear();
+        for (; first != last; ++first) out.push_back(to_lower(*first));
+    }
+
+    /**
+     * @brief Counts the starts of whitespace separated words in a chunk.
+     * 
+     * @param p The start of the chunk.
+     * @param end The end of the chunk.
+     */
+    void count_words(const char* p, const char* end) {
+        for (; p != end; ++p) {
+            bool space = CLASSES[static_cast<unsigned char>(*p)] & SPACE;
+            words += !space && !in_word;
+            in_word = !space;
+        }
+    }
+
+    std::string partial;  ///< A lower-cased token that started in the previous chunk.
+    std::string lowered;  ///< Scratch space for lower-casing a token.
+    bool in_word;         ///< True if the last byte seen was part of a whitespace delimited word.
+    size_t words;         ///< The number of whitespace delimited words seen.
+};
+
+inline constexpr std::array<uint8_t, 256> WordTokenizer::CLASSES = WordTokenizer::make_classes();
+
+#endif // WORDTOKENIZER_H
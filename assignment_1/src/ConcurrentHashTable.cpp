@@ -0,0 +1,410 @@
+#include "ConcurrentHashTable.h"
+#include <stdexcept>
+
+ConcurrentHashTable::Entry* const ConcurrentHashTable::TOMBSTONE = reinterpret_cast<Entry*>(uintptr_t(1));
+ConcurrentHashTable::Entry* const ConcurrentHashTable::MOVED = reinterpret_cast<Entry*>(uintptr_t(2));
+
+/**
+ * @brief Allocates a table of empty slots.
+ *
+ * @param size The number of slots, a power of two.
+ */
+ConcurrentHashTable::Table::Table(int size)
+    : size(size), used(0), slots(new std::atomic<Entry*>[size]), next(nullptr) {
+    for (int i = 0; i < size; ++i) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Returns the reader shard of the calling thread; threads take the shards in turn.
+ */
+static int reader_shard(int shard_count) {
+    static std::atomic<int> next_shard(0);
+    thread_local const int shard = next_shard.fetch_add(1, std::memory_order_relaxed);
+    return shard % shard_count;
+}
+
+/**
+ * @brief Counts the calling thread as a reader of the current epoch.
+ *
+ * The epoch is read again once the count is visible: if it changed in between, the writer may
+ * have found the old counter empty already, so the reader counts itself in the new epoch instead.
+ *
+ * @param table The table being read.
+ */
+ConcurrentHashTable::ReadGuard::ReadGuard(const ConcurrentHashTable& table) {
+    ReaderShard& shard = table.readers[reader_shard(READER_SHARDS)];
+    uint64_t epoch = table.epoch.load(std::memory_order_relaxed);
+    while (true) {
+        counter = &shard.active[epoch & 1];
+        counter->fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t current_epoch = table.epoch.load(std::memory_order_relaxed);
+        if (current_epoch == epoch) return;
+        counter->fetch_sub(1, std::memory_order_relaxed);
+        epoch = current_epoch;
+    }
+}
+
+/**
+ * @brief Stops counting the reader; its loads of the table happen before the decrement.
+ */
+ConcurrentHashTable::ReadGuard::~ReadGuard() {
+    counter->fetch_sub(1, std::memory_order_release);
+}
+
+/**
+ * @brief Constructs a new concurrent hash table.
+ *
+ * @param size The initial size of the hash table, rounded up to the next power of two.
+ * @param max_load_factor The fraction of used slots (0, 1) above which the table is migrated
+ * to a larger one.
+ * @throw invalid_argument if any parameter is out of range.
+ */
+ConcurrentHashTable::ConcurrentHashTable(int size, double max_load_factor)
+    : elements_count(0), max_load_factor(max_load_factor), migration_cursor(0), writes_since_reclaim(0), epoch(0) {
+    if (size <= 0) {
+        throw std::invalid_argument("HashTable size must be positive");
+    }
+    if (!(max_load_factor > 0.0 && max_load_factor < 1.0)) {
+        throw std::invalid_argument("HashTable max_load_factor must be in (0, 1)");
+    }
+    if (size > (1 << 30)) {
+        throw std::overflow_error("HashTable size exceeds the maximum capacity");
+    }
+    int capacity = 1;
+    while (capacity < size) capacity <<= 1;
+    current.store(new Table(capacity), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Destroys the table and all retired memory.
+ */
+ConcurrentHashTable::~ConcurrentHashTable() {
+    // Every live entry is referenced by exactly one slot of the chain
+    Table* table = current.load(std::memory_order_relaxed);
+    while (table) {
+        for (int i = 0; i < table->size; ++i) {
+            Entry* entry = table->slots[i].load(std::memory_order_relaxed);
+            if (is_entry(entry)) delete entry;
+        }
+        Table* next = table->next.load(std::memory_order_relaxed);
+        delete table;
+        table = next;
+    }
+    // No reader is left, so nothing retired needs to wait for one
+    for (std::vector<Entry*>* entries : {&retired_entries, &expiring_entries}) {
+        for (Entry* entry : *entries) delete entry;
+    }
+    for (std::vector<Table*>* tables : {&retired_tables, &expiring_tables}) {
+        for (Table* table : *tables) delete table;
+    }
+}
+
+/**
+ * @brief Tells whether a slot value points to an entry rather than being empty or a marker.
+ *
+ * @param entry The slot value.
+ * @return True if the slot holds an entry.
+ */
+bool ConcurrentHashTable::is_entry(const Entry* entry) {
+    return reinterpret_cast<uintptr_t>(entry) > reinterpret_cast<uintptr_t>(MOVED);
+}
+
+/**
+ * @brief Searches one table for a key.
+ *
+ * Probing stops at the first empty slot and continues past tombstones and moved slots.
+ *
+ * @param table The table to search.
+ * @param key The key to search for.
+ * @param key_hash The full hash of the key.
+ * @return The index of the slot holding the key, or -1 if it is not in this table.
+ */
+int ConcurrentHashTable::find_in(const Table* table, std::string_view key, size_t key_hash) {
+    int mask = table->size - 1;
+    int index = static_cast<int>(key_hash & mask);
+    for (int probes = 0; probes < table->size; ++probes) {
+        Entry* entry = table->slots[index].load(std::memory_order_acquire);
+        if (entry == nullptr) {
+            return -1;
+        }
+        if (is_entry(entry) && entry->key_hash == key_hash && entry->key == key) {
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+ * @brief Searches the chain of tables for a key, as readers do.
+ *
+ * An entry being migrated is published in the next table before its old slot is marked as
+ * moved, so searching from the oldest table to the newest never misses it.
+ *
+ * @param key The key to search for.
+ * @param key_hash The full hash of the key.
+ * @return The entry holding the key, or nullptr if it is not found.
+ */
+ConcurrentHashTable::Entry* ConcurrentHashTable::find_entry(std::string_view key, size_t key_hash) const {
+    for (Table* table = current.load(std::memory_order_acquire); table;
+         table = table->next.load(std::memory_order_acquire)) {
+        int index = find_in(table, key, key_hash);
+        if (index >= 0) {
+            Entry* entry = table->slots[index].load(std::memory_order_acquire);
+            if (is_entry(entry)) return entry;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Stores an entry in the first free slot of its probe sequence. Writer only.
+ *
+ * @param table The table to store the entry in.
+ * @param entry The entry to publish.
+ */
+void ConcurrentHashTable::place(Table* table, Entry* entry) {
+    int mask = table->size - 1;
+    int index = static_cast<int>(entry->key_hash & mask);
+    while (true) {
+        Entry* slot = table->slots[index].load(std::memory_order_relaxed);
+        if (slot == nullptr || slot == TOMBSTONE) {
+            if (slot == nullptr) table->used++;
+            table->slots[index].store(entry, std::memory_order_release);
+            return;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+/**
+ * @brief Moves the next batch of entries to the table being migrated to. Writer only.
+ *
+ * Once the whole table is moved, the next table becomes the current one and the old table is
+ * retired; it keeps pointing to its successor for readers that are still searching it.
+ *
+ * @param count The number of old slots to process.
+ */
+void ConcurrentHashTable::migrate(int count) {
+    Table* old_table = current.load(std::memory_order_relaxed);
+    Table* new_table = old_table->next.load(std::memory_order_relaxed);
+    if (!new_table) {
+        return;
+    }
+
+    for (; count > 0 && migration_cursor < old_table->size; --count, ++migration_cursor) {
+        Entry* entry = old_table->slots[migration_cursor].load(std::memory_order_relaxed);
+        if (is_entry(entry)) {
+            place(new_table, entry);
+            old_table->slots[migration_cursor].store(MOVED, std::memory_order_release);
+        }
+    }
+
+    if (migration_cursor == old_table->size) {
+        current.store(new_table, std::memory_order_release);
+        retired_tables.push_back(old_table);
+        migration_cursor = 0;
+    }
+}
+
+/**
+ * @brief Returns the table new keys go to, starting a migration first if it is too full. Writer only.
+ *
+ * A migration copies only live entries, so it also purges tombstones. The new table is twice as
+ * large unless most used slots are tombstones, in which case it keeps the same size.
+ *
+ * @return The newest table of the chain.
+ */
+ConcurrentHashTable::Table* ConcurrentHashTable::table_for_insert() {
+    Table* table = current.load(std::memory_order_relaxed);
+    Table* next = table->next.load(std::memory_order_relaxed);
+    if (next) {
+        // A migration finishes long before its target fills up, see MIGRATION_BATCH
+        if (next->used + 1 <= max_load_factor * next->size) return next;
+        migrate(table->size);
+        table = next;
+    }
+
+    if (table->used + 1 > max_load_factor * table->size) {
+        int live = elements_count.load(std::memory_order_relaxed);
+        if (table->size > (1 << 29)) {
+            throw std::overflow_error("HashTable size exceeds the maximum capacity");
+        }
+        int new_size = (live * 2 >= table->used) ? table->size * 2 : table->size;
+        Table* new_table = new Table(new_size);
+        table->next.store(new_table, std::memory_order_release);
+        migrate(MIGRATION_BATCH);
+        return new_table;
+    }
+    return table;
+}
+
+/**
+ * @brief Inserts a key-value pair into the hash table.
+ *
+ * @param key The key to be inserted.
+ * @param value The value associated with the key.
+ */
+void ConcurrentHashTable::insert(std::string_view key, int value) {
+    size_t key_hash = hasher(key);
+    std::lock_guard<std::mutex> lock(write_mutex);
+    migrate(MIGRATION_BATCH);
+    maybe_reclaim();
+
+    Entry* entry = find_entry(key, key_hash);
+    if (entry) {
+        entry->value.store(value, std::memory_order_relaxed);
+        return;
+    }
+    place(table_for_insert(), new Entry(key, key_hash, value));
+    elements_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Adds a delta to the value associated with a key, inserting the key if it is missing.
+ *
+ * @param key The key whose value is incremented.
+ * @param delta The amount added to the value; a missing key starts from 0.
+ * @return The value associated with the key after the increment.
+ */
+int ConcurrentHashTable::increment(std::string_view key, int delta) {
+    size_t key_hash = hasher(key);
+    std::lock_guard<std::mutex> lock(write_mutex);
+    migrate(MIGRATION_BATCH);
+    maybe_reclaim();
+
+    Entry* entry = find_entry(key, key_hash);
+    if (entry) {
+        return entry->value.fetch_add(delta, std::memory_order_relaxed) + delta;
+    }
+    place(table_for_insert(), new Entry(key, key_hash, delta));
+    elements_count.fetch_add(1, std::memory_order_relaxed);
+    return delta;
+}
+
+/**
+ * @brief Frees the memory retired before the last epoch change if its readers are gone, then
+ * starts a new epoch for the memory retired since. Never waits. Writer only.
+ *
+ * Memory is retired only after it was unlinked, and the epoch changes after that, so a reader
+ * counted in the new epoch can no longer reach it. Readers counted in the old epoch may; once
+ * none is left, the memory is freed. The epoch changes again only after that, so the old
+ * epoch's counters only ever count readers that started before the change.
+ */
+void ConcurrentHashTable::reclaim() {
+    if (!expiring_entries.empty() || !expiring_tables.empty()) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int parity = static_cast<int>((epoch.load(std::memory_order_relaxed) - 1) & 1);
+        for (const ReaderShard& shard : readers) {
+            if (shard.active[parity].load(std::memory_order_acquire) != 0) return;
+        }
+        for (Entry* entry : expiring_entries) delete entry;
+        expiring_entries.clear();
+        for (Table* table : expiring_tables) delete table;
+        expiring_tables.clear();
+    }
+
+    if (!retired_entries.empty() || !retired_tables.empty()) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        epoch.fetch_add(1, std::memory_order_relaxed);
+        expiring_entries.swap(retired_entries);
+        expiring_tables.swap(retired_tables);
+    }
+}
+
+/**
+ * @brief Counts a write and reclaims retired memory every RECLAIM_INTERVAL writes. Writer only.
+ *
+ * Checking the reader counters touches every shard, so it is not done on every write.
+ */
+void ConcurrentHashTable::maybe_reclaim() {
+    if (++writes_since_reclaim >= RECLAIM_INTERVAL) {
+        writes_since_reclaim = 0;
+        reclaim();
+    }
+}
+
+/**
+ * @brief Removes a key-value pair from the hash table.
+ *
+ * The slot becomes a tombstone and the entry is retired, since readers may still hold it.
+ *
+ * @param key The key to be removed.
+ * @throw invalid_argument if the key is not found.
+ */
+void ConcurrentHashTable::remove(std::string_view key) {
+    size_t key_hash = hasher(key);
+    std::lock_guard<std::mutex> lock(write_mutex);
+    migrate(MIGRATION_BATCH);
+    maybe_reclaim();
+
+    for (Table* table = current.load(std::memory_order_relaxed); table;
+         table = table->next.load(std::memory_order_relaxed)) {
+        int index = find_in(table, key, key_hash);
+        if (index >= 0) {
+            Entry* entry = table->slots[index].load(std::memory_order_relaxed);
+            table->slots[index].store(TOMBSTONE, std::memory_order_release);
+            retired_entries.push_back(entry);
+            elements_count.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    throw std::invalid_argument("Key not found");
+}
+
+/**
+ * @brief Retrieves the value associated with a key. Never blocks.
+ *
+ * @param key The key to search for.
+ * @return The value associated with the key.
+ * @throw invalid_argument if the key is not found.
+ */
+int ConcurrentHashTable::get(std::string_view key) const {
+    int value;
+    if (!try_get(key, value)) {
+        throw std::invalid_argument("Key not found");
+    }
+    return value;
+}
+
+/**
+ * @brief Retrieves the value associated with a key without throwing. Never blocks.
+ *
+ * @param key The key to search for.
+ * @param value Receives the value if the key is found.
+ * @return True if the key is found, otherwise false.
+ */
+bool ConcurrentHashTable::try_get(std::string_view key, int& value) const {
+    size_t key_hash = hasher(key);
+    ReadGuard guard(*this);
+    Entry* entry = find_entry(key, key_hash);
+    if (!entry) {
+        return false;
+    }
+    value = entry->value.load(std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Returns statistics about the hash table.
+ *
+ * @return A pair containing the number of elements and the size of the current table.
+ */
+std::pair<int, int> ConcurrentHashTable::get_stats() const {
+    ReadGuard guard(*this);
+    return {elements_count.load(std::memory_order_relaxed), current.load(std::memory_order_acquire)->size};
+}
+
+/**
+ * @brief Frees the removed entries and migrated tables no reader can still hold.
+ *
+ * Memory retired since the last epoch change is freed too if no reader of that epoch is left.
+ */
+void ConcurrentHashTable::collect_garbage() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    reclaim();
+    reclaim();
+}
@@ -0,0 +1,140 @@
+#include "Fingerprint.h"
+#include "HashFunctions.h"
+#include <openssl/evp.h>
+#include <stdexcept>
+
+struct Fingerprint::State {
+    FingerprintAlgorithm algorithm;  ///< The algorithm in use.
+    EVP_MD_CTX* md5 = nullptr;       ///< The MD5 digest context, if the algorithm is MD5.
+    Xxh64Hash::State xxh64;          ///< The xxHash state, if the algorithm is XXH64.
+
+    ~State() { EVP_MD_CTX_free(md5); }
+};
+
+/**
+ * @brief Starts hashing with the given algorithm.
+ *
+ * @param algorithm The hash algorithm.
+ * @throw std::runtime_error if OpenSSL cannot start an MD5 digest.
+ */
+Fingerprint::Fingerprint(FingerprintAlgorithm algorithm) : state(new State()) {
+    state->algorithm = algorithm;
+    if (algorithm == FingerprintAlgorithm::MD5) {
+        state->md5 = EVP_MD_CTX_new();
+        if (!state->md5 || EVP_DigestInit_ex(state->md5, EVP_md5(), nullptr) != 1) {
+            throw std::runtime_error("Cannot start an MD5 digest");
+        }
+    }
+}
+
+/**
+ * @brief Destroys the hash state.
+ */
+Fingerprint::~Fingerprint() {}
+
+/**
+ * @brief Hashes the next bytes of the input.
+ *
+ * @param data The bytes.
+ * @param length The number of bytes.
+ */
+void Fingerprint::update(const char* data, size_t length) {
+    if (state->algorithm == FingerprintAlgorithm::MD5) {
+        EVP_DigestUpdate(state->md5, data, length);
+    } else {
+        state->xxh64.update(data, length);
+    }
+}
+
+/**
+ * @brief Returns the digest of the bytes hashed so far; hashing can continue afterwards.
+ *
+ * @return The digest as a zero-padded hexadecimal string.
+ * @throw std::runtime_error if OpenSSL cannot finalize the MD5 digest.
+ */
+std::string Fingerprint::hex_digest() const {
+    static const char digits[] = "0123456789abcdef";
+    unsigned char bytes[EVP_MAX_MD_SIZE];
+    size_t size;
+    if (state->algorithm == FingerprintAlgorithm::MD5) {
+        // Finalize a copy so the running state can keep hashing
+        std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX*)> md5(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+        unsigned int md5_size = 0;
+        if (!md5 || EVP_MD_CTX_copy_ex(md5.get(), state->md5) != 1 ||
+            EVP_DigestFinal_ex(md5.get(), bytes, &md5_size) != 1) {
+            throw std::runtime_error("Cannot finalize an MD5 digest");
+        }
+        size = md5_size;
+    } else {
+        // xxHash's canonical representation is big endian
+        uint64_t hash = state->xxh64.digest();
+        for (size_t i = 0; i < sizeof(hash); ++i) {
+            bytes[i] = static_cast<unsigned char>(hash >> (56 - 8 * i));
+        }
+        size = sizeof(hash);
+    }
+
+    std::string hex(2 * size, '0');
+    for (size_t i = 0; i < size; ++i) {
+        hex[2 * i] = digits[bytes[i] >> 4];
+        hex[2 * i + 1] = digits[bytes[i] & 0xf];
+    }
+    return hex;
+}
+
+/**
+ * @brief Returns the checksum of the bytes hashed so far; hashing can continue afterwards.
+ *
+ * @return The checksum as "<algorithm>:<hexadecimal digest>".
+ */
+std::string Fingerprint::checksum() const {
+    return std::string(name(state->algorithm)) + ":" + hex_digest();
+}
+
+/**
+ * @brief Returns the algorithm in use.
+ *
+ * @return The hash algorithm.
+ */
+FingerprintAlgorithm Fingerprint::algorithm() const {
+    return state->algorithm;
+}
+
+/**
+ * @brief Returns the name of an algorithm as recorded in checksums.
+ *
+ * @param algorithm The hash algorithm.
+ * @return "md5" or "xxh64".
+ */
+const char* Fingerprint::name(FingerprintAlgorithm algorithm) {
+    return algorithm == FingerprintAlgorithm::MD5 ? "md5" : "xxh64";
+}
+
+/**
+ * @brief Finds the algorithm that produced a checksum.
+ *
+ * @param checksum A checksum as returned by checksum().
+ * @param algorithm Receives the algorithm named by the checksum.
+ * @return False if the checksum names no known algorithm, e.g. a bare digest.
+ */
+bool Fingerprint::parse(const std::string& checksum, FingerprintAlgorithm& algorithm) {
+    for (FingerprintAlgorithm candidate : {FingerprintAlgorithm::MD5, FingerprintAlgorithm::XXH64}) {
+        std::string prefix = std::string(name(candidate)) + ":";
+        if (checksum.compare(0, prefix.size(), prefix) == 0) {
+            algorithm = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Hashes a buffer in one call.
+ *
+ * @param data The bytes.
+ * @param length The number of bytes.
+ * @return The 64-bit xxHash of the bytes.
+ */
+uint64_t Fingerprint::xxh64(const char* data, size_t length) {
+    return Xxh64Hash::hash(data, length, 0);
+}
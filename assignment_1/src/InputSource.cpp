@@ -0,0 +1,135 @@
+#include "InputSource.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Opens an input file, mapping it if it is a non-empty regular file.
+ * 
+ * @param path The path of the file to read.
+ */
+InputSource::InputSource(const std::string& path)
+    : fd(-1), mapping(nullptr), mapping_size(0), position(0), streamed_size(0) {
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            mapping = static_cast<const char*>(address);
+            mapping_size = info.st_size;
+            madvise(address, mapping_size, MADV_SEQUENTIAL);
+            return;
+        }
+    }
+
+    // Not mappable (pipe, FIFO, empty or special file): stream it instead
+    buffer.resize(CHUNK_SIZE);
+}
+
+/**
+ * @brief Unmaps and closes the file.
+ */
+InputSource::~InputSource() {
+    if (mapping != nullptr) {
+        munmap(const_cast<char*>(mapping), mapping_size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Tells whether the file was opened successfully.
+ * 
+ * @return True if chunks can be read.
+ */
+bool InputSource::is_open() const {
+    return fd >= 0;
+}
+
+/**
+ * @brief Tells whether the file is memory-mapped, and can therefore be rewound.
+ * 
+ * @return True if the file is memory-mapped.
+ */
+bool InputSource::is_mapped() const {
+    return mapping != nullptr;
+}
+
+/**
+ * @brief Returns the next chunk of the input.
+ * 
+ * @param data Receives a pointer to the chunk, valid until the next call.
+ * @return The number of bytes in the chunk, or 0 at the end of the input.
+ * @throw runtime_error if reading from a streamed input fails.
+ */
+size_t InputSource::next(const char*& data) {
+    if (fd < 0) {
+        return 0;
+    }
+
+    if (mapping != nullptr) {
+        size_t length = std::min(CHUNK_SIZE, mapping_size - position);
+        data = mapping + position;
+        position += length;
+        return length;
+    }
+
+    ssize_t length;
+    do {
+        length = read(fd, buffer.data(), buffer.size());
+    } while (length < 0 && errno == EINTR);
+    if (length < 0) {
+        throw std::runtime_error(std::string("Could not read input: ") + std::strerror(errno));
+    }
+    data = buffer.data();
+    streamed_size += length;
+    return static_cast<size_t>(length);
+}
+
+/**
+ * @brief Restarts a memory-mapped input from its first byte.
+ * 
+ * @return True on success, false if the input is streamed and cannot be read again.
+ */
+bool InputSource::rewind() {
+    if (mapping == nullptr) {
+        return false;
+    }
+    position = 0;
+    return true;
+}
+
+/**
+ * @brief Returns the size of the input.
+ * 
+ * @return The size of the file if it is memory-mapped, otherwise the number of bytes read so far.
+ */
+uint64_t InputSource::size() const {
+    return mapping != nullptr ? mapping_size : streamed_size;
+}
+
+/**
+ * @brief Consumes the rest of a memory-mapped input in one piece.
+ * 
+ * @param data Receives a pointer to the remaining bytes, valid as long as the input.
+ * @return The number of remaining bytes, or 0 if the input is streamed or exhausted.
+ */
+size_t InputSource::take_remaining(const char*& data) {
+    if (mapping == nullptr) {
+        return 0;
+    }
+    size_t length = mapping_size - position;
+    data = mapping + position;
+    position = mapping_size;
+    return length;
+}
@@ -1,32 +1,166 @@
 #include "TextProcessor.h"
+#include "ByteRing.h"
+#include "InputSource.h"
+#include "WordTokenizer.h"
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <vector>
 #include <curl/curl.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <regex>
-#include <openssl/md5.h>
+#include <unistd.h>
 
 using namespace std;
 
 /**
  * @brief Constructs a new TextProcessor object.
+ * 
+ * @param algorithm The hash algorithm of the checksums process_file records.
+ */
+TextProcessor::TextProcessor(FingerprintAlgorithm algorithm) : algorithm(algorithm) {}
+
+/**
+ * @struct Download
+ * @brief The state of a book download shared with the curl callbacks.
+ */
+struct Download {
+    CURL* curl;                 ///< The transfer.
+    FILE* file;                 ///< The file the body is written to.
+    ByteRing* ring;             ///< Receives a copy of the body, if not null.
+    bool rejected;              ///< The response is not a 200 and its body was refused.
+    std::string etag;           ///< The ETag of the response, if any.
+    std::string last_modified;  ///< The Last-Modified date of the response, if any.
+};
+
+/**
+ * @class BatchCounter
+ * @brief A tokenizer sink that counts tokens into a table a batch at a time.
+ * 
+ * Batches go through HashTable::increment_batch, which overlaps the cache misses of their
+ * lookups. A tokenizer's views only last for one call, so tokens are copied into the batch;
+ * a copy costs a few bytes, a lookup in a table larger than the cache a memory round trip.
+ * flush() must be called after the tokenizer has finished.
  */
-TextProcessor::TextProcessor() {}
+class BatchCounter {
+public:
+    /**
+     * @brief Creates an empty batch.
+     * 
+     * @param table The table that counts the tokens.
+     */
+    explicit BatchCounter(HashTable& table) : table(table), used(0), count(0) {}
+
+    /**
+     * @brief Adds a token to the batch, counting the batch first if it is full.
+     * 
+     * @param token The token; copied, so it needs to stay valid only during the call.
+     */
+    void operator()(string_view token) {
+        if (count == BATCH_SIZE || used + token.size() > sizeof(bytes)) {
+            flush();
+        }
+        if (token.size() > sizeof(bytes)) {
+            table.increment(token);
+            return;
+        }
+        std::memcpy(bytes + used, token.data(), token.size());
+        tokens[count++] = string_view(bytes + used, token.size());
+        used += token.size();
+    }
+
+    /**
+     * @brief Counts the tokens of the batch.
+     */
+    void flush() {
+        table.increment_batch(tokens, count);
+        used = 0;
+        count = 0;
+    }
+
+private:
+    static const size_t BATCH_SIZE = 64;  ///< Tokens per batch.
+
+    HashTable& table;                ///< Counts the tokens.
+    char bytes[4096];                ///< The bytes of the batched tokens.
+    string_view tokens[BATCH_SIZE];  ///< The batched tokens, viewing bytes.
+    size_t used;                     ///< The bytes in use.
+    size_t count;                    ///< The number of batched tokens.
+};
 
 /**
  * @brief Helper function to handle data writing when downloading a file.
  * 
+ * Only the body of a successful response is kept: on anything else (e.g. an error page) the
+ * transfer is aborted before a byte reaches the file or the ring buffer.
+ * 
  * @param ptr Pointer to the data received.
  * @param size Size of each data chunk.
  * @param nmemb Number of chunks.
- * @param stream Output file stream.
- * @return The number of bytes written.
+ * @param userdata The download in progress.
+ * @return The number of bytes written, or 0 to abort the transfer.
+ */
+size_t TextProcessor::write_data(void* ptr, size_t size, size_t nmemb, void* userdata) {
+    Download& download = *static_cast<Download*>(userdata);
+    long response_code = 0;
+    curl_easy_getinfo(download.curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (response_code != 200) {
+        download.rejected = true;
+        return 0;
+    }
+
+    size_t length = size * nmemb;
+    if (fwrite(ptr, 1, length, download.file) != length) {
+        return 0;
+    }
+    if (download.ring && !download.ring->write(static_cast<const char*>(ptr), length)) {
+        return 0;
+    }
+    return length;
+}
+
+/**
+ * @brief Helper function recording the cache validators of a response when downloading a file.
+ * 
+ * @param buffer One header line, not null-terminated.
+ * @param size Always 1.
+ * @param nitems The length of the line.
+ * @param userdata The download in progress.
+ * @return The number of bytes handled.
  */
-size_t TextProcessor::write_data(void* ptr, size_t size, size_t nmemb, FILE* stream) {
-    size_t written = fwrite(ptr, size, nmemb, stream);
-    return written;
+size_t TextProcessor::header_data(char* buffer, size_t size, size_t nitems, void* userdata) {
+    Download& download = *static_cast<Download*>(userdata);
+    string line(buffer, size * nitems);
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) line.pop_back();
+
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        // A new response (e.g. after a redirect) starts: forget the previous one's headers
+        download.etag.clear();
+        download.last_modified.clear();
+        return size * nitems;
+    }
+    size_t colon = line.find(':');
+    if (colon != string::npos) {
+        string name = line.substr(0, colon);
+        transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return tolower(c); });
+        size_t value = line.find_first_not_of(' ', colon + 1);
+        string content = (value == string::npos) ? "" : line.substr(value);
+        if (name == "etag") {
+            download.etag = content;
+        } else if (name == "last-modified") {
+            download.last_modified = content;
+        }
+    }
+    return size * nitems;
 }
 
 /**
@@ -54,49 +188,141 @@ void TextProcessor::create_directory(const std::string& dir) {
     }
 }
 
+/**
+ * @brief Returns the file holding the cache validators of a downloaded book.
+ * 
+ * It holds "etag <value>" and "last-modified <value>" lines, as sent by the server.
+ * 
+ * @param output_path The file path of the book.
+ * @return The path of the validators file.
+ */
+static string validators_file(const string& output_path) {
+    return output_path + ".validators";
+}
+
 /**
  * @brief Downloads a book from the specified URL and saves it to the output path.
  * 
  * @param url The URL to download the book from.
  * @param output_path The file path where the downloaded book will be saved.
+ * @return True if a new copy was saved, false if the saved copy is current or the download failed.
+ */
+bool TextProcessor::download_book(const std::string& url, const std::string& output_path) {
+    try {
+        return fetch_book(url, output_path, nullptr);
+    } catch (const exception& e) {
+        cerr << "Failed to download book: " << e.what() << endl;
+        return false;
+    }
+}
+
+/**
+ * @brief Downloads a book with a conditional GET, optionally passing the body on as it arrives.
+ * 
+ * The validators of the last download are sent along, so the server answers 304 Not Modified
+ * without a body if the book did not change. A new body is written to a temporary file that
+ * replaces the saved copy only once the transfer completed.
+ * 
+ * @param url The URL to download the book from.
+ * @param output_path The file path where the downloaded book will be saved.
+ * @param ring If not null, receives a copy of the body.
+ * @return True if a new copy was saved, false if the saved copy is current.
+ * @throw runtime_error if the transfer fails; the saved copy is then left untouched.
  */
-void TextProcessor::download_book(const std::string& url, const std::string& output_path) {
+bool TextProcessor::fetch_book(const std::string& url, const std::string& output_path, ByteRing* ring) {
     string dir = "data";
     if (!directory_exists(dir)) {
         create_directory(dir);
     }
 
-    CURL* curl;
-    FILE* fp;
-    CURLcode res;
-    curl = curl_easy_init();
-    if (curl) {
-        fp = fopen(output_path.c_str(), "wb");
-        if (!fp) {
-            cerr << "Error: Could not open file for writing: " << output_path << endl;
-            return;
-        }
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            cerr << "Failed to download book: " << curl_easy_strerror(res) << endl;
+    // Validators are only worth sending if the copy they describe is still there
+    struct curl_slist* headers = nullptr;
+    ifstream saved_validators(validators_file(output_path));
+    struct stat info;
+    if (saved_validators.is_open() && stat(output_path.c_str(), &info) == 0) {
+        string name, value;
+        while (saved_validators >> name && getline(saved_validators >> ws, value)) {
+            if (name == "etag") {
+                headers = curl_slist_append(headers, ("If-None-Match: " + value).c_str());
+            } else if (name == "last-modified") {
+                headers = curl_slist_append(headers, ("If-Modified-Since: " + value).c_str());
+            }
         }
+    }
+
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        curl_slist_free_all(headers);
+        throw runtime_error("Could not initialize curl");
+    }
+    string temporary_path = output_path + ".part";
+    FILE* fp = fopen(temporary_path.c_str(), "wb");
+    if (!fp) {
+        curl_slist_free_all(headers);
         curl_easy_cleanup(curl);
-        fclose(fp);
+        throw runtime_error("Could not open file for writing: " + temporary_path);
+    }
+
+    Download download{curl, fp, ring, false, "", ""};
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &download);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_data);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &download);
+    CURLcode res = curl_easy_perform(curl);
+    long response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_cleanup(curl);
+    curl_slist_free_all(headers);
+    bool written = fclose(fp) == 0;
+
+    if (res == CURLE_OK && response_code == 304) {
+        remove(temporary_path.c_str());
+        cout << "Book not modified since the last download." << endl;
+        return false;
+    }
+    if (res != CURLE_OK || response_code != 200 || !written) {
+        remove(temporary_path.c_str());
+        if (download.rejected || (res == CURLE_OK && response_code != 200)) {
+            throw runtime_error("Server answered with HTTP status " + to_string(response_code));
+        }
+        throw runtime_error(res != CURLE_OK ? curl_easy_strerror(res) : "Could not write " + temporary_path);
     }
+    if (rename(temporary_path.c_str(), output_path.c_str()) != 0) {
+        remove(temporary_path.c_str());
+        throw runtime_error("Could not replace " + output_path);
+    }
+
+    ofstream validators(validators_file(output_path));
+    if (!download.etag.empty()) validators << "etag " << download.etag << "\n";
+    if (!download.last_modified.empty()) validators << "last-modified " << download.last_modified << "\n";
+    return true;
 }
 
 /**
  * @brief Cleans the input text by replacing non-alphanumeric characters with spaces.
  * 
+ * Every run of characters outside [a-zA-Z0-9] becomes a single space.
+ * 
  * @param text The input text to clean.
  * @return A cleaned version of the text.
  */
 string TextProcessor::clean_text(const string& text) {
-    regex non_alpha_numeric("[^a-zA-Z0-9]+");
-    return regex_replace(text, non_alpha_numeric, " ");
+    string cleaned;
+    cleaned.reserve(text.size());
+    bool in_separator = false;
+    for (char c : text) {
+        if (WordTokenizer::is_word_char(c)) {
+            cleaned.push_back(c);
+            in_separator = false;
+        } else if (!in_separator) {
+            cleaned.push_back(' ');
+            in_separator = true;
+        }
+    }
+    return cleaned;
 }
 
 /**
@@ -104,34 +330,130 @@ string TextProcessor::clean_text(const string& text) {
  * 
  * @param file_path The path to the file from which to extract words.
  * @param hash_table The hash table to store the extracted words.
+ * @param thread_count The number of threads counting words.
  */
-void TextProcessor::extract_words(const string& file_path, HashTable& hash_table) {
-    ifstream file(file_path);
-    if (!file.is_open()) {
+void TextProcessor::extract_words(const string& file_path, HashTable& hash_table, int thread_count) {
+    InputSource input(file_path);
+    if (!input.is_open()) {
         cerr << "Error: Could not open file: " << file_path << endl;
         return;
     }
+    extract_words(input, hash_table, thread_count);
+}
+
+/**
+ * @brief Splits a text into at most the given number of consecutive parts that end on whitespace.
+ * 
+ * Since neither a token nor a whitespace separated word crosses a whitespace byte, counting the
+ * parts separately yields the same words as counting the whole text.
+ * 
+ * @param data The text.
+ * @param length The number of bytes in the text.
+ * @param parts The requested number of parts.
+ * @return The end offset of every non-empty part, in order.
+ */
+static vector<size_t> split_on_whitespace(const char* data, size_t length, size_t parts) {
+    vector<size_t> ends;
+    size_t begin = 0;
+    for (size_t i = 1; i <= parts && begin < length; ++i) {
+        size_t end = (i == parts) ? length : max(begin, length / parts * i);
+        while (end < length && !WordTokenizer::is_space(data[end])) ++end;
+        if (end > begin) ends.push_back(end);
+        begin = end;
+    }
+    return ends;
+}
+
+/**
+ * @brief Counts the words of a text on several threads and merges the counts into a hash table.
+ * 
+ * The text is split on whitespace into one part per thread, and every thread counts its part into
+ * a private table, so no locks are taken. The private tables are merged in text order, which makes
+ * the result, including get_first() and get_last(), identical to a sequential count. The merge
+ * only touches the distinct words of every part, which is small next to tokenizing.
+ * 
+ * @param data The text.
+ * @param length The number of bytes in the text.
+ * @param hash_table The hash table to store the extracted words.
+ * @param thread_count The number of threads counting words.
+ * @param fingerprint If not null, the text is also hashed into it on the calling thread while the
+ * other threads count.
+ * @return The number of whitespace separated words in the text.
+ */
+static size_t extract_words_parallel(const char* data, size_t length, HashTable& hash_table,
+                                     int thread_count, Fingerprint* fingerprint) {
+    // Parts smaller than this are not worth a thread
+    const size_t min_part_size = 1 << 20;
+    size_t parts = max<size_t>(1, min(static_cast<size_t>(thread_count), length / min_part_size));
+    vector<size_t> ends = split_on_whitespace(data, length, parts);
 
-    string word;
-    int word_count = 0;
+    vector<HashTable> tables(ends.size(), HashTable(1 << 14));
+    vector<size_t> word_counts(ends.size(), 0);
+    vector<exception_ptr> errors(ends.size());
+    vector<thread> workers;
+    workers.reserve(ends.size());
 
-    while (file >> word) {
-        word_count++;
-        string cleaned_word = clean_text(word);
-        stringstream ss(cleaned_word);
-        string processed_word;
-        while (ss >> processed_word) {
-            transform(processed_word.begin(), processed_word.end(), processed_word.begin(), ::tolower);
-            if (processed_word.empty()) continue;
+    for (size_t i = 0; i < ends.size(); ++i) {
+        size_t begin = (i == 0) ? 0 : ends[i - 1];
+        workers.emplace_back([&, i, begin]() {
             try {
-                int count = hash_table.get(processed_word);
-                hash_table.insert(processed_word, count + 1);
-            } catch (const invalid_argument&) {
-                hash_table.insert(processed_word, 1);
+                WordTokenizer tokenizer;
+                HashTable& table = tables[i];
+                BatchCounter count_token(table);
+                tokenizer.feed(data + begin, ends[i] - begin, count_token);
+                tokenizer.finish(count_token);
+                count_token.flush();
+                word_counts[i] = tokenizer.word_count();
+            } catch (...) {
+                errors[i] = current_exception();
             }
-        }
+        });
+    }
+
+    if (fingerprint) {
+        fingerprint->update(data, length);
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    size_t word_count = 0;
+    for (size_t i = 0; i < ends.size(); ++i) {
+        if (errors[i]) rethrow_exception(errors[i]);
+        hash_table.merge(tables[i]);
+        word_count += word_counts[i];
+    }
+    return word_count;
+}
+
+/**
+ * @brief Extracts the words of the remaining input and adds them to the hash table.
+ * 
+ * The input is tokenized chunk by chunk by a WordTokenizer, so tokens reach the hash table as
+ * std::string_view without any per-word allocation; a key is only copied once, into the table's
+ * key arena, the first time it is seen. A memory-mapped input is counted on thread_count threads.
+ * 
+ * @param input The input to read.
+ * @param hash_table The hash table to store the extracted words.
+ * @param thread_count The number of threads counting words.
+ */
+void TextProcessor::extract_words(InputSource& input, HashTable& hash_table, int thread_count) {
+    size_t word_count;
+    const char* data;
+    size_t length;
+    if (thread_count > 1 && input.is_mapped()) {
+        length = input.take_remaining(data);
+        word_count = extract_words_parallel(data, length, hash_table, thread_count, nullptr);
+    } else {
+        WordTokenizer tokenizer;
+        BatchCounter count_token(hash_table);
+        input.for_each_chunk([&](const char* data, size_t length) {
+            tokenizer.feed(data, length, count_token);
+        });
+        tokenizer.finish(count_token);
+        count_token.flush();
+        word_count = tokenizer.word_count();
     }
-    file.close();
     cout << "Finished processing " << word_count << " words." << endl;
 }
 
@@ -143,61 +465,537 @@ void TextProcessor::extract_words(const string& file_path, HashTable& hash_table
  * @throw runtime_error if the file cannot be opened.
  */
 string TextProcessor::compute_md5(const string& filename) {
-    ifstream file(filename, ios::binary);
-    if (!file.is_open()) {
+    InputSource input(filename);
+    if (!input.is_open()) {
         throw runtime_error("Could not open file to compute checksum");
     }
+    return compute_md5(input);
+}
 
-    MD5_CTX md5_ctx;
-    MD5_Init(&md5_ctx);
+/**
+ * @brief Computes the MD5 checksum of the remaining input.
+ * 
+ * @param input The input to read.
+ * @return A string representing the MD5 checksum of the input.
+ */
+string TextProcessor::compute_md5(InputSource& input) {
+    Fingerprint md5(FingerprintAlgorithm::MD5);
+    input.for_each_chunk([&](const char* data, size_t length) {
+        md5.update(data, length);
+    });
+    return md5.hex_digest();
+}
+
+/**
+ * @brief Computes the checksum of the remaining input with the configured algorithm.
+ * 
+ * @param input The input to read.
+ * @return The checksum as "<algorithm>:<digest>".
+ */
+string TextProcessor::compute_checksum(InputSource& input) {
+    Fingerprint fingerprint(algorithm);
+    input.for_each_chunk([&](const char* data, size_t length) {
+        fingerprint.update(data, length);
+    });
+    return fingerprint.checksum();
+}
 
-    char buffer[4096];
-    while (file.read(buffer, sizeof(buffer))) {
-        MD5_Update(&md5_ctx, buffer, file.gcount());
+/**
+ * @brief Computes the checksum of the remaining input and extracts its words in the same pass.
+ * 
+ * Every chunk is hashed and then tokenized while it is still in cache, so the input is only
+ * read once. With several threads, a memory-mapped input is hashed on the calling thread while
+ * the other threads count its words.
+ * 
+ * @param input The input to read.
+ * @param hash_table The hash table to store the extracted words.
+ * @param thread_count The number of threads counting words.
+ * @return The checksum of the input as "<algorithm>:<digest>", with the configured algorithm.
+ */
+string TextProcessor::compute_checksum_and_extract_words(InputSource& input, HashTable& hash_table, int thread_count) {
+    Fingerprint fingerprint(algorithm);
+    size_t word_count;
+    const char* data;
+    size_t length;
+    if (thread_count > 1 && input.is_mapped()) {
+        length = input.take_remaining(data);
+        word_count = extract_words_parallel(data, length, hash_table, thread_count, &fingerprint);
+    } else {
+        WordTokenizer tokenizer;
+        BatchCounter count_token(hash_table);
+        input.for_each_chunk([&](const char* data, size_t length) {
+            fingerprint.update(data, length);
+            tokenizer.feed(data, length, count_token);
+        });
+        tokenizer.finish(count_token);
+        count_token.flush();
+        word_count = tokenizer.word_count();
     }
+    cout << "Finished processing " << word_count << " words." << endl;
+    return fingerprint.checksum();
+}
 
-    unsigned char result[MD5_DIGEST_LENGTH];
-    MD5_Final(result, &md5_ctx);
+/**
+ * @brief Computes the checksums of a prefix of the remaining input and of the whole input in one pass.
+ * 
+ * @param input The input to read.
+ * @param algorithm The hash algorithm to use.
+ * @param prefix_length The length of the prefix.
+ * @param prefix_checksum Receives the checksum of the first prefix_length bytes, or is left empty if the
+ * input is shorter.
+ * @return The checksum of the whole input as "<algorithm>:<digest>".
+ */
+string TextProcessor::compute_checksum(InputSource& input, FingerprintAlgorithm algorithm, uint64_t prefix_length,
+                                       string& prefix_checksum) {
+    Fingerprint fingerprint(algorithm);
+    uint64_t offset = 0;
+    prefix_checksum.clear();
+    if (prefix_length == 0) {
+        prefix_checksum = fingerprint.checksum();
+    }
+    input.for_each_chunk([&](const char* data, size_t length) {
+        if (offset < prefix_length && prefix_length <= offset + length) {
+            // The prefix ends in this chunk: take the running checksum there
+            size_t head = static_cast<size_t>(prefix_length - offset);
+            fingerprint.update(data, head);
+            prefix_checksum = fingerprint.checksum();
+            data += head;
+            length -= head;
+            offset += head;
+        }
+        fingerprint.update(data, length);
+        offset += length;
+    });
+    return fingerprint.checksum();
+}
+
+/**
+ * @brief The snapshot of the word count table saved by process_file.
+ */
+static const string SNAPSHOT_FILE = "hash_table.dat";
+
+/**
+ * @brief The delta log recording the changes made to the table since SNAPSHOT_FILE was saved.
+ */
+static const string DELTA_LOG_FILE = SNAPSHOT_FILE + ".log";
+
+/**
+ * @brief Marks a checksum file that does not record the processed length.
+ */
+static const uint64_t UNKNOWN_LENGTH = static_cast<uint64_t>(-1);
 
-    ostringstream md5_string;
-    for (int i = 0; i < MD5_DIGEST_LENGTH; ++i) {
-        md5_string << hex << static_cast<int>(result[i]);
+/**
+ * @brief The number of blocks of an input hashed into its stamp.
+ */
+static const size_t STAMP_SAMPLE_COUNT = 16;
+
+/**
+ * @brief The size of every block hashed into an input's stamp.
+ */
+static const size_t STAMP_SAMPLE_SIZE = 4096;
+
+/**
+ * @brief Summarizes a memory-mapped input by its size, modification time and a hash of evenly spaced blocks.
+ * 
+ * Two inputs with the same stamp are taken to be identical without hashing them entirely, the way
+ * build tools trust modification times; the sampled blocks additionally catch most edits that keep
+ * the size and restore the modification time. A file modified in the last two seconds is not stamped,
+ * since it may be written again within the resolution of its modification time.
+ * 
+ * @param file_path The path of the input.
+ * @param input The input, not read yet.
+ * @return The stamp as "<size>-<modification time>-<sample hash>", or an empty string if the input is
+ * streamed or too recent.
+ */
+static string input_stamp(const string& file_path, InputSource& input) {
+    struct stat info;
+    if (!input.is_mapped() || stat(file_path.c_str(), &info) != 0 ||
+        static_cast<uint64_t>(info.st_size) != input.size() || time(nullptr) - info.st_mtim.tv_sec < 2) {
+        return "";
+    }
+
+    const char* data;
+    size_t length = input.take_remaining(data);
+    input.rewind();
+    Fingerprint samples;
+    if (length <= STAMP_SAMPLE_COUNT * STAMP_SAMPLE_SIZE) {
+        samples.update(data, length);
+    } else {
+        for (size_t i = 0; i < STAMP_SAMPLE_COUNT; ++i) {
+            size_t offset = static_cast<size_t>(static_cast<uint64_t>(length - STAMP_SAMPLE_SIZE) * i /
+                                                (STAMP_SAMPLE_COUNT - 1));
+            samples.update(data + offset, STAMP_SAMPLE_SIZE);
+        }
+    }
+
+    ostringstream stamp;
+    stamp << length << "-" << info.st_mtim.tv_sec << "." << setw(9) << setfill('0') << info.st_mtim.tv_nsec << "-"
+          << samples.hex_digest();
+    return stamp.str();
+}
+
+/**
+ * @brief Reads what the snapshot covers from a checksum file: "<checksum> <processed length> [<stamp>]".
+ * 
+ * The checksum names its algorithm ("xxh64:..." or "md5:..."); a file written before that
+ * only holds a bare MD5 digest of the whole input, which no longer matches and forces a rebuild.
+ * 
+ * @param hash_file The path to the checksum file.
+ * @return The checksum, processed length and stamp, with an empty checksum if the file is missing.
+ */
+static DeltaLog::Commit read_checksum_file(const string& hash_file) {
+    DeltaLog::Commit saved{UNKNOWN_LENGTH, "", ""};
+    ifstream existing_checksum(hash_file);
+    if (existing_checksum.is_open()) {
+        existing_checksum >> saved.checksum;
+        if (!(existing_checksum >> saved.length)) {
+            saved.length = UNKNOWN_LENGTH;
+        } else {
+            existing_checksum >> saved.stamp;
+        }
+    }
+    return saved;
+}
+
+/**
+ * @brief Flushes a file or directory to disk.
+ * 
+ * @return False if it cannot be opened or synced.
+ */
+static bool sync_path(const string& path, int flags) {
+    int fd = ::open(path.c_str(), flags);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+/**
+ * @brief Writes what the snapshot covers to a checksum file and flushes it to disk.
+ * 
+ * A torn checksum file only costs a recount, but a stale one next to a newer snapshot would count
+ * the tail twice, so it is synced before the delta log may be emptied.
+ * 
+ * @param hash_file The path to the checksum file.
+ * @param saved The checksum, processed length and stamp.
+ * @throw runtime_error if the file cannot be written or synced.
+ */
+static void write_checksum_file(const string& hash_file, const DeltaLog::Commit& saved) {
+    ofstream checksum_file(hash_file);
+    checksum_file << saved.checksum << " " << saved.length;
+    if (!saved.stamp.empty()) {
+        checksum_file << " " << saved.stamp;
+    }
+    checksum_file.close();
+    if (!checksum_file || !sync_path(hash_file, O_RDONLY)) {
+        throw runtime_error("Could not write checksum file " + hash_file);
+    }
+}
+
+/**
+ * @brief Replaces SNAPSHOT_FILE with a snapshot of a table, atomically and durably.
+ * 
+ * The snapshot is written to a temporary file, which is synced before it is renamed over the old
+ * one; the directory is synced after the rename. Once this returns, the new snapshot survives a
+ * power loss, and until then the old one is left intact.
+ * 
+ * @param hash_table The table.
+ * @throw runtime_error if the snapshot cannot be written, synced or renamed.
+ */
+static void replace_snapshot(const HashTable& hash_table) {
+    string temporary_file = SNAPSHOT_FILE + ".tmp";
+    hash_table.save_to_file(temporary_file);
+    if (!sync_path(temporary_file, O_RDONLY)) {
+        throw runtime_error("Could not sync " + temporary_file);
+    }
+    if (rename(temporary_file.c_str(), SNAPSHOT_FILE.c_str()) != 0) {
+        throw runtime_error("Could not replace " + SNAPSHOT_FILE);
+    }
+    // SNAPSHOT_FILE is relative to the working directory
+    if (!sync_path(".", O_RDONLY | O_DIRECTORY)) {
+        throw runtime_error("Could not sync the directory of " + SNAPSHOT_FILE);
+    }
+}
+
+/**
+ * @brief Counts the words appended to an input after a processed prefix and logs the changes.
+ * 
+ * If the prefix ends inside a token that the appended text continues, that token was counted
+ * incompletely: it is taken back and counted again together with the tail. The tail is counted
+ * into a separate table, merged into the hash table in order and every changed count is appended
+ * to the delta log.
+ * 
+ * @param data The whole input.
+ * @param length The length of the input.
+ * @param processed_length The length of the prefix that is already counted.
+ * @param hash_table The hash table holding the counts of the prefix.
+ * @param log The delta log of the hash table.
+ * @param thread_count The number of threads counting words.
+ */
+static void extract_tail(const char* data, size_t length, size_t processed_length, HashTable& hash_table,
+                         DeltaLog& log, int thread_count) {
+    size_t start = processed_length;
+    if (start > 0 && WordTokenizer::is_word_char(data[start - 1]) && WordTokenizer::is_word_char(data[start])) {
+        while (start > 0 && WordTokenizer::is_word_char(data[start - 1])) --start;
+        WordTokenizer tokenizer;
+        auto uncount_token = [&](string_view token) {
+            if (hash_table.increment(token, -1) == 0) {
+                hash_table.remove(token);
+                log.log_remove(token);
+            } else {
+                log.log_insert(token, hash_table.get(token));
+            }
+        };
+        tokenizer.feed(data + start, processed_length - start, uncount_token);
+        tokenizer.finish(uncount_token);
+    }
+
+    HashTable tail(1024);
+    size_t word_count;
+    if (thread_count > 1) {
+        word_count = extract_words_parallel(data + start, length - start, tail, thread_count, nullptr);
+    } else {
+        WordTokenizer tokenizer;
+        BatchCounter count_token(tail);
+        tokenizer.feed(data + start, length - start, count_token);
+        tokenizer.finish(count_token);
+        count_token.flush();
+        word_count = tokenizer.word_count();
+    }
+    cout << "Finished processing " << word_count << " words." << endl;
+
+    hash_table.merge(tail);
+    tail.for_each([&](string_view key, int) { log.log_insert(key, hash_table.get(key)); });
+}
+
+/**
+ * @brief Saves a freshly built table for future runs.
+ * 
+ * The old delta log no longer applies, so it is emptied first; the checksum file is written last.
+ * 
+ * @param hash_table The table.
+ * @param log The delta log of the snapshot.
+ * @param hash_file The path to the checksum file.
+ * @param saved The input the table covers.
+ */
+static void save_snapshot(const HashTable& hash_table, DeltaLog& log, const string& hash_file,
+                          const DeltaLog::Commit& saved) {
+    log.reset();
+    replace_snapshot(hash_table);
+    write_checksum_file(hash_file, saved);
+}
+
+/**
+ * @brief Destroys the TextProcessor, waiting for a background compaction to finish.
+ */
+TextProcessor::~TextProcessor() {
+    wait_for_compaction();
+}
+
+/**
+ * @brief Waits until a background compaction started by process_file has finished.
+ */
+void TextProcessor::wait_for_compaction() {
+    if (compaction_thread.joinable()) {
+        compaction_thread.join();
     }
+}
 
-    return md5_string.str();
+/**
+ * @brief Saves a copy of the table as the new snapshot on a background thread, then empties the delta log.
+ * 
+ * The snapshot is written to a temporary file, synced and renamed, and the directory synced; then
+ * the checksum file is written and synced, and only then is the log emptied. A crash or power
+ * loss at any point leaves a snapshot that the log can be replayed on.
+ * 
+ * @param hash_table The table to snapshot.
+ * @param saved The input prefix the table covers.
+ * @param hash_file The path to the checksum file.
+ */
+void TextProcessor::start_compaction(const HashTable& hash_table, const DeltaLog::Commit& saved,
+                                     const std::string& hash_file) {
+    wait_for_compaction();
+    compaction_thread = thread([snapshot = hash_table, saved, hash_file]() {
+        try {
+            replace_snapshot(snapshot);
+            write_checksum_file(hash_file, saved);
+            DeltaLog(DELTA_LOG_FILE).reset();
+        } catch (const exception& e) {
+            cerr << "Error: Background compaction failed: " << e.what() << endl;
+        }
+    });
 }
 
 /**
  * @brief Processes the file by comparing its checksum with an existing one, then either loads a previously
  * saved hash table or processes the file and rebuilds the hash table.
  * 
- * This function computes the MD5 checksum of the specified text file, compares it with an existing checksum
+ * This function computes the checksum of the specified text file, compares it with an existing checksum
  * stored in the given hash file. If the checksums match and a saved hash table is available, it loads the
  * hash table from a file. Otherwise, it processes the file to extract words and build the hash table, and 
  * saves both the checksum and the hash table for future runs.
  * 
+ * The checksum file records how many bytes the saved table covers, and a delta log next to the snapshot
+ * records the changes made since it was saved. If the file only grew since then, the snapshot is loaded,
+ * the log is replayed and only the appended tail is counted; the changes are appended to the log, which
+ * is compacted into a new snapshot in the background once it reaches a quarter of the snapshot's size.
+ * 
+ * The checksum file also records a stamp of the file (size, modification time and a hash of sampled
+ * blocks). If the stamp is unchanged, the saved table is loaded without hashing the file at all; any
+ * difference escalates to hashing the file with the algorithm the saved checksum names. New checksums
+ * use the algorithm the TextProcessor was constructed with.
+ * 
+ * The file is read once: without a saved checksum (or when it cannot be mapped) hashing and tokenizing are
+ * fused into a single pass; otherwise the mapping is hashed first and only tokenized on a mismatch.
+ * 
  * @param hash_table The hash table to be populated or loaded.
  * @param file_path The path to the text file being processed.
  * @param hash_file The path to the file that stores the checksum of the previously processed file.
+ * @param thread_count The number of threads counting words.
  */
-void TextProcessor::process_file(HashTable& hash_table, const std::string& file_path, const std::string& hash_file) {
-    std::string checksum = compute_md5(file_path);
-    std::ifstream existing_checksum(hash_file);
-    std::string saved_checksum;
-    if (existing_checksum.is_open()) {
-        existing_checksum >> saved_checksum;
-        existing_checksum.close();
+void TextProcessor::process_file(HashTable& hash_table, const std::string& file_path, const std::string& hash_file,
+                                 int thread_count) {
+    // The snapshot must not change while it is loaded
+    wait_for_compaction();
+
+    InputSource input(file_path);
+    if (!input.is_open()) {
+        throw runtime_error("Could not open file to compute checksum");
     }
-    if (saved_checksum == checksum && hash_table.load_from_file("hash_table.dat")) {
-        std::cout << "Checksum matches, loaded hash table from file." << std::endl;
+
+    DeltaLog log(DELTA_LOG_FILE);
+    DeltaLog::Commit saved = read_checksum_file(hash_file);
+    log.last_commit(saved);
+    std::string stamp = input_stamp(file_path, input);
+
+    std::string checksum;
+    FingerprintAlgorithm saved_algorithm = algorithm;
+    if (Fingerprint::parse(saved.checksum, saved_algorithm) && input.is_mapped()) {
+        DeltaLog::Commit replayed;
+        if (!stamp.empty() && stamp == saved.stamp && saved.length == input.size() &&
+            hash_table.load_from_file(SNAPSHOT_FILE)) {
+            log.replay(hash_table, replayed);
+            std::cout << "File unchanged since the last run, loaded hash table from file." << std::endl;
+            return;
+        }
+
+        // A saved table may be reusable, so only hash the file first; on a mismatch the
+        // mapping is tokenized without reading the file again.
+        uint64_t processed_length = (saved.length == UNKNOWN_LENGTH) ? input.size() : saved.length;
+        std::string prefix_checksum;
+        checksum = compute_checksum(input, saved_algorithm, processed_length, prefix_checksum);
+        if (saved.checksum == prefix_checksum && hash_table.load_from_file(SNAPSHOT_FILE)) {
+            log.replay(hash_table, replayed);
+            if (processed_length == input.size()) {
+                std::cout << "Checksum matches, loaded hash table from file." << std::endl;
+                if (stamp != saved.stamp) {
+                    // Only the stamp changed (e.g. the file was touched): skip hashing next time
+                    log.log_commit(DeltaLog::Commit{processed_length, checksum, stamp});
+                }
+                return;
+            }
+
+            std::cout << "File grew by " << input.size() - processed_length << " bytes, counting only the new text."
+                      << std::endl;
+            const char* data;
+            input.rewind();
+            size_t length = input.take_remaining(data);
+            extract_tail(data, length, processed_length, hash_table, log, thread_count);
+            DeltaLog::Commit grown{length, checksum, stamp};
+            log.log_commit(grown);
+
+            struct stat info;
+            if (stat(SNAPSHOT_FILE.c_str(), &info) != 0 || log.size_on_disk() * 4 > static_cast<uint64_t>(info.st_size)) {
+                start_compaction(hash_table, grown, hash_file);
+            }
+            return;
+        }
+        input.rewind();
+    }
+
+    std::cout << "Checksum mismatch or no previous data, processing file and building hash table." << std::endl;
+    // Extract words from the book and populate the hash table, hashing it in the same pass if needed
+    if (checksum.empty() || saved_algorithm != algorithm) {
+        checksum = compute_checksum_and_extract_words(input, hash_table, thread_count);
     } else {
-        std::cout << "Checksum mismatch or no previous data, processing file and building hash table." << std::endl;
-        // Extract words from the book and populate the hash table
-        extract_words(file_path, hash_table);
-        // Save the checksum and hash table for future runs
-        std::ofstream checksum_file(hash_file);
-        checksum_file << checksum;
-        checksum_file.close();
-        hash_table.save_to_file("hash_table.dat");
-    }
-}
\ No newline at end of file
+        extract_words(input, hash_table, thread_count);
+    }
+    save_snapshot(hash_table, log, hash_file, DeltaLog::Commit{input.size(), checksum, stamp});
+}
+
+/**
+ * @brief The capacity of the ring buffer between a download and the word counter.
+ */
+static const size_t DOWNLOAD_RING_SIZE = 4 << 20;
+
+/**
+ * @brief Downloads a book and counts its words while it arrives, then saves the table for future runs.
+ * 
+ * The curl callback writes every block of the body to the file and to a bounded ring buffer; a
+ * second thread hashes and tokenizes the ring's contents as they arrive, so counting overlaps the
+ * transfer and the file is never read back. When the ring is full the transfer waits for the counter.
+ * The words are counted into an empty table with the capacity and hash parameters of the hash
+ * table, which replaces it once the whole book arrived, so words already in it are not counted twice.
+ * 
+ * @param url The URL to download the book from.
+ * @param output_path The file path where the downloaded book will be saved.
+ * @param hash_table The hash table to be populated or loaded.
+ * @param hash_file The path to the file that stores the checksum of the previously processed file.
+ * @param thread_count The number of threads counting words when the saved copy is processed.
+ */
+void TextProcessor::download_and_process(const std::string& url, const std::string& output_path,
+                                         HashTable& hash_table, const std::string& hash_file, int thread_count) {
+    // The snapshot is replaced once the book arrived
+    wait_for_compaction();
+
+    ByteRing ring(DOWNLOAD_RING_SIZE);
+    HashTable counted = hash_table.empty_copy();
+    Fingerprint fingerprint(algorithm);
+    uint64_t length = 0;
+    size_t word_count = 0;
+    exception_ptr error;
+    thread counter([&]() {
+        try {
+            WordTokenizer tokenizer;
+            BatchCounter count_token(counted);
+            const char* data;
+            size_t available;
+            while ((available = ring.read(data)) != 0) {
+                fingerprint.update(data, available);
+                tokenizer.feed(data, available, count_token);
+                ring.consume(available);
+                length += available;
+            }
+            tokenizer.finish(count_token);
+            count_token.flush();
+            word_count = tokenizer.word_count();
+        } catch (...) {
+            error = current_exception();
+            ring.abort();
+        }
+    });
+
+    bool downloaded = false;
+    try {
+        downloaded = fetch_book(url, output_path, &ring);
+    } catch (const exception& e) {
+        cerr << "Failed to download book: " << e.what() << endl;
+    }
+    ring.close();
+    counter.join();
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    if (!downloaded) {
+        // Not modified, or unreachable: the saved copy is the best there is
+        process_file(hash_table, output_path, hash_file, thread_count);
+        return;
+    }
+    cout << "Finished processing " << word_count << " words while downloading." << endl;
+    hash_table = std::move(counted);
+    DeltaLog log(DELTA_LOG_FILE);
+    save_snapshot(hash_table, log, hash_file, DeltaLog::Commit{length, fingerprint.checksum(), ""});
+}
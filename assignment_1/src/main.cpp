@@ -1,8 +1,14 @@
+#include "FrozenHashTable.h"
 #include "HashTable.h"
 #include "TextProcessor.h"
 #include "PerformanceTimer.h"
+#include <algorithm>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -24,15 +30,16 @@ int main() {
     // Create a TextProcessor instance
     TextProcessor text_processor;
 
-    cout << "Downloading book" << endl;
-    // Download the book
-    text_processor.download_book(url, output_path);
-
     // Create a hash table with an initial size of 5000
     HashTable hash_table(5000);
 
-    // Process the file by comparing the checksum and either loading or building the hash table
-    text_processor.process_file(hash_table, output_path, checksum_file);
+    // Number of threads counting words; 1 processes the book sequentially
+    int thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    cout << "Downloading book" << endl;
+    // Download the book and count its words as it arrives; an unchanged book is not downloaded again,
+    // and the saved copy is processed by comparing the checksum and either loading or building the hash table
+    text_processor.download_and_process(url, output_path, hash_table, checksum_file, thread_count);
     cout << "Done processing book" << endl;
 
     // Display some data and use PerformanceTimer to measure performance
@@ -55,15 +62,83 @@ int main() {
         timeTaken = timer.stop();
         cout << "Last inserted: " << last.first << " -> " << last.second << " in " << timeTaken << " ms" << endl;
 
+        // Time the selection of the most frequent words
+        timer.start();
+        auto top_words = hash_table.top_k(10);
+        timeTaken = timer.stop();
+        cout << "Most frequent words (found in " << timeTaken << " ms):";
+        for (const auto& word : top_words) {
+            cout << " " << word.first << " (" << word.second << ")";
+        }
+        cout << endl;
+
+        // Show how far keys sit from their home slot, to tune the hash and the load factor
+        auto probe_stats = hash_table.get_probe_stats();
+        cout << "Average probe length: " << probe_stats.average_probe_length
+             << ", longest probe: " << probe_stats.probe_lengths.size()
+             << ", largest cluster: " << probe_stats.cluster_sizes.size() - 1 << endl;
+
+        // Measure the latency distribution of a lookup and an insertion of every distinct word, in
+        // order of decreasing count so the order favours neither table layout; build with
+        // `make PERF_FLAGS=-DPERF_TIMER_RDTSC` for a cheaper clock on x86
+        auto all_words = hash_table.top_k(stats.first);
+        LatencyHistogram& get_latency = PerformanceRegistry::histogram("get");
+        LatencyHistogram& insert_latency = PerformanceRegistry::histogram("insert");
+        HashTable copy(stats.second);
+        for (const auto& word : all_words) {
+            {
+                ScopedTimer scope(get_latency);
+                hash_table.get(word.first);
+            }
+            ScopedTimer scope(insert_latency);
+            copy.insert(word.first, word.second);
+        }
+
+        // Freeze the table for read-only serving: one perfect hash, one slot and one key compare per lookup
+        timer.start();
+        FrozenHashTable frozen(hash_table);
+        timeTaken = timer.stop();
+        cout << "Frozen " << frozen.size() << " words in " << timeTaken << " ms" << endl;
+        LatencyHistogram& frozen_get_latency = PerformanceRegistry::histogram("frozen get");
+        for (const auto& word : all_words) {
+            ScopedTimer scope(frozen_get_latency);
+            frozen.get(word.first);
+        }
+        cout << "Latencies over " << stats.first << " words:" << endl;
+        PerformanceRegistry::report(cout);
+
+        // Compare the throughput of single lookups with batched ones, whose cache misses overlap
+        std::vector<std::string_view> all_keys;
+        all_keys.reserve(all_words.size());
+        for (const auto& word : all_words) {
+            all_keys.push_back(word.first);
+        }
+        std::vector<const int*> found(all_keys.size());
+        timer.start();
+        for (size_t i = 0; i < all_keys.size(); ++i) {
+            found[i] = hash_table.try_get(all_keys[i]);
+        }
+        timeTaken = timer.stop();
+        cout << "Looked up " << all_keys.size() << " words one at a time in " << timeTaken << " ms";
+        timer.start();
+        hash_table.get_batch(all_keys.data(), all_keys.size(), found.data());
+        timeTaken = timer.stop();
+        cout << ", in batches in " << timeTaken << " ms" << endl;
+
         // Time the search for specific words
         std::vector<std::string> words = {"london", "manette", "dover"};
 
-        // Loop to handle repeated queries for the words in the list
-        for (const auto& word : words) {
-            timer.start();
-            int count = hash_table.get(word);
-            double timeTaken = timer.stop();
-            std::cout << "Count of '" << word << "': " << count << " in " << timeTaken << " ms" << std::endl;
+        // Look the words up as one batch, then report each of them
+        std::vector<const int*> counts(words.size());
+        timer.start();
+        hash_table.get_batch(words.data(), words.size(), counts.data());
+        timeTaken = timer.stop();
+        std::cout << "Searched " << words.size() << " words in " << timeTaken << " ms" << std::endl;
+        for (size_t i = 0; i < words.size(); ++i) {
+            if (!counts[i]) {
+                throw std::invalid_argument("Key not found");
+            }
+            std::cout << "Count of '" << words[i] << "': " << *counts[i] << std::endl;
         }
 
         // Test remove functionality.
@@ -0,0 +1,186 @@
+#include "TradeParser.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The response the benchmarks replay: $BENCHMARK_FIXTURE, or the committed 1000-trade fixture.
+ * 
+ * `binance_api_test record` saves the latest trades to `bench/aggTrades_recorded.json`, which
+ * BENCHMARK_FIXTURE can point at.
+ * 
+ * @return The path of the fixture.
+ */
+static std::string fixturePath() {
+    const char* path = std::getenv("BENCHMARK_FIXTURE");
+    return path ? path : "bench/aggTrades_BTCUSDT.json";
+}
+
+/**
+ * @struct Fixture
+ * @brief The trade objects of a recorded aggTrades response, as they appear in its text.
+ */
+struct Fixture {
+    std::vector<std::string> trades;  ///< One JSON object per trade.
+    bool loaded;                      ///< False if the fixture is missing and the trades are synthetic.
+};
+
+/**
+ * @brief Generates aggTrades objects shaped like Binance's, for when no response was recorded.
+ */
+static std::vector<std::string> syntheticTrades(size_t count) {
+    std::vector<std::string> trades;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    long long id = 2130364784;
+    long long tradeId = 4224219120;
+    long long time = 1712345678901;
+    for (size_t i = 0; i < count; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int tradeCount = 1 + static_cast<int>(state % 4);
+        char trade[160];
+        std::snprintf(trade, sizeof(trade),
+                      "{\"a\":%lld,\"p\":\"%d.%d0\",\"q\":\"%d.%03d\",\"f\":%lld,\"l\":%lld,\"T\":%lld,\"m\":%s}", id,
+                      67000 + static_cast<int>(state % 800), static_cast<int>((state >> 20) % 10),
+                      static_cast<int>((state >> 24) % 3), static_cast<int>((state >> 32) % 1000), tradeId,
+                      tradeId + tradeCount - 1, time, (state >> 40) & 1 ? "true" : "false");
+        trades.push_back(trade);
+        ++id;
+        tradeId += tradeCount;
+        time += static_cast<long long>((state >> 48) % 40);
+    }
+    return trades;
+}
+
+/**
+ * @brief Returns the fixture, read once per process.
+ * 
+ * A response is a flat array of flat objects, so the objects are cut at their braces and their
+ * text, field order included, is kept as it was received.
+ */
+static const Fixture& fixture() {
+    static const Fixture loaded = []() {
+        Fixture result;
+        std::ifstream file(fixturePath(), std::ios::binary);
+        std::stringstream text;
+        text << file.rdbuf();
+        std::string response = text.str();
+        for (size_t start = response.find('{'); start != std::string::npos; start = response.find('{', start)) {
+            size_t end = response.find('}', start);
+            if (end == std::string::npos) {
+                break;
+            }
+            result.trades.push_back(response.substr(start, end - start + 1));
+            start = end;
+        }
+        result.loaded = !result.trades.empty();
+        if (!result.loaded) {
+            result.trades = syntheticTrades(1000);
+        }
+        return result;
+    }();
+    return loaded;
+}
+
+/**
+ * @brief Builds a response of a number of trades by cycling through the fixture's trades.
+ */
+static std::string replayResponse(size_t count) {
+    const std::vector<std::string>& trades = fixture().trades;
+    std::string response = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            response += ',';
+        }
+        response += trades[i % trades.size()];
+    }
+    response += ']';
+    return response;
+}
+
+/**
+ * @brief Parses a replayed response into Trades with the backend of the first argument.
+ */
+static void BM_ParseTrades(benchmark::State& state) {
+    TradeParser parser(static_cast<TradeParser::Backend>(state.range(0)));
+    size_t count = static_cast<size_t>(state.range(1));
+    std::string response = replayResponse(count);
+    for (auto _ : state) {
+        try {
+            std::vector<Trade> trades = parser.parseTrades(response);
+            benchmark::DoNotOptimize(trades.data());
+        } catch (const std::runtime_error& e) {
+            state.SkipWithError(e.what());
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetBytesProcessed(state.iterations() * response.size());
+    state.SetLabel(fixture().loaded ? "fixture" : "synthetic");
+}
+
+/**
+ * @brief Parses a replayed response into fixed-point TradeRecords with the backend of the first argument.
+ */
+static void BM_ParseTradeRecords(benchmark::State& state) {
+    TradeParser parser(static_cast<TradeParser::Backend>(state.range(0)));
+    size_t count = static_cast<size_t>(state.range(1));
+    std::string response = replayResponse(count);
+    TradeScale scale;
+    for (auto _ : state) {
+        try {
+            std::vector<TradeRecord> records = parser.parseTradeRecords(response, scale);
+            benchmark::DoNotOptimize(records.data());
+        } catch (const std::runtime_error& e) {
+            state.SkipWithError(e.what());
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetBytesProcessed(state.iterations() * response.size());
+    state.SetLabel(fixture().loaded ? "fixture" : "synthetic");
+}
+
+/**
+ * @brief Both backends on responses of 10 to 100,000 trades.
+ */
+static void parserArguments(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"backend", "trades"})
+        ->ArgsProduct({{static_cast<int64_t>(TradeParser::Backend::Scanner),
+                        static_cast<int64_t>(TradeParser::Backend::Document)},
+                       {10, 100, 1000, 10000, 100000}});
+}
+
+BENCHMARK(BM_ParseTrades)->Apply(parserArguments);
+BENCHMARK(BM_ParseTradeRecords)->Apply(parserArguments);
+
+/**
+ * @brief Runs the benchmarks, reporting trades/s (items_per_second) and bytes/s per backend and response size.
+ * 
+ * Backend 0 is the single-pass scanner, 1 the nlohmann::json document parser. The trades of the
+ * fixture are cycled to fill the larger responses, and the records use the default scale of 8
+ * decimals, which holds prices and quantities below 10 billion exactly. Pass
+ * --benchmark_out=<file> --benchmark_out_format=json to keep the results.
+ * 
+ * @return int Returns 0 on successful execution.
+ */
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    std::cerr << "Replaying " << fixture().trades.size()
+              << (fixture().loaded ? " trades from " : " synthetic trades, no fixture at ") << fixturePath()
+              << std::endl;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
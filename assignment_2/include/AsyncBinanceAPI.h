@@ -0,0 +1,144 @@
+#ifndef ASYNC_BINANCE_API_H
+#define ASYNC_BINANCE_API_H
+
+#include "RateLimiter.h"
+#include <curl/curl.h>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class AsyncBinanceAPI
+ * @brief A non-blocking client of the Binance USD(S)-M Futures REST API, for many symbols at once.
+ * 
+ * Requests are queued from any thread and run by one event loop thread over a cURL multi handle,
+ * so many of them are in flight together without a thread each. The multi handle keeps a pool of
+ * connections to the host, multiplexes the requests over one HTTP/2 connection when the server
+ * supports it, and otherwise keeps up to `maxConnections` HTTP/1.1 connections alive; the easy
+ * handles and their response buffers are reused from one request to the next. Every request waits
+ * in the queue for its weight in a RateLimiter, which may be shared with a BinanceAPI, so the loop
+ * never blocks on it.
+ * 
+ * A request completes either through a `std::future`, or through a callback run on the event loop
+ * thread, which must therefore return quickly; exceptions it throws are discarded. Errors are
+ * reported as BinanceAPI::APIException.
+ */
+class AsyncBinanceAPI {
+public:
+    /**
+     * @brief Receives the body of a response, valid only during the call, or the error of the
+     * request, in which case the body is empty.
+     */
+    typedef std::function<void(const std::string& response, const std::exception_ptr& error)> Callback;
+
+    /**
+     * @brief Constructs a new AsyncBinanceAPI object and starts its event loop.
+     * 
+     * @param baseURL The base URL of the Binance API (e.g., "https://fapi.binance.com").
+     * @param rateLimiter The rate limiter of the requests, or nullptr for a new one.
+     * @param maxConnections The most connections opened to the host.
+     * @param useHttp2 Multiplexes the requests over HTTP/2 when the server and libcurl support it.
+     * @throw BinanceAPI::APIException if cURL cannot be initialized.
+     */
+    explicit AsyncBinanceAPI(const std::string& baseURL,
+                             const std::shared_ptr<RateLimiter>& rateLimiter = std::shared_ptr<RateLimiter>(),
+                             int maxConnections = 8, bool useHttp2 = true);
+
+    /**
+     * @brief Stops the event loop; requests still queued or in flight fail with an APIException.
+     */
+    ~AsyncBinanceAPI();
+
+    AsyncBinanceAPI(const AsyncBinanceAPI&) = delete;
+    AsyncBinanceAPI& operator=(const AsyncBinanceAPI&) = delete;
+
+    /**
+     * @brief Queues a request for the aggregate trades of a symbol.
+     * 
+     * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+     * @param limit The number of trades to retrieve (at most 1000).
+     * @param fromId The aggregate trade ID to start from, or -1 for the most recent trades.
+     * @param onComplete Receives the JSON response or the error, on the event loop thread.
+     */
+    void getAggregateTrades(const std::string& symbol, int limit, long long fromId, const Callback& onComplete);
+
+    /**
+     * @brief Queues a request for the aggregate trades of a symbol.
+     * 
+     * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+     * @param limit The number of trades to retrieve (at most 1000).
+     * @param fromId The aggregate trade ID to start from, or -1 for the most recent trades.
+     * @return The JSON response; `get()` throws BinanceAPI::APIException if the request failed.
+     */
+    std::future<std::string> getAggregateTrades(const std::string& symbol, int limit = 5, long long fromId = -1);
+
+    /**
+     * @brief Returns the rate limiter of the requests.
+     */
+    const std::shared_ptr<RateLimiter>& getRateLimiter() const;
+
+    /**
+     * @brief Returns the number of requests queued or in flight.
+     */
+    size_t pendingCount() const;
+
+private:
+    /**
+     * @brief A request, with the easy handle and the response buffer it keeps between requests.
+     */
+    struct Transfer;
+
+    /**
+     * @brief Runs the transfers until the object is destroyed, then fails the remaining ones.
+     */
+    void runLoop();
+
+    /**
+     * @brief Moves queued requests to the multi handle while the rate limiter allows.
+     * 
+     * @return How long until the next queued request may start in milliseconds, or -1 if none is waiting.
+     */
+    long startQueued();
+
+    /**
+     * @brief Completes the transfers the multi handle reports as done.
+     */
+    void completeFinished();
+
+    /**
+     * @brief Hands a finished transfer's result to its callback and returns it to the idle pool.
+     */
+    void complete(Transfer* transfer, const std::exception_ptr& error);
+
+    /**
+     * @brief Queues a request, reusing an idle transfer if there is one.
+     */
+    void enqueue(const std::string& endpoint, int weight, const Callback& onComplete);
+
+    /**
+     * @brief Receives the response headers and records the rate-limit ones.
+     */
+    static size_t headerCallback(char* buffer, size_t size, size_t count, void* transfer);
+
+    std::string baseURL;                       ///< The base URL for the Binance API
+    bool useHttp2;                             ///< Whether HTTP/2 is negotiated
+    std::shared_ptr<RateLimiter> rateLimiter;  ///< Paces the requests
+    CURLM* multi;                              ///< Runs the transfers and pools the connections
+    CURLSH* share;                             ///< The DNS cache and TLS sessions of the handles
+    std::vector<Transfer*> active;             ///< Transfers in the multi handle; loop thread only
+
+    mutable std::mutex mutex;                  ///< Guards the members below
+    std::deque<std::unique_ptr<Transfer>> queue; ///< Requests waiting to start
+    std::vector<std::unique_ptr<Transfer>> idle; ///< Finished transfers, for reuse
+    size_t pending;                            ///< Requests queued or in flight
+    bool stopping;                             ///< Set by the destructor
+    std::thread loop;                          ///< The event loop thread
+};
+
+#endif
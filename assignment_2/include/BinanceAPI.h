@@ -1,8 +1,13 @@
 #ifndef BINANCE_API_H
 #define BINANCE_API_H
 
+#include "RateLimiter.h"
+#include "TradeParser.h"
+#include <curl/curl.h>
+#include <memory>
 #include <string>
 #include <stdexcept>
+#include <vector>
 
 /**
  * @class BinanceAPI
@@ -10,6 +15,16 @@
  * 
  * This class allows you to retrieve aggregate trades data from the Binance API. It includes
  * functionality for sending GET requests and handling errors.
+ * 
+ * Requests go through one long-lived cURL handle, so after the first request the connection
+ * (TCP and TLS) is kept alive and reused instead of being set up again, and the response buffer
+ * keeps its capacity. The handle is attached to a share object holding the DNS cache and the
+ * TLS sessions, which later handles can join. An object must only be used by one thread at a
+ * time.
+ * 
+ * Every request takes its weight from a RateLimiter, which follows the used weight reported by
+ * the server and backs off on HTTP 429 and 418. The backfill methods fetch long histories in
+ * pages of MAX_AGG_TRADES_LIMIT trades on several connections at once, all sharing the limiter.
  */
 class BinanceAPI {
 public:
@@ -17,18 +32,113 @@ public:
      * @brief Constructs a new BinanceAPI object.
      * 
      * @param baseURL The base URL for the Binance API.
+     * @param useHttp2 Negotiates HTTP/2 over TLS when the server and libcurl support it, and
+     *        HTTP/1.1 otherwise.
+     * @throw APIException if cURL cannot be initialized.
+     */
+    BinanceAPI(const std::string& baseURL, bool useHttp2 = true);
+
+    /**
+     * @brief Closes the connection and releases the cURL handles.
+     */
+    ~BinanceAPI();
+
+    BinanceAPI(const BinanceAPI&) = delete;
+    BinanceAPI& operator=(const BinanceAPI&) = delete;
+
+    /**
+     * @brief The largest number of aggregate trades one request may return.
      */
-    BinanceAPI(const std::string& baseURL);
+    static const int MAX_AGG_TRADES_LIMIT = 1000;
+
+    /**
+     * @brief The weight of an aggregate trades request.
+     */
+    static const int AGG_TRADES_WEIGHT = 20;
 
     /**
      * @brief Retrieves aggregate trades data from Binance for a given symbol.
      * 
      * @param symbol The trading pair symbol (e.g., "BTCUSDT").
-     * @param limit The number of trades to retrieve (default is 5).
-     * @return A JSON string containing aggregate trades data.
+     * @param limit The number of trades to retrieve (default is 5, at most 1000).
+     * @param fromId The aggregate trade ID to start from, or -1 for the most recent trades.
+     * @return A JSON string containing aggregate trades data, valid until the next request.
      * @throw APIException if there is an error while retrieving the data.
      */
-    std::string getAggregateTrades(const std::string& symbol, int limit = 5);
+    const std::string& getAggregateTrades(const std::string& symbol, int limit = 5, long long fromId = -1);
+
+    /**
+     * @brief Retrieves the aggregate trades of a symbol within a time window, oldest first.
+     * 
+     * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+     * @param startTime The start of the window, in milliseconds since the epoch.
+     * @param endTime The inclusive end of the window, less than an hour after the start.
+     * @param limit The number of trades to retrieve (at most 1000).
+     * @return A JSON string containing aggregate trades data, valid until the next request.
+     * @throw APIException if there is an error while retrieving the data.
+     */
+    const std::string& getAggregateTradesInWindow(const std::string& symbol, long long startTime, long long endTime,
+                                                  int limit = MAX_AGG_TRADES_LIMIT);
+
+    /**
+     * @brief Fetches the aggregate trades of a symbol within an ID range, in order.
+     * 
+     * The range is split into pages of MAX_AGG_TRADES_LIMIT trades, which `workerCount`
+     * connections fetch concurrently. A page throttled (HTTP 429 or 418) or failing with a
+     * network or server error is retried; any other error ends the backfill.
+     * 
+     * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+     * @param fromId The first aggregate trade ID.
+     * @param toId The aggregate trade ID after the last one.
+     * @param scale The number of decimals of the symbol's prices and quantities.
+     * @param workerCount The number of concurrent connections, this one included.
+     * @return The trades in ID order; fewer than requested if the range goes past the latest trade.
+     * @throw APIException if a page cannot be fetched.
+     */
+    std::vector<TradeRecord> backfillAggregateTrades(const std::string& symbol, long long fromId, long long toId,
+                                                     const TradeScale& scale = TradeScale(), int workerCount = 4);
+
+    /**
+     * @brief Fetches the aggregate trades of a symbol within a time range, in order.
+     * 
+     * Finds the ID range of the time range (one or a few requests per end), then fetches it like
+     * `backfillAggregateTrades`.
+     * 
+     * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+     * @param startTime The start of the range, in milliseconds since the epoch.
+     * @param endTime The inclusive end of the range, in milliseconds since the epoch.
+     * @param scale The number of decimals of the symbol's prices and quantities.
+     * @param workerCount The number of concurrent connections, this one included.
+     * @return The trades in ID order, and therefore in time order.
+     * @throw APIException if a request fails.
+     */
+    std::vector<TradeRecord> backfillAggregateTradesByTime(const std::string& symbol, long long startTime, long long endTime,
+                                                           const TradeScale& scale = TradeScale(), int workerCount = 4);
+
+    /**
+     * @brief Returns the rate limiter shared by the requests of this object and its backfill workers,
+     * which an AsyncBinanceAPI may share too.
+     */
+    const std::shared_ptr<RateLimiter>& getRateLimiter() const;
+
+    /**
+     * @brief Retrieves the exchange information: the symbols with their tick and step sizes.
+     * 
+     * @return A JSON string containing the exchange information, valid until the next request.
+     * @throw APIException if there is an error while retrieving the data.
+     */
+    const std::string& getExchangeInfo();
+
+    /**
+     * @brief Records the network phases of a finished transfer in the PerformanceRegistry.
+     * 
+     * From libcurl's `CURLINFO_*_TIME_T` timings: "api.dns", "api.connect" and "api.tls" are the
+     * durations of those phases, recorded only when the transfer opened a new connection;
+     * "api.ttfb" (to the first response byte) and "api.total" run from the start of the transfer.
+     * 
+     * @param handle The cURL handle of the transfer.
+     */
+    static void recordTransferTimings(CURL* handle);
 
     /**
      * @class APIException
@@ -42,21 +152,72 @@ public:
          * @brief Constructs a new APIException object with an error message.
          * 
          * @param message The error message to be associated with the exception.
+         * @param httpCode The HTTP status code of the response, or 0 if there was none.
+         */
+        explicit APIException(const std::string& message, long httpCode = 0)
+            : std::runtime_error(message), httpCode(httpCode) {}
+
+        /**
+         * @brief Returns the HTTP status code of the response, or 0 if there was none.
          */
-        explicit APIException(const std::string& message) : std::runtime_error(message) {}
+        long getHttpCode() const { return httpCode; }
+
+    private:
+        long httpCode; ///< The HTTP status code of the response
     };
 
 private:
+    /**
+     * @brief Constructs a backfill worker that joins the share object and the rate limiter of another.
+     */
+    BinanceAPI(const std::string& baseURL, bool useHttp2, CURLSH* share, const std::shared_ptr<RateLimiter>& rateLimiter);
+
     /**
      * @brief Sends a GET request to the Binance API and returns the response.
      * 
      * @param endpoint The API endpoint to send the request to.
-     * @return The response from the API as a string.
+     * @param weight The weight of the request, taken from the rate limiter first.
+     * @return The response from the API as a string, valid until the next request.
      * @throw APIException if the request fails or the API returns an error.
      */
-    std::string sendGETRequest(const std::string& endpoint);
+    const std::string& sendGETRequest(const std::string& endpoint, int weight);
+
+    /**
+     * @brief Fetches one page of a backfill, retrying throttled and failed requests.
+     */
+    std::vector<TradeRecord> fetchTradePage(const std::string& symbol, long long fromId, int limit,
+                                            const TradeScale& scale, TradeParser& parser);
+
+    /**
+     * @brief Returns the ID of the first trade at or after a time, or -1 if there is none yet.
+     */
+    long long findTradeIdAt(const std::string& symbol, long long time, TradeParser& parser);
+
+    /**
+     * @brief Receives the response headers and records the rate-limit ones.
+     */
+    static size_t headerCallback(char* buffer, size_t size, size_t count, void* api);
+
+    /**
+     * @brief The capacity reserved for responses; 1000 aggregate trades take about 110 KiB.
+     */
+    static const size_t RESPONSE_RESERVE = 128 * 1024;
+
+    /**
+     * @brief The most attempts at a page of a backfill.
+     */
+    static const int MAX_PAGE_ATTEMPTS = 8;
 
-    std::string baseURL; ///< The base URL for the Binance API
+    std::string baseURL;  ///< The base URL for the Binance API
+    bool useHttp2;        ///< Whether HTTP/2 is negotiated, also for the backfill workers
+    bool ownsShare;       ///< False for backfill workers, which join another object's share
+    CURLSH* share;        ///< The DNS cache and TLS sessions shared by the handles
+    CURL* curl;           ///< The handle that keeps the connection alive between requests
+    std::shared_ptr<RateLimiter> rateLimiter; ///< Paces the requests of this object and its workers
+    std::string url;      ///< The URL of the current request, reused to avoid allocating
+    std::string response; ///< The body of the last response
+    int usedWeight;       ///< The X-MBX-USED-WEIGHT-1M of the last response, or -1
+    int retryAfter;       ///< The Retry-After of the last response in seconds, or -1
 };
 
 #endif
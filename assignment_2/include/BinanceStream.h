@@ -0,0 +1,91 @@
+#ifndef BINANCE_STREAM_H
+#define BINANCE_STREAM_H
+
+#include "BinanceAPI.h"
+#include "TradeParser.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @class BinanceStream
+ * @brief A client of the aggTrade WebSocket market streams of the Binance USD(S)-M Futures API.
+ * 
+ * Subscribes to `<symbol>@aggTrade` for every symbol through one combined stream and delivers the
+ * trades to a callback as they arrive, with the latency measured from the event timestamp. The
+ * connection is kept alive with pings and answers the server's pings; when it drops, it is opened
+ * again with an exponential backoff. The aggregate trade IDs of a symbol are consecutive, so a
+ * jump in them reveals missed trades, which are fetched through the REST API and delivered, in
+ * order, before the trade that revealed the gap. Trades already delivered are never repeated.
+ * 
+ * The WebSocket protocol (RFC 6455) is spoken over a raw cURL connection, since libcurl only
+ * handles WebSockets natively from version 7.86 with an experimental build option.
+ */
+class BinanceStream {
+public:
+    /**
+     * @brief Receives every trade, with its symbol and its latency in milliseconds: the time since
+     * the event was sent, or since the trade for trades fetched to fill a gap.
+     */
+    typedef std::function<void(const std::string& symbol, const Trade& trade, double latencyMs)> TradeCallback;
+
+    /**
+     * @brief Constructs a new BinanceStream object.
+     * 
+     * @param streamURL The base URL of the market streams, `ws://` or `wss://`
+     *        (e.g., "wss://fstream.binance.com").
+     * @param api The REST API used to fill gaps; must outlive the stream.
+     */
+    BinanceStream(const std::string& streamURL, BinanceAPI& api);
+
+    /**
+     * @brief Streams the trades of the given symbols until `stop()` is called.
+     * 
+     * Connection failures are retried; exceptions thrown by the callback end the run.
+     * 
+     * @param symbols The trading pair symbols (e.g., "BTCUSDT").
+     * @param onTrade Receives every trade.
+     */
+    void run(const std::vector<std::string>& symbols, const TradeCallback& onTrade);
+
+    /**
+     * @brief Makes `run()` return within about a second; may be called from any thread.
+     */
+    void stop();
+
+private:
+    /**
+     * @brief Connects once and delivers trades until the connection fails or `stop()` is called.
+     * 
+     * @param backoffMs Reset to its initial value once connected.
+     * @throw APIException if the connection fails or the server closes it.
+     */
+    void streamOnce(const std::string& path, const TradeCallback& onTrade, int& backoffMs);
+
+    /**
+     * @brief Delivers a trade of the stream, after the trades missed since the last one.
+     */
+    void deliver(const std::string& symbol, const Trade& trade, long long eventTime, const TradeCallback& onTrade);
+
+    /**
+     * @brief Fetches and delivers the trades of a symbol from `fromId` up to, excluding, `toId`.
+     * 
+     * @throw APIException if a request fails.
+     */
+    void backfill(const std::string& symbol, long long fromId, long long toId, const TradeCallback& onTrade);
+
+    static const int MAX_BACKFILL_REQUEST = 1000;  ///< The largest `limit` the REST API accepts.
+    static const int PING_AFTER_MS = 30000;        ///< Silence after which the client pings.
+    static const int TIMEOUT_MS = 60000;           ///< Silence after which the connection is dropped.
+    static const int MAX_BACKOFF_MS = 30000;       ///< The longest wait before reconnecting.
+
+    std::string streamURL;                    ///< The base URL of the market streams
+    BinanceAPI& api;                          ///< The REST API that fills gaps
+    TradeParser parser;                       ///< Parses the events
+    std::atomic<bool> stopping;               ///< Set by `stop()`
+    std::map<std::string, long long> lastIds; ///< The last delivered aggregate trade ID per symbol
+};
+
+#endif
@@ -0,0 +1,226 @@
+#ifndef LOCK_FREE_RING_H
+#define LOCK_FREE_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief The size of a cache line, by which the indexes of the rings are kept apart so that the
+ * producer and the consumer do not invalidate each other's line on every operation.
+ */
+static const size_t RING_CACHE_LINE = 64;
+
+/**
+ * @brief Rounds a capacity up to a power of two, at least 2, so that indexes wrap with a mask.
+ */
+inline size_t ringCapacity(size_t capacity) {
+    size_t rounded = 2;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+    return rounded;
+}
+
+/**
+ * @class SPSCRing
+ * @brief A bounded lock-free queue between one producer thread and one consumer thread.
+ * 
+ * The slots are allocated once; pushing and popping copy-assign into them, so types that keep
+ * their capacity across assignments (e.g. `std::string`) stop allocating once every slot has held
+ * a large enough value. Each side only writes its own index and keeps a cached copy of the
+ * other's, so the shared cache lines are only read when the cached copy says the ring looks full
+ * or empty. Neither operation waits: callers decide how to spin, yield or give up.
+ * 
+ * @tparam T The element type, default-constructible and copy-assignable.
+ */
+template <typename T>
+class SPSCRing {
+public:
+    /**
+     * @brief Creates an empty ring.
+     * 
+     * @param capacity The number of elements the ring holds, rounded up to a power of two.
+     */
+    explicit SPSCRing(size_t capacity)
+        : slots(ringCapacity(capacity)), mask(slots.size() - 1), head(0), cachedTail(0), tail(0), cachedHead(0) {}
+
+    SPSCRing(const SPSCRing&) = delete;
+    SPSCRing& operator=(const SPSCRing&) = delete;
+
+    /**
+     * @brief Appends an element unless the ring is full. Producer only.
+     * 
+     * @param item The element, copied into its slot.
+     * @return False if the ring is full.
+     */
+    bool tryPush(const T& item) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead > mask) {
+                return false;
+            }
+        }
+        slots[position & mask] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element unless the ring is empty. Consumer only.
+     * 
+     * @param item Receives the element.
+     * @return False if the ring is empty.
+     */
+    bool tryPop(T& item) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) {
+                return false;
+            }
+        }
+        item = slots[position & mask];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Returns the number of elements, exact only when both sides are idle.
+     */
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns the number of elements the ring holds.
+     */
+    size_t capacity() const {
+        return slots.size();
+    }
+
+private:
+    std::vector<T> slots;          ///< The storage.
+    const size_t mask;             ///< The capacity minus one.
+    char padding0[RING_CACHE_LINE];
+    std::atomic<size_t> head;      ///< The next position to pop; written by the consumer.
+    size_t cachedTail;             ///< The consumer's copy of the tail.
+    char padding1[RING_CACHE_LINE];
+    std::atomic<size_t> tail;      ///< The next position to push; written by the producer.
+    size_t cachedHead;             ///< The producer's copy of the head.
+    char padding2[RING_CACHE_LINE];
+};
+
+/**
+ * @class MPSCRing
+ * @brief A bounded lock-free queue from any number of producer threads to one consumer thread.
+ * 
+ * Every slot carries a sequence number telling whether it is free for the push of a given
+ * position or holds the element of a given position (D. Vyukov's bounded queue). Producers claim
+ * positions with a compare-and-swap on the tail and publish their slot with its sequence number,
+ * so a producer that is slow to copy only delays the consumer at its own slot. Neither operation
+ * waits. As with SPSCRing, elements are copy-assigned into pre-allocated slots.
+ * 
+ * @tparam T The element type, default-constructible and copy-assignable.
+ */
+template <typename T>
+class MPSCRing {
+public:
+    /**
+     * @brief Creates an empty ring.
+     * 
+     * @param capacity The number of elements the ring holds, rounded up to a power of two.
+     */
+    explicit MPSCRing(size_t capacity) : slots(ringCapacity(capacity)), mask(slots.size() - 1), head(0), tail(0) {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCRing(const MPSCRing&) = delete;
+    MPSCRing& operator=(const MPSCRing&) = delete;
+
+    /**
+     * @brief Appends an element unless the ring is full. Any thread.
+     * 
+     * @param item The element, copied into its slot.
+     * @return False if the ring is full.
+     */
+    bool tryPush(const T& item) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[position & mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                // The slot still holds the element of the previous lap
+                return false;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = item;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element unless none is published yet. Consumer only.
+     * 
+     * @param item Receives the element.
+     * @return False if the ring is empty, or its oldest element is still being pushed.
+     */
+    bool tryPop(T& item) {
+        size_t position = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[position & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            return false;
+        }
+        item = slot.value;
+        slot.sequence.store(position + slots.size(), std::memory_order_release);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Returns the number of elements claimed by producers and not yet popped, approximately.
+     */
+    size_t size() const {
+        size_t popped = head.load(std::memory_order_acquire);
+        size_t pushed = tail.load(std::memory_order_acquire);
+        return pushed > popped ? pushed - popped : 0;
+    }
+
+    /**
+     * @brief Returns the number of elements the ring holds.
+     */
+    size_t capacity() const {
+        return slots.size();
+    }
+
+private:
+    /**
+     * @struct Slot
+     * @brief An element with the sequence number of the position it is free for or holds.
+     */
+    struct Slot {
+        std::atomic<size_t> sequence; ///< Equal to the position when free, the position plus one when full.
+        T value;                      ///< The element.
+    };
+
+    std::vector<Slot> slots;       ///< The storage.
+    const size_t mask;             ///< The capacity minus one.
+    char padding0[RING_CACHE_LINE];
+    std::atomic<size_t> head;      ///< The next position to pop; written by the consumer.
+    char padding1[RING_CACHE_LINE];
+    std::atomic<size_t> tail;      ///< The next position to claim; written by the producers.
+    char padding2[RING_CACHE_LINE];
+};
+
+#endif
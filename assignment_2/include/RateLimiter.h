@@ -0,0 +1,100 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <chrono>
+#include <mutex>
+
+/**
+ * @class RateLimiter
+ * @brief A token bucket over the request weight of the Binance API, shared by concurrent requests.
+ * 
+ * Binance limits the weight of the requests of an IP address per minute (2400 on the USD(S)-M
+ * Futures API) and reports the weight used so far in the `X-MBX-USED-WEIGHT-1M` header of every
+ * response. The bucket refills at the limit spread over the minute; a request takes its weight
+ * from it before it is sent, waiting if needed, and every reported used weight caps the tokens at
+ * what the server still allows. An HTTP 429 (too many requests) or 418 (banned after ignoring
+ * 429s) pauses every request for the `Retry-After` time, or an exponentially growing pause if
+ * there is none, and halves the refill rate; each successful request then restores 5% of the
+ * configured rate. All methods may be called from any thread.
+ */
+class RateLimiter {
+public:
+    /**
+     * @brief Constructs a full bucket.
+     * 
+     * @param weightPerMinute The weight limit per minute of the API.
+     */
+    explicit RateLimiter(int weightPerMinute = 2400);
+
+    /**
+     * @brief Returns whether a request of the given weight can ever be granted.
+     * 
+     * @param weight The weight of the request.
+     * @return False if the weight is negative or above the limit, which the bucket never holds.
+     */
+    bool canAcquire(int weight) const;
+
+    /**
+     * @brief Waits until a request of the given weight may be sent, and takes its weight.
+     * 
+     * @param weight The weight of the request (e.g., 20 for `/fapi/v1/aggTrades`).
+     * @throw std::invalid_argument if the weight is negative or above the limit.
+     */
+    void acquire(int weight);
+
+    /**
+     * @brief Takes the weight of a request if it may be sent now, without waiting.
+     * 
+     * @param weight The weight of the request.
+     * @param delay Set, on failure, to how long to wait before trying again.
+     * @return True if the weight was taken.
+     * @throw std::invalid_argument if the weight is negative or above the limit.
+     */
+    bool tryAcquire(int weight, std::chrono::milliseconds& delay);
+
+    /**
+     * @brief Accounts for the weight the server reports as used in the current minute.
+     * 
+     * @param usedWeight The value of the `X-MBX-USED-WEIGHT-1M` header.
+     */
+    void observeUsedWeight(int usedWeight);
+
+    /**
+     * @brief Pauses every request after an HTTP 429 or 418, and slows down the refill.
+     * 
+     * @param httpCode The status code, 429 or 418.
+     * @param retryAfterSeconds The value of the `Retry-After` header, or -1 if there was none.
+     */
+    void backOff(long httpCode, int retryAfterSeconds);
+
+    /**
+     * @brief Restores part of the refill rate after a successful request.
+     */
+    void succeed();
+
+    /**
+     * @brief Returns the current refill rate, in weight per minute.
+     */
+    double getWeightPerMinute() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief Adds the tokens earned since the last refill; the mutex must be held.
+     */
+    void refill(Clock::time_point now);
+
+    static const int MAX_PAUSE_SECONDS = 60;  ///< The longest pause without a `Retry-After`.
+
+    mutable std::mutex mutex;        ///< Guards the members below.
+    const double limit;              ///< The configured weight per minute, also the capacity.
+    double rate;                     ///< The current refill rate, in weight per minute.
+    double tokens;                   ///< The weight that may be sent now.
+    Clock::time_point lastRefill;    ///< When the tokens were last refilled.
+    Clock::time_point pausedUntil;   ///< No request is sent before this time.
+    Clock::time_point lastBackOffEnd; ///< The end of the pause of the last backoff that lowered the rate.
+    int consecutiveBackOffs;         ///< Backoffs since the last success, for the pause length.
+};
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef TRADE_AGGREGATOR_H
+#define TRADE_AGGREGATOR_H
+
+#include "HashTable.h"
+#include "TradeParser.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The kind of a bar: a fixed time interval, or a fixed traded volume.
+ */
+enum class BarType {
+    Time,   ///< Covers `[startTime, endTime)`, closed once no late trade can reach it any more
+    Volume  ///< Closed by the trade that brings its volume to the symbol's bar volume
+};
+
+/**
+ * @struct Bar
+ * @brief The OHLCV summary of consecutive trades of a symbol, with what VWAP and imbalance are computed from.
+ * 
+ * Prices and quantities are fixed-point, in the symbol's TradeScale. Open and close are the
+ * prices of the trades with the lowest and the highest aggregate trade ID, so a late trade that
+ * fills a gap does not move them wrongly. Buy volume is the volume of trades whose taker bought
+ * (`isBuyerMaker` false).
+ */
+struct Bar {
+    int64_t startTime;       ///< A time bar's start; a volume bar's first trade time, in ms since the epoch.
+    int64_t endTime;         ///< A time bar's exclusive end; a volume bar's last trade time.
+    int64_t open;            ///< The price of the first trade.
+    int64_t high;            ///< The highest price.
+    int64_t low;             ///< The lowest price.
+    int64_t close;           ///< The price of the last trade.
+    int64_t volume;          ///< The traded quantity.
+    int64_t buyVolume;       ///< The quantity bought by takers.
+    double notional;         ///< The sum of price times quantity, in fixed-point units of both.
+    int64_t firstId;         ///< The aggregate trade ID of the first trade.
+    int64_t lastId;          ///< The aggregate trade ID of the last trade.
+    uint32_t tradeCount;     ///< The number of trades, counted as the exchange does.
+
+    /**
+     * @brief Returns the volume-weighted average price, fixed-point like the prices.
+     */
+    double vwap() const { return volume > 0 ? notional / static_cast<double>(volume) : 0.0; }
+
+    /**
+     * @brief Returns the taker imbalance, (buy volume - sell volume) / volume, between -1 and 1.
+     */
+    double imbalance() const {
+        return volume > 0 ? static_cast<double>(2 * buyVolume - volume) / static_cast<double>(volume) : 0.0;
+    }
+};
+
+/**
+ * @class TradeAggregator
+ * @brief Maintains time and volume bars of many symbols incrementally, one trade at a time.
+ * 
+ * Symbols are found by name in a BasicHashTable, which maps them to an index into flat per-symbol
+ * state, without building a string. Each symbol keeps its open time bars in a ring covering the
+ * late window, so a trade up to `lateMillis` older than the newest one seen for its symbol still
+ * updates its bar; bars are handed to the callback, in time order, once the newest trade is
+ * `lateMillis` past their end, and a trade for a bar already handed over is counted as too late.
+ * Every update is O(1) and, once the symbols are added, allocates nothing: the bars live in
+ * storage sized when the symbol is added.
+ * 
+ * An object must only be used by one thread at a time; the callback runs on the thread that adds
+ * the trade.
+ */
+class TradeAggregator {
+public:
+    /**
+     * @brief Receives every closed bar of every symbol; the arguments are valid during the call only.
+     */
+    typedef std::function<void(const std::string& symbol, BarType type, const Bar& bar)> BarCallback;
+
+    /**
+     * @brief Constructs an aggregator without symbols.
+     * 
+     * @param barMillis The length of the time bars in milliseconds.
+     * @param lateMillis How much older than the newest trade of its symbol a trade may be.
+     * @param onBar Receives the closed bars.
+     * @throw std::invalid_argument if `barMillis` is not positive or `lateMillis` is negative.
+     */
+    TradeAggregator(int64_t barMillis, int64_t lateMillis, const BarCallback& onBar);
+
+    /**
+     * @brief Adds a symbol; trades of unknown symbols are rejected.
+     * 
+     * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+     * @param barVolume The fixed-point volume of its volume bars, or 0 for no volume bars.
+     * @throw std::invalid_argument if the symbol was already added.
+     */
+    void addSymbol(const std::string& symbol, int64_t barVolume = 0);
+
+    /**
+     * @brief Adds a trade to the bars of its symbol.
+     * 
+     * @param symbol The trading pair symbol.
+     * @param trade The trade.
+     * @return False if the trade is too late for its time bar, which then ignores it.
+     * @throw std::invalid_argument if the symbol was not added.
+     */
+    bool add(std::string_view symbol, const TradeRecord& trade);
+
+    /**
+     * @brief Closes every open bar, as if no more trades could arrive.
+     */
+    void flush();
+
+    /**
+     * @brief Returns the most recent open bar of a symbol, or nullptr if it has none.
+     * 
+     * @param symbol The trading pair symbol.
+     * @param type Which bar.
+     * @return The bar, valid until the next call that adds a trade or closes bars.
+     */
+    const Bar* currentBar(std::string_view symbol, BarType type) const;
+
+    /**
+     * @brief Returns the number of trades that were too late for their time bar.
+     */
+    uint64_t getLateTradeCount() const;
+
+private:
+    /**
+     * @struct SymbolState
+     * @brief The open bars of a symbol.
+     */
+    struct SymbolState {
+        std::string symbol;          ///< The symbol, passed to the callback.
+        int64_t barVolume;           ///< The volume of the volume bars, or 0.
+        std::vector<Bar> timeBars;   ///< The open time bars, bucket `b` at `slotOf(b)`.
+        int64_t firstOpenBucket;     ///< The oldest bucket that may still be open.
+        int64_t newestTime;          ///< The newest trade time seen.
+        bool started;                ///< Whether a trade was seen.
+        Bar volumeBar;               ///< The open volume bar, empty when its trade count is 0.
+    };
+
+    /**
+     * @brief Finds a symbol's state, or throws.
+     */
+    SymbolState& state(std::string_view symbol);
+
+    /**
+     * @brief Hands the time bars of a symbol up to, excluding, `bucket` to the callback.
+     */
+    void closeTimeBars(SymbolState& state, int64_t bucket);
+
+    /**
+     * @brief Returns the slot of a bucket in a symbol's time bar ring.
+     */
+    static size_t slotOf(const SymbolState& state, int64_t bucket);
+
+    /**
+     * @brief Returns the bucket of a time, rounding down also before the epoch.
+     */
+    int64_t bucketOf(int64_t time) const;
+
+    /**
+     * @brief Starts a bar with a trade.
+     */
+    static void open(Bar& bar, const TradeRecord& trade);
+
+    /**
+     * @brief Adds a trade to a bar that has some already.
+     */
+    static void update(Bar& bar, const TradeRecord& trade);
+
+    int64_t barMillis;                          ///< The length of the time bars
+    int64_t lateMillis;                         ///< The late window
+    BarCallback onBar;                          ///< Receives the closed bars
+    BasicHashTable<std::string, uint32_t> indexes; ///< The index in `symbols` of every symbol
+    std::vector<SymbolState> symbols;           ///< The state of every symbol
+    uint64_t lateTrades;                        ///< The trades too late for their time bar
+};
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef TRADEPARSER_H
 #define TRADEPARSER_H
 
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 /**
@@ -15,20 +17,101 @@ struct Trade {
     long long aggregateTradeId;  ///< The aggregate trade ID.
     std::string price;           ///< The price of the trade.
     std::string quantity;        ///< The quantity traded.
-    int firstTradeId;            ///< The first trade ID.
-    int lastTradeId;             ///< The last trade ID.
+    long long firstTradeId;      ///< The first trade ID.
+    long long lastTradeId;       ///< The last trade ID.
     long long timestamp;         ///< The timestamp of the trade.
     bool isBuyerMaker;           ///< True if the buyer is the maker, false otherwise.
 };
 
+/**
+ * @struct TradeScale
+ * @brief The number of decimals kept by the fixed-point prices and quantities of a symbol.
+ * 
+ * Taken from the symbol's tick size (price) and step size (quantity) in the exchange information, so
+ * every valid price and quantity is an exact integer. A value has at most 18 digits, so the default of
+ * 8 decimals holds any price or quantity below 10 billion exactly, for when the exchange information
+ * is not at hand.
+ */
+struct TradeScale {
+    /**
+     * @brief Constructs a scale.
+     * 
+     * @param priceDecimals The number of decimals of the prices.
+     * @param quantityDecimals The number of decimals of the quantities.
+     */
+    TradeScale(int priceDecimals = 8, int quantityDecimals = 8)
+        : priceDecimals(priceDecimals), quantityDecimals(quantityDecimals) {}
+
+    int priceDecimals;     ///< A price of 1 is stored as 10^priceDecimals.
+    int quantityDecimals;  ///< A quantity of 1 is stored as 10^quantityDecimals.
+};
+
+/**
+ * @struct TradeRecord
+ * @brief A compact, trivially copyable aggregate trade, with fixed-point price and quantity.
+ * 
+ * The 48-byte records can be copied with memcpy, stored in flat arrays or files and aggregated
+ * without parsing strings again. The trade IDs of an aggregate trade are consecutive, so only their
+ * count is kept next to the first one.
+ */
+struct TradeRecord {
+    int64_t aggregateTradeId;  ///< The aggregate trade ID.
+    int64_t price;             ///< The price in units of 10^-priceDecimals.
+    int64_t quantity;          ///< The quantity in units of 10^-quantityDecimals.
+    int64_t firstTradeId;      ///< The first trade ID.
+    int64_t timestamp;         ///< The timestamp of the trade, in milliseconds since the epoch.
+    uint32_t tradeCount;       ///< The number of trades aggregated, lastTradeId - firstTradeId + 1.
+    bool isBuyerMaker;         ///< True if the buyer is the maker, false otherwise.
+
+    /**
+     * @brief Returns the last trade ID.
+     */
+    int64_t lastTradeId() const { return firstTradeId + tradeCount - 1; }
+};
+
+static_assert(std::is_trivially_copyable<TradeRecord>::value, "TradeRecord must be copyable with memcpy");
+static_assert(sizeof(TradeRecord) == 48, "TradeRecord must stay compact");
+
+/**
+ * @brief Converts a fixed-point value back to a floating-point number, e.g. for display.
+ * 
+ * @param value The fixed-point value.
+ * @param decimals Its number of decimals.
+ */
+double fromFixedPoint(int64_t value, int decimals);
+
 /**
  * @class TradeParser
  * @brief A class to parse trade data from the Binance API.
  * 
  * This class provides a method to parse a JSON response containing trade data into a list of Trade structures.
+ * 
+ * By default the responses are read by a single-pass scanner specialized to the aggTrades schema, which
+ * writes the fields straight into the Trade records without building a JSON tree. The nlohmann::json
+ * document parser remains available as a fallback. Both accept the fields in any order and skip
+ * unknown fields. They reject the same malformed JSON, with a "JSON parsing error" whose details
+ * differ, and report a missing or mistyped field of an otherwise well-formed response with the same
+ * message. The scanner checks the grammar of numbers and escapes, but not the raw bytes of strings:
+ * control characters and invalid UTF-8 are only rejected by the document parser.
+ * `tests/parser_differential_test.cpp` checks these cases against both backends.
  */
 class TradeParser {
 public:
+    /**
+     * @brief The ways a response can be parsed.
+     */
+    enum class Backend {
+        Scanner,  ///< The single-pass aggTrades scanner.
+        Document  ///< The nlohmann::json document parser.
+    };
+
+    /**
+     * @brief Constructs a new TradeParser object.
+     * 
+     * @param backend How the responses are parsed.
+     */
+    explicit TradeParser(Backend backend = Backend::Scanner) : backend(backend) {}
+
     /**
      * @brief Parses a JSON response to extract trade data.
      * 
@@ -37,6 +120,47 @@ public:
      * @throw std::runtime_error if the JSON parsing fails.
      */
     std::vector<Trade> parseTrades(const std::string& jsonResponse);
+
+    /**
+     * @brief Parses an aggTrade event of the WebSocket market streams.
+     * 
+     * Accepts both the raw event and the combined stream wrapper `{"stream": ..., "data": ...}`.
+     * 
+     * @param message One text message of the stream.
+     * @param symbol Receives the symbol of the trade (e.g., "BTCUSDT").
+     * @param eventTime Receives the time the event was sent, in milliseconds since the epoch.
+     * @param trade Receives the trade.
+     * @return False if the message is not an aggTrade event, e.g. the reply to a subscription.
+     * @throw std::runtime_error if the JSON parsing fails or a required field is missing.
+     */
+    bool parseStreamTrade(const std::string& message, std::string& symbol, long long& eventTime, Trade& trade);
+
+    /**
+     * @brief Parses a JSON response to extract compact trade records.
+     * 
+     * The prices and quantities are converted from their decimal digits straight into fixed point,
+     * without going through floating point.
+     * 
+     * @param jsonResponse A JSON string containing the trade data.
+     * @param scale The number of decimals of the symbol's prices and quantities.
+     * @return The trade records, in the order of the response.
+     * @throw std::runtime_error if the JSON parsing fails, a required field is missing, or a price or
+     *        quantity has more decimals than the scale.
+     */
+    std::vector<TradeRecord> parseTradeRecords(const std::string& jsonResponse, const TradeScale& scale = TradeScale());
+
+    /**
+     * @brief Reads the scale of a symbol from the exchange information.
+     * 
+     * @param exchangeInfo The response of `/fapi/v1/exchangeInfo`.
+     * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+     * @return The decimals of the symbol's tick size and step size.
+     * @throw std::runtime_error if the JSON parsing fails or the symbol or its filters are missing.
+     */
+    static TradeScale parseTradeScale(const std::string& exchangeInfo, const std::string& symbol);
+
+private:
+    Backend backend;  ///< How the responses are parsed.
 };
 
 #endif
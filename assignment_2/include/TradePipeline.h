@@ -0,0 +1,231 @@
+#ifndef TRADE_PIPELINE_H
+#define TRADE_PIPELINE_H
+
+#include "LockFreeRing.h"
+#include "PerformanceTimer.h"
+#include "TradeParser.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief What the parser does with a trade when the queue of a consumer is full.
+ */
+enum class Backpressure {
+    Block,    ///< Waits for the consumer, slowing the parser and in turn the sources
+    Drop,     ///< Drops the trade, counted in "pipeline.<consumer>.dropped"
+    Coalesce  ///< Merges the trade into a pending record of its source, counted in "pipeline.<consumer>.coalesced"
+};
+
+/**
+ * @struct PipelineTrade
+ * @brief A trade on its way to the consumers, with where and when it was received.
+ * 
+ * A coalesced trade stands for several consecutive trades of its source: it has the ID, price,
+ * side and time of the latest, the summed quantity, the trade ID range of them all, and the
+ * receive time of the earliest.
+ */
+struct PipelineTrade {
+    TradeRecord trade;       ///< The trade.
+    uint64_t receivedTicks;  ///< When its message was received, a CycleClock reading.
+    uint32_t source;         ///< The index of the source that received it.
+};
+
+/**
+ * @class TradePipeline
+ * @brief Runs network receive, parsing and consumers on their own threads, connected by lock-free rings.
+ * 
+ * Sources (e.g. REST pollers) each run on a thread and push the JSON aggTrades arrays they
+ * receive into one MPSCRing. One parser thread turns them into fixed-size TradeRecords, skips the
+ * trades of a source not newer than its last one (so overlapping polls are harmless), and fans
+ * them out to one SPSCRing per consumer. Each consumer runs on its own thread, so a slow one only
+ * fills its own ring, and its Backpressure policy decides whether that slows everyone (Block) or
+ * loses (Drop) or merges (Coalesce) its own trades.
+ * 
+ * The parser and the consumers poll their rings, yielding and then sleeping for 50 microseconds when idle,
+ * and every thread can be pinned to a CPU, so that latency stays flat through bursts. The
+ * following metrics are recorded in the PerformanceRegistry:
+ * - "pipeline.parser.queue_wait": from receive to parse, and "pipeline.parse" per message;
+ * - "pipeline.<consumer>.tick_to_consumer": from receive to the consumer call;
+ * - "pipeline.parser.max_depth" and "pipeline.<consumer>.max_depth": the deepest queue seen;
+ * - "pipeline.<consumer>.dropped", ".coalesced" and ".errors", "pipeline.parse_errors" and
+ *   "pipeline.source_errors".
+ */
+class TradePipeline {
+public:
+    /**
+     * @brief Receives the next message into `message`, on the thread of its source.
+     * 
+     * Returns false once the source is exhausted. It is called again as long as it returns true and
+     * the pipeline is not stopped, so it should block for at most a moment. An exception ends the
+     * source and is counted in "pipeline.source_errors".
+     */
+    typedef std::function<bool(std::string& message)> Source;
+
+    /**
+     * @brief Handles a trade, on the thread of its consumer; exceptions are counted, not propagated.
+     */
+    typedef std::function<void(const PipelineTrade& trade)> Consumer;
+
+    /**
+     * @brief Constructs a pipeline without stages.
+     * 
+     * @param scale The number of decimals of the prices and quantities.
+     * @param messageCapacity The number of messages between the sources and the parser.
+     * @param tradeCapacity The number of trades between the parser and each consumer.
+     */
+    explicit TradePipeline(const TradeScale& scale = TradeScale(), size_t messageCapacity = 1024,
+                           size_t tradeCapacity = 65536);
+
+    /**
+     * @brief Stops the pipeline if it is running.
+     */
+    ~TradePipeline();
+
+    TradePipeline(const TradePipeline&) = delete;
+    TradePipeline& operator=(const TradePipeline&) = delete;
+
+    /**
+     * @brief Adds a source; only before `start()`.
+     * 
+     * @param source Receives the messages.
+     * @param cpu The CPU to pin its thread to, or -1.
+     * @return The index of the source, found in its PipelineTrades.
+     */
+    uint32_t addSource(const Source& source, int cpu = -1);
+
+    /**
+     * @brief Adds a consumer; only before `start()`.
+     * 
+     * @param name The name of the consumer in the metrics (e.g., "db_writer").
+     * @param consumer Handles the trades.
+     * @param policy What to do with trades when its queue is full.
+     * @param cpu The CPU to pin its thread to, or -1.
+     */
+    void addConsumer(const std::string& name, const Consumer& consumer, Backpressure policy = Backpressure::Block,
+                     int cpu = -1);
+
+    /**
+     * @brief Sets the CPU to pin the parser thread to, or -1; only before `start()`.
+     */
+    void setParserCPU(int cpu);
+
+    /**
+     * @brief Starts every thread.
+     * 
+     * @throw std::logic_error if the pipeline is already started or has no source or consumer.
+     */
+    void start();
+
+    /**
+     * @brief Waits until every source is exhausted and every trade is consumed, then joins the threads.
+     */
+    void wait();
+
+    /**
+     * @brief Asks sources to stop after their current message, then waits like `wait()`.
+     */
+    void stop();
+
+    /**
+     * @brief Returns the number of messages waiting for the parser.
+     */
+    size_t parserQueueDepth() const;
+
+    /**
+     * @brief Returns the number of trades waiting for a consumer.
+     * 
+     * @param consumer The index of the consumer, in the order they were added.
+     */
+    size_t consumerQueueDepth(size_t consumer) const;
+
+private:
+    /**
+     * @struct Message
+     * @brief A message of a source, with when it was received.
+     */
+    struct Message {
+        std::string body;        ///< The JSON aggTrades array.
+        uint64_t receivedTicks;  ///< A CycleClock reading.
+        uint32_t source;         ///< The index of the source.
+    };
+
+    /**
+     * @struct SourceStage
+     * @brief A source with its thread.
+     */
+    struct SourceStage {
+        Source receive;          ///< Receives the messages.
+        int cpu;                 ///< The CPU to pin to, or -1.
+        long long lastId;        ///< The last aggregate trade ID passed on; parser only.
+        std::thread thread;      ///< Runs `receive`.
+    };
+
+    /**
+     * @struct ConsumerStage
+     * @brief A consumer with its queue, its pending coalesced trade and its metrics.
+     */
+    struct ConsumerStage {
+        ConsumerStage(const std::string& name, const Consumer& consume, Backpressure policy, int cpu, size_t capacity);
+
+        std::string name;            ///< The name in the metrics.
+        Consumer consume;            ///< Handles the trades.
+        Backpressure policy;         ///< What to do when the queue is full.
+        int cpu;                     ///< The CPU to pin to, or -1.
+        SPSCRing<PipelineTrade> queue; ///< The trades from the parser.
+        std::vector<PipelineTrade> pending; ///< Per source, the trades coalesced while the queue was full; parser only.
+        std::vector<bool> hasPending;       ///< Per source, whether `pending` holds a trade; parser only.
+        size_t pendingCount;         ///< The number of sources with a pending trade; parser only.
+        LatencyHistogram& latency;   ///< "pipeline.<name>.tick_to_consumer"
+        std::atomic<uint64_t>& maxDepth;  ///< "pipeline.<name>.max_depth"
+        std::atomic<uint64_t>& dropped;   ///< "pipeline.<name>.dropped"
+        std::atomic<uint64_t>& coalesced; ///< "pipeline.<name>.coalesced"
+        std::atomic<uint64_t>& errors;    ///< "pipeline.<name>.errors"
+        std::thread thread;          ///< Runs `consume`.
+    };
+
+    /**
+     * @brief Runs a source until it is exhausted or the pipeline stops.
+     */
+    void runSource(SourceStage& stage, uint32_t index);
+
+    /**
+     * @brief Parses messages until the sources are done and their queue is empty.
+     */
+    void runParser();
+
+    /**
+     * @brief Consumes trades until the parser is done and the queue is empty.
+     */
+    void runConsumer(ConsumerStage& stage);
+
+    /**
+     * @brief Hands a trade to a consumer's queue according to its policy.
+     */
+    void deliver(ConsumerStage& stage, const PipelineTrade& trade);
+
+    /**
+     * @brief Moves a consumer's pending coalesced trades into its queue, waiting if `block`.
+     * 
+     * @return True if none is left pending.
+     */
+    bool flushPending(ConsumerStage& stage, bool block);
+
+    TradeScale scale;                                       ///< The decimals of the records
+    size_t tradeCapacity;                                   ///< The capacity of each consumer queue
+    MPSCRing<Message> messages;                             ///< From the sources to the parser
+    std::vector<std::unique_ptr<SourceStage>> sources;      ///< The sources
+    std::vector<std::unique_ptr<ConsumerStage>> consumers;  ///< The consumers
+    int parserCPU;                                          ///< The CPU to pin the parser to, or -1
+    std::thread parser;                                     ///< Runs `runParser`
+    bool started;                                           ///< Set by `start()`, cleared once joined
+    std::atomic<bool> stopping;                             ///< Set by `stop()`
+    std::atomic<size_t> activeSources;                      ///< Sources still receiving
+    std::atomic<bool> parserDone;                           ///< The parser has delivered its last trade
+};
+
+#endif
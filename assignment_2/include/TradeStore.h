@@ -0,0 +1,315 @@
+#ifndef TRADE_STORE_H
+#define TRADE_STORE_H
+
+#include "SnapshotFormat.h"
+#include "TradeParser.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The current version of the trade segment format.
+ */
+constexpr uint32_t TRADE_SEGMENT_VERSION = 1;
+
+/**
+ * @brief The magic bytes identifying a trade segment.
+ */
+constexpr char TRADE_SEGMENT_MAGIC[8] = {'D', 'W', 'F', 'T', 'R', 'D', 'S', '\0'};
+
+/**
+ * @struct TradeSegmentHeader
+ * @brief The header of a trade segment file, following the conventions of SnapshotFormat.h.
+ * 
+ * The header is followed by sections that each start at a multiple of SNAPSHOT_ALIGNMENT: the
+ * block index (blockCount TradeBlockIndex entries), then one column per field of the `count`
+ * trades: aggregate trade ID, timestamp and first trade ID as uint32 deltas from the base of
+ * their block, price and quantity as int64 fixed-point values, the trade count as uint32 and
+ * `isBuyerMaker` as one byte. The offsets of the sections are recorded so that a reader can
+ * check them against the file size before using the mapped columns in place.
+ */
+struct TradeSegmentHeader {
+    char magic[8];               ///< TRADE_SEGMENT_MAGIC.
+    uint32_t version;            ///< TRADE_SEGMENT_VERSION.
+    uint32_t byteOrder;          ///< SNAPSHOT_BYTE_ORDER_MARK in the producer's byte order.
+    uint32_t headerSize;         ///< sizeof(TradeSegmentHeader).
+    int32_t priceDecimals;       ///< The TradeScale of the prices.
+    int32_t quantityDecimals;    ///< The TradeScale of the quantities.
+    uint32_t blockCount;         ///< The number of blocks.
+    uint64_t count;              ///< The number of trades.
+    char symbol[32];             ///< The trading pair symbol, padded with zeros.
+    uint64_t indexOffset;        ///< The offset of the block index.
+    uint64_t idOffset;           ///< The offset of the aggregate trade ID deltas.
+    uint64_t timeOffset;         ///< The offset of the timestamp deltas.
+    uint64_t priceOffset;        ///< The offset of the prices.
+    uint64_t quantityOffset;     ///< The offset of the quantities.
+    uint64_t firstTradeIdOffset; ///< The offset of the first trade ID deltas.
+    uint64_t tradeCountOffset;   ///< The offset of the trade counts.
+    uint64_t buyerMakerOffset;   ///< The offset of the buyer-maker flags.
+};
+
+static_assert(sizeof(TradeSegmentHeader) % SNAPSHOT_ALIGNMENT == 0, "Segment sections must stay aligned");
+
+/**
+ * @struct TradeBlockIndex
+ * @brief The sparse index entry of a block of consecutive trades, with the bases of its deltas.
+ */
+struct TradeBlockIndex {
+    uint64_t firstRow;           ///< The row of the first trade of the block in the segment.
+    uint32_t rowCount;           ///< The number of trades of the block, at least 1.
+    uint32_t reserved;           ///< Always 0.
+    int64_t firstId;             ///< The aggregate trade ID of the first trade, the base of the ID deltas.
+    int64_t lastId;              ///< The aggregate trade ID of the last trade.
+    int64_t firstTime;           ///< The timestamp of the first trade, the base of the timestamp deltas.
+    int64_t lastTime;            ///< The timestamp of the last trade.
+    int64_t firstTradeIdBase;    ///< The smallest first trade ID, the base of the first trade ID deltas.
+};
+
+static_assert(sizeof(TradeBlockIndex) % SNAPSHOT_ALIGNMENT == 0, "Segment sections must stay aligned");
+
+/**
+ * @struct TradeColumns
+ * @brief A view of consecutive trades of a block, column by column.
+ * 
+ * The pointers point into the mapped segment (or the trades not yet written), so they are valid
+ * during the visit only. Scans that need a few fields read only their columns, e.g. prices and
+ * quantities for a VWAP.
+ */
+struct TradeColumns {
+    size_t count;                       ///< The number of trades.
+    int64_t idBase;                     ///< Added to `idDeltas`.
+    int64_t timeBase;                   ///< Added to `timeDeltas`.
+    int64_t firstTradeIdBase;           ///< Added to `firstTradeIdDeltas`.
+    const uint32_t* idDeltas;           ///< The aggregate trade IDs.
+    const uint32_t* timeDeltas;         ///< The timestamps.
+    const int64_t* prices;              ///< The fixed-point prices.
+    const int64_t* quantities;          ///< The fixed-point quantities.
+    const uint32_t* firstTradeIdDeltas; ///< The first trade IDs.
+    const uint32_t* tradeCounts;        ///< The numbers of trades aggregated.
+    const uint8_t* buyerMaker;          ///< 1 if the buyer is the maker.
+
+    /**
+     * @brief Decodes one trade.
+     * 
+     * @param i Its position in the view.
+     */
+    TradeRecord record(size_t i) const {
+        TradeRecord trade;
+        trade.aggregateTradeId = idBase + idDeltas[i];
+        trade.price = prices[i];
+        trade.quantity = quantities[i];
+        trade.firstTradeId = firstTradeIdBase + firstTradeIdDeltas[i];
+        trade.timestamp = timeBase + timeDeltas[i];
+        trade.tradeCount = tradeCounts[i];
+        trade.isBuyerMaker = buyerMaker[i] != 0;
+        return trade;
+    }
+};
+
+/**
+ * @class TradeStore
+ * @brief Persists the trade records of many symbols in columnar, memory-mapped segment files.
+ * 
+ * Each symbol has a directory of append-only segments named after their first aggregate trade ID.
+ * A segment is written once, when it is full or on `flush()`, then mapped and read in place:
+ * nothing is parsed or copied when a store is opened. Its trades are cut into blocks whose index
+ * entries hold the first and last aggregate trade ID and timestamp, so a range query binary-searches
+ * the index, then the delta column of the blocks at the edges of the range, and hands the columns
+ * of every block in between to the visitor as they lie in the file. Trades not yet written are
+ * kept in the same layout, so they are found by the same queries.
+ * 
+ * Trades are appended in aggregate trade ID order; those not newer than the last stored trade of
+ * their symbol are skipped, so overlapping backfills are harmless. An object must only be used by
+ * one thread at a time.
+ */
+class TradeStore {
+public:
+    /**
+     * @brief Receives the trades of a range, a block at a time, in aggregate trade ID order.
+     */
+    typedef std::function<void(const TradeColumns& columns)> BlockVisitor;
+
+    /**
+     * @brief Opens a store, creating its directory if needed.
+     * 
+     * @param directory The directory of the store.
+     * @param blockTrades The number of trades per block, at most.
+     * @param segmentTrades The number of trades per segment, at most.
+     * @throw std::invalid_argument if a size is 0.
+     * @throw std::runtime_error if the directory cannot be created.
+     */
+    explicit TradeStore(const std::string& directory, uint32_t blockTrades = 4096, size_t segmentTrades = 1 << 20);
+
+    /**
+     * @brief Writes the trades not yet written, then unmaps the segments.
+     */
+    ~TradeStore();
+
+    TradeStore(const TradeStore&) = delete;
+    TradeStore& operator=(const TradeStore&) = delete;
+
+    /**
+     * @brief Appends trades of a symbol.
+     * 
+     * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+     * @param scale The scale of the records, which must not change for a symbol.
+     * @param trades The trades, in aggregate trade ID order.
+     * @return The number of trades appended, without those skipped as already stored.
+     * @throw std::invalid_argument if the symbol is not a valid name, the scale differs from the stored
+     * one, or a trade is older than the one before it; nothing is appended then.
+     * @throw std::runtime_error if a full segment cannot be written; the trades before it stay appended.
+     */
+    size_t append(const std::string& symbol, const TradeScale& scale, const std::vector<TradeRecord>& trades);
+
+    /**
+     * @brief Writes the trades not yet written of every symbol as new segments.
+     * 
+     * @throw std::runtime_error if a segment cannot be written.
+     */
+    void flush();
+
+    /**
+     * @brief Returns the scale of a symbol's records.
+     * 
+     * @throw std::invalid_argument if the symbol has no trades.
+     */
+    TradeScale getScale(const std::string& symbol);
+
+    /**
+     * @brief Returns the number of trades of a symbol.
+     */
+    uint64_t size(const std::string& symbol);
+
+    /**
+     * @brief Returns the last aggregate trade ID of a symbol, or -1 if it has no trades.
+     */
+    int64_t getLastTradeId(const std::string& symbol);
+
+    /**
+     * @brief Visits the trades of a symbol with timestamps in `[startTime, endTime)`.
+     * 
+     * @return The number of trades visited.
+     */
+    uint64_t scanByTime(const std::string& symbol, int64_t startTime, int64_t endTime, const BlockVisitor& visit);
+
+    /**
+     * @brief Visits the trades of a symbol with aggregate trade IDs in `[fromId, toId)`.
+     * 
+     * @return The number of trades visited.
+     */
+    uint64_t scanById(const std::string& symbol, int64_t fromId, int64_t toId, const BlockVisitor& visit);
+
+    /**
+     * @brief Returns the trades of a symbol with timestamps in `[startTime, endTime)`.
+     */
+    std::vector<TradeRecord> readByTime(const std::string& symbol, int64_t startTime, int64_t endTime);
+
+    /**
+     * @brief Returns the trades of a symbol with aggregate trade IDs in `[fromId, toId)`.
+     */
+    std::vector<TradeRecord> readById(const std::string& symbol, int64_t fromId, int64_t toId);
+
+private:
+    /**
+     * @struct SegmentView
+     * @brief The block index and columns of a mapped segment, or of the trades not yet written.
+     */
+    struct SegmentView {
+        const TradeBlockIndex* blocks;      ///< The block index.
+        size_t blockCount;                  ///< The number of blocks.
+        const uint32_t* idDeltas;           ///< The aggregate trade ID column.
+        const uint32_t* timeDeltas;         ///< The timestamp column.
+        const int64_t* prices;              ///< The price column.
+        const int64_t* quantities;          ///< The quantity column.
+        const uint32_t* firstTradeIdDeltas; ///< The first trade ID column.
+        const uint32_t* tradeCounts;        ///< The trade count column.
+        const uint8_t* buyerMaker;          ///< The buyer-maker column.
+    };
+
+    /**
+     * @struct Segment
+     * @brief A mapped segment file.
+     */
+    struct Segment {
+        ~Segment();
+
+        const char* mapping;                ///< The mapped file.
+        size_t mappingSize;                 ///< Its size.
+        const TradeSegmentHeader* header;   ///< The header at the start of the mapping.
+        SegmentView view;                   ///< The sections, in place.
+    };
+
+    /**
+     * @struct PendingColumns
+     * @brief The trades of a symbol not yet written, in the layout of a segment.
+     */
+    struct PendingColumns {
+        std::vector<TradeBlockIndex> blocks;        ///< The block index.
+        std::vector<uint32_t> idDeltas;             ///< The aggregate trade ID column.
+        std::vector<uint32_t> timeDeltas;           ///< The timestamp column.
+        std::vector<int64_t> prices;                ///< The price column.
+        std::vector<int64_t> quantities;            ///< The quantity column.
+        std::vector<uint32_t> firstTradeIdDeltas;   ///< The first trade ID column.
+        std::vector<uint32_t> tradeCounts;          ///< The trade count column.
+        std::vector<uint8_t> buyerMaker;            ///< The buyer-maker column.
+    };
+
+    /**
+     * @struct SymbolStore
+     * @brief The segments and the pending trades of a symbol.
+     */
+    struct SymbolStore {
+        std::string symbol;                             ///< The trading pair symbol.
+        std::string directory;                          ///< The directory of its segments.
+        bool hasScale;                                  ///< Whether a segment or an append set `scale`.
+        TradeScale scale;                               ///< The scale of the records.
+        std::vector<std::unique_ptr<Segment>> segments; ///< The segments, in ID order.
+        PendingColumns pending;                         ///< The trades not yet written.
+        uint64_t count;                                 ///< The number of trades, written or not.
+        int64_t lastId;                                 ///< The last aggregate trade ID, or -1.
+        int64_t lastTime;                               ///< The timestamp of the last trade.
+    };
+
+    /**
+     * @brief Returns the state of a symbol, mapping its segments on first use.
+     */
+    SymbolStore& symbolStore(const std::string& symbol);
+
+    /**
+     * @brief Maps and checks a segment file.
+     * 
+     * @throw std::runtime_error if the file cannot be opened or mapped, or is not a valid segment.
+     */
+    static std::unique_ptr<Segment> mapSegment(const std::string& path);
+
+    /**
+     * @brief Writes the pending trades of a symbol as a segment and maps it.
+     */
+    void writeSegment(SymbolStore& store);
+
+    /**
+     * @brief Visits the trades of a symbol whose time (or ID) is in `[from, to)`.
+     */
+    uint64_t scan(SymbolStore& store, bool byTime, int64_t from, int64_t to, const BlockVisitor& visit);
+
+    /**
+     * @brief Returns the trades of a symbol whose time (or ID) is in `[from, to)`.
+     */
+    std::vector<TradeRecord> read(SymbolStore& store, bool byTime, int64_t from, int64_t to);
+
+    /**
+     * @brief Visits the trades of one segment whose time (or ID) is in `[from, to)`.
+     */
+    static uint64_t scanSegment(const SegmentView& view, bool byTime, int64_t from, int64_t to,
+                                const BlockVisitor& visit);
+
+    std::string directory;                                 ///< The directory of the store
+    uint32_t blockTrades;                                  ///< The maximum number of trades per block
+    size_t segmentTrades;                                  ///< The maximum number of trades per segment
+    std::map<std::string, std::unique_ptr<SymbolStore>> symbols; ///< The symbols used so far
+};
+
+#endif
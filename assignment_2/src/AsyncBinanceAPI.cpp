@@ -0,0 +1,377 @@
+#include "AsyncBinanceAPI.h"
+#include "BinanceAPI.h"
+#include "PerformanceTimer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+
+/**
+ * @struct AsyncBinanceAPI::Transfer
+ * @brief A request, with the easy handle and the response buffer it keeps between requests.
+ * 
+ * A transfer is owned by the queue while it waits, by the multi handle (through `active` and
+ * `CURLOPT_PRIVATE`) while it runs, and by the idle pool once it is done.
+ */
+struct AsyncBinanceAPI::Transfer {
+    CURL* curl = nullptr;        ///< Created on first use, then kept for every later request
+    std::string url;             ///< The URL of the request
+    int weight = 0;              ///< The weight taken from the rate limiter before it starts
+    Callback onComplete;         ///< Receives the result
+    std::exception_ptr rejection; ///< Set if the request is failed without being sent
+    std::string response;        ///< The body of the response
+    int usedWeight = -1;         ///< The X-MBX-USED-WEIGHT-1M of the response, or -1
+    int retryAfter = -1;         ///< The Retry-After of the response in seconds, or -1
+    std::chrono::steady_clock::time_point startTime; ///< When the transfer was added to the multi handle
+
+    ~Transfer() {
+        curl_easy_cleanup(curl);
+    }
+};
+
+/**
+ * @brief Appends the data received from the server to the response of a transfer.
+ */
+static size_t writeCallback(void* contents, size_t size, size_t count, void* response) {
+    static_cast<std::string*>(response)->append(static_cast<char*>(contents), size * count);
+    return size * count;
+}
+
+/**
+ * @brief Constructs a new AsyncBinanceAPI object and starts its event loop.
+ * 
+ * @param baseURL The base URL of the Binance API (e.g., "https://fapi.binance.com").
+ * @param rateLimiter The rate limiter of the requests, or nullptr for a new one.
+ * @param maxConnections The most connections opened to the host.
+ * @param useHttp2 Multiplexes the requests over HTTP/2 when the server and libcurl support it.
+ * @throw BinanceAPI::APIException if cURL cannot be initialized.
+ */
+AsyncBinanceAPI::AsyncBinanceAPI(const std::string& baseURL, const std::shared_ptr<RateLimiter>& rateLimiter,
+                                 int maxConnections, bool useHttp2)
+    : baseURL(baseURL), useHttp2(useHttp2), rateLimiter(rateLimiter ? rateLimiter : std::make_shared<RateLimiter>()),
+      multi(curl_multi_init()), share(curl_share_init()), pending(0), stopping(false) {
+    if (!multi || !share) {
+        curl_multi_cleanup(multi);
+        curl_share_cleanup(share);
+        throw BinanceAPI::APIException("Failed to initialize cURL.");
+    }
+    // The multi handle already shares its DNS cache and connections; only the event loop thread
+    // uses the handles, so the share object needs no locks
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(maxConnections));
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(maxConnections));
+
+    loop = std::thread(&AsyncBinanceAPI::runLoop, this);
+}
+
+/**
+ * @brief Stops the event loop; requests still queued or in flight fail with an APIException.
+ */
+AsyncBinanceAPI::~AsyncBinanceAPI() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    curl_multi_wakeup(multi);
+    loop.join();
+
+    // The easy handles must be cleaned up before the share object they use
+    idle.clear();
+    curl_multi_cleanup(multi);
+    curl_share_cleanup(share);
+}
+
+/**
+ * @brief Queues a request for the aggregate trades of a symbol.
+ * 
+ * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+ * @param limit The number of trades to retrieve (at most 1000).
+ * @param fromId The aggregate trade ID to start from, or -1 for the most recent trades.
+ * @param onComplete Receives the JSON response or the error, on the event loop thread.
+ */
+void AsyncBinanceAPI::getAggregateTrades(const std::string& symbol, int limit, long long fromId,
+                                         const Callback& onComplete) {
+    std::string endpoint = "/fapi/v1/aggTrades?symbol=" + symbol + "&limit=" + std::to_string(limit);
+    if (fromId >= 0) {
+        endpoint += "&fromId=" + std::to_string(fromId);
+    }
+    enqueue(endpoint, BinanceAPI::AGG_TRADES_WEIGHT, onComplete);
+}
+
+/**
+ * @brief Queues a request for the aggregate trades of a symbol.
+ * 
+ * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+ * @param limit The number of trades to retrieve (at most 1000).
+ * @param fromId The aggregate trade ID to start from, or -1 for the most recent trades.
+ * @return The JSON response; `get()` throws BinanceAPI::APIException if the request failed.
+ */
+std::future<std::string> AsyncBinanceAPI::getAggregateTrades(const std::string& symbol, int limit, long long fromId) {
+    // std::function must be copyable, and std::promise is not
+    std::shared_ptr<std::promise<std::string>> promise = std::make_shared<std::promise<std::string>>();
+    getAggregateTrades(symbol, limit, fromId, [promise](const std::string& response, const std::exception_ptr& error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(response);
+        }
+    });
+    return promise->get_future();
+}
+
+/**
+ * @brief Returns the rate limiter of the requests.
+ */
+const std::shared_ptr<RateLimiter>& AsyncBinanceAPI::getRateLimiter() const {
+    return rateLimiter;
+}
+
+/**
+ * @brief Returns the number of requests queued or in flight.
+ */
+size_t AsyncBinanceAPI::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+/**
+ * @brief Queues a request, reusing an idle transfer if there is one, and wakes the event loop up.
+ * 
+ * A request heavier than the rate limit could never start; it is queued all the same, so that its
+ * callback still runs on the event loop thread, and fails there with an APIException.
+ * 
+ * @param endpoint The API endpoint of the request.
+ * @param weight The weight of the request.
+ * @param onComplete Receives the result.
+ */
+void AsyncBinanceAPI::enqueue(const std::string& endpoint, int weight, const Callback& onComplete) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<Transfer> transfer;
+        if (idle.empty()) {
+            transfer.reset(new Transfer());
+        } else {
+            transfer = std::move(idle.back());
+            idle.pop_back();
+        }
+        transfer->url.assign(baseURL).append(endpoint);
+        transfer->weight = weight;
+        transfer->onComplete = onComplete;
+        transfer->rejection = nullptr;
+        if (!rateLimiter->canAcquire(weight)) {
+            transfer->rejection = std::make_exception_ptr(BinanceAPI::APIException(
+                "Request weight " + std::to_string(weight) + " can never be granted by the rate limiter."));
+        }
+        queue.push_back(std::move(transfer));
+        ++pending;
+    }
+    curl_multi_wakeup(multi);
+}
+
+/**
+ * @brief Receives the response headers of a transfer and records the rate-limit ones.
+ * 
+ * @param buffer One header line, not null-terminated.
+ * @param size Always 1.
+ * @param count The length of the line.
+ * @param transfer The transfer of the response.
+ * @return The number of bytes handled, the whole line.
+ */
+size_t AsyncBinanceAPI::headerCallback(char* buffer, size_t size, size_t count, void* transfer) {
+    Transfer* self = static_cast<Transfer*>(transfer);
+    std::string line(buffer, size * count);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name == "x-mbx-used-weight-1m") {
+            self->usedWeight = std::atoi(line.c_str() + colon + 1);
+        } else if (name == "retry-after") {
+            self->retryAfter = std::atoi(line.c_str() + colon + 1);
+        }
+    }
+    return size * count;
+}
+
+/**
+ * @brief Runs the transfers until the object is destroyed, then fails the remaining ones.
+ * 
+ * Each turn starts the queued requests the rate limiter allows, lets cURL progress on every
+ * transfer, completes the finished ones, and waits for network activity, a new request, or the
+ * rate limiter, at most a second.
+ */
+void AsyncBinanceAPI::runLoop() {
+    for (;;) {
+        long waitMs = startQueued();
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        completeFinished();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                break;
+            }
+        }
+        int timeoutMs = waitMs < 0 ? 1000 : static_cast<int>(std::min(waitMs, 1000L));
+        curl_multi_poll(multi, nullptr, 0, timeoutMs, nullptr);
+    }
+
+    std::exception_ptr cancelled =
+        std::make_exception_ptr(BinanceAPI::APIException("Request cancelled: the client was destroyed."));
+    while (!active.empty()) {
+        curl_multi_remove_handle(multi, active.back()->curl);
+        complete(active.back(), cancelled);
+    }
+    std::deque<std::unique_ptr<Transfer>> waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        waiting.swap(queue);
+    }
+    for (std::unique_ptr<Transfer>& transfer : waiting) {
+        complete(transfer.release(), cancelled);
+    }
+}
+
+/**
+ * @brief Moves queued requests to the multi handle while the rate limiter allows.
+ * 
+ * The easy handle of a transfer is created on its first request and keeps its options after; a
+ * reused handle only gets the new URL.
+ * 
+ * @return How long until the next queued request may start in milliseconds, or -1 if none is waiting.
+ */
+long AsyncBinanceAPI::startQueued() {
+    for (;;) {
+        Transfer* transfer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queue.empty()) {
+                return -1;
+            }
+            std::chrono::milliseconds delay(0);
+            if (!queue.front()->rejection && !rateLimiter->tryAcquire(queue.front()->weight, delay)) {
+                return static_cast<long>(delay.count());
+            }
+            transfer = queue.front().release();
+            queue.pop_front();
+        }
+        if (transfer->rejection) {
+            std::exception_ptr rejection = transfer->rejection;
+            transfer->rejection = nullptr;
+            complete(transfer, rejection);
+            continue;
+        }
+
+        if (!transfer->curl) {
+            transfer->curl = curl_easy_init();
+            if (!transfer->curl) {
+                complete(transfer, std::make_exception_ptr(BinanceAPI::APIException("Failed to initialize cURL.")));
+                continue;
+            }
+            curl_easy_setopt(transfer->curl, CURLOPT_SHARE, share);
+            curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer);
+            curl_easy_setopt(transfer->curl, CURLOPT_WRITEFUNCTION, writeCallback);
+            curl_easy_setopt(transfer->curl, CURLOPT_WRITEDATA, &transfer->response);
+            curl_easy_setopt(transfer->curl, CURLOPT_HEADERFUNCTION, headerCallback);
+            curl_easy_setopt(transfer->curl, CURLOPT_HEADERDATA, transfer);
+            curl_easy_setopt(transfer->curl, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(transfer->curl, CURLOPT_TCP_NODELAY, 1L);
+            curl_easy_setopt(transfer->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(transfer->curl, CURLOPT_ACCEPT_ENCODING, "");
+            // Waits for a connection to be multiplexed on rather than opening a new one
+            curl_easy_setopt(transfer->curl, CURLOPT_PIPEWAIT, 1L);
+            if (useHttp2) {
+                curl_easy_setopt(transfer->curl, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+            }
+        }
+        curl_easy_setopt(transfer->curl, CURLOPT_URL, transfer->url.c_str());
+        transfer->response.clear();
+        transfer->usedWeight = -1;
+        transfer->retryAfter = -1;
+        transfer->startTime = std::chrono::steady_clock::now();
+        active.push_back(transfer);
+        curl_multi_add_handle(multi, transfer->curl);
+    }
+}
+
+/**
+ * @brief Completes the transfers the multi handle reports as done.
+ * 
+ * The result is checked like BinanceAPI does: network errors, no response and non-2xx codes become
+ * APIExceptions, and the used weight, throttling and successes are reported to the rate limiter.
+ * The network phases of the transfers that got a response are recorded as BinanceAPI's are.
+ */
+void AsyncBinanceAPI::completeFinished() {
+    int remaining = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi, &remaining)) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        CURL* curl = message->easy_handle;
+        CURLcode res = message->data.result;
+        Transfer* transfer = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, &transfer);
+        curl_multi_remove_handle(multi, curl);
+
+        if (res == CURLE_OK) {
+            BinanceAPI::recordTransferTimings(curl);
+        }
+        long http_code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        if (transfer->usedWeight >= 0) {
+            rateLimiter->observeUsedWeight(transfer->usedWeight);
+        }
+
+        std::exception_ptr error;
+        if (res != CURLE_OK) {
+            error = std::make_exception_ptr(
+                BinanceAPI::APIException("Network error: " + std::string(curl_easy_strerror(res))));
+        } else if (http_code == 0) {
+            error = std::make_exception_ptr(
+                BinanceAPI::APIException("No response from server (HTTP code 0). Possible network or DNS issue."));
+        } else if (http_code == 429 || http_code == 418) {
+            rateLimiter->backOff(http_code, transfer->retryAfter);
+            error = std::make_exception_ptr(BinanceAPI::APIException(
+                "API error: HTTP code " + std::to_string(http_code) + " (rate limited)", http_code));
+        } else if (http_code < 200 || http_code >= 300) {
+            error = std::make_exception_ptr(
+                BinanceAPI::APIException("API error: HTTP code " + std::to_string(http_code), http_code));
+        } else {
+            rateLimiter->succeed();
+        }
+        complete(transfer, error);
+    }
+}
+
+/**
+ * @brief Hands a finished transfer's result to its callback and returns it to the idle pool.
+ * 
+ * The time from the start of the transfer is recorded in the "api.async_round_trip" histogram.
+ * 
+ * @param transfer The finished transfer, in `active` or owned by no one.
+ * @param error The error of the request, or null if it succeeded.
+ */
+void AsyncBinanceAPI::complete(Transfer* transfer, const std::exception_ptr& error) {
+    std::unique_ptr<Transfer> owner(transfer);
+    std::vector<Transfer*>::iterator position = std::find(active.begin(), active.end(), transfer);
+    if (position != active.end()) {
+        *position = active.back();
+        active.pop_back();
+        PerformanceRegistry::histogram("api.async_round_trip").record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - transfer->startTime).count()));
+    }
+
+    Callback onComplete;
+    onComplete.swap(transfer->onComplete);
+    try {
+        onComplete(error ? std::string() : transfer->response, error);
+    } catch (...) {
+        // The event loop must survive its callbacks
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    idle.push_back(std::move(owner));
+    --pending;
+}
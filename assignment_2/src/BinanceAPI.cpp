@@ -1,6 +1,14 @@
 #include "BinanceAPI.h"
+#include "PerformanceTimer.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
-#include <curl/curl.h>
+#include <mutex>
+#include <thread>
 
 /**
  * @brief Callback function to handle cURL data.
@@ -19,72 +27,220 @@ static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::stri
     return totalSize;
 }
 
+/**
+ * @brief Guards the data of the share object, one mutex per kind of shared data.
+ */
+static std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+/**
+ * @brief Locks shared data for cURL, so that handles on several threads can join the share object.
+ */
+static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void*) {
+    shareLocks[data].lock();
+}
+
+/**
+ * @brief Unlocks shared data locked by `lockShare`.
+ */
+static void unlockShare(CURL*, curl_lock_data data, void*) {
+    shareLocks[data].unlock();
+}
+
 /**
  * @brief Constructs a new BinanceAPI object with the specified base URL.
  * 
+ * Creates the share object, the rate limiter and the long-lived handle.
+ * 
+ * @param baseURL The base URL of the Binance API.
+ * @param useHttp2 Negotiates HTTP/2 over TLS when the server and libcurl support it.
+ * @throw APIException if cURL cannot be initialized.
+ */
+BinanceAPI::BinanceAPI(const std::string& baseURL, bool useHttp2)
+    : BinanceAPI(baseURL, useHttp2, nullptr, std::make_shared<RateLimiter>()) {}
+
+/**
+ * @brief Constructs a BinanceAPI object, joining an existing share object if one is given.
+ * 
+ * Sets the options that do not change between requests: keep-alive probes on the connection,
+ * `TCP_NODELAY` so small requests are not held back, any response encoding libcurl can decode
+ * (gzip, deflate, ...), and HTTP/2 if requested.
+ * 
  * @param baseURL The base URL of the Binance API.
+ * @param useHttp2 Negotiates HTTP/2 over TLS when the server and libcurl support it.
+ * @param share The share object to join, or nullptr to create one.
+ * @param rateLimiter The rate limiter of the requests.
+ * @throw APIException if cURL cannot be initialized.
+ */
+BinanceAPI::BinanceAPI(const std::string& baseURL, bool useHttp2, CURLSH* share, const std::shared_ptr<RateLimiter>& rateLimiter)
+    : baseURL(baseURL), useHttp2(useHttp2), ownsShare(share == nullptr), share(share ? share : curl_share_init()),
+      curl(curl_easy_init()), rateLimiter(rateLimiter), usedWeight(-1), retryAfter(-1) {
+    if (!this->share || !curl) {
+        curl_easy_cleanup(curl);
+        if (ownsShare) {
+            curl_share_cleanup(this->share);
+        }
+        throw APIException("Failed to initialize cURL.");
+    }
+    if (ownsShare) {
+        curl_share_setopt(this->share, CURLSHOPT_LOCKFUNC, lockShare);
+        curl_share_setopt(this->share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+        curl_share_setopt(this->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(this->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_SHARE, this->share);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, this);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    if (useHttp2) {
+        // Fails harmlessly if libcurl was built without HTTP/2; HTTP/1.1 is used then
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    }
+
+    // Enable verbose output for debugging 
+    //curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+
+    response.reserve(RESPONSE_RESERVE);
+}
+
+/**
+ * @brief Closes the connection and releases the cURL handles.
+ */
+BinanceAPI::~BinanceAPI() {
+    // The share object can only be cleaned up once no handle uses it
+    curl_easy_cleanup(curl);
+    if (ownsShare) {
+        curl_share_cleanup(share);
+    }
+}
+
+/**
+ * @brief Receives the response headers and records the rate-limit ones.
+ * 
+ * Header names are compared case-insensitively, since HTTP/2 sends them in lower case.
+ * 
+ * @param buffer One header line, not null-terminated.
+ * @param size Always 1.
+ * @param count The length of the line.
+ * @param api The BinanceAPI object of the request.
+ * @return The number of bytes handled, the whole line.
  */
-BinanceAPI::BinanceAPI(const std::string& baseURL) : baseURL(baseURL) {}
+size_t BinanceAPI::headerCallback(char* buffer, size_t size, size_t count, void* api) {
+    BinanceAPI* self = static_cast<BinanceAPI*>(api);
+    std::string line(buffer, size * count);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name == "x-mbx-used-weight-1m") {
+            self->usedWeight = std::atoi(line.c_str() + colon + 1);
+        } else if (name == "retry-after") {
+            self->retryAfter = std::atoi(line.c_str() + colon + 1);
+        }
+    }
+    return size * count;
+}
 
 /**
  * @brief Sends a GET request to the Binance API and retrieves the response.
  * 
  * This function sends a GET request to the specified API endpoint and handles various error
- * scenarios, including network issues and invalid HTTP response codes.
+ * scenarios, including network issues and invalid HTTP response codes. The connection of the
+ * previous request is reused if it is still open; otherwise libcurl reconnects, with the DNS
+ * entry and the TLS session cached. The request waits for its weight in the rate limiter, and
+ * the response's used weight, or its 429 or 418 status, is reported back to it.
  * 
  * @param endpoint The API endpoint to send the GET request to.
- * @return A string containing the response from the API.
- * @throw APIException if there is a network error or if the API returns an error code.
+ * @param weight The weight of the request.
+ * @return A string containing the response from the API, valid until the next request.
+ * @throw APIException if there is a network error, if the API returns an error code, or if the weight
+ * is above what the rate limiter can ever grant.
  */
-std::string BinanceAPI::sendGETRequest(const std::string& endpoint) {
-    std::string url = baseURL + endpoint;
-    CURL* curl;
-    CURLcode res;
-    std::string response;
+const std::string& BinanceAPI::sendGETRequest(const std::string& endpoint, int weight) {
+    if (!rateLimiter->canAcquire(weight)) {
+        throw APIException("Request weight " + std::to_string(weight) + " can never be granted by the rate limiter.");
+    }
+    rateLimiter->acquire(weight);
+    url.assign(baseURL).append(endpoint);
+    response.clear();
+    usedWeight = -1;
+    retryAfter = -1;
     long http_code = 0;
 
-    curl = curl_easy_init();
-    if(curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-        // Enable verbose output for debugging 
-        //curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
+    CURLcode res;
+    {
+        PERF_SCOPE("api.curl_perform");
         res = curl_easy_perform(curl);
+    }
 
-        // Get HTTP response code
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-
-        if (res != CURLE_OK) {
-            std::string errorMessage = "Network error: " + std::string(curl_easy_strerror(res));
-            curl_easy_cleanup(curl);
-            throw APIException(errorMessage);
-        }
-
-        // Check for HTTP error codes or no response (HTTP code 0)
-        if (http_code == 0) {
-            curl_easy_cleanup(curl);
-            throw APIException("No response from server (HTTP code 0). Possible network or DNS issue.");
-        } else if (http_code >= 200 && http_code < 300) {
-            // Request was successful
-            curl_easy_cleanup(curl);
-            return response;
-        } else {
-            // Handle any other non-successful HTTP status codes
-            curl_easy_cleanup(curl);
-            throw APIException("API error: HTTP code " + std::to_string(http_code));
-        }
+    if (res != CURLE_OK) {
+        throw APIException("Network error: " + std::string(curl_easy_strerror(res)));
+    }
+    recordTransferTimings(curl);
 
-        curl_easy_cleanup(curl);
-    } else {
-        throw APIException("Failed to initialize cURL.");
+    // Get HTTP response code
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    if (usedWeight >= 0) {
+        rateLimiter->observeUsedWeight(usedWeight);
     }
 
+    // Check for HTTP error codes or no response (HTTP code 0)
+    if (http_code == 0) {
+        throw APIException("No response from server (HTTP code 0). Possible network or DNS issue.");
+    } else if (http_code == 429 || http_code == 418) {
+        // Too many requests, or banned for ignoring them: every request pauses
+        rateLimiter->backOff(http_code, retryAfter);
+        throw APIException("API error: HTTP code " + std::to_string(http_code) + " (rate limited)", http_code);
+    } else if (http_code < 200 || http_code >= 300) {
+        // Handle any other non-successful HTTP status codes
+        throw APIException("API error: HTTP code " + std::to_string(http_code), http_code);
+    }
+    rateLimiter->succeed();
     return response;
 }
 
+/**
+ * @brief Records the network phases of a finished transfer in the PerformanceRegistry.
+ * 
+ * libcurl reports each phase as the time from the start of the transfer to its end, in
+ * microseconds; consecutive ones are subtracted to get the phases. A reused connection has no
+ * DNS, connect or TLS phase, so those are only recorded for new connections, where a zero TLS
+ * time means plain HTTP. The time between "api.total" and the caller's own measurement of the
+ * request is spent in this code, e.g. waiting for the rate limiter.
+ * 
+ * @param handle The cURL handle of the transfer.
+ */
+void BinanceAPI::recordTransferTimings(CURL* handle) {
+    curl_off_t nameLookup = 0, connect = 0, appConnect = 0, startTransfer = 0, total = 0;
+    long newConnections = 0;
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &nameLookup);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &startTransfer);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &newConnections);
+
+    if (newConnections > 0) {
+        PerformanceRegistry::histogram("api.dns").record(static_cast<uint64_t>(nameLookup) * 1000);
+        PerformanceRegistry::histogram("api.connect").record(static_cast<uint64_t>(connect - nameLookup) * 1000);
+        if (appConnect > 0) {
+            PerformanceRegistry::histogram("api.tls").record(static_cast<uint64_t>(appConnect - connect) * 1000);
+        }
+    }
+    PerformanceRegistry::histogram("api.ttfb").record(static_cast<uint64_t>(startTransfer) * 1000);
+    PerformanceRegistry::histogram("api.total").record(static_cast<uint64_t>(total) * 1000);
+}
+
 /**
  * @brief Retrieves aggregate trade data from the Binance API.
  * 
@@ -92,11 +248,230 @@ std::string BinanceAPI::sendGETRequest(const std::string& endpoint) {
  * the Binance USD(S)-M Futures API.
  * 
  * @param symbol The trading pair symbol (e.g., "BTCUSDT").
- * @param limit The number of trades to retrieve (default is 5).
- * @return A JSON string containing the aggregate trade data.
+ * @param limit The number of trades to retrieve (default is 5, at most 1000).
+ * @param fromId The aggregate trade ID to start from, or -1 for the most recent trades.
+ * @return A JSON string containing the aggregate trade data, valid until the next request.
  * @throw APIException if there is a network error or if the API returns an error code.
  */
-std::string BinanceAPI::getAggregateTrades(const std::string& symbol, int limit) {
+const std::string& BinanceAPI::getAggregateTrades(const std::string& symbol, int limit, long long fromId) {
     std::string endpoint = "/fapi/v1/aggTrades?symbol=" + symbol + "&limit=" + std::to_string(limit);
-    return sendGETRequest(endpoint);
+    if (fromId >= 0) {
+        endpoint += "&fromId=" + std::to_string(fromId);
+    }
+    return sendGETRequest(endpoint, AGG_TRADES_WEIGHT);
+}
+
+/**
+ * @brief Retrieves the exchange information from the Binance API.
+ * 
+ * The response lists every symbol of the USD(S)-M Futures market with its filters, among which
+ * the tick size of the prices and the step size of the quantities.
+ * 
+ * @return A JSON string containing the exchange information, valid until the next request.
+ * @throw APIException if there is a network error or if the API returns an error code.
+ */
+const std::string& BinanceAPI::getExchangeInfo() {
+    return sendGETRequest("/fapi/v1/exchangeInfo", 1);
+}
+
+/**
+ * @brief Retrieves the aggregate trades of a symbol within a time window from the Binance API.
+ * 
+ * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+ * @param startTime The start of the window, in milliseconds since the epoch.
+ * @param endTime The inclusive end of the window, less than an hour after the start.
+ * @param limit The number of trades to retrieve (at most 1000).
+ * @return A JSON string containing the aggregate trade data, valid until the next request.
+ * @throw APIException if there is a network error or if the API returns an error code.
+ */
+const std::string& BinanceAPI::getAggregateTradesInWindow(const std::string& symbol, long long startTime, long long endTime,
+                                                          int limit) {
+    std::string endpoint = "/fapi/v1/aggTrades?symbol=" + symbol + "&limit=" + std::to_string(limit)
+        + "&startTime=" + std::to_string(startTime) + "&endTime=" + std::to_string(endTime);
+    return sendGETRequest(endpoint, AGG_TRADES_WEIGHT);
+}
+
+/**
+ * @brief Fetches the aggregate trades of a symbol within an ID range, in order.
+ * 
+ * The pages are handed out in order through an atomic counter to `workerCount - 1` threads, each
+ * with its own handle joined to this object's share object and rate limiter, and to the calling
+ * thread, which uses this object. Every page has its own slot, so they are concatenated in ID
+ * order once all threads are done. The first error stops the others from taking more pages and
+ * is rethrown.
+ * 
+ * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+ * @param fromId The first aggregate trade ID.
+ * @param toId The aggregate trade ID after the last one.
+ * @param scale The number of decimals of the symbol's prices and quantities.
+ * @param workerCount The number of concurrent connections, this one included.
+ * @return The trades in ID order; fewer than requested if the range goes past the latest trade.
+ * @throw APIException if a page cannot be fetched.
+ */
+std::vector<TradeRecord> BinanceAPI::backfillAggregateTrades(const std::string& symbol, long long fromId, long long toId,
+                                                             const TradeScale& scale, int workerCount) {
+    if (toId <= fromId) {
+        return std::vector<TradeRecord>();
+    }
+    size_t pageCount = static_cast<size_t>((toId - fromId + MAX_AGG_TRADES_LIMIT - 1) / MAX_AGG_TRADES_LIMIT);
+    std::vector<std::vector<TradeRecord>> pages(pageCount);
+    std::atomic<size_t> nextPage(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&](BinanceAPI& api) {
+        try {
+            TradeParser parser;
+            for (size_t page = nextPage++; page < pageCount && !failed; page = nextPage++) {
+                long long pageFrom = fromId + static_cast<long long>(page) * MAX_AGG_TRADES_LIMIT;
+                int limit = static_cast<int>(std::min<long long>(MAX_AGG_TRADES_LIMIT, toId - pageFrom));
+                pages[page] = api.fetchTradePage(symbol, pageFrom, limit, scale, parser);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            failed = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    size_t threadCount = std::min(pageCount, static_cast<size_t>(std::max(workerCount, 1))) - 1;
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&]() {
+            try {
+                BinanceAPI worker(baseURL, useHttp2, share, rateLimiter);
+                work(worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        });
+    }
+    work(*this);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    std::vector<TradeRecord> trades;
+    trades.reserve(static_cast<size_t>(toId - fromId));
+    for (const std::vector<TradeRecord>& page : pages) {
+        trades.insert(trades.end(), page.begin(), page.end());
+    }
+    return trades;
+}
+
+/**
+ * @brief Fetches the aggregate trades of a symbol within a time range, in order.
+ * 
+ * The ID range runs from the first trade at or after the start to the first trade after the end,
+ * or past the latest trade if there is none yet. Trades after the end that the last page may
+ * still contain are dropped.
+ * 
+ * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+ * @param startTime The start of the range, in milliseconds since the epoch.
+ * @param endTime The inclusive end of the range, in milliseconds since the epoch.
+ * @param scale The number of decimals of the symbol's prices and quantities.
+ * @param workerCount The number of concurrent connections, this one included.
+ * @return The trades in ID order, and therefore in time order.
+ * @throw APIException if a request fails.
+ */
+std::vector<TradeRecord> BinanceAPI::backfillAggregateTradesByTime(const std::string& symbol, long long startTime,
+                                                                   long long endTime, const TradeScale& scale,
+                                                                   int workerCount) {
+    TradeParser parser;
+    long long fromId = findTradeIdAt(symbol, startTime, parser);
+    if (fromId < 0) {
+        return std::vector<TradeRecord>();
+    }
+    long long toId = findTradeIdAt(symbol, endTime + 1, parser);
+    if (toId < 0) {
+        std::vector<Trade> latest = parser.parseTrades(getAggregateTrades(symbol, 1));
+        if (latest.empty()) {
+            return std::vector<TradeRecord>();
+        }
+        toId = latest.back().aggregateTradeId + 1;
+    }
+
+    std::vector<TradeRecord> trades = backfillAggregateTrades(symbol, fromId, toId, scale, workerCount);
+    while (!trades.empty() && trades.back().timestamp > endTime) {
+        trades.pop_back();
+    }
+    return trades;
+}
+
+/**
+ * @brief Returns the rate limiter shared by the requests of this object and its backfill workers.
+ */
+const std::shared_ptr<RateLimiter>& BinanceAPI::getRateLimiter() const {
+    return rateLimiter;
+}
+
+/**
+ * @brief Fetches one page of a backfill, retrying throttled and failed requests.
+ * 
+ * A throttled request has already paused the rate limiter, so it is retried right away and
+ * waits there. A network or server error is retried after a delay of 100 ms, doubled with
+ * every attempt. Any other error, such as an invalid symbol, is rethrown at once.
+ * 
+ * @param symbol The trading pair symbol.
+ * @param fromId The first aggregate trade ID of the page.
+ * @param limit The number of trades of the page.
+ * @param scale The number of decimals of the symbol's prices and quantities.
+ * @param parser The parser of this thread.
+ * @return The trades of the page.
+ * @throw APIException if the last attempt fails, or on an error that is not retried.
+ */
+std::vector<TradeRecord> BinanceAPI::fetchTradePage(const std::string& symbol, long long fromId, int limit,
+                                                    const TradeScale& scale, TradeParser& parser) {
+    int delayMs = 100;
+    for (int attempt = 1;; ++attempt) {
+        try {
+            return parser.parseTradeRecords(getAggregateTrades(symbol, limit, fromId), scale);
+        } catch (const APIException& e) {
+            long code = e.getHttpCode();
+            bool throttled = code == 429 || code == 418;
+            bool transient = code == 0 || code >= 500;
+            if (attempt == MAX_PAGE_ATTEMPTS || !(throttled || transient)) {
+                throw;
+            }
+            if (transient) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+                delayMs *= 2;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the ID of the first trade at or after a time, or -1 if there is none yet.
+ * 
+ * Asks for the first trade of successive one-hour windows, the longest the API accepts, until one
+ * has a trade or the window starts in the future.
+ * 
+ * @param symbol The trading pair symbol.
+ * @param time The time, in milliseconds since the epoch.
+ * @param parser The parser of this thread.
+ * @return The aggregate trade ID, or -1.
+ * @throw APIException if a request fails.
+ */
+long long BinanceAPI::findTradeIdAt(const std::string& symbol, long long time, TradeParser& parser) {
+    const long long hourMs = 60LL * 60 * 1000;
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    for (long long start = time; start <= now; start += hourMs) {
+        std::vector<Trade> trades = parser.parseTrades(getAggregateTradesInWindow(symbol, start, start + hourMs - 1, 1));
+        if (!trades.empty()) {
+            return trades.front().aggregateTradeId;
+        }
+    }
+    return -1;
 }
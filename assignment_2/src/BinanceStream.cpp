@@ -0,0 +1,566 @@
+#include "BinanceStream.h"
+#include "PerformanceTimer.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <openssl/evp.h>
+#include <poll.h>
+#include <random>
+#include <thread>
+
+/**
+ * @brief Returns the wall-clock time in milliseconds since the epoch, the clock of the event timestamps.
+ */
+static long long currentTimeMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Returns a monotonic time in milliseconds, for timeouts.
+ */
+static long long steadyTimeMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Encodes bytes in base64, as the WebSocket handshake requires.
+ * 
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return The base64 text, padded with '='.
+ */
+static std::string base64(const unsigned char* data, size_t size) {
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string text;
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t group = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < size) group |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (i + 2 < size) group |= data[i + 2];
+        text += digits[(group >> 18) & 63];
+        text += digits[(group >> 12) & 63];
+        text += i + 1 < size ? digits[(group >> 6) & 63] : '=';
+        text += i + 2 < size ? digits[group & 63] : '=';
+    }
+    return text;
+}
+
+/**
+ * @class WebSocket
+ * @brief A client WebSocket connection (RFC 6455) over a raw cURL connection.
+ * 
+ * cURL opens the TCP connection and, for `wss://`, the TLS session (`CURLOPT_CONNECT_ONLY`);
+ * the upgrade handshake and the framing are done here. Pings from the server are answered and
+ * close frames are acknowledged as they are read.
+ */
+class WebSocket {
+public:
+    /**
+     * @brief Connects and performs the upgrade handshake.
+     * 
+     * @param url The base URL, `ws://host[:port]` or `wss://host[:port]`.
+     * @param path The path and query of the stream (e.g., "/stream?streams=btcusdt@aggTrade").
+     * @throw BinanceAPI::APIException if the connection or the handshake fails.
+     */
+    WebSocket(const std::string& url, const std::string& path) : curl(curl_easy_init()), mask(std::random_device()()) {
+        if (!curl) {
+            throw BinanceAPI::APIException("Failed to initialize cURL.");
+        }
+        try {
+            connect(url, path);
+        } catch (...) {
+            curl_easy_cleanup(curl);
+            throw;
+        }
+    }
+
+    /**
+     * @brief Closes the connection.
+     */
+    ~WebSocket() {
+        curl_easy_cleanup(curl);
+    }
+
+    WebSocket(const WebSocket&) = delete;
+    WebSocket& operator=(const WebSocket&) = delete;
+
+    /**
+     * @brief Waits for the next text or binary message.
+     * 
+     * @param message Receives the message, reassembled if it was fragmented.
+     * @param timeoutMs The longest time to wait.
+     * @return False if no complete message arrived in time.
+     * @throw BinanceAPI::APIException if the connection fails or the server closes it.
+     */
+    bool receive(std::string& message, int timeoutMs) {
+        long long deadline = steadyTimeMs() + timeoutMs;
+        for (;;) {
+            while (readFrame()) {
+                if (complete) {
+                    complete = false;
+                    message.swap(partial);
+                    partial.clear();
+                    return true;
+                }
+            }
+            long long remaining = deadline - steadyTimeMs();
+            if (remaining <= 0 || !fill(static_cast<int>(remaining))) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief Sends a ping; the pong that answers it counts as activity.
+     */
+    void ping() {
+        sendFrame(OPCODE_PING, nullptr, 0);
+    }
+
+    /**
+     * @brief Returns the steady time of the last frame received, in milliseconds.
+     */
+    long long lastActivityMs() const {
+        return lastActivity;
+    }
+
+private:
+    static const int OPCODE_CONTINUATION = 0x0;
+    static const int OPCODE_TEXT = 0x1;
+    static const int OPCODE_BINARY = 0x2;
+    static const int OPCODE_CLOSE = 0x8;
+    static const int OPCODE_PING = 0x9;
+    static const int OPCODE_PONG = 0xA;
+    static const int HANDSHAKE_TIMEOUT_MS = 10000;   ///< Also bounds a blocked send.
+    static const size_t MAX_MESSAGE_SIZE = 1 << 24;  ///< Guards against a corrupt length.
+
+    /**
+     * @brief Opens the connection and upgrades it to a WebSocket.
+     */
+    void connect(const std::string& url, const std::string& path) {
+        size_t schemeEnd = url.find("://");
+        if (schemeEnd == std::string::npos) {
+            throw BinanceAPI::APIException("Invalid stream URL: " + url);
+        }
+        std::string scheme = url.substr(0, schemeEnd);
+        std::string host = url.substr(schemeEnd + 3);
+        host = host.substr(0, host.find('/'));
+        if (scheme != "ws" && scheme != "wss") {
+            throw BinanceAPI::APIException("Invalid stream URL: " + url);
+        }
+
+        std::string connectURL = (scheme == "wss" ? "https://" : "http://") + host + "/";
+        curl_easy_setopt(curl, CURLOPT_URL, connectURL.c_str());
+        curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
+        // The upgrade is an HTTP/1.1 request, so HTTP/2 must not be negotiated through ALPN
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_1_1));
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(HANDSHAKE_TIMEOUT_MS));
+        CURLcode res = curl_easy_perform(curl);
+        if (res != CURLE_OK) {
+            throw BinanceAPI::APIException("Network error: " + std::string(curl_easy_strerror(res)));
+        }
+        curl_easy_getinfo(curl, CURLINFO_ACTIVESOCKET, &socket);
+
+        unsigned char nonce[16];
+        std::random_device random;
+        for (unsigned char& byte : nonce) byte = static_cast<unsigned char>(random());
+        std::string key = base64(nonce, sizeof(nonce));
+        std::string request = "GET " + path + " HTTP/1.1\r\n"
+                              "Host: " + host + "\r\n"
+                              "Upgrade: websocket\r\n"
+                              "Connection: Upgrade\r\n"
+                              "Sec-WebSocket-Key: " + key + "\r\n"
+                              "Sec-WebSocket-Version: 13\r\n\r\n";
+        sendAll(request.data(), request.size());
+
+        size_t headerEnd;
+        long long deadline = steadyTimeMs() + HANDSHAKE_TIMEOUT_MS;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            long long remaining = deadline - steadyTimeMs();
+            if (remaining <= 0 || !fill(static_cast<int>(remaining))) {
+                throw BinanceAPI::APIException("WebSocket handshake timed out.");
+            }
+        }
+        std::string response = buffer.substr(0, headerEnd + 2);
+        buffer.erase(0, headerEnd + 4);
+
+        std::string statusLine = response.substr(0, response.find("\r\n"));
+        if (statusLine.find(" 101") == std::string::npos) {
+            throw BinanceAPI::APIException("WebSocket handshake refused: " + statusLine);
+        }
+        if (headerValue(response, "sec-websocket-accept") != acceptKey(key)) {
+            throw BinanceAPI::APIException("WebSocket handshake failed: wrong Sec-WebSocket-Accept.");
+        }
+        lastActivity = steadyTimeMs();
+    }
+
+    /**
+     * @brief Returns the value of a header of an HTTP response, or "" if it is missing.
+     * 
+     * @param response The status line and headers, each ending with CRLF.
+     * @param name The header name in lower case.
+     */
+    static std::string headerValue(const std::string& response, const std::string& name) {
+        size_t lineStart = response.find("\r\n") + 2;
+        while (lineStart < response.size()) {
+            size_t lineEnd = response.find("\r\n", lineStart);
+            std::string line = response.substr(lineStart, lineEnd - lineStart);
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                std::string field = line.substr(0, colon);
+                std::transform(field.begin(), field.end(), field.begin(), ::tolower);
+                if (field == name) {
+                    size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+                    size_t valueEnd = line.find_last_not_of(" \t");
+                    return valueStart == std::string::npos ? "" : line.substr(valueStart, valueEnd - valueStart + 1);
+                }
+            }
+            lineStart = lineEnd + 2;
+        }
+        return "";
+    }
+
+    /**
+     * @brief Returns the Sec-WebSocket-Accept a server must answer a key with.
+     */
+    static std::string acceptKey(const std::string& key) {
+        std::string input = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int size = 0;
+        EVP_Digest(input.data(), input.size(), digest, &size, EVP_sha1(), nullptr);
+        return base64(digest, size);
+    }
+
+    /**
+     * @brief Reads the bytes available into the buffer, waiting for some if there are none.
+     * 
+     * @param timeoutMs The longest time to wait.
+     * @return False if nothing arrived in time.
+     * @throw BinanceAPI::APIException if the connection fails or is closed.
+     */
+    bool fill(int timeoutMs) {
+        char chunk[16384];
+        for (;;) {
+            size_t received = 0;
+            CURLcode res = curl_easy_recv(curl, chunk, sizeof(chunk), &received);
+            if (res == CURLE_OK) {
+                if (received == 0) {
+                    throw BinanceAPI::APIException("Connection closed by server.");
+                }
+                buffer.append(chunk, received);
+                return true;
+            }
+            if (res != CURLE_AGAIN) {
+                throw BinanceAPI::APIException("Network error: " + std::string(curl_easy_strerror(res)));
+            }
+            if (!waitFor(POLLIN, timeoutMs)) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief Waits for the socket to become readable or writable.
+     * 
+     * @return False on timeout.
+     */
+    bool waitFor(short events, int timeoutMs) {
+        pollfd descriptor = {socket, events, 0};
+        int ready = poll(&descriptor, 1, timeoutMs);
+        if (ready < 0 && errno != EINTR) {
+            throw BinanceAPI::APIException("Network error: poll failed: " + std::string(std::strerror(errno)));
+        }
+        return ready != 0;
+    }
+
+    /**
+     * @brief Sends bytes, waiting while the socket is full.
+     */
+    void sendAll(const char* data, size_t size) {
+        while (size > 0) {
+            size_t sent = 0;
+            CURLcode res = curl_easy_send(curl, data, size, &sent);
+            if (res == CURLE_AGAIN) {
+                if (!waitFor(POLLOUT, HANDSHAKE_TIMEOUT_MS)) {
+                    throw BinanceAPI::APIException("Network error: send timed out.");
+                }
+                continue;
+            }
+            if (res != CURLE_OK) {
+                throw BinanceAPI::APIException("Network error: " + std::string(curl_easy_strerror(res)));
+            }
+            data += sent;
+            size -= sent;
+        }
+    }
+
+    /**
+     * @brief Sends one frame, masked as client frames must be.
+     */
+    void sendFrame(int opcode, const char* payload, size_t size) {
+        std::string frame;
+        frame += static_cast<char>(0x80 | opcode);
+        if (size < 126) {
+            frame += static_cast<char>(0x80 | size);
+        } else if (size < 65536) {
+            frame += static_cast<char>(0x80 | 126);
+            for (int shift = 8; shift >= 0; shift -= 8) frame += static_cast<char>(size >> shift);
+        } else {
+            frame += static_cast<char>(0x80 | 127);
+            for (int shift = 56; shift >= 0; shift -= 8) frame += static_cast<char>(static_cast<uint64_t>(size) >> shift);
+        }
+        uint32_t key = mask();
+        char maskBytes[4] = {static_cast<char>(key >> 24), static_cast<char>(key >> 16),
+                             static_cast<char>(key >> 8), static_cast<char>(key)};
+        frame.append(maskBytes, 4);
+        for (size_t i = 0; i < size; ++i) frame += static_cast<char>(payload[i] ^ maskBytes[i % 4]);
+        sendAll(frame.data(), frame.size());
+    }
+
+    /**
+     * @brief Consumes one complete frame from the buffer, answering control frames.
+     * 
+     * Data frames are appended to `partial`, and `complete` is set when a message ends.
+     * 
+     * @return False if the buffer does not hold a complete frame.
+     * @throw BinanceAPI::APIException on a close frame or a protocol error.
+     */
+    bool readFrame() {
+        if (buffer.size() < 2) {
+            return false;
+        }
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(buffer.data());
+        bool final = (bytes[0] & 0x80) != 0;
+        int opcode = bytes[0] & 0x0f;
+        bool masked = (bytes[1] & 0x80) != 0;
+        uint64_t size = bytes[1] & 0x7f;
+        size_t headerSize = 2;
+        if (size >= 126) {
+            size_t lengthBytes = size == 126 ? 2 : 8;
+            if (buffer.size() < headerSize + lengthBytes) {
+                return false;
+            }
+            size = 0;
+            for (size_t i = 0; i < lengthBytes; ++i) size = (size << 8) | bytes[headerSize + i];
+            headerSize += lengthBytes;
+        }
+        if (size > MAX_MESSAGE_SIZE || partial.size() + size > MAX_MESSAGE_SIZE) {
+            throw BinanceAPI::APIException("WebSocket message too large.");
+        }
+        const unsigned char* maskBytes = bytes + headerSize;
+        if (masked) headerSize += 4;
+        if (buffer.size() < headerSize + size) {
+            return false;
+        }
+
+        std::string payload = buffer.substr(headerSize, size);
+        if (masked) {
+            for (size_t i = 0; i < payload.size(); ++i) payload[i] ^= maskBytes[i % 4];
+        }
+        buffer.erase(0, headerSize + size);
+        lastActivity = steadyTimeMs();
+
+        switch (opcode) {
+        case OPCODE_TEXT:
+        case OPCODE_BINARY:
+        case OPCODE_CONTINUATION:
+            partial += payload;
+            complete = final;
+            break;
+        case OPCODE_PING:
+            sendFrame(OPCODE_PONG, payload.data(), payload.size());
+            break;
+        case OPCODE_PONG:
+            break;
+        case OPCODE_CLOSE: {
+            int code = payload.size() >= 2 ? (static_cast<unsigned char>(payload[0]) << 8) | static_cast<unsigned char>(payload[1]) : 1005;
+            sendFrame(OPCODE_CLOSE, payload.data(), std::min<size_t>(payload.size(), 2));
+            throw BinanceAPI::APIException("WebSocket closed by server with code " + std::to_string(code) + ".");
+        }
+        default:
+            throw BinanceAPI::APIException("WebSocket protocol error: opcode " + std::to_string(opcode) + ".");
+        }
+        return true;
+    }
+
+    CURL* curl;                              ///< The connection
+    curl_socket_t socket = CURL_SOCKET_BAD;  ///< Its socket, to wait on
+    std::mt19937 mask;                       ///< Draws the frame masks
+    std::string buffer;                      ///< Bytes received but not yet consumed
+    std::string partial;                     ///< The message being reassembled
+    bool complete = false;                   ///< Whether `partial` holds a whole message
+    long long lastActivity = 0;              ///< The steady time of the last frame
+};
+
+/**
+ * @brief Constructs a new BinanceStream object.
+ * 
+ * @param streamURL The base URL of the market streams (e.g., "wss://fstream.binance.com").
+ * @param api The REST API used to fill gaps.
+ */
+BinanceStream::BinanceStream(const std::string& streamURL, BinanceAPI& api)
+    : streamURL(streamURL), api(api), stopping(false) {}
+
+/**
+ * @brief Streams the trades of the given symbols until `stop()` is called.
+ * 
+ * A failed connection is retried after 1 s, then after twice as long each time up to 30 s;
+ * the wait starts again from 1 s once a connection succeeds. Reconnections are counted in
+ * the "stream.reconnects" counter.
+ * 
+ * @param symbols The trading pair symbols (e.g., "BTCUSDT").
+ * @param onTrade Receives every trade.
+ */
+void BinanceStream::run(const std::vector<std::string>& symbols, const TradeCallback& onTrade) {
+    std::string path = "/stream?streams=";
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        std::string stream = symbols[i];
+        std::transform(stream.begin(), stream.end(), stream.begin(), ::tolower);
+        path += (i > 0 ? "/" : "") + stream + "@aggTrade";
+    }
+
+    stopping = false;
+    int backoffMs = 1000;
+    while (!stopping) {
+        try {
+            streamOnce(path, onTrade, backoffMs);
+        } catch (const BinanceAPI::APIException&) {
+            PerformanceRegistry::counter("stream.reconnects").fetch_add(1, std::memory_order_relaxed);
+        }
+        for (int waited = 0; waited < backoffMs && !stopping; waited += 100) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        backoffMs = std::min(2 * backoffMs, static_cast<int>(MAX_BACKOFF_MS));
+    }
+}
+
+/**
+ * @brief Makes `run()` return within about a second; may be called from any thread.
+ */
+void BinanceStream::stop() {
+    stopping = true;
+}
+
+/**
+ * @brief Connects once and delivers trades until the connection fails or `stop()` is called.
+ * 
+ * Waits for messages a second at a time so that `stop()` is noticed. After PING_AFTER_MS
+ * without a frame the client pings, and after TIMEOUT_MS it gives up on the connection.
+ * 
+ * @param path The path and query of the combined stream.
+ * @param onTrade Receives every trade.
+ * @param backoffMs Reset to 1 s once connected.
+ * @throw APIException if the connection fails or the server closes it.
+ */
+void BinanceStream::streamOnce(const std::string& path, const TradeCallback& onTrade, int& backoffMs) {
+    WebSocket socket(streamURL, path);
+    backoffMs = 1000;
+
+    std::string message;
+    std::string symbol;
+    Trade trade;
+    long long pingedAt = 0;
+    while (!stopping) {
+        if (socket.receive(message, 1000)) {
+            long long eventTime = 0;
+            bool isTrade;
+            try {
+                isTrade = parser.parseStreamTrade(message, symbol, eventTime, trade);
+            } catch (const std::runtime_error& e) {
+                // Reconnecting is safe: the gap detection recovers whatever is missed meanwhile
+                throw BinanceAPI::APIException(e.what());
+            }
+            if (isTrade) {
+                deliver(symbol, trade, eventTime, onTrade);
+            }
+        }
+
+        long long silentMs = steadyTimeMs() - socket.lastActivityMs();
+        if (silentMs > TIMEOUT_MS) {
+            throw BinanceAPI::APIException("WebSocket timed out.");
+        }
+        if (silentMs > PING_AFTER_MS && pingedAt < socket.lastActivityMs()) {
+            socket.ping();
+            pingedAt = steadyTimeMs();
+        }
+    }
+}
+
+/**
+ * @brief Delivers a trade of the stream, after the trades missed since the last one.
+ * 
+ * A trade at or below the last delivered ID of its symbol, e.g. one sent again after a
+ * reconnection, is dropped. The latency is recorded in the "stream.event_latency" histogram;
+ * gaps are counted in "stream.gaps".
+ * 
+ * @param symbol The symbol of the trade.
+ * @param trade The trade.
+ * @param eventTime The time the event was sent, in milliseconds since the epoch.
+ * @param onTrade Receives the trades.
+ */
+void BinanceStream::deliver(const std::string& symbol, const Trade& trade, long long eventTime, const TradeCallback& onTrade) {
+    std::map<std::string, long long>::iterator last = lastIds.find(symbol);
+    if (last != lastIds.end()) {
+        if (trade.aggregateTradeId <= last->second) {
+            return;
+        }
+        if (trade.aggregateTradeId > last->second + 1) {
+            PerformanceRegistry::counter("stream.gaps").fetch_add(1, std::memory_order_relaxed);
+            backfill(symbol, last->second + 1, trade.aggregateTradeId, onTrade);
+        }
+    }
+
+    // The clocks of the exchange and of this machine may disagree by a few milliseconds
+    long long latencyMs = std::max(0LL, currentTimeMs() - eventTime);
+    static LatencyHistogram& eventLatency = PerformanceRegistry::histogram("stream.event_latency");
+    eventLatency.record(static_cast<uint64_t>(latencyMs) * 1000000);
+    onTrade(symbol, trade, static_cast<double>(latencyMs));
+    lastIds[symbol] = trade.aggregateTradeId;
+}
+
+/**
+ * @brief Fetches and delivers the trades of a symbol from `fromId` up to, excluding, `toId`.
+ * 
+ * Requests up to MAX_BACKFILL_REQUEST trades at a time and counts them in the
+ * "stream.backfilled_trades" counter. The last delivered ID advances with every trade, so a
+ * failed request only loses the trades not yet fetched, which the next gap covers again.
+ * 
+ * @param symbol The symbol.
+ * @param fromId The first missing aggregate trade ID.
+ * @param toId The ID of the trade that revealed the gap.
+ * @param onTrade Receives the trades.
+ * @throw APIException if a request fails.
+ */
+void BinanceStream::backfill(const std::string& symbol, long long fromId, long long toId, const TradeCallback& onTrade) {
+    static std::atomic<uint64_t>& backfilled = PerformanceRegistry::counter("stream.backfilled_trades");
+    while (fromId < toId) {
+        int limit = static_cast<int>(std::min<long long>(MAX_BACKFILL_REQUEST, toId - fromId));
+        std::vector<Trade> trades;
+        try {
+            trades = parser.parseTrades(api.getAggregateTrades(symbol, limit, fromId));
+        } catch (const BinanceAPI::APIException&) {
+            throw;
+        } catch (const std::runtime_error& e) {
+            throw BinanceAPI::APIException(e.what());
+        }
+        long long before = fromId;
+        for (const Trade& trade : trades) {
+            if (trade.aggregateTradeId < fromId) continue;
+            if (trade.aggregateTradeId >= toId) break;
+            onTrade(symbol, trade, static_cast<double>(std::max(0LL, currentTimeMs() - trade.timestamp)));
+            lastIds[symbol] = trade.aggregateTradeId;
+            fromId = trade.aggregateTradeId + 1;
+            backfilled.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (fromId == before) {
+            // The REST API has nothing (yet) for the gap; give up on it rather than spin
+            break;
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#include "RateLimiter.h"
+#include "PerformanceTimer.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Constructs a full bucket.
+ * 
+ * @param weightPerMinute The weight limit per minute of the API.
+ */
+RateLimiter::RateLimiter(int weightPerMinute)
+    : limit(weightPerMinute), rate(weightPerMinute), tokens(weightPerMinute),
+      lastRefill(Clock::now()), pausedUntil(Clock::now()), lastBackOffEnd(Clock::now()), consecutiveBackOffs(0) {}
+
+/**
+ * @brief Returns whether a request of the given weight can ever be granted.
+ * 
+ * The limit never changes, so callers can reject a request up front instead of handling the
+ * exceptions of acquire() and tryAcquire().
+ */
+bool RateLimiter::canAcquire(int weight) const {
+    return weight >= 0 && weight <= limit;
+}
+
+/**
+ * @brief Adds the tokens earned since the last refill, up to the capacity.
+ */
+void RateLimiter::refill(Clock::time_point now) {
+    std::chrono::duration<double, std::ratio<60>> elapsed = now - lastRefill;
+    tokens = std::min(limit, tokens + elapsed.count() * rate);
+    lastRefill = now;
+}
+
+/**
+ * @brief Waits until a request of the given weight may be sent, and takes its weight.
+ * 
+ * Sleeps outside the lock, so other threads keep observing responses meanwhile; the wait is
+ * recomputed after every sleep since a backoff may have happened in between. Time spent
+ * waiting is recorded in the "rate_limiter.wait" histogram.
+ * 
+ * @param weight The weight of the request.
+ * @throw std::invalid_argument if the weight is negative or above the limit, so could never be taken.
+ */
+void RateLimiter::acquire(int weight) {
+    ScopedTimer wait(PerformanceRegistry::histogram("rate_limiter.wait"));
+    std::chrono::milliseconds delay(0);
+    while (!tryAcquire(weight, delay)) {
+        std::this_thread::sleep_for(delay);
+    }
+}
+
+/**
+ * @brief Takes the weight of a request if it may be sent now, without waiting.
+ * 
+ * Lets an event loop keep serving other transfers while a request waits for its weight.
+ * 
+ * @param weight The weight of the request.
+ * @param delay Set, on failure, to how long to wait before trying again, at least 1 ms.
+ * @return True if the weight was taken.
+ * @throw std::invalid_argument if the weight is negative or above the limit, so could never be taken.
+ */
+bool RateLimiter::tryAcquire(int weight, std::chrono::milliseconds& delay) {
+    // The bucket never holds more than the limit, so a heavier request would wait forever
+    if (!canAcquire(weight)) {
+        throw std::invalid_argument("Request weight " + std::to_string(weight) + " is outside the rate limit of " +
+                                    std::to_string(static_cast<int>(limit)) + " per minute.");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    refill(now);
+    Clock::duration wait = Clock::duration::zero();
+    if (now < pausedUntil) {
+        wait = pausedUntil - now;
+    } else if (tokens >= weight) {
+        tokens -= weight;
+        return true;
+    } else {
+        wait = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::ratio<60>>((weight - tokens) / rate));
+    }
+    // Rounded up, so that the bucket has refilled when the caller tries again
+    delay = std::max(std::chrono::milliseconds(1),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(wait + std::chrono::microseconds(999)));
+    return false;
+}
+
+/**
+ * @brief Accounts for the weight the server reports as used in the current minute.
+ * 
+ * The server counts in fixed minute windows while the bucket refills continuously, so the bucket
+ * is only ever lowered to what the server has left, never raised.
+ * 
+ * @param usedWeight The value of the `X-MBX-USED-WEIGHT-1M` header.
+ */
+void RateLimiter::observeUsedWeight(int usedWeight) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refill(Clock::now());
+    // A server window counting more than the limit still only lasts a minute: cap at empty
+    tokens = std::min(tokens, std::max(0.0, limit - usedWeight));
+}
+
+/**
+ * @brief Pauses every request after an HTTP 429 or 418, and slows down the refill.
+ * 
+ * Without a `Retry-After`, the pause is 1 s after the first backoff and doubles with every
+ * following one up to a minute. A 418 means the address is banned for a while, so the refill
+ * rate is quartered rather than halved. The requests in flight when the limit was hit are
+ * throttled together, so the rate only drops once until the pause they caused is over. Backoffs
+ * are counted in the "rate_limiter.backoffs" counter.
+ * 
+ * @param httpCode The status code, 429 or 418.
+ * @param retryAfterSeconds The value of the `Retry-After` header, or -1 if there was none.
+ */
+void RateLimiter::backOff(long httpCode, int retryAfterSeconds) {
+    PerformanceRegistry::counter("rate_limiter.backoffs").fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    refill(now);
+    tokens = 0;
+    if (now < pausedUntil && retryAfterSeconds < 0) {
+        // Another request of the same burst was already throttled
+        return;
+    }
+    int pauseSeconds = retryAfterSeconds;
+    if (pauseSeconds < 0) {
+        pauseSeconds = consecutiveBackOffs < 6 ? 1 << consecutiveBackOffs : MAX_PAUSE_SECONDS;
+    }
+    pausedUntil = std::max(pausedUntil, now + std::chrono::seconds(pauseSeconds));
+    if (now >= lastBackOffEnd) {
+        // Slow down once per burst, however many of its requests were in flight
+        ++consecutiveBackOffs;
+        rate = std::max(limit / 20, rate / (httpCode == 418 ? 4 : 2));
+    }
+    lastBackOffEnd = pausedUntil;
+}
+
+/**
+ * @brief Restores 5% of the configured refill rate after a successful request.
+ */
+void RateLimiter::succeed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    consecutiveBackOffs = 0;
+    if (rate < limit) {
+        refill(Clock::now());
+        rate = std::min(limit, rate + limit / 20);
+    }
+}
+
+/**
+ * @brief Returns the current refill rate, in weight per minute.
+ */
+double RateLimiter::getWeightPerMinute() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rate;
+}
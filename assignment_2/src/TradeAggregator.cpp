@@ -0,0 +1,232 @@
+#include "TradeAggregator.h"
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @brief Constructs an aggregator without symbols.
+ * 
+ * @param barMillis The length of the time bars in milliseconds.
+ * @param lateMillis How much older than the newest trade of its symbol a trade may be.
+ * @param onBar Receives the closed bars.
+ * @throw std::invalid_argument if `barMillis` is not positive or `lateMillis` is negative.
+ */
+TradeAggregator::TradeAggregator(int64_t barMillis, int64_t lateMillis, const BarCallback& onBar)
+    : barMillis(barMillis), lateMillis(lateMillis), onBar(onBar), indexes(64), lateTrades(0) {
+    if (barMillis <= 0 || lateMillis < 0) {
+        throw std::invalid_argument("The bar length must be positive and the late window not negative.");
+    }
+}
+
+/**
+ * @brief Adds a symbol; trades of unknown symbols are rejected.
+ * 
+ * The time bar ring holds every bucket a trade within the late window can fall into: those the
+ * window spans, plus the bucket of the newest trade and the one the window starts in.
+ * 
+ * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+ * @param barVolume The fixed-point volume of its volume bars, or 0 for no volume bars.
+ * @throw std::invalid_argument if the symbol was already added.
+ */
+void TradeAggregator::addSymbol(const std::string& symbol, int64_t barVolume) {
+    if (indexes.try_get(symbol) != nullptr) {
+        throw std::invalid_argument("Symbol already added: " + symbol);
+    }
+    indexes.insert(symbol, static_cast<uint32_t>(symbols.size()));
+    SymbolState added;
+    added.symbol = symbol;
+    added.barVolume = barVolume;
+    added.timeBars.assign(static_cast<size_t>(lateMillis / barMillis + 2), Bar());
+    added.firstOpenBucket = 0;
+    added.newestTime = 0;
+    added.started = false;
+    added.volumeBar = Bar();
+    symbols.push_back(std::move(added));
+}
+
+/**
+ * @brief Adds a trade to the bars of its symbol.
+ * 
+ * A trade newer than any before first closes the time bars the late window has left behind.
+ * Volume bars follow the arrival order, so late trades go into the open one.
+ * 
+ * @param symbol The trading pair symbol.
+ * @param trade The trade.
+ * @return False if the trade is too late for its time bar, which then ignores it.
+ * @throw std::invalid_argument if the symbol was not added.
+ */
+bool TradeAggregator::add(std::string_view symbol, const TradeRecord& trade) {
+    SymbolState& symbolState = state(symbol);
+
+    if (symbolState.barVolume > 0) {
+        Bar& bar = symbolState.volumeBar;
+        if (bar.tradeCount == 0) {
+            open(bar, trade);
+            bar.startTime = trade.timestamp;
+        } else {
+            update(bar, trade);
+            bar.startTime = std::min(bar.startTime, trade.timestamp);
+        }
+        bar.endTime = std::max(bar.endTime, trade.timestamp);
+        if (bar.volume >= symbolState.barVolume) {
+            onBar(symbolState.symbol, BarType::Volume, bar);
+            bar = Bar();
+        }
+    }
+
+    if (!symbolState.started) {
+        symbolState.started = true;
+        symbolState.newestTime = trade.timestamp;
+        symbolState.firstOpenBucket = bucketOf(trade.timestamp - lateMillis);
+    } else if (trade.timestamp > symbolState.newestTime) {
+        symbolState.newestTime = trade.timestamp;
+        closeTimeBars(symbolState, bucketOf(trade.timestamp - lateMillis));
+    }
+
+    int64_t bucket = bucketOf(trade.timestamp);
+    if (bucket < symbolState.firstOpenBucket) {
+        ++lateTrades;
+        return false;
+    }
+    Bar& bar = symbolState.timeBars[slotOf(symbolState, bucket)];
+    if (bar.tradeCount == 0) {
+        open(bar, trade);
+        bar.startTime = bucket * barMillis;
+        bar.endTime = bar.startTime + barMillis;
+    } else {
+        update(bar, trade);
+    }
+    return true;
+}
+
+/**
+ * @brief Closes every open bar, as if no more trades could arrive.
+ * 
+ * Volume bars that have not reached their volume are handed over as they are.
+ */
+void TradeAggregator::flush() {
+    for (SymbolState& symbolState : symbols) {
+        if (symbolState.started) {
+            closeTimeBars(symbolState, bucketOf(symbolState.newestTime) + 1);
+        }
+        if (symbolState.volumeBar.tradeCount > 0) {
+            onBar(symbolState.symbol, BarType::Volume, symbolState.volumeBar);
+            symbolState.volumeBar = Bar();
+        }
+    }
+}
+
+/**
+ * @brief Returns the most recent open bar of a symbol, or nullptr if it has none.
+ * 
+ * @param symbol The trading pair symbol.
+ * @param type Which bar.
+ * @return The bar, valid until the next call that adds a trade or closes bars.
+ */
+const Bar* TradeAggregator::currentBar(std::string_view symbol, BarType type) const {
+    const uint32_t* index = indexes.try_get(symbol);
+    if (index == nullptr) {
+        return nullptr;
+    }
+    const SymbolState& symbolState = symbols[*index];
+    if (type == BarType::Volume) {
+        return symbolState.volumeBar.tradeCount > 0 ? &symbolState.volumeBar : nullptr;
+    }
+    if (!symbolState.started) {
+        return nullptr;
+    }
+    const Bar& bar = symbolState.timeBars[slotOf(symbolState, bucketOf(symbolState.newestTime))];
+    return bar.tradeCount > 0 ? &bar : nullptr;
+}
+
+/**
+ * @brief Returns the number of trades that were too late for their time bar.
+ */
+uint64_t TradeAggregator::getLateTradeCount() const {
+    return lateTrades;
+}
+
+/**
+ * @brief Finds a symbol's state, or throws.
+ * 
+ * @param symbol The trading pair symbol.
+ * @return The state.
+ * @throw std::invalid_argument if the symbol was not added.
+ */
+TradeAggregator::SymbolState& TradeAggregator::state(std::string_view symbol) {
+    const uint32_t* index = indexes.try_get(symbol);
+    if (index == nullptr) {
+        throw std::invalid_argument("Unknown symbol: " + std::string(symbol));
+    }
+    return symbols[*index];
+}
+
+/**
+ * @brief Hands the time bars of a symbol up to, excluding, `bucket` to the callback.
+ * 
+ * Only the buckets of the ring are visited, so a trade after a long silence costs no more than
+ * one that opens the next bar. Empty buckets produce no bar.
+ * 
+ * @param state The symbol.
+ * @param bucket The new oldest bucket that may still be open.
+ */
+void TradeAggregator::closeTimeBars(SymbolState& state, int64_t bucket) {
+    int64_t end = std::min(bucket, state.firstOpenBucket + static_cast<int64_t>(state.timeBars.size()));
+    for (int64_t closing = state.firstOpenBucket; closing < end; ++closing) {
+        Bar& bar = state.timeBars[slotOf(state, closing)];
+        if (bar.tradeCount > 0) {
+            onBar(state.symbol, BarType::Time, bar);
+            bar = Bar();
+        }
+    }
+    state.firstOpenBucket = std::max(state.firstOpenBucket, bucket);
+}
+
+/**
+ * @brief Returns the bucket of a time, rounding down also before the epoch.
+ */
+int64_t TradeAggregator::bucketOf(int64_t time) const {
+    int64_t bucket = time / barMillis;
+    return time % barMillis < 0 ? bucket - 1 : bucket;
+}
+
+/**
+ * @brief Returns the slot of a bucket in a symbol's time bar ring.
+ */
+size_t TradeAggregator::slotOf(const SymbolState& state, int64_t bucket) {
+    int64_t ringSize = static_cast<int64_t>(state.timeBars.size());
+    return static_cast<size_t>((bucket % ringSize + ringSize) % ringSize);
+}
+
+/**
+ * @brief Starts a bar with a trade; the caller sets the times.
+ */
+void TradeAggregator::open(Bar& bar, const TradeRecord& trade) {
+    bar.open = bar.high = bar.low = bar.close = trade.price;
+    bar.volume = trade.quantity;
+    bar.buyVolume = trade.isBuyerMaker ? 0 : trade.quantity;
+    bar.notional = static_cast<double>(trade.price) * static_cast<double>(trade.quantity);
+    bar.firstId = bar.lastId = trade.aggregateTradeId;
+    bar.tradeCount = trade.tradeCount;
+}
+
+/**
+ * @brief Adds a trade to a bar that has some already.
+ */
+void TradeAggregator::update(Bar& bar, const TradeRecord& trade) {
+    if (trade.aggregateTradeId < bar.firstId) {
+        bar.firstId = trade.aggregateTradeId;
+        bar.open = trade.price;
+    }
+    if (trade.aggregateTradeId > bar.lastId) {
+        bar.lastId = trade.aggregateTradeId;
+        bar.close = trade.price;
+    }
+    bar.high = std::max(bar.high, trade.price);
+    bar.low = std::min(bar.low, trade.price);
+    bar.volume += trade.quantity;
+    if (!trade.isBuyerMaker) {
+        bar.buyVolume += trade.quantity;
+    }
+    bar.notional += static_cast<double>(trade.price) * static_cast<double>(trade.quantity);
+    bar.tradeCount += trade.tradeCount;
+}
@@ -1,45 +1,777 @@
 #include "TradeParser.h"
+#include "PerformanceTimer.h"
 #include "json.hpp" // External library for JSON parsing
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
 using json = nlohmann::json;
 
+/**
+ * @brief The smallest magnitude an integer field cannot have: integers have at most 18 digits.
+ */
+static const unsigned long long INTEGER_LIMIT = 1000000000000000000ULL;
+
+/**
+ * @brief Throws the error of a field whose value has the wrong type.
+ */
+static void wrongType(const char* name, const char* type) {
+    throw std::runtime_error(std::string("Malformed JSON: field '") + name + "' must be " + type + ".");
+}
+
+/**
+ * @brief Reads an integer field of a parsed object, with the checks and messages of the scanner.
+ * 
+ * @throw std::runtime_error if the value is not a number, or not an integer of at most 18 digits.
+ */
+static long long integerField(const json& object, const char* name) {
+    const json& value = object[name];
+    if (!value.is_number()) {
+        wrongType(name, "an integer");
+    }
+    bool fits = !value.is_number_float() &&
+                (value.is_number_unsigned() ? value.get<unsigned long long>() < INTEGER_LIMIT
+                                            : value.get<long long>() > -static_cast<long long>(INTEGER_LIMIT) &&
+                                              value.get<long long>() < static_cast<long long>(INTEGER_LIMIT));
+    if (!fits) {
+        wrongType(name, "an integer of at most 18 digits");
+    }
+    return value.get<long long>();
+}
+
+/**
+ * @brief Reads a string field of a parsed object.
+ * 
+ * @throw std::runtime_error if the value is not a string.
+ */
+static std::string stringField(const json& object, const char* name) {
+    const json& value = object[name];
+    if (!value.is_string()) {
+        wrongType(name, "a string");
+    }
+    return value.get<std::string>();
+}
+
+/**
+ * @brief Reads a boolean field of a parsed object.
+ * 
+ * @throw std::runtime_error if the value is not a boolean.
+ */
+static bool boolField(const json& object, const char* name) {
+    const json& value = object[name];
+    if (!value.is_boolean()) {
+        wrongType(name, "a boolean");
+    }
+    return value.get<bool>();
+}
+
+/**
+ * @brief Converts one aggregate trade object, as sent by the REST API and the streams.
+ * 
+ * @param trade The JSON object of the trade.
+ * @return The trade.
+ * @throw std::runtime_error if a required field is missing or has the wrong type.
+ */
+static Trade toTrade(const json& trade) {
+    // Check for necessary fields and handle missing fields
+    if (!(trade.contains("a") && trade.contains("p") && trade.contains("q") &&
+          trade.contains("f") && trade.contains("l") && trade.contains("T") && trade.contains("m"))) {
+        // If any required field is missing, throw an exception
+        throw std::runtime_error("Malformed JSON: Missing required fields in the trade data.");
+    }
+    return {
+        integerField(trade, "a"),             // Aggregate tradeId
+        stringField(trade, "p"),              // Price
+        stringField(trade, "q"),              // Quantity
+        integerField(trade, "f"),             // First tradeId
+        integerField(trade, "l"),             // Last tradeId
+        integerField(trade, "T"),             // Timestamp
+        boolField(trade, "m")                 // Buyer is the maker?
+    };
+}
+
+/**
+ * @brief Converts decimal digits into a fixed-point integer, without going through floating point.
+ * 
+ * @param text The decimal number, e.g. "62345.10"; it may be signed and have no fraction.
+ * @param size The length of the text.
+ * @param decimals The number of decimals of the result: "62345.10" with 2 gives 6234510.
+ * @param value Receives the fixed-point value.
+ * @param name The name of the field, for the error messages.
+ * @throw std::runtime_error if the text is not a decimal number, has nonzero digits beyond the
+ *        scale, or is too large.
+ */
+static void toFixedPoint(const char* text, size_t size, int decimals, int64_t& value, const char* name) {
+    const char* c = text;
+    const char* end = text + size;
+    bool negative = c < end && *c == '-';
+    if (negative) {
+        ++c;
+    }
+    uint64_t result = 0;
+    int digits = 0;
+    bool any = false;
+    for (; c < end && *c >= '0' && *c <= '9'; ++c, any = true) {
+        result = result * 10 + static_cast<unsigned>(*c - '0');
+        ++digits;
+    }
+    int fraction = 0;
+    if (c < end && *c == '.') {
+        for (++c; c < end && *c >= '0' && *c <= '9'; ++c, any = true) {
+            if (fraction < decimals) {
+                result = result * 10 + static_cast<unsigned>(*c - '0');
+                ++digits;
+                ++fraction;
+            } else if (*c != '0') {
+                throw std::runtime_error(std::string("Malformed JSON: field '") + name + "' has more decimals than its scale.");
+            }
+        }
+    }
+    if (!any || c != end) {
+        throw std::runtime_error(std::string("Malformed JSON: field '") + name + "' must be a decimal number.");
+    }
+    for (; fraction < decimals; ++fraction) {
+        result *= 10;
+        ++digits;
+    }
+    if (digits > 18) {
+        throw std::runtime_error(std::string("Malformed JSON: field '") + name + "' is too large for its scale.");
+    }
+    value = negative ? -static_cast<int64_t>(result) : static_cast<int64_t>(result);
+}
+
+/**
+ * @brief Converts a fixed-point value back to a floating-point number, e.g. for display.
+ * 
+ * @param value The fixed-point value.
+ * @param decimals Its number of decimals.
+ */
+double fromFixedPoint(int64_t value, int decimals) {
+    double scale = 1.0;
+    for (int i = 0; i < decimals; ++i) {
+        scale *= 10.0;
+    }
+    return static_cast<double>(value) / scale;
+}
+
+/**
+ * @brief Checks the trade IDs of a trade and returns the number of trades it aggregates.
+ * 
+ * @throw std::runtime_error if an ID is negative, the last trade ID is below the first, or the
+ *        trades they span do not fit the 32-bit trade count.
+ */
+static uint32_t tradeCountOf(long long aggregateTradeId, long long firstTradeId, long long lastTradeId) {
+    if (aggregateTradeId < 0 || firstTradeId < 0 || lastTradeId < 0) {
+        throw std::runtime_error("Malformed JSON: fields 'a', 'f' and 'l' must not be negative.");
+    }
+    if (lastTradeId < firstTradeId) {
+        throw std::runtime_error("Malformed JSON: field 'l' must not be below field 'f'.");
+    }
+    if (static_cast<uint64_t>(lastTradeId) - static_cast<uint64_t>(firstTradeId) >= UINT32_MAX) {
+        throw std::runtime_error("Malformed JSON: fields 'f' to 'l' span too many trades for a trade count.");
+    }
+    return static_cast<uint32_t>(lastTradeId - firstTradeId + 1);
+}
+
+/**
+ * @brief Converts a parsed trade into a compact record.
+ * 
+ * @throw std::runtime_error if the price or quantity does not fit the scale or the trade IDs are invalid.
+ */
+static TradeRecord toRecord(const Trade& trade, const TradeScale& scale) {
+    uint32_t tradeCount = tradeCountOf(trade.aggregateTradeId, trade.firstTradeId, trade.lastTradeId);
+    TradeRecord record;
+    record.aggregateTradeId = trade.aggregateTradeId;
+    toFixedPoint(trade.price.data(), trade.price.size(), scale.priceDecimals, record.price, "p");
+    toFixedPoint(trade.quantity.data(), trade.quantity.size(), scale.quantityDecimals, record.quantity, "q");
+    record.firstTradeId = trade.firstTradeId;
+    record.tradeCount = tradeCount;
+    record.timestamp = trade.timestamp;
+    record.isBuyerMaker = trade.isBuyerMaker;
+    return record;
+}
+
+/**
+ * @class ScanError
+ * @brief A syntax error found by the scanner, reported like a parse error of the document parser.
+ */
+class ScanError : public std::runtime_error {
+public:
+    explicit ScanError(const std::string& message) : std::runtime_error(message) {}
+};
+
+/**
+ * @class AggTradeScanner
+ * @brief A single-pass reader of aggregate trades, specialized to their JSON schema.
+ * 
+ * The text is read once, left to right. Keys are compared in place, integers are converted as their
+ * digits are read, and strings without escapes are assigned to the fields in one copy (prices and
+ * quantities fit in the small string buffer, so they do not allocate). Fields may come in any order;
+ * unknown fields are skipped whatever their value.
+ */
+class AggTradeScanner {
+public:
+    /**
+     * @brief Prepares to read a text, which must outlive the scanner.
+     */
+    explicit AggTradeScanner(const std::string& text)
+        : begin(text.data()), position(text.data()), end(text.data() + text.size()) {}
+
+    /**
+     * @brief Reads an array of aggregate trades, as returned by `/fapi/v1/aggTrades`.
+     * 
+     * @param trades Receives the trades, as Trade or TradeRecord.
+     * @param scale The decimals of the fixed-point prices and quantities of TradeRecords.
+     * @throw ScanError on a syntax error, std::runtime_error if a field is missing or mistyped.
+     */
+    template <class Record>
+    void parseTrades(std::vector<Record>& trades, const TradeScale& scale = TradeScale()) {
+        // A trade takes 90 to 100 bytes; overestimate rather than move every trade once more
+        trades.reserve(static_cast<size_t>(end - begin) / 80 + 1);
+        expect('[');
+        if (!consume(']')) {
+            do {
+                trades.emplace_back();
+                Fields<Record> fields(trades.back(), scale);
+                if (peek() != '{') {
+                    skipValue();
+                } else {
+                    parseObject(fields, false);
+                }
+                if (fields.seen != TRADE_FIELDS) {
+                    throw std::runtime_error("Malformed JSON: Missing required fields in the trade data.");
+                }
+                store(fields);
+            } while (consume(','));
+            expect(']');
+        }
+        finish();
+    }
+
+    /**
+     * @brief Reads an event of the market streams, raw or wrapped by a combined stream.
+     * 
+     * @return False if the message is not an aggTrade event.
+     * @throw ScanError on a syntax error, std::runtime_error if a field is missing or mistyped.
+     */
+    bool parseEvent(std::string& symbol, long long& eventTime, Trade& trade) {
+        Fields<Trade> fields(trade, TradeScale());
+        fields.symbol = &symbol;
+        if (peek() != '{') {
+            skipValue();
+            finish();
+            return false;
+        }
+        parseObject(fields, true);
+        finish();
+        if (!fields.aggTradeEvent) {
+            return false;
+        }
+        if ((fields.seen & (SYMBOL | EVENT_TIME)) != (SYMBOL | EVENT_TIME)) {
+            throw std::runtime_error("Malformed JSON: Missing required fields in the trade event.");
+        }
+        if ((fields.seen & TRADE_FIELDS) != TRADE_FIELDS) {
+            throw std::runtime_error("Malformed JSON: Missing required fields in the trade data.");
+        }
+        store(fields);
+        eventTime = fields.eventTime;
+        return true;
+    }
+
+private:
+    enum FieldBit {
+        AGGREGATE_ID = 1 << 0,
+        PRICE = 1 << 1,
+        QUANTITY = 1 << 2,
+        FIRST_ID = 1 << 3,
+        LAST_ID = 1 << 4,
+        TIMESTAMP = 1 << 5,
+        BUYER_MAKER = 1 << 6,
+        SYMBOL = 1 << 7,
+        EVENT_TIME = 1 << 8
+    };
+    static const unsigned TRADE_FIELDS = AGGREGATE_ID | PRICE | QUANTITY | FIRST_ID | LAST_ID | TIMESTAMP | BUYER_MAKER;
+
+    /**
+     * @struct Fields
+     * @brief The fields of one object as they are read, and which of them were seen.
+     * 
+     * The price and quantity go straight into the record; the other fields are stored once the
+     * object is complete, since the trade count of a TradeRecord needs both trade IDs.
+     */
+    template <class Record>
+    struct Fields {
+        Fields(Record& record, const TradeScale& scale) : record(record), scale(scale) {}
+
+        Record& record;                 ///< Receives the trade.
+        const TradeScale& scale;        ///< The decimals of fixed-point prices and quantities.
+        std::string* symbol = nullptr;  ///< Receives "s", if wanted.
+        long long aggregateTradeId = 0; ///< "a"
+        long long firstTradeId = 0;     ///< "f"
+        long long lastTradeId = 0;      ///< "l"
+        long long timestamp = 0;        ///< "T"
+        long long eventTime = 0;        ///< "E"
+        bool isBuyerMaker = false;      ///< "m"
+        bool aggTradeEvent = false;     ///< Whether "e" is "aggTrade"
+        unsigned seen = 0;              ///< The FieldBits that were read
+    };
+
+    /**
+     * @brief Stores the integer fields of a complete object into a Trade.
+     */
+    static void store(Fields<Trade>& fields) {
+        fields.record.aggregateTradeId = fields.aggregateTradeId;
+        fields.record.firstTradeId = fields.firstTradeId;
+        fields.record.lastTradeId = fields.lastTradeId;
+        fields.record.timestamp = fields.timestamp;
+        fields.record.isBuyerMaker = fields.isBuyerMaker;
+    }
+
+    /**
+     * @brief Stores the integer fields of a complete object into a TradeRecord.
+     */
+    static void store(Fields<TradeRecord>& fields) {
+        fields.record.tradeCount = tradeCountOf(fields.aggregateTradeId, fields.firstTradeId, fields.lastTradeId);
+        fields.record.aggregateTradeId = fields.aggregateTradeId;
+        fields.record.firstTradeId = fields.firstTradeId;
+        fields.record.timestamp = fields.timestamp;
+        fields.record.isBuyerMaker = fields.isBuyerMaker;
+    }
+
+    /**
+     * @brief Reads an object into the fields; with `unwrap`, a "data" object is read into them too.
+     */
+    template <class Record>
+    void parseObject(Fields<Record>& fields, bool unwrap) {
+        expect('{');
+        if (consume('}')) {
+            return;
+        }
+        do {
+            const char* key;
+            size_t keySize;
+            readRawString(key, keySize);
+            expect(':');
+            if (keySize == 1) {
+                switch (key[0]) {
+                case 'a': fields.aggregateTradeId = readInteger("a"); fields.seen |= AGGREGATE_ID; continue;
+                case 'p': readDecimal(fields.record.price, "p", fields.scale.priceDecimals); fields.seen |= PRICE; continue;
+                case 'q': readDecimal(fields.record.quantity, "q", fields.scale.quantityDecimals); fields.seen |= QUANTITY; continue;
+                case 'f': fields.firstTradeId = readInteger("f"); fields.seen |= FIRST_ID; continue;
+                case 'l': fields.lastTradeId = readInteger("l"); fields.seen |= LAST_ID; continue;
+                case 'T': fields.timestamp = readInteger("T"); fields.seen |= TIMESTAMP; continue;
+                case 'm': fields.isBuyerMaker = readBool("m"); fields.seen |= BUYER_MAKER; continue;
+                case 'E': fields.eventTime = readInteger("E"); fields.seen |= EVENT_TIME; continue;
+                case 'e':
+                    if (peek() == '"') {
+                        const char* type;
+                        size_t typeSize;
+                        readRawString(type, typeSize);
+                        fields.aggTradeEvent = typeSize == 8 && std::memcmp(type, "aggTrade", 8) == 0;
+                        continue;
+                    }
+                    break;
+                case 's':
+                    if (fields.symbol != nullptr) {
+                        readString(*fields.symbol, "s");
+                        fields.seen |= SYMBOL;
+                        continue;
+                    }
+                    break;
+                }
+            } else if (unwrap && keySize == 4 && std::memcmp(key, "data", 4) == 0 && peek() == '{') {
+                parseObject(fields, false);
+                continue;
+            }
+            skipValue();
+        } while (consume(','));
+        expect('}');
+    }
+
+    /**
+     * @brief Reads a decimal string field as text, for Trade.
+     */
+    void readDecimal(std::string& target, const char* name, int) {
+        readString(target, name);
+    }
+
+    /**
+     * @brief Reads a decimal string field as fixed point, for TradeRecord.
+     */
+    void readDecimal(int64_t& target, const char* name, int decimals) {
+        if (peek() != '"') {
+            mistyped(name, "a string");
+        }
+        const char* text;
+        size_t size;
+        readRawString(text, size);
+        if (std::memchr(text, '\\', size) != nullptr) {
+            std::string decoded;
+            decode(text, size, decoded);
+            toFixedPoint(decoded.data(), decoded.size(), decimals, target, name);
+            return;
+        }
+        toFixedPoint(text, size, decimals, target, name);
+    }
+
+    /**
+     * @brief Skips whitespace and returns the next character, or '\0' at the end of the text.
+     */
+    char peek() {
+        // A local cursor: stores through a char pointer could alias the member, which blocks registers
+        const char* c = position;
+        while (c < end && (*c == ' ' || *c == '\n' || *c == '\r' || *c == '\t')) {
+            ++c;
+        }
+        position = c;
+        return c < end ? *c : '\0';
+    }
+
+    /**
+     * @brief Consumes the next character if it is the given one.
+     */
+    bool consume(char expected) {
+        if (peek() == expected) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Consumes the next character, which must be the given one.
+     */
+    void expect(char expected) {
+        if (!consume(expected)) {
+            fail(std::string("expected '") + expected + "'");
+        }
+    }
+
+    /**
+     * @brief Checks that only whitespace follows the value.
+     */
+    void finish() {
+        if (peek() != '\0') {
+            fail("unexpected characters after the value");
+        }
+    }
+
+    /**
+     * @brief Throws a syntax error at the current position.
+     */
+    void fail(const std::string& message) const {
+        throw ScanError("syntax error at offset " + std::to_string(position - begin) + ": " + message);
+    }
+
+    /**
+     * @brief Throws the error of a field whose value has the wrong type, once the value proved well-formed.
+     * 
+     * The position must be at the start of the value, so that malformed JSON is reported as a
+     * syntax error, as the document parser does.
+     */
+    void mistyped(const char* name, const char* type) {
+        skipValue();
+        wrongType(name, type);
+    }
+
+    /**
+     * @brief Reads the four hex digits of a `\u` escape.
+     */
+    unsigned readHex(const char*& c, const char* limit) {
+        if (limit - c < 4) {
+            fail("invalid escape");
+        }
+        unsigned code = 0;
+        for (const char* digits = c + 4; c < digits; ++c) {
+            char digit = *c;
+            unsigned value = digit >= '0' && digit <= '9'   ? static_cast<unsigned>(digit - '0')
+                             : digit >= 'a' && digit <= 'f' ? static_cast<unsigned>(digit - 'a' + 10)
+                             : digit >= 'A' && digit <= 'F' ? static_cast<unsigned>(digit - 'A' + 10)
+                                                            : 16;
+            if (value == 16) {
+                fail("invalid escape");
+            }
+            code = code << 4 | value;
+        }
+        return code;
+    }
+
+    /**
+     * @brief Decodes the escape after a backslash and moves past it.
+     * 
+     * @param c The character after the backslash; moved past the escape.
+     * @param limit The end of the string.
+     * @return The code point, with a surrogate pair combined.
+     */
+    unsigned decodeEscape(const char*& c, const char* limit) {
+        if (c >= limit) {
+            fail("invalid escape");
+        }
+        switch (*c++) {
+        case '"': return '"';
+        case '\\': return '\\';
+        case '/': return '/';
+        case 'b': return '\b';
+        case 'f': return '\f';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 't': return '\t';
+        case 'u': break;
+        default: fail("invalid escape");
+        }
+        unsigned code = readHex(c, limit);
+        if (code >= 0xdc00 && code <= 0xdfff) {
+            fail("invalid escape: lone low surrogate");
+        }
+        if (code >= 0xd800 && code <= 0xdbff) {
+            if (limit - c < 2 || c[0] != '\\' || c[1] != 'u') {
+                fail("invalid escape: lone high surrogate");
+            }
+            c += 2;
+            unsigned low = readHex(c, limit);
+            if (low < 0xdc00 || low > 0xdfff) {
+                fail("invalid escape: lone high surrogate");
+            }
+            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+        }
+        return code;
+    }
+
+    /**
+     * @brief Reads a string without decoding it: the bytes between the quotes, escapes included.
+     * 
+     * Escapes are checked, so that a string the document parser rejects is rejected here too; the
+     * other bytes are taken as they are.
+     */
+    void readRawString(const char*& text, size_t& size) {
+        expect('"');
+        const char* start = position;
+        const char* quote = static_cast<const char*>(std::memchr(start, '"', static_cast<size_t>(end - start)));
+        if (quote != nullptr && std::memchr(start, '\\', static_cast<size_t>(quote - start)) != nullptr) {
+            // Escaped quotes do not end the string
+            const char* c = start;
+            while (c < end && *c != '"') {
+                if (*c++ == '\\') {
+                    decodeEscape(c, end);
+                }
+            }
+            quote = c < end ? c : nullptr;
+        }
+        if (quote == nullptr) {
+            fail("unterminated string");
+        }
+        text = start;
+        size = static_cast<size_t>(quote - start);
+        position = quote + 1;
+    }
+
+    /**
+     * @brief Reads a string field, decoding escapes if there are any.
+     */
+    void readString(std::string& target, const char* name) {
+        if (peek() != '"') {
+            mistyped(name, "a string");
+        }
+        const char* text;
+        size_t size;
+        readRawString(text, size);
+        if (std::memchr(text, '\\', size) == nullptr) {
+            target.assign(text, size);
+            return;
+        }
+        decode(text, size, target);
+    }
+
+    /**
+     * @brief Decodes the escapes of a string read by readRawString, which checked them, into UTF-8.
+     */
+    void decode(const char* text, size_t size, std::string& target) {
+        target.clear();
+        const char* limit = text + size;
+        for (const char* c = text; c < limit;) {
+            if (*c != '\\') {
+                target += *c++;
+                continue;
+            }
+            ++c;
+            unsigned code = decodeEscape(c, limit);
+            if (code < 0x80) {
+                target += static_cast<char>(code);
+            } else if (code < 0x800) {
+                target += static_cast<char>(0xc0 | (code >> 6));
+                target += static_cast<char>(0x80 | (code & 0x3f));
+            } else if (code < 0x10000) {
+                target += static_cast<char>(0xe0 | (code >> 12));
+                target += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                target += static_cast<char>(0x80 | (code & 0x3f));
+            } else {
+                target += static_cast<char>(0xf0 | (code >> 18));
+                target += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+                target += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                target += static_cast<char>(0x80 | (code & 0x3f));
+            }
+        }
+    }
+
+    /**
+     * @brief Reads an integer field.
+     */
+    long long readInteger(const char* name) {
+        char first = peek();
+        const char* start = position;
+        bool negative = first == '-';
+        if (negative) {
+            ++position;
+        }
+        if (position >= end || *position < '0' || *position > '9') {
+            if (negative) {
+                fail("invalid number");
+            }
+            mistyped(name, "an integer");
+        }
+        unsigned long long value = 0;
+        const char* digits = position;
+        const char* c = digits;
+        while (c < end && *c >= '0' && *c <= '9') {
+            value = value * 10 + static_cast<unsigned>(*c++ - '0');
+        }
+        if (*digits == '0' && c - digits > 1) {
+            fail("invalid number: leading zero");
+        }
+        position = c;
+        if (c - digits > 18 || (c < end && (*c == '.' || *c == 'e' || *c == 'E'))) {
+            position = start;
+            mistyped(name, "an integer of at most 18 digits");
+        }
+        return negative ? -static_cast<long long>(value) : static_cast<long long>(value);
+    }
+
+    /**
+     * @brief Reads a boolean field.
+     */
+    bool readBool(const char* name) {
+        char first = peek();
+        if (first == 't' && end - position >= 4 && std::memcmp(position, "true", 4) == 0) {
+            position += 4;
+            return true;
+        }
+        if (first == 'f' && end - position >= 5 && std::memcmp(position, "false", 5) == 0) {
+            position += 5;
+            return false;
+        }
+        mistyped(name, "a boolean");
+        return false;
+    }
+
+    /**
+     * @brief Skips a number, checking it against the JSON grammar: `-? (0 | [1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?`.
+     */
+    void skipNumber() {
+        const char* c = position;
+        auto skipDigits = [&]() {
+            const char* digits = c;
+            while (c < end && *c >= '0' && *c <= '9') {
+                ++c;
+            }
+            return c - digits;
+        };
+        if (c < end && *c == '-') {
+            ++c;
+        }
+        const char* integer = c;
+        ptrdiff_t integerDigits = skipDigits();
+        bool valid = integerDigits > 0 && (*integer != '0' || integerDigits == 1);
+        if (valid && c < end && *c == '.') {
+            ++c;
+            valid = skipDigits() > 0;
+        }
+        if (valid && c < end && (*c == 'e' || *c == 'E')) {
+            ++c;
+            if (c < end && (*c == '+' || *c == '-')) {
+                ++c;
+            }
+            valid = skipDigits() > 0;
+        }
+        if (!valid) {
+            position = c;
+            fail("invalid number");
+        }
+        position = c;
+    }
+
+    /**
+     * @brief Skips a value of any type.
+     */
+    void skipValue() {
+        char first = peek();
+        if (first == '"') {
+            const char* text;
+            size_t size;
+            readRawString(text, size);
+        } else if (first == '{' || first == '[') {
+            char close = first == '{' ? '}' : ']';
+            ++position;
+            if (consume(close)) {
+                return;
+            }
+            do {
+                if (first == '{') {
+                    const char* key;
+                    size_t keySize;
+                    readRawString(key, keySize);
+                    expect(':');
+                }
+                skipValue();
+            } while (consume(','));
+            expect(close);
+        } else if (first == 't' || first == 'f' || first == 'n') {
+            const char* literal = first == 't' ? "true" : first == 'f' ? "false" : "null";
+            size_t size = std::strlen(literal);
+            if (static_cast<size_t>(end - position) < size || std::memcmp(position, literal, size) != 0) {
+                fail("invalid literal");
+            }
+            position += size;
+        } else if (first == '-' || (first >= '0' && first <= '9')) {
+            skipNumber();
+        } else {
+            fail("unexpected character");
+        }
+    }
+
+    const char* begin;     ///< The start of the text, for error offsets
+    const char* position;  ///< The next character to read
+    const char* end;       ///< The end of the text
+};
+
 /**
  * @brief Parses a JSON response to extract trade data.
  * 
  * This function parses a JSON response string containing multiple trades and converts
- * it into a vector of Trade structures. It checks for necessary fields and throws an
- * exception if required fields are missing or if the JSON parsing fails.
+ * it into a vector of Trade structures, with the scanner or the document parser. It checks
+ * for necessary fields and throws an exception if required fields are missing or if the
+ * JSON parsing fails.
  * 
  * @param jsonResponse A JSON string containing the trade data.
  * @return A vector of Trade objects representing the parsed trades.
  * @throw std::runtime_error if there is an issue parsing the JSON or if the required fields are missing.
  */
 std::vector<Trade> TradeParser::parseTrades(const std::string& jsonResponse) {
+    PERF_SCOPE("parser.parse_trades");
     std::vector<Trade> trades;
     
     try {
+        if (backend == Backend::Scanner) {
+            AggTradeScanner(jsonResponse).parseTrades(trades);
+            return trades;
+        }
+
         auto jsonData = json::parse(jsonResponse);
 
         for (const auto& trade : jsonData) {
-            // Check for necessary fields and handle missing fields
-            if (trade.contains("a") && trade.contains("p") && trade.contains("q") &&
-                trade.contains("f") && trade.contains("l") && trade.contains("T") && trade.contains("m")) {
-                trades.push_back({
-                    trade["a"].get<long long>(),          // Aggregate tradeId
-                    trade["p"].get<std::string>(),        // Price
-                    trade["q"].get<std::string>(),        // Quantity
-                    trade["f"].get<int>(),                // First tradeId
-                    trade["l"].get<int>(),                // Last tradeId
-                    trade["T"].get<long long>(),          // Timestamp
-                    trade["m"].get<bool>()                // Buyer is the maker?
-                });
-            } else {
-                // If any required field is missing, throw an exception
-                throw std::runtime_error("Malformed JSON: Missing required fields in the trade data.");
-            }
+            trades.push_back(toTrade(trade));
         }
+    } catch (const ScanError& e) {
+        throw std::runtime_error("JSON parsing error: " + std::string(e.what()));
     } catch (const json::parse_error& e) {
         throw std::runtime_error("JSON parsing error: " + std::string(e.what()));
     } catch (const std::exception& e) {
@@ -47,3 +779,129 @@ std::vector<Trade> TradeParser::parseTrades(const std::string& jsonResponse) {
     }
     return trades;
 }
+
+/**
+ * @brief Parses an aggTrade event of the WebSocket market streams.
+ * 
+ * @param message One text message of the stream, raw or wrapped by a combined stream.
+ * @param symbol Receives the symbol of the trade (e.g., "BTCUSDT").
+ * @param eventTime Receives the time the event was sent, in milliseconds since the epoch.
+ * @param trade Receives the trade.
+ * @return False if the message is not an aggTrade event, e.g. the reply to a subscription.
+ * @throw std::runtime_error if the JSON parsing fails or a required field is missing.
+ */
+bool TradeParser::parseStreamTrade(const std::string& message, std::string& symbol, long long& eventTime, Trade& trade) {
+    PERF_SCOPE("parser.parse_stream_trade");
+    try {
+        if (backend == Backend::Scanner) {
+            return AggTradeScanner(message).parseEvent(symbol, eventTime, trade);
+        }
+
+        auto jsonData = json::parse(message);
+        const json& event = jsonData.contains("data") ? jsonData["data"] : jsonData;
+        if (!event.is_object() || !event.contains("e") || event["e"] != "aggTrade") {
+            return false;
+        }
+        if (!event.contains("s") || !event.contains("E")) {
+            throw std::runtime_error("Malformed JSON: Missing required fields in the trade event.");
+        }
+        symbol = stringField(event, "s");
+        eventTime = integerField(event, "E");
+        trade = toTrade(event);
+    } catch (const ScanError& e) {
+        throw std::runtime_error("JSON parsing error: " + std::string(e.what()));
+    } catch (const json::parse_error& e) {
+        throw std::runtime_error("JSON parsing error: " + std::string(e.what()));
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error parsing trade event: " + std::string(e.what()));
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a JSON response to extract compact trade records.
+ * 
+ * The scanner converts the digits of the prices and quantities straight into fixed point; the
+ * document parser converts the strings it extracted.
+ * 
+ * @param jsonResponse A JSON string containing the trade data.
+ * @param scale The number of decimals of the symbol's prices and quantities.
+ * @return The trade records, in the order of the response.
+ * @throw std::runtime_error if the JSON parsing fails, a required field is missing, or a price or
+ *        quantity has more decimals than the scale.
+ */
+std::vector<TradeRecord> TradeParser::parseTradeRecords(const std::string& jsonResponse, const TradeScale& scale) {
+    PERF_SCOPE("parser.parse_trade_records");
+    std::vector<TradeRecord> records;
+    try {
+        if (backend == Backend::Scanner) {
+            AggTradeScanner(jsonResponse).parseTrades(records, scale);
+            return records;
+        }
+
+        auto jsonData = json::parse(jsonResponse);
+        records.reserve(jsonData.size());
+        for (const auto& trade : jsonData) {
+            records.push_back(toRecord(toTrade(trade), scale));
+        }
+    } catch (const ScanError& e) {
+        throw std::runtime_error("JSON parsing error: " + std::string(e.what()));
+    } catch (const json::parse_error& e) {
+        throw std::runtime_error("JSON parsing error: " + std::string(e.what()));
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error parsing trade data: " + std::string(e.what()));
+    }
+    return records;
+}
+
+/**
+ * @brief Returns the number of decimals of a tick or step size, e.g. 1 for "0.10" and 0 for "1".
+ */
+static int decimalsOf(const std::string& size) {
+    size_t point = size.find('.');
+    if (point == std::string::npos) {
+        return 0;
+    }
+    size_t last = size.find_last_not_of('0');
+    return last > point ? static_cast<int>(last - point) : 0;
+}
+
+/**
+ * @brief Reads the scale of a symbol from the exchange information.
+ * 
+ * The price decimals are those of the tick size of the PRICE_FILTER, the quantity decimals those
+ * of the step size of the LOT_SIZE filter.
+ * 
+ * @param exchangeInfo The response of `/fapi/v1/exchangeInfo`.
+ * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+ * @return The decimals of the symbol's tick size and step size.
+ * @throw std::runtime_error if the JSON parsing fails or the symbol or its filters are missing.
+ */
+TradeScale TradeParser::parseTradeScale(const std::string& exchangeInfo, const std::string& symbol) {
+    try {
+        auto jsonData = json::parse(exchangeInfo);
+        for (const auto& entry : jsonData.at("symbols")) {
+            if (entry.at("symbol") != symbol) {
+                continue;
+            }
+            int priceDecimals = -1;
+            int quantityDecimals = -1;
+            for (const auto& filter : entry.at("filters")) {
+                if (filter.at("filterType") == "PRICE_FILTER") {
+                    priceDecimals = decimalsOf(filter.at("tickSize").get<std::string>());
+                } else if (filter.at("filterType") == "LOT_SIZE") {
+                    quantityDecimals = decimalsOf(filter.at("stepSize").get<std::string>());
+                }
+            }
+            if (priceDecimals < 0 || quantityDecimals < 0) {
+                throw std::runtime_error("Missing PRICE_FILTER or LOT_SIZE filter for " + symbol + ".");
+            }
+            return TradeScale(priceDecimals, quantityDecimals);
+        }
+    } catch (const json::parse_error& e) {
+        throw std::runtime_error("JSON parsing error: " + std::string(e.what()));
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error parsing exchange information: " + std::string(e.what()));
+    }
+    throw std::runtime_error("Error parsing exchange information: unknown symbol " + symbol + ".");
+}
@@ -0,0 +1,405 @@
+#include "TradePipeline.h"
+#include <stdexcept>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief Pins the calling thread to a CPU; failures are counted in "pipeline.pin_failures".
+ * 
+ * @param cpu The CPU, or -1 to leave the thread where the scheduler puts it.
+ */
+static void pinCurrentThread(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        return;
+    }
+#endif
+    PerformanceRegistry::counter("pipeline.pin_failures").fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @class IdleWait
+ * @brief Waits between polls of an empty or full ring: yields for a while, then sleeps for 50 microseconds.
+ * 
+ * Yielding keeps the latency of the next item at a few microseconds during bursts, while the
+ * sleeps keep an idle pipeline from burning its CPUs.
+ */
+class IdleWait {
+public:
+    IdleWait() : idleCount(0) {}
+
+    /**
+     * @brief Waits once.
+     */
+    void operator()() {
+        if (++idleCount < YIELDS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    /**
+     * @brief Starts over after some work was done.
+     */
+    void reset() {
+        idleCount = 0;
+    }
+
+private:
+    static const int YIELDS = 200;  ///< The yields before sleeping.
+    int idleCount;                  ///< The waits since the last work.
+};
+
+/**
+ * @brief Keeps the largest value of a single-writer maximum.
+ */
+static void updateMax(std::atomic<uint64_t>& maximum, uint64_t value) {
+    if (value > maximum.load(std::memory_order_relaxed)) {
+        maximum.store(value, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Returns the nanoseconds elapsed since a CycleClock reading.
+ */
+static uint64_t nanosecondsSince(uint64_t ticks) {
+    return CycleClock::toNanoseconds(CycleClock::now() - ticks);
+}
+
+/**
+ * @brief Constructs a consumer stage and looks its metrics up.
+ */
+TradePipeline::ConsumerStage::ConsumerStage(const std::string& name, const Consumer& consume, Backpressure policy,
+                                            int cpu, size_t capacity)
+    : name(name), consume(consume), policy(policy), cpu(cpu), queue(capacity), pendingCount(0),
+      latency(PerformanceRegistry::histogram("pipeline." + name + ".tick_to_consumer")),
+      maxDepth(PerformanceRegistry::counter("pipeline." + name + ".max_depth")),
+      dropped(PerformanceRegistry::counter("pipeline." + name + ".dropped")),
+      coalesced(PerformanceRegistry::counter("pipeline." + name + ".coalesced")),
+      errors(PerformanceRegistry::counter("pipeline." + name + ".errors")) {}
+
+/**
+ * @brief Constructs a pipeline without stages.
+ * 
+ * @param scale The number of decimals of the prices and quantities.
+ * @param messageCapacity The number of messages between the sources and the parser.
+ * @param tradeCapacity The number of trades between the parser and each consumer.
+ */
+TradePipeline::TradePipeline(const TradeScale& scale, size_t messageCapacity, size_t tradeCapacity)
+    : scale(scale), tradeCapacity(tradeCapacity), messages(messageCapacity), parserCPU(-1), started(false),
+      stopping(false), activeSources(0), parserDone(false) {}
+
+/**
+ * @brief Stops the pipeline if it is running.
+ */
+TradePipeline::~TradePipeline() {
+    if (started) {
+        stop();
+    }
+}
+
+/**
+ * @brief Adds a source; only before `start()`.
+ * 
+ * @param source Receives the messages.
+ * @param cpu The CPU to pin its thread to, or -1.
+ * @return The index of the source, found in its PipelineTrades.
+ */
+uint32_t TradePipeline::addSource(const Source& source, int cpu) {
+    std::unique_ptr<SourceStage> stage(new SourceStage());
+    stage->receive = source;
+    stage->cpu = cpu;
+    stage->lastId = -1;
+    sources.push_back(std::move(stage));
+    return static_cast<uint32_t>(sources.size() - 1);
+}
+
+/**
+ * @brief Adds a consumer; only before `start()`.
+ * 
+ * @param name The name of the consumer in the metrics (e.g., "db_writer").
+ * @param consumer Handles the trades.
+ * @param policy What to do with trades when its queue is full.
+ * @param cpu The CPU to pin its thread to, or -1.
+ */
+void TradePipeline::addConsumer(const std::string& name, const Consumer& consumer, Backpressure policy, int cpu) {
+    consumers.push_back(std::unique_ptr<ConsumerStage>(new ConsumerStage(name, consumer, policy, cpu, tradeCapacity)));
+}
+
+/**
+ * @brief Sets the CPU to pin the parser thread to, or -1; only before `start()`.
+ */
+void TradePipeline::setParserCPU(int cpu) {
+    parserCPU = cpu;
+}
+
+/**
+ * @brief Starts every thread: consumers first, then the parser, then the sources.
+ * 
+ * @throw std::logic_error if the pipeline is already started or has no source or consumer.
+ */
+void TradePipeline::start() {
+    if (started) {
+        throw std::logic_error("The trade pipeline is already started.");
+    }
+    if (sources.empty() || consumers.empty()) {
+        throw std::logic_error("The trade pipeline needs a source and a consumer.");
+    }
+    started = true;
+    stopping = false;
+    parserDone = false;
+    activeSources = sources.size();
+    for (std::unique_ptr<ConsumerStage>& stage : consumers) {
+        stage->pending.assign(sources.size(), PipelineTrade());
+        stage->hasPending.assign(sources.size(), false);
+        stage->pendingCount = 0;
+        ConsumerStage* consumer = stage.get();
+        stage->thread = std::thread([this, consumer]() { runConsumer(*consumer); });
+    }
+    parser = std::thread([this]() { runParser(); });
+    for (size_t i = 0; i < sources.size(); ++i) {
+        SourceStage* source = sources[i].get();
+        uint32_t index = static_cast<uint32_t>(i);
+        source->thread = std::thread([this, source, index]() { runSource(*source, index); });
+    }
+}
+
+/**
+ * @brief Waits until every source is exhausted and every trade is consumed, then joins the threads.
+ */
+void TradePipeline::wait() {
+    if (!started) {
+        return;
+    }
+    for (std::unique_ptr<SourceStage>& stage : sources) {
+        stage->thread.join();
+    }
+    parser.join();
+    for (std::unique_ptr<ConsumerStage>& stage : consumers) {
+        stage->thread.join();
+    }
+    started = false;
+}
+
+/**
+ * @brief Asks sources to stop after their current message, then waits like `wait()`.
+ */
+void TradePipeline::stop() {
+    stopping = true;
+    wait();
+}
+
+/**
+ * @brief Returns the number of messages waiting for the parser.
+ */
+size_t TradePipeline::parserQueueDepth() const {
+    return messages.size();
+}
+
+/**
+ * @brief Returns the number of trades waiting for a consumer.
+ * 
+ * @param consumer The index of the consumer, in the order they were added.
+ */
+size_t TradePipeline::consumerQueueDepth(size_t consumer) const {
+    return consumers.at(consumer)->queue.size();
+}
+
+/**
+ * @brief Runs a source until it is exhausted or the pipeline stops.
+ * 
+ * The message buffer is reused, and the ring keeps the capacity of its slots, so receiving stops
+ * allocating once the messages stop growing. A full ring is waited on: the parser is the one
+ * stage every message goes through. Exceptions end the source.
+ * 
+ * @param stage The source.
+ * @param index The index of the source.
+ */
+void TradePipeline::runSource(SourceStage& stage, uint32_t index) {
+    pinCurrentThread(stage.cpu);
+    Message message;
+    message.source = index;
+    IdleWait idle;
+    try {
+        while (!stopping && stage.receive(message.body)) {
+            message.receivedTicks = CycleClock::now();
+            while (!messages.tryPush(message)) {
+                idle();
+            }
+            idle.reset();
+        }
+    } catch (...) {
+        PerformanceRegistry::counter("pipeline.source_errors").fetch_add(1, std::memory_order_relaxed);
+    }
+    activeSources.fetch_sub(1, std::memory_order_release);
+}
+
+/**
+ * @brief Parses messages until the sources are done and their queue is empty.
+ * 
+ * Trades come out of a message oldest first; those not newer than the last one passed on for
+ * their source are skipped. While waiting for messages, the pending coalesced trades are offered
+ * to their consumers again.
+ */
+void TradePipeline::runParser() {
+    pinCurrentThread(parserCPU);
+    TradeParser tradeParser;
+    LatencyHistogram& queueWait = PerformanceRegistry::histogram("pipeline.parser.queue_wait");
+    LatencyHistogram& parseTime = PerformanceRegistry::histogram("pipeline.parse");
+    std::atomic<uint64_t>& maxDepth = PerformanceRegistry::counter("pipeline.parser.max_depth");
+    std::atomic<uint64_t>& parseErrors = PerformanceRegistry::counter("pipeline.parse_errors");
+    Message message;
+    PipelineTrade trade;
+    IdleWait idle;
+    for (;;) {
+        // Read the count before popping: a source that is done has pushed its last message
+        bool sourcesDone = activeSources.load(std::memory_order_acquire) == 0;
+        if (!messages.tryPop(message)) {
+            bool flushed = true;
+            for (std::unique_ptr<ConsumerStage>& stage : consumers) {
+                flushed = flushPending(*stage, sourcesDone) && flushed;
+            }
+            if (sourcesDone && flushed) {
+                break;
+            }
+            idle();
+            continue;
+        }
+        idle.reset();
+        updateMax(maxDepth, messages.size() + 1);
+        queueWait.record(nanosecondsSince(message.receivedTicks));
+
+        std::vector<TradeRecord> records;
+        try {
+            ScopedTimer parse(parseTime);
+            records = tradeParser.parseTradeRecords(message.body, scale);
+        } catch (const std::runtime_error&) {
+            parseErrors.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        SourceStage& source = *sources[message.source];
+        trade.receivedTicks = message.receivedTicks;
+        trade.source = message.source;
+        for (const TradeRecord& record : records) {
+            if (record.aggregateTradeId <= source.lastId) {
+                continue;
+            }
+            source.lastId = record.aggregateTradeId;
+            trade.trade = record;
+            for (std::unique_ptr<ConsumerStage>& stage : consumers) {
+                deliver(*stage, trade);
+            }
+        }
+    }
+    parserDone.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Consumes trades until the parser is done and the queue is empty.
+ * 
+ * @param stage The consumer.
+ */
+void TradePipeline::runConsumer(ConsumerStage& stage) {
+    pinCurrentThread(stage.cpu);
+    PipelineTrade trade;
+    IdleWait idle;
+    for (;;) {
+        // Read the flag before popping: once the parser is done, its last trade is in the queue
+        bool done = parserDone.load(std::memory_order_acquire);
+        if (!stage.queue.tryPop(trade)) {
+            if (done) {
+                break;
+            }
+            idle();
+            continue;
+        }
+        idle.reset();
+        updateMax(stage.maxDepth, stage.queue.size() + 1);
+        stage.latency.record(nanosecondsSince(trade.receivedTicks));
+        try {
+            stage.consume(trade);
+        } catch (...) {
+            stage.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Hands a trade to a consumer's queue according to its policy.
+ * 
+ * Trades of a source with a pending coalesced trade are merged into it until it gets through, so
+ * the consumer never sees them out of order.
+ * 
+ * @param stage The consumer.
+ * @param trade The trade.
+ */
+void TradePipeline::deliver(ConsumerStage& stage, const PipelineTrade& trade) {
+    if (stage.pendingCount > 0) {
+        flushPending(stage, false);
+    }
+    if (stage.hasPending[trade.source]) {
+        PipelineTrade& pending = stage.pending[trade.source];
+        int64_t firstTradeId = pending.trade.firstTradeId;
+        int64_t quantity = pending.trade.quantity + trade.trade.quantity;
+        pending.trade = trade.trade;
+        pending.trade.quantity = quantity;
+        pending.trade.firstTradeId = firstTradeId;
+        pending.trade.tradeCount = static_cast<uint32_t>(trade.trade.lastTradeId() - firstTradeId + 1);
+        stage.coalesced.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (stage.queue.tryPush(trade)) {
+        return;
+    }
+    switch (stage.policy) {
+    case Backpressure::Block: {
+        IdleWait idle;
+        while (!stage.queue.tryPush(trade)) {
+            idle();
+        }
+        break;
+    }
+    case Backpressure::Drop:
+        stage.dropped.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case Backpressure::Coalesce:
+        stage.pending[trade.source] = trade;
+        stage.hasPending[trade.source] = true;
+        ++stage.pendingCount;
+        break;
+    }
+}
+
+/**
+ * @brief Moves a consumer's pending coalesced trades into its queue, waiting if `block`.
+ * 
+ * @param stage The consumer.
+ * @param block Whether to wait for room in the queue.
+ * @return True if none is left pending.
+ */
+bool TradePipeline::flushPending(ConsumerStage& stage, bool block) {
+    IdleWait idle;
+    for (size_t source = 0; source < stage.hasPending.size() && stage.pendingCount > 0; ++source) {
+        if (!stage.hasPending[source]) {
+            continue;
+        }
+        while (!stage.queue.tryPush(stage.pending[source])) {
+            if (!block) {
+                return false;
+            }
+            idle();
+        }
+        stage.hasPending[source] = false;
+        --stage.pendingCount;
+    }
+    return true;
+}
@@ -0,0 +1,613 @@
+#include "TradeStore.h"
+#include "PerformanceTimer.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief The largest delta a uint32 column holds.
+ */
+const int64_t MAX_DELTA = std::numeric_limits<uint32_t>::max();
+
+/**
+ * @class InvalidSegment
+ * @brief A segment file that exists but is empty, torn or not a valid segment.
+ */
+class InvalidSegment : public std::runtime_error {
+public:
+    explicit InvalidSegment(const std::string& message) : std::runtime_error(message) {}
+};
+
+/**
+ * @brief Creates a directory unless it exists.
+ * 
+ * @throw std::runtime_error if it cannot be created.
+ */
+void makeDirectory(const std::string& path) {
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("Could not create directory " + path + ": " + std::strerror(errno));
+    }
+}
+
+/**
+ * @brief Flushes a file or directory to disk.
+ * 
+ * @return False if it cannot be opened or synced.
+ */
+bool syncPath(const std::string& path, int flags) {
+    int fd = ::open(path.c_str(), flags);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+/**
+ * @brief Throws unless a symbol can name a directory and fits into a segment header.
+ */
+void checkSymbol(const std::string& symbol) {
+    bool valid = !symbol.empty() && symbol.size() < sizeof(TradeSegmentHeader().symbol);
+    for (char c : symbol) {
+        valid = valid && std::isalnum(static_cast<unsigned char>(c));
+    }
+    if (!valid) {
+        throw std::invalid_argument("Not a valid symbol for the trade store: " + symbol);
+    }
+}
+
+/**
+ * @brief Writes a column as a section, padded so that the next one is aligned.
+ * 
+ * @param out The segment file.
+ * @param offset The offset of the section, updated to the offset of the next one.
+ * @return The offset of the section.
+ */
+template <typename T>
+uint64_t writeSection(std::ostream& out, uint64_t& offset, const std::vector<T>& column) {
+    uint64_t start = offset;
+    out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+    offset = write_snapshot_padding(out, offset + column.size() * sizeof(T));
+    return start;
+}
+
+/**
+ * @brief Returns a section of a mapped segment, or nullptr if it does not lie within the file.
+ */
+template <typename T>
+const T* mappedSection(const char* mapping, size_t mappingSize, uint64_t offset, uint64_t count) {
+    if (offset % SNAPSHOT_ALIGNMENT != 0 || offset > mappingSize || count > (mappingSize - offset) / sizeof(T)) {
+        return nullptr;
+    }
+    return reinterpret_cast<const T*>(mapping + offset);
+}
+
+/**
+ * @brief Returns the first key of a block: its first timestamp or first aggregate trade ID.
+ */
+int64_t firstKey(const TradeBlockIndex& block, bool byTime) {
+    return byTime ? block.firstTime : block.firstId;
+}
+
+/**
+ * @brief Returns the last key of a block.
+ */
+int64_t lastKey(const TradeBlockIndex& block, bool byTime) {
+    return byTime ? block.lastTime : block.lastId;
+}
+
+}  // namespace
+
+/**
+ * @brief Opens a store, creating its directory if needed.
+ * 
+ * Symbols are mapped when first used, so opening a large store costs nothing.
+ * 
+ * @param directory The directory of the store.
+ * @param blockTrades The number of trades per block, at most.
+ * @param segmentTrades The number of trades per segment, at most.
+ * @throw std::invalid_argument if a size is 0.
+ * @throw std::runtime_error if the directory cannot be created.
+ */
+TradeStore::TradeStore(const std::string& directory, uint32_t blockTrades, size_t segmentTrades)
+    : directory(directory), blockTrades(blockTrades), segmentTrades(segmentTrades) {
+    if (blockTrades == 0 || segmentTrades == 0) {
+        throw std::invalid_argument("The block and segment sizes must be positive.");
+    }
+    makeDirectory(directory);
+}
+
+/**
+ * @brief Writes the trades not yet written, then unmaps the segments.
+ */
+TradeStore::~TradeStore() {
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        std::cerr << "Trade store error: " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Unmaps a segment.
+ */
+TradeStore::Segment::~Segment() {
+    munmap(const_cast<char*>(mapping), mappingSize);
+}
+
+/**
+ * @brief Appends trades of a symbol.
+ * 
+ * A trade starts a new block when the current one is full or when one of its deltas would not
+ * fit into 32 bits, and a full segment is written at once. The batch is checked before anything
+ * is appended, so an invalid batch leaves the store unchanged; if writing a segment fails, the
+ * trades before it stay appended.
+ * 
+ * @param symbol The trading pair symbol (e.g., "BTCUSDT").
+ * @param scale The scale of the records, which must not change for a symbol.
+ * @param trades The trades, in aggregate trade ID order.
+ * @return The number of trades appended, without those skipped as already stored.
+ * @throw std::invalid_argument if the symbol is not a valid name, the scale differs from the stored
+ * one, or a trade is older than the one before it.
+ * @throw std::runtime_error if a full segment cannot be written.
+ */
+size_t TradeStore::append(const std::string& symbol, const TradeScale& scale, const std::vector<TradeRecord>& trades) {
+    SymbolStore& store = symbolStore(symbol);
+    if (store.hasScale && (store.scale.priceDecimals != scale.priceDecimals ||
+                           store.scale.quantityDecimals != scale.quantityDecimals)) {
+        throw std::invalid_argument("The scale of " + symbol + " differs from the stored one.");
+    }
+    int64_t lastId = store.lastId;
+    int64_t lastTime = store.lastTime;
+    for (const TradeRecord& trade : trades) {
+        if (trade.aggregateTradeId <= lastId) {
+            continue;
+        }
+        if (lastId >= 0 && trade.timestamp < lastTime) {
+            throw std::invalid_argument("Trade " + std::to_string(trade.aggregateTradeId) + " of " + symbol +
+                                        " is older than the one before it.");
+        }
+        lastId = trade.aggregateTradeId;
+        lastTime = trade.timestamp;
+    }
+    if (!store.hasScale) {
+        store.hasScale = true;
+        store.scale = scale;
+    }
+
+    size_t appended = 0;
+    PendingColumns& pending = store.pending;
+    for (const TradeRecord& trade : trades) {
+        if (trade.aggregateTradeId <= store.lastId) {
+            continue;
+        }
+
+        TradeBlockIndex* block = pending.blocks.empty() ? nullptr : &pending.blocks.back();
+        if (block == nullptr || block->rowCount == blockTrades || trade.aggregateTradeId - block->firstId > MAX_DELTA ||
+            trade.timestamp - block->firstTime > MAX_DELTA || trade.firstTradeId < block->firstTradeIdBase ||
+            trade.firstTradeId - block->firstTradeIdBase > MAX_DELTA) {
+            TradeBlockIndex started = {};
+            started.firstRow = pending.idDeltas.size();
+            started.firstId = trade.aggregateTradeId;
+            started.firstTime = trade.timestamp;
+            started.firstTradeIdBase = trade.firstTradeId;
+            pending.blocks.push_back(started);
+            block = &pending.blocks.back();
+        }
+        ++block->rowCount;
+        block->lastId = trade.aggregateTradeId;
+        block->lastTime = trade.timestamp;
+        pending.idDeltas.push_back(static_cast<uint32_t>(trade.aggregateTradeId - block->firstId));
+        pending.timeDeltas.push_back(static_cast<uint32_t>(trade.timestamp - block->firstTime));
+        pending.prices.push_back(trade.price);
+        pending.quantities.push_back(trade.quantity);
+        pending.firstTradeIdDeltas.push_back(static_cast<uint32_t>(trade.firstTradeId - block->firstTradeIdBase));
+        pending.tradeCounts.push_back(trade.tradeCount);
+        pending.buyerMaker.push_back(trade.isBuyerMaker ? 1 : 0);
+
+        store.lastId = trade.aggregateTradeId;
+        store.lastTime = trade.timestamp;
+        ++store.count;
+        ++appended;
+        if (pending.idDeltas.size() == segmentTrades) {
+            writeSegment(store);
+        }
+    }
+    return appended;
+}
+
+/**
+ * @brief Writes the trades not yet written of every symbol as new segments.
+ * 
+ * @throw std::runtime_error if a segment cannot be written.
+ */
+void TradeStore::flush() {
+    for (auto& entry : symbols) {
+        if (!entry.second->pending.idDeltas.empty()) {
+            writeSegment(*entry.second);
+        }
+    }
+}
+
+/**
+ * @brief Returns the scale of a symbol's records.
+ * 
+ * @throw std::invalid_argument if the symbol has no trades.
+ */
+TradeScale TradeStore::getScale(const std::string& symbol) {
+    SymbolStore& store = symbolStore(symbol);
+    if (!store.hasScale) {
+        throw std::invalid_argument("No trades stored for " + symbol);
+    }
+    return store.scale;
+}
+
+/**
+ * @brief Returns the number of trades of a symbol.
+ */
+uint64_t TradeStore::size(const std::string& symbol) {
+    return symbolStore(symbol).count;
+}
+
+/**
+ * @brief Returns the last aggregate trade ID of a symbol, or -1 if it has no trades.
+ */
+int64_t TradeStore::getLastTradeId(const std::string& symbol) {
+    return symbolStore(symbol).lastId;
+}
+
+/**
+ * @brief Visits the trades of a symbol with timestamps in `[startTime, endTime)`.
+ * 
+ * @return The number of trades visited.
+ */
+uint64_t TradeStore::scanByTime(const std::string& symbol, int64_t startTime, int64_t endTime,
+                                const BlockVisitor& visit) {
+    return scan(symbolStore(symbol), true, startTime, endTime, visit);
+}
+
+/**
+ * @brief Visits the trades of a symbol with aggregate trade IDs in `[fromId, toId)`.
+ * 
+ * @return The number of trades visited.
+ */
+uint64_t TradeStore::scanById(const std::string& symbol, int64_t fromId, int64_t toId, const BlockVisitor& visit) {
+    return scan(symbolStore(symbol), false, fromId, toId, visit);
+}
+
+/**
+ * @brief Returns the trades of a symbol with timestamps in `[startTime, endTime)`.
+ */
+std::vector<TradeRecord> TradeStore::readByTime(const std::string& symbol, int64_t startTime, int64_t endTime) {
+    return read(symbolStore(symbol), true, startTime, endTime);
+}
+
+/**
+ * @brief Returns the trades of a symbol with aggregate trade IDs in `[fromId, toId)`.
+ */
+std::vector<TradeRecord> TradeStore::readById(const std::string& symbol, int64_t fromId, int64_t toId) {
+    return read(symbolStore(symbol), false, fromId, toId);
+}
+
+/**
+ * @brief Returns the state of a symbol, mapping its segments on first use.
+ * 
+ * Segment names are zero-padded first IDs, so sorting them orders the segments. An invalid last
+ * segment, e.g. one cut short by a crash, is renamed to `.corrupt` and skipped, so its trades are
+ * fetched again rather than making the whole symbol unreadable. A segment that cannot be opened or
+ * mapped, e.g. for lack of file descriptors or memory, is left alone.
+ * 
+ * @throw std::invalid_argument if the symbol is not a valid name.
+ * @throw std::runtime_error if a segment cannot be opened or mapped, a segment before the last is
+ * invalid, or a segment does not follow the one before.
+ */
+TradeStore::SymbolStore& TradeStore::symbolStore(const std::string& symbol) {
+    auto found = symbols.find(symbol);
+    if (found != symbols.end()) {
+        return *found->second;
+    }
+    checkSymbol(symbol);
+
+    std::unique_ptr<SymbolStore> store(new SymbolStore());
+    store->symbol = symbol;
+    store->directory = directory + "/" + symbol;
+    store->hasScale = false;
+    store->count = 0;
+    store->lastId = -1;
+    store->lastTime = 0;
+
+    std::vector<std::string> names;
+    if (DIR* listing = opendir(store->directory.c_str())) {
+        while (dirent* entry = readdir(listing)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".seg") == 0) {
+                names.push_back(name);
+            }
+        }
+        closedir(listing);
+    }
+    std::sort(names.begin(), names.end());
+
+    for (const std::string& name : names) {
+        std::string path = store->directory + "/" + name;
+        std::unique_ptr<Segment> segment;
+        try {
+            segment = mapSegment(path);
+        } catch (const InvalidSegment& e) {
+            if (&name != &names.back()) {
+                throw;
+            }
+            std::string quarantined = path + ".corrupt";
+            std::rename(path.c_str(), quarantined.c_str());
+            std::cerr << "Trade store error: " << e.what() << ", moved to " << quarantined << std::endl;
+            break;
+        }
+        const TradeSegmentHeader& header = *segment->header;
+        const TradeBlockIndex& first = segment->view.blocks[0];
+        const TradeBlockIndex& last = segment->view.blocks[segment->view.blockCount - 1];
+        if (std::strncmp(header.symbol, symbol.c_str(), sizeof(header.symbol)) != 0 ||
+            (store->hasScale && (header.priceDecimals != store->scale.priceDecimals ||
+                                 header.quantityDecimals != store->scale.quantityDecimals)) ||
+            first.firstId <= store->lastId || (store->lastId >= 0 && first.firstTime < store->lastTime)) {
+            throw std::runtime_error("Trade segment does not follow the ones before it: " + path);
+        }
+        store->hasScale = true;
+        store->scale = TradeScale(header.priceDecimals, header.quantityDecimals);
+        store->count += header.count;
+        store->lastId = last.lastId;
+        store->lastTime = last.lastTime;
+        store->segments.push_back(std::move(segment));
+    }
+
+    SymbolStore& added = *store;
+    symbols[symbol] = std::move(store);
+    return added;
+}
+
+/**
+ * @brief Maps and checks a segment file.
+ * 
+ * The header, the position and size of every section and the block index are checked, so that
+ * scans can use the columns without bounds checks; the columns themselves are not read.
+ * 
+ * @throw InvalidSegment if the file is empty or not a valid segment.
+ * @throw std::runtime_error if the file cannot be opened or mapped.
+ */
+std::unique_ptr<TradeStore::Segment> TradeStore::mapSegment(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open trade segment " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not map trade segment " + path);
+    }
+    if (info.st_size == 0) {
+        ::close(fd);
+        throw InvalidSegment("Not a valid trade segment: " + path);
+    }
+    void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Could not map trade segment " + path);
+    }
+
+    std::unique_ptr<Segment> segment(new Segment());
+    segment->mapping = static_cast<const char*>(address);
+    segment->mappingSize = static_cast<size_t>(info.st_size);
+    const char* mapping = segment->mapping;
+    size_t size = segment->mappingSize;
+
+    const TradeSegmentHeader* header = mappedSection<TradeSegmentHeader>(mapping, size, 0, 1);
+    bool valid = header != nullptr && std::memcmp(header->magic, TRADE_SEGMENT_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == TRADE_SEGMENT_VERSION && header->byteOrder == SNAPSHOT_BYTE_ORDER_MARK &&
+                 header->headerSize == sizeof(TradeSegmentHeader) && header->blockCount > 0 && header->count > 0;
+    if (valid) {
+        uint64_t count = header->count;
+        SegmentView& view = segment->view;
+        view.blockCount = header->blockCount;
+        view.blocks = mappedSection<TradeBlockIndex>(mapping, size, header->indexOffset, header->blockCount);
+        view.idDeltas = mappedSection<uint32_t>(mapping, size, header->idOffset, count);
+        view.timeDeltas = mappedSection<uint32_t>(mapping, size, header->timeOffset, count);
+        view.prices = mappedSection<int64_t>(mapping, size, header->priceOffset, count);
+        view.quantities = mappedSection<int64_t>(mapping, size, header->quantityOffset, count);
+        view.firstTradeIdDeltas = mappedSection<uint32_t>(mapping, size, header->firstTradeIdOffset, count);
+        view.tradeCounts = mappedSection<uint32_t>(mapping, size, header->tradeCountOffset, count);
+        view.buyerMaker = mappedSection<uint8_t>(mapping, size, header->buyerMakerOffset, count);
+        valid = view.blocks && view.idDeltas && view.timeDeltas && view.prices && view.quantities &&
+                view.firstTradeIdDeltas && view.tradeCounts && view.buyerMaker;
+
+        // The blocks must cover the rows in order, with ascending IDs and non-decreasing times
+        uint64_t row = 0;
+        for (size_t i = 0; valid && i < view.blockCount; ++i) {
+            const TradeBlockIndex& block = view.blocks[i];
+            valid = block.firstRow == row && block.rowCount > 0 && block.rowCount <= count - row &&
+                    block.firstId <= block.lastId && block.firstTime <= block.lastTime &&
+                    (i == 0 || (block.firstId > view.blocks[i - 1].lastId &&
+                                block.firstTime >= view.blocks[i - 1].lastTime));
+            row += block.rowCount;
+        }
+        valid = valid && row == count;
+    }
+    if (!valid) {
+        throw InvalidSegment("Not a valid trade segment: " + path);
+    }
+    segment->header = header;
+    return segment;
+}
+
+/**
+ * @brief Writes the pending trades of a symbol as a segment and maps it.
+ * 
+ * The segment is written under a temporary name, synced and renamed once complete, then the
+ * directory is synced, so a crash leaves either no segment or a complete one.
+ * 
+ * @throw std::runtime_error if the segment cannot be written.
+ */
+void TradeStore::writeSegment(SymbolStore& store) {
+    ScopedTimer timer(PerformanceRegistry::histogram("store.write_segment"));
+    PendingColumns& pending = store.pending;
+    makeDirectory(store.directory);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020lld.seg", static_cast<long long>(pending.blocks.front().firstId));
+    std::string path = store.directory + "/" + name;
+    std::string temporary = path + ".tmp";
+
+    TradeSegmentHeader header = {};
+    std::memcpy(header.magic, TRADE_SEGMENT_MAGIC, sizeof(header.magic));
+    header.version = TRADE_SEGMENT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER_MARK;
+    header.headerSize = sizeof(TradeSegmentHeader);
+    header.priceDecimals = store.scale.priceDecimals;
+    header.quantityDecimals = store.scale.quantityDecimals;
+    header.blockCount = static_cast<uint32_t>(pending.blocks.size());
+    header.count = pending.idDeltas.size();
+    std::memcpy(header.symbol, store.symbol.data(), store.symbol.size());
+
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        // The offsets are only known once the sections are written, so the header is rewritten last
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t offset = sizeof(header);
+        header.indexOffset = writeSection(out, offset, pending.blocks);
+        header.idOffset = writeSection(out, offset, pending.idDeltas);
+        header.timeOffset = writeSection(out, offset, pending.timeDeltas);
+        header.priceOffset = writeSection(out, offset, pending.prices);
+        header.quantityOffset = writeSection(out, offset, pending.quantities);
+        header.firstTradeIdOffset = writeSection(out, offset, pending.firstTradeIdDeltas);
+        header.tradeCountOffset = writeSection(out, offset, pending.tradeCounts);
+        header.buyerMakerOffset = writeSection(out, offset, pending.buyerMaker);
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out || !syncPath(temporary, O_RDONLY)) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Could not write trade segment " + path);
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not rename trade segment " + path);
+    }
+    if (!syncPath(store.directory, O_RDONLY | O_DIRECTORY)) {
+        throw std::runtime_error("Could not sync the directory of trade segment " + path);
+    }
+
+    store.segments.push_back(mapSegment(path));
+    pending = PendingColumns();
+}
+
+/**
+ * @brief Visits the trades of a symbol whose time (or ID) is in `[from, to)`.
+ * 
+ * Segments are skipped by the first and last entries of their index, then the trades not yet
+ * written are scanned like one more segment.
+ */
+uint64_t TradeStore::scan(SymbolStore& store, bool byTime, int64_t from, int64_t to, const BlockVisitor& visit) {
+    ScopedTimer timer(PerformanceRegistry::histogram("store.scan"));
+    uint64_t visited = 0;
+    for (const std::unique_ptr<Segment>& segment : store.segments) {
+        const SegmentView& view = segment->view;
+        if (lastKey(view.blocks[view.blockCount - 1], byTime) < from) {
+            continue;
+        }
+        if (firstKey(view.blocks[0], byTime) >= to) {
+            break;
+        }
+        visited += scanSegment(view, byTime, from, to, visit);
+    }
+
+    const PendingColumns& pending = store.pending;
+    if (!pending.blocks.empty()) {
+        SegmentView view = {pending.blocks.data(), pending.blocks.size(), pending.idDeltas.data(),
+                            pending.timeDeltas.data(), pending.prices.data(), pending.quantities.data(),
+                            pending.firstTradeIdDeltas.data(), pending.tradeCounts.data(), pending.buyerMaker.data()};
+        visited += scanSegment(view, byTime, from, to, visit);
+    }
+    return visited;
+}
+
+/**
+ * @brief Returns the trades of a symbol whose time (or ID) is in `[from, to)`.
+ * 
+ * The views of the blocks stay valid until the store changes, so they are gathered first and
+ * the records decoded into a vector allocated once.
+ */
+std::vector<TradeRecord> TradeStore::read(SymbolStore& store, bool byTime, int64_t from, int64_t to) {
+    std::vector<TradeColumns> blocks;
+    uint64_t count = scan(store, byTime, from, to, [&blocks](const TradeColumns& columns) {
+        blocks.push_back(columns);
+    });
+    std::vector<TradeRecord> trades;
+    trades.reserve(count);
+    for (const TradeColumns& columns : blocks) {
+        for (size_t i = 0; i < columns.count; ++i) {
+            trades.push_back(columns.record(i));
+        }
+    }
+    return trades;
+}
+
+/**
+ * @brief Visits the trades of one segment whose time (or ID) is in `[from, to)`.
+ * 
+ * The blocks are found by binary search on the index. Only the blocks the bounds fall into are
+ * searched in their delta column; the others are visited whole.
+ */
+uint64_t TradeStore::scanSegment(const SegmentView& view, bool byTime, int64_t from, int64_t to,
+                                 const BlockVisitor& visit) {
+    const TradeBlockIndex* end = view.blocks + view.blockCount;
+    const TradeBlockIndex* block = std::partition_point(view.blocks, end, [byTime, from](const TradeBlockIndex& b) {
+        return lastKey(b, byTime) < from;
+    });
+
+    uint64_t visited = 0;
+    for (; block != end && firstKey(*block, byTime) < to; ++block) {
+        const uint32_t* deltas = (byTime ? view.timeDeltas : view.idDeltas) + block->firstRow;
+        int64_t base = firstKey(*block, byTime);
+        size_t first = 0;
+        size_t last = block->rowCount;
+        if (from > base) {
+            first = std::lower_bound(deltas, deltas + last, static_cast<uint32_t>(from - base)) - deltas;
+        }
+        if (to <= lastKey(*block, byTime)) {
+            last = std::lower_bound(deltas + first, deltas + last, static_cast<uint32_t>(to - base)) - deltas;
+        }
+        if (first == last) {
+            continue;
+        }
+
+        size_t row = block->firstRow + first;
+        TradeColumns columns;
+        columns.count = last - first;
+        columns.idBase = block->firstId;
+        columns.timeBase = block->firstTime;
+        columns.firstTradeIdBase = block->firstTradeIdBase;
+        columns.idDeltas = view.idDeltas + row;
+        columns.timeDeltas = view.timeDeltas + row;
+        columns.prices = view.prices + row;
+        columns.quantities = view.quantities + row;
+        columns.firstTradeIdDeltas = view.firstTradeIdDeltas + row;
+        columns.tradeCounts = view.tradeCounts + row;
+        columns.buyerMaker = view.buyerMaker + row;
+        visit(columns);
+        visited += columns.count;
+    }
+    return visited;
+}
@@ -1,30 +1,323 @@
 #include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include "AsyncBinanceAPI.h"
 #include "BinanceAPI.h"
+#include "BinanceStream.h"
+#include "TradeAggregator.h"
 #include "TradeParser.h"
+#include "TradePipeline.h"
+#include "TradeStore.h"
 #include "PerformanceTimer.h"
 
+/**
+ * @brief Returns the value of an environment variable, or a default if it is not set.
+ */
+static std::string environmentOr(const char* name, const char* fallback) {
+    const char* value = std::getenv(name);
+    return value != nullptr && *value != '\0' ? value : fallback;
+}
+
+/**
+ * @brief Streams the BTCUSDT aggregate trades for a while and prints each with its latency.
+ * 
+ * @param binance The REST API, used to fill gaps in the stream.
+ * @param seconds How long to stream.
+ */
+static void streamTrades(BinanceAPI& binance, int seconds) {
+    BinanceStream stream(environmentOr("BINANCE_STREAM_URL", "wss://fstream.binance.com"), binance);
+    std::thread stopper([&stream, seconds]() {
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stream.stop();
+    });
+    stream.run({"BTCUSDT"}, [](const std::string& symbol, const Trade& trade, double latencyMs) {
+        std::cout << symbol << " " << trade.aggregateTradeId << " " << trade.price << " x " << trade.quantity
+                  << (trade.isBuyerMaker ? " sell" : " buy") << ", " << latencyMs << " ms" << std::endl;
+    });
+    stopper.join();
+    PerformanceRegistry::report(std::cout);
+}
+
+/**
+ * @brief Fetches the BTCUSDT aggregate trades of the last minutes over concurrent connections.
+ * 
+ * @param binance The REST API, whose rate limiter paces the backfill.
+ * @param minutes How far back to fetch.
+ */
+static void backfillTrades(BinanceAPI& binance, int minutes) {
+    TradeScale scale = TradeParser::parseTradeScale(binance.getExchangeInfo(), "BTCUSDT");
+    long long endTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    long long startTime = endTime - minutes * 60LL * 1000;
+
+    PerformanceTimer timer;
+    timer.start();
+    std::vector<TradeRecord> records = binance.backfillAggregateTradesByTime("BTCUSDT", startTime, endTime, scale);
+    double timeTaken = timer.stop();
+
+    std::cout << "Fetched " << records.size() << " trades of the last " << minutes << " minutes in " << timeTaken
+              << " ms";
+    if (!records.empty()) {
+        std::cout << ", IDs " << records.front().aggregateTradeId << " to " << records.back().aggregateTradeId;
+    }
+    std::cout << "\nRate limit now at " << binance.getRateLimiter()->getWeightPerMinute() << " weight per minute"
+              << std::endl;
+    PerformanceRegistry::report(std::cout);
+}
+
+/**
+ * @brief Backfills the BTCUSDT aggregate trades of the last minutes and prints their one-minute and 100 BTC bars.
+ * 
+ * @param binance The REST API, whose rate limiter paces the backfill.
+ * @param minutes How far back to fetch.
+ */
+static void printBars(BinanceAPI& binance, int minutes) {
+    TradeScale scale = TradeParser::parseTradeScale(binance.getExchangeInfo(), "BTCUSDT");
+    long long endTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::vector<TradeRecord> records =
+        binance.backfillAggregateTradesByTime("BTCUSDT", endTime - minutes * 60LL * 1000, endTime, scale);
+
+    TradeAggregator aggregator(60 * 1000, 5 * 1000, [&scale](const std::string& symbol, BarType type, const Bar& bar) {
+        std::cout << symbol << (type == BarType::Time ? " 1m   " : " 100  ") << bar.startTime << " O "
+                  << fromFixedPoint(bar.open, scale.priceDecimals) << " H "
+                  << fromFixedPoint(bar.high, scale.priceDecimals) << " L "
+                  << fromFixedPoint(bar.low, scale.priceDecimals) << " C "
+                  << fromFixedPoint(bar.close, scale.priceDecimals) << " V "
+                  << fromFixedPoint(bar.volume, scale.quantityDecimals) << " VWAP "
+                  << bar.vwap() / std::pow(10.0, scale.priceDecimals) << " imbalance " << bar.imbalance()
+                  << std::endl;
+    });
+    aggregator.addSymbol("BTCUSDT", 100 * static_cast<int64_t>(std::pow(10.0, scale.quantityDecimals) + 0.5));
+    {
+        ScopedTimer aggregate(PerformanceRegistry::histogram("bars.aggregate"));
+        for (const TradeRecord& record : records) {
+            aggregator.add("BTCUSDT", record);
+        }
+    }
+    aggregator.flush();
+    std::cout << records.size() << " trades, " << aggregator.getLateTradeCount() << " too late" << std::endl;
+    PerformanceRegistry::report(std::cout);
+}
+
+/**
+ * @brief Backfills the BTCUSDT aggregate trades of the last minutes into a TradeStore, then scans them back.
+ * 
+ * Trades already in the store are skipped, so running it again only adds the new ones. The
+ * directory is `trade_store`, or TRADE_STORE_DIR.
+ * 
+ * @param binance The REST API, whose rate limiter paces the backfill.
+ * @param minutes How far back to fetch.
+ */
+static void storeTrades(BinanceAPI& binance, int minutes) {
+    TradeScale scale = TradeParser::parseTradeScale(binance.getExchangeInfo(), "BTCUSDT");
+    long long endTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    long long startTime = endTime - minutes * 60LL * 1000;
+    std::vector<TradeRecord> records = binance.backfillAggregateTradesByTime("BTCUSDT", startTime, endTime, scale);
+
+    TradeStore store(environmentOr("TRADE_STORE_DIR", "trade_store"));
+    size_t appended = store.append("BTCUSDT", scale, records);
+    store.flush();
+    std::cout << "Stored " << appended << " new of " << records.size() << " trades, " << store.size("BTCUSDT")
+              << " in the store" << std::endl;
+
+    // The VWAP only reads the price and quantity columns
+    PerformanceTimer timer;
+    timer.start();
+    double notional = 0;
+    int64_t volume = 0;
+    uint64_t scanned = store.scanByTime("BTCUSDT", startTime, endTime + 1, [&](const TradeColumns& columns) {
+        for (size_t i = 0; i < columns.count; ++i) {
+            notional += static_cast<double>(columns.prices[i]) * static_cast<double>(columns.quantities[i]);
+            volume += columns.quantities[i];
+        }
+    });
+    double scanTime = timer.stop();
+    if (volume > 0) {
+        std::cout << "VWAP of " << scanned << " trades: "
+                  << notional / static_cast<double>(volume) / std::pow(10.0, scale.priceDecimals) << " (" << scanTime
+                  << " ms)" << std::endl;
+    }
+    PerformanceRegistry::report(std::cout);
+}
+
+/**
+ * @brief Records the latest BTCUSDT aggregate trades response for the parser benchmark to replay.
+ * 
+ * The file is `bench/aggTrades_recorded.json`, which git ignores, so the committed fixture stays
+ * untouched; BENCHMARK_FIXTURE names another file and points `parser_benchmark` at it too, e.g.
+ * `BENCHMARK_FIXTURE=bench/aggTrades_recorded.json make benchmark` replays the recorded trades.
+ * 
+ * @param binance The REST API.
+ * @param limit The number of trades, at most MAX_AGG_TRADES_LIMIT.
+ */
+static void recordFixture(BinanceAPI& binance, int limit) {
+    const std::string& response = binance.getAggregateTrades("BTCUSDT", limit);
+    std::string path = environmentOr("BENCHMARK_FIXTURE", "bench/aggTrades_recorded.json");
+    std::ofstream file(path, std::ios::binary);
+    file << response;
+    if (!file) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    std::cout << "Recorded " << response.size() << " bytes of trades to " << path << std::endl;
+    PerformanceRegistry::report(std::cout);
+}
+
+/**
+ * @brief Polls the latest aggregate trades of several symbols once a second, all requests in flight together.
+ * 
+ * @param binance The REST API, whose rate limiter the polling shares.
+ * @param rounds How many times to poll.
+ */
+static void pollSymbols(BinanceAPI& binance, int rounds) {
+    const std::vector<std::string> symbols = {"BTCUSDT", "ETHUSDT", "BNBUSDT", "SOLUSDT", "XRPUSDT",
+                                              "DOGEUSDT", "ADAUSDT", "AVAXUSDT", "LINKUSDT", "LTCUSDT"};
+    AsyncBinanceAPI async(environmentOr("BINANCE_REST_URL", "https://fapi.binance.com"),
+                          binance.getRateLimiter());
+    TradeParser parser;
+    for (int round = 0; round < rounds; ++round) {
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        std::vector<std::future<std::string>> responses;
+        {
+            ScopedTimer poll(PerformanceRegistry::histogram("poll.round"));
+            for (const std::string& symbol : symbols) {
+                responses.push_back(async.getAggregateTrades(symbol, 1));
+            }
+            for (std::future<std::string>& response : responses) {
+                response.wait();
+            }
+        }
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            try {
+                std::vector<Trade> trades = parser.parseTrades(responses[i].get());
+                std::cout << symbols[i] << " " << (trades.empty() ? "-" : trades.back().price) << "  ";
+            } catch (const std::runtime_error& e) {
+                std::cout << symbols[i] << " error (" << e.what() << ")  ";
+            }
+        }
+        std::cout << std::endl;
+        std::this_thread::sleep_until(next);
+    }
+    PerformanceRegistry::report(std::cout);
+}
+
+/**
+ * @brief Polls the BTCUSDT aggregate trades for a while through a TradePipeline, with a printer and a slow writer.
+ * 
+ * The writer takes 5 ms per trade and coalesces the trades it cannot keep up with, so the printer
+ * and the polling are never held up by it.
+ * 
+ * @param binance The REST API, used by the source thread only.
+ * @param seconds How long to poll.
+ */
+static void pipelineTrades(BinanceAPI& binance, int seconds) {
+    TradeScale scale = TradeParser::parseTradeScale(binance.getExchangeInfo(), "BTCUSDT");
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    TradePipeline pipeline(scale);
+    pipeline.addSource([&binance, end](std::string& message) {
+        while (std::chrono::steady_clock::now() < end) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            try {
+                message = binance.getAggregateTrades("BTCUSDT", 100);
+                return true;
+            } catch (const BinanceAPI::APIException& e) {
+                std::cerr << "API Error: " << e.what() << std::endl;
+            }
+        }
+        return false;
+    });
+    pipeline.addConsumer("printer", [&scale](const PipelineTrade& trade) {
+        std::cout << "BTCUSDT " << trade.trade.aggregateTradeId << " "
+                  << fromFixedPoint(trade.trade.price, scale.priceDecimals) << " x "
+                  << fromFixedPoint(trade.trade.quantity, scale.quantityDecimals)
+                  << (trade.trade.isBuyerMaker ? " sell" : " buy") << std::endl;
+    });
+    pipeline.addConsumer("db_writer", [](const PipelineTrade&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }, Backpressure::Coalesce);
+    pipeline.start();
+    pipeline.wait();
+    PerformanceRegistry::report(std::cout);
+}
+
 /**
  * @brief Main function to interact with the Binance API, retrieve trades, and measure the parsing performance.
  * 
- * This function initializes the BinanceAPI, retrieves a stream of trades for the "BTCUSDT" symbol, parses
- * the trades using the TradeParser class, and prints the parsed trades. It also measures the time taken 
- * to parse the trades using the PerformanceTimer class.
+ * This function initializes the BinanceAPI, retrieves a stream of trades for the "BTCUSDT" symbol a few
+ * times over one kept-alive connection, parses the last response using the TradeParser class, and prints
+ * the parsed trades. It also measures the time taken to parse the trades using the PerformanceTimer class.
+ * 
+ * With the arguments `stream [seconds]` it streams the trades over the WebSocket API instead, for 10 seconds by
+ * default, and with `backfill [minutes]` it fetches the trades of the last minutes, 60 by default, over concurrent
+ * connections, and with `poll [rounds]` it polls ten symbols once a second, 10 times by default, with all requests
+ * of a round in flight together, and with `pipeline [seconds]` it runs the polling, the parsing and two consumers on
+ * threads of their own, and with `bars [minutes]` it backfills the last minutes, 10 by default, and prints their
+ * OHLCV bars, and with `store [minutes]` it backfills the last minutes, 60 by default, into the trade store and
+ * scans them back, and with `record [limit]` it saves the latest 1000 trades, by default, for the parser
+ * benchmark to replay. BINANCE_REST_URL and BINANCE_STREAM_URL override the endpoints.
  * 
  * @return int Returns 0 on successful execution, or prints an error message if there is an API or runtime error.
  */
-int main() {
+int main(int argc, char* argv[]) {
     try {
         // Initialize the Binance API with base URL
-        BinanceAPI binance("https://fapi.binance.com");
+        BinanceAPI binance(environmentOr("BINANCE_REST_URL", "https://fapi.binance.com"));
+
+        if (argc > 1 && std::strcmp(argv[1], "stream") == 0) {
+            streamTrades(binance, argc > 2 ? std::atoi(argv[2]) : 10);
+            return 0;
+        }
+        if (argc > 1 && std::strcmp(argv[1], "poll") == 0) {
+            pollSymbols(binance, argc > 2 ? std::atoi(argv[2]) : 10);
+            return 0;
+        }
+        if (argc > 1 && std::strcmp(argv[1], "pipeline") == 0) {
+            pipelineTrades(binance, argc > 2 ? std::atoi(argv[2]) : 10);
+            return 0;
+        }
+        if (argc > 1 && std::strcmp(argv[1], "backfill") == 0) {
+            backfillTrades(binance, argc > 2 ? std::atoi(argv[2]) : 60);
+            return 0;
+        }
+        if (argc > 1 && std::strcmp(argv[1], "record") == 0) {
+            recordFixture(binance, argc > 2 ? std::atoi(argv[2]) : BinanceAPI::MAX_AGG_TRADES_LIMIT);
+            return 0;
+        }
+        if (argc > 1 && std::strcmp(argv[1], "store") == 0) {
+            storeTrades(binance, argc > 2 ? std::atoi(argv[2]) : 60);
+            return 0;
+        }
+        if (argc > 1 && std::strcmp(argv[1], "bars") == 0) {
+            printBars(binance, argc > 2 ? std::atoi(argv[2]) : 10);
+            return 0;
+        }
 
-        // Get a stream of trades
-        std::string jsonResponse = binance.getAggregateTrades("BTCUSDT", 10);
+        // The tick and step sizes of the symbol give the scale of the fixed-point trade records
+        TradeScale scale = TradeParser::parseTradeScale(binance.getExchangeInfo(), "BTCUSDT");
+
+        // Get a stream of trades a few times, recording the HTTP round trips: the first one
+        // connects, the others reuse the connection
+        const int requestCount = 5;
+        const std::string* jsonResponse = nullptr;
+        for (int i = 0; i < requestCount; ++i) {
+            ScopedTimer roundTrip(PerformanceRegistry::histogram(i == 0 ? "http.round_trip.first" : "http.round_trip"));
+            jsonResponse = &binance.getAggregateTrades("BTCUSDT", 10);
+        }
 
         // Parse the trades
         TradeParser parser;
         PerformanceTimer timer;
         timer.start();
-        std::vector<Trade> trades = parser.parseTrades(jsonResponse);
+        std::vector<Trade> trades;
+        {
+            ScopedTimer parse(PerformanceRegistry::histogram("parse"));
+            trades = parser.parseTrades(*jsonResponse);
+        }
         double timeTaken = timer.stop();
 
         // Print the parsed trades
@@ -42,6 +335,20 @@ int main() {
 
         // Print the time taken to parse the trades
         std::cout << "Time taken to parse trades: " << timeTaken << " ms" << std::endl;
+
+        // Parse them again into compact fixed-point records
+        timer.start();
+        std::vector<TradeRecord> records = parser.parseTradeRecords(*jsonResponse, scale);
+        double recordTime = timer.stop();
+        std::cout << "Time taken to parse " << records.size() << " trade records of " << sizeof(TradeRecord)
+                  << " bytes (" << scale.priceDecimals << " price and " << scale.quantityDecimals
+                  << " quantity decimals): " << recordTime << " ms" << std::endl;
+        if (!records.empty()) {
+            std::cout << "Last price: " << fromFixedPoint(records.back().price, scale.priceDecimals) << std::endl;
+        }
+
+        // Print the latency percentiles of the round trip and the parse
+        PerformanceRegistry::report(std::cout);
     } catch (const BinanceAPI::APIException& e) {
         std::cerr << "API Error: " << e.what() << std::endl;
     } catch (const std::runtime_error& e) {
@@ -0,0 +1,222 @@
+#include "TradeParser.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief What a backend is expected to make of an input.
+ */
+enum class Expected {
+    Parsed,       ///< The input is valid and parsed alike by both backends.
+    SyntaxError,  ///< The input is not JSON: "JSON parsing error".
+    FieldError    ///< The input is JSON, but a field is missing or mistyped: the same message from both.
+};
+
+/**
+ * @struct Case
+ * @brief An input and what both backends must make of it.
+ */
+struct Case {
+    const char* name;
+    std::string text;
+    Expected expected;
+};
+
+/**
+ * @brief Wraps the fields of a trade object into an aggTrades response.
+ */
+static std::string response(const std::string& fields) {
+    return "[{" + fields + "}]";
+}
+
+/**
+ * @brief Wraps the fields of a trade into an aggTrade event of the streams.
+ */
+static std::string event(const std::string& fields) {
+    return "{\"e\":\"aggTrade\",\"E\":1700000000001,\"s\":\"BTCUSDT\"," + fields + "}";
+}
+
+/**
+ * @brief The fields of a valid trade, followed by `extra` fields.
+ */
+static std::string trade(const std::string& extra = "") {
+    std::string fields = "\"a\":26129,\"p\":\"0.01633102\",\"q\":\"4.70443515\",\"f\":27781,\"l\":27781,"
+                         "\"T\":1498793709153,\"m\":true";
+    return extra.empty() ? fields : fields + "," + extra;
+}
+
+/**
+ * @brief A trade with one field replaced by a raw value.
+ */
+static std::string tradeWith(const std::string& name, const std::string& value) {
+    std::string fields;
+    const char* names[] = {"a", "p", "q", "f", "l", "T", "m"};
+    const char* values[] = {"26129", "\"0.01633102\"", "\"4.70443515\"", "27781", "27781", "1498793709153", "true"};
+    for (int i = 0; i < 7; ++i) {
+        fields += std::string(fields.empty() ? "" : ",") + "\"" + names[i] + "\":" + (name == names[i] ? value : values[i]);
+    }
+    return fields;
+}
+
+/**
+ * @brief Describes the outcome of a parse: the parsed values, or the error message.
+ *
+ * Syntax errors are reduced to their prefix, since the backends describe the position differently.
+ */
+template <class Parse>
+static std::string outcome(Parse parse) {
+    try {
+        return "parsed " + parse();
+    } catch (const std::exception& e) {
+        std::string message = e.what();
+        const std::string syntax = "JSON parsing error";
+        return message.compare(0, syntax.size(), syntax) == 0 ? syntax : message;
+    }
+}
+
+static std::string describe(const std::vector<Trade>& trades) {
+    std::ostringstream out;
+    for (const Trade& t : trades) {
+        out << t.aggregateTradeId << ' ' << t.price << ' ' << t.quantity << ' ' << t.firstTradeId << ' '
+            << t.lastTradeId << ' ' << t.timestamp << ' ' << t.isBuyerMaker << ';';
+    }
+    return out.str();
+}
+
+static std::string describe(const std::vector<TradeRecord>& records) {
+    std::ostringstream out;
+    for (const TradeRecord& r : records) {
+        out << r.aggregateTradeId << ' ' << r.price << ' ' << r.quantity << ' ' << r.firstTradeId << ' '
+            << r.tradeCount << ' ' << r.timestamp << ' ' << r.isBuyerMaker << ';';
+    }
+    return out.str();
+}
+
+/**
+ * @brief Runs one way of parsing on both backends and checks that they agree with each other and the case.
+ *
+ * @return True if the check passed.
+ */
+template <class Run>
+static bool check(const Case& c, const char* method, Run run) {
+    TradeParser scanner(TradeParser::Backend::Scanner);
+    TradeParser document(TradeParser::Backend::Document);
+    std::string scanned = outcome([&]() { return run(scanner); });
+    std::string parsed = outcome([&]() { return run(document); });
+
+    bool asExpected = c.expected == Expected::Parsed        ? scanned.compare(0, 7, "parsed ") == 0
+                      : c.expected == Expected::SyntaxError ? scanned == "JSON parsing error"
+                                                            : scanned.compare(0, 7, "parsed ") != 0 &&
+                                                                  scanned != "JSON parsing error";
+    if (scanned == parsed && asExpected) {
+        return true;
+    }
+    std::cerr << "FAIL " << c.name << " (" << method << ")\n  input:    " << c.text.substr(0, 200)
+              << "\n  scanner:  " << scanned.substr(0, 200) << "\n  document: " << parsed.substr(0, 200) << "\n";
+    return false;
+}
+
+int main() {
+    std::vector<Case> responses = {
+        {"valid", response(trade()), Expected::Parsed},
+        {"empty array", "[]", Expected::Parsed},
+        {"fields reordered", "[{\"m\":false,\"T\":1,\"l\":3,\"f\":2,\"q\":\"1\",\"p\":\"2.5\",\"a\":7}]", Expected::Parsed},
+        {"unknown fields", response(trade("\"x\":[1,-0,0.5,-2.5e-3,1E+2,{\"y\":null}],\"z\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"")),
+         Expected::Parsed},
+        {"escaped price", response(tradeWith("p", "\"0\\u002e5\"")), Expected::Parsed},
+        {"surrogate pair", response(trade("\"x\":\"\\ud83d\\ude00\"")), Expected::Parsed},
+        {"negative zero id", response(tradeWith("T", "-0")), Expected::Parsed},
+        {"18 digits", response(tradeWith("T", "999999999999999999")), Expected::Parsed},
+
+        {"number with two points", response(trade("\"x\":1.2.3")), Expected::SyntaxError},
+        {"lone minus", response(trade("\"x\":-")), Expected::SyntaxError},
+        {"missing fraction", response(trade("\"x\":1.")), Expected::SyntaxError},
+        {"missing exponent", response(trade("\"x\":1e")), Expected::SyntaxError},
+        {"leading zero in unknown field", response(trade("\"x\":01")), Expected::SyntaxError},
+        {"leading zero in id", response(tradeWith("a", "01")), Expected::SyntaxError},
+        {"malformed fraction in id", response(tradeWith("a", "1.")), Expected::SyntaxError},
+        {"bad hex escape", response(trade("\"x\":\"\\u12G4\"")), Expected::SyntaxError},
+        {"short unicode escape", response(trade("\"x\":\"\\u12\"")), Expected::SyntaxError},
+        {"unknown escape", response(trade("\"x\":\"\\q\"")), Expected::SyntaxError},
+        {"lone high surrogate", response(trade("\"x\":\"\\ud800\"")), Expected::SyntaxError},
+        {"lone low surrogate", response(trade("\"x\":\"\\udc00\"")), Expected::SyntaxError},
+        {"bad escape in price", response(tradeWith("p", "\"1\\u00zz\"")), Expected::SyntaxError},
+        {"bad literal", response(trade("\"x\":tru")), Expected::SyntaxError},
+        {"bad literal in mistyped field", response(tradeWith("m", "nul")), Expected::SyntaxError},
+        {"trailing comma", "[{" + trade() + "},]", Expected::SyntaxError},
+        {"unterminated", "[{" + trade(), Expected::SyntaxError},
+        {"trailing characters", response(trade()) + "x", Expected::SyntaxError},
+
+        {"fractional id", response(tradeWith("a", "1.0")), Expected::FieldError},
+        {"exponent id", response(tradeWith("a", "1e3")), Expected::FieldError},
+        {"19-digit id", response(tradeWith("a", "1234567890123456789")), Expected::FieldError},
+        {"20-digit id", response(tradeWith("l", "12345678901234567890")), Expected::FieldError},
+        {"string id", response(tradeWith("f", "\"1\"")), Expected::FieldError},
+        {"numeric price", response(tradeWith("p", "1.5")), Expected::FieldError},
+        {"numeric flag", response(tradeWith("m", "1")), Expected::FieldError},
+        {"null timestamp", response(tradeWith("T", "null")), Expected::FieldError},
+        {"missing field", "[{\"a\":1,\"p\":\"1\",\"q\":\"1\",\"f\":1,\"l\":1,\"T\":1}]", Expected::FieldError},
+        {"not an object", "[1]", Expected::FieldError},
+    };
+
+    std::ifstream fixture("bench/aggTrades_BTCUSDT.json", std::ios::binary);
+    if (fixture) {
+        std::ostringstream text;
+        text << fixture.rdbuf();
+        responses.push_back({"fixture", text.str(), Expected::Parsed});
+    }
+
+    std::vector<Case> records = {
+        {"negative id", response(tradeWith("a", "-1")), Expected::FieldError},
+        {"last below first", response(tradeWith("l", "1")), Expected::FieldError},
+        {"too many decimals", response(tradeWith("q", "\"1.000000001\"")), Expected::FieldError},
+        {"not a decimal", response(tradeWith("p", "\"1e5\"")), Expected::FieldError},
+    };
+
+    std::vector<Case> events = {
+        {"event", event(trade()), Expected::Parsed},
+        {"combined stream", "{\"stream\":\"btcusdt@aggTrade\",\"data\":" + event(trade()) + "}", Expected::Parsed},
+        {"subscription reply", "{\"result\":null,\"id\":1}", Expected::Parsed},
+        {"escaped symbol", "{\"e\":\"aggTrade\",\"E\":1,\"s\":\"BTC\\u0055SDT\"," + trade() + "}", Expected::Parsed},
+        {"bad escape in symbol", "{\"e\":\"aggTrade\",\"E\":1,\"s\":\"BTC\\uZZZZ\"," + trade() + "}", Expected::SyntaxError},
+        {"leading zero in event time", "{\"e\":\"aggTrade\",\"E\":01,\"s\":\"BTCUSDT\"," + trade() + "}",
+         Expected::SyntaxError},
+        {"fractional event time", "{\"e\":\"aggTrade\",\"E\":1.5,\"s\":\"BTCUSDT\"," + trade() + "}", Expected::FieldError},
+        {"numeric symbol", "{\"e\":\"aggTrade\",\"E\":1,\"s\":5," + trade() + "}", Expected::FieldError},
+        {"missing symbol", "{\"e\":\"aggTrade\",\"E\":1," + trade() + "}", Expected::FieldError},
+    };
+
+    int failures = 0;
+    int checks = 0;
+    for (const Case& c : responses) {
+        failures += !check(c, "parseTrades", [&](TradeParser& parser) { return describe(parser.parseTrades(c.text)); });
+        failures += !check(c, "parseTradeRecords", [&](TradeParser& parser) {
+            return describe(parser.parseTradeRecords(c.text, TradeScale(8, 8)));
+        });
+        checks += 2;
+    }
+    for (const Case& c : records) {
+        failures += !check(c, "parseTradeRecords", [&](TradeParser& parser) {
+            return describe(parser.parseTradeRecords(c.text, TradeScale(8, 8)));
+        });
+        ++checks;
+    }
+    for (const Case& c : events) {
+        failures += !check(c, "parseStreamTrade", [&](TradeParser& parser) {
+            std::string symbol;
+            long long eventTime = 0;
+            Trade parsed;
+            if (!parser.parseStreamTrade(c.text, symbol, eventTime, parsed)) {
+                return std::string("not an aggTrade event");
+            }
+            return symbol + ' ' + std::to_string(eventTime) + ' ' + describe(std::vector<Trade>{parsed});
+        });
+        ++checks;
+    }
+
+    std::cout << checks - failures << " of " << checks << " parser checks agree" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+#ifndef PERFORMANCE_TIMER_H
+#define PERFORMANCE_TIMER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(PERF_TIMER_RDTSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PERF_TIMER_USES_RDTSC 1
+#endif
+
+/**
+ * @class PerformanceTimer
+ * @brief A class to measure the time taken by various operations.
+ * 
+ * This class uses the high-resolution clock to provide precise measurements of
+ * elapsed time between the `start` and `stop` calls.
+ */
+class PerformanceTimer {
+public:
+    /**
+     * @brief Starts the performance timer.
+     * 
+     * This method records the current time as the start time for timing.
+     */
+    void start();
+
+    /**
+     * @brief Stops the performance timer and calculates the elapsed time.
+     * 
+     * @return The elapsed time in milliseconds since the last call to `start()`.
+     */
+    double stop();  // Returns time in milliseconds
+
+private:
+    /**
+     * @brief Stores the time point when the timer was started.
+     */
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTime;
+};
+
+/**
+ * @class CycleClock
+ * @brief The clock behind the scoped timers and latency histograms.
+ * 
+ * By default it reads `std::chrono::steady_clock` in nanoseconds. Built with `-DPERF_TIMER_RDTSC`
+ * on x86 it reads the time stamp counter instead, which costs a few nanoseconds rather than
+ * some tens and is converted to nanoseconds with a rate calibrated once against the steady
+ * clock. `rdtsc` is not serializing, so single readings may be off by a few cycles; it is meant
+ * for aggregating many short operations, not for timing one of them.
+ */
+class CycleClock {
+public:
+    /**
+     * @brief Reads the clock.
+     * 
+     * @return The current time in ticks.
+     */
+    static uint64_t now() {
+#ifdef PERF_TIMER_USES_RDTSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     * @brief Converts a number of ticks into nanoseconds.
+     * 
+     * @param ticks The difference between two readings of `now()`.
+     * @return The elapsed time in nanoseconds.
+     */
+    static uint64_t toNanoseconds(uint64_t ticks);
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief A fixed-size histogram of latencies with HDR-style log-linear buckets.
+ * 
+ * Values below 64 ns get a bucket each; above that, every power of two is split into 32
+ * buckets, so any value up to 2^64 ns is recorded in constant time and space with a relative
+ * error of at most 1/32 (about 3%). Recording is lock-free and may happen from any thread;
+ * readings taken while other threads record are approximate.
+ */
+class LatencyHistogram {
+public:
+    /**
+     * @brief Creates an empty histogram.
+     */
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief Records one latency.
+     * 
+     * @param nanoseconds The latency in nanoseconds.
+     */
+    void record(uint64_t nanoseconds);
+
+    /**
+     * @brief Returns the number of recorded latencies.
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Returns the smallest recorded latency in nanoseconds, or 0 if none was recorded.
+     */
+    uint64_t min() const;
+
+    /**
+     * @brief Returns the largest recorded latency in nanoseconds.
+     */
+    uint64_t max() const;
+
+    /**
+     * @brief Returns the mean of the recorded latencies in nanoseconds.
+     */
+    double mean() const;
+
+    /**
+     * @brief Returns a percentile of the recorded latencies.
+     * 
+     * @param percent The percentile, between 0 and 100 (e.g. 99.9 for the p999).
+     * @return The highest value of the bucket holding the percentile, in nanoseconds, or 0 if
+     *         nothing was recorded.
+     */
+    uint64_t percentile(double percent) const;
+
+    /**
+     * @brief Adds the latencies recorded by another histogram.
+     * 
+     * @param other The other histogram.
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * @brief Forgets every recorded latency.
+     */
+    void reset();
+
+private:
+    static const int SUB_BUCKET_BITS = 6;                         ///< Bits of precision kept per value.
+    static const uint64_t SUB_BUCKET_HALF = 1 << (SUB_BUCKET_BITS - 1);  ///< Buckets per power of two.
+    static const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 2) * SUB_BUCKET_HALF;  ///< Covers 2^64.
+
+    /**
+     * @brief Finds the bucket of a value.
+     */
+    static size_t bucketIndex(uint64_t value);
+
+    /**
+     * @brief Returns the highest value that falls into a bucket.
+     */
+    static uint64_t bucketUpperBound(size_t index);
+
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];  ///< The number of values per bucket.
+    std::atomic<uint64_t> total;                  ///< The number of values.
+    std::atomic<uint64_t> sum;                    ///< The sum of the values.
+    std::atomic<uint64_t> minimum;                ///< The smallest value.
+    std::atomic<uint64_t> maximum;                ///< The largest value.
+};
+
+/**
+ * @class ScopedTimer
+ * @brief Records the lifetime of a scope into a latency histogram.
+ */
+class ScopedTimer {
+public:
+    /**
+     * @brief Starts timing.
+     * 
+     * @param histogram The histogram that receives the latency when the timer goes out of scope.
+     */
+    explicit ScopedTimer(LatencyHistogram& histogram) : histogram(histogram), startTicks(CycleClock::now()) {}
+
+    /**
+     * @brief Stops timing and records the latency.
+     */
+    ~ScopedTimer() {
+        histogram.record(CycleClock::toNanoseconds(CycleClock::now() - startTicks));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    LatencyHistogram& histogram;  ///< Receives the latency.
+    uint64_t startTicks;          ///< The clock reading at construction.
+};
+
+/**
+ * @class PerformanceRegistry
+ * @brief Process-wide named latency histograms and event counters.
+ * 
+ * Histograms and counters are created on first use and live until the program ends, so the
+ * references returned can be cached, e.g. in a function-local static as PERF_SCOPE does.
+ */
+class PerformanceRegistry {
+public:
+    /**
+     * @brief Returns the histogram with the given name, creating it if needed.
+     * 
+     * @param name The name of the measured operation, e.g. "get" or "http.round_trip".
+     * @return The histogram.
+     */
+    static LatencyHistogram& histogram(const std::string& name);
+
+    /**
+     * @brief Returns the counter with the given name, creating it if needed.
+     * 
+     * @param name The name of the counted event.
+     * @return The counter.
+     */
+    static std::atomic<uint64_t>& counter(const std::string& name);
+
+    /**
+     * @brief Prints count, mean, p50, p99, p999 and max of every histogram, then every counter.
+     * 
+     * @param out The stream to print to.
+     */
+    static void report(std::ostream& out);
+
+    /**
+     * @brief Clears every histogram and counter.
+     */
+    static void reset();
+};
+
+/**
+ * @brief Hot-path instrumentation that compiles to nothing unless PERF_INSTRUMENTATION is defined.
+ * 
+ * PERF_SCOPE(name) times the rest of the enclosing scope into the histogram `name`, and
+ * PERF_COUNT(name, n) adds `n` to the counter `name`. The registry is only consulted the first
+ * time a given line runs; afterwards a scope costs two clock readings and a few relaxed atomic
+ * additions. Build with `make PERF_FLAGS=-DPERF_INSTRUMENTATION` to enable them.
+ */
+#ifdef PERF_INSTRUMENTATION
+#define PERF_CONCAT_IMPL(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_IMPL(a, b)
+#define PERF_SCOPE(name)                                                                                   \
+    static LatencyHistogram& PERF_CONCAT(perfHistogram, __LINE__) = PerformanceRegistry::histogram(name); \
+    ScopedTimer PERF_CONCAT(perfScope, __LINE__)(PERF_CONCAT(perfHistogram, __LINE__))
+#define PERF_COUNT(name, n)                                                                   \
+    do {                                                                                      \
+        static std::atomic<uint64_t>& perfCounter = PerformanceRegistry::counter(name);       \
+        perfCounter.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);           \
+    } while (0)
+#else
+#define PERF_SCOPE(name) do {} while (0)
+#define PERF_COUNT(name, n) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,324 @@
+#include "PerformanceTimer.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+/**
+ * @brief Starts the performance timer.
+ * 
+ * Records the current time as the start time for measuring the duration.
+ */
+void PerformanceTimer::start() {
+    startTime = std::chrono::high_resolution_clock::now();
+}
+
+/**
+ * @brief Stops the performance timer and calculates the elapsed time.
+ * 
+ * @return The elapsed time in milliseconds since the last call to `start()`.
+ */
+double PerformanceTimer::stop() {
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = endTime - startTime;
+    return duration.count();
+}
+
+#ifdef PERF_TIMER_USES_RDTSC
+/**
+ * @brief Measures the time stamp counter rate against the steady clock, once.
+ * 
+ * @return The number of nanoseconds per tick.
+ */
+static double nanosecondsPerTick() {
+    static const double rate = []() {
+        auto startTime = std::chrono::steady_clock::now();
+        uint64_t startTicks = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t ticks = __rdtsc() - startTicks;
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - startTime;
+        return ticks > 0 ? elapsed.count() / static_cast<double>(ticks) : 1.0;
+    }();
+    return rate;
+}
+#endif
+
+/**
+ * @brief Converts a number of ticks into nanoseconds.
+ * 
+ * @param ticks The difference between two readings of `now()`.
+ * @return The elapsed time in nanoseconds.
+ */
+uint64_t CycleClock::toNanoseconds(uint64_t ticks) {
+#ifdef PERF_TIMER_USES_RDTSC
+    return static_cast<uint64_t>(static_cast<double>(ticks) * nanosecondsPerTick());
+#else
+    return ticks;
+#endif
+}
+
+/**
+ * @brief Creates an empty histogram.
+ */
+LatencyHistogram::LatencyHistogram() {
+#ifdef PERF_TIMER_USES_RDTSC
+    // Calibrate now rather than in the first timed scope
+    nanosecondsPerTick();
+#endif
+    reset();
+}
+
+/**
+ * @brief Finds the bucket of a value.
+ * 
+ * Values below 2 * SUB_BUCKET_HALF map to themselves. Larger values keep their SUB_BUCKET_BITS
+ * leading bits: the shift that drops the remaining bits selects the power of two, and the kept
+ * bits, which lie in [SUB_BUCKET_HALF, 2 * SUB_BUCKET_HALF), select the bucket within it.
+ */
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < 2 * SUB_BUCKET_HALF) {
+        return static_cast<size_t>(value);
+    }
+    int magnitude = 63 - __builtin_clzll(value);
+    int shift = magnitude - SUB_BUCKET_BITS + 1;
+    return static_cast<size_t>(shift) * SUB_BUCKET_HALF + static_cast<size_t>(value >> shift);
+}
+
+/**
+ * @brief Returns the highest value that falls into a bucket.
+ */
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < 2 * SUB_BUCKET_HALF) {
+        return index;
+    }
+    int shift = static_cast<int>(index / SUB_BUCKET_HALF) - 1;
+    uint64_t top = index % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+    // Wraps to the largest uint64_t for the last bucket
+    return ((top + 1) << shift) - 1;
+}
+
+/**
+ * @brief Records one latency.
+ * 
+ * @param nanoseconds The latency in nanoseconds.
+ */
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[bucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t current = minimum.load(std::memory_order_relaxed);
+    while (nanoseconds < current && !minimum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {
+    }
+    current = maximum.load(std::memory_order_relaxed);
+    while (nanoseconds > current && !maximum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Returns the number of recorded latencies.
+ */
+uint64_t LatencyHistogram::count() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the smallest recorded latency in nanoseconds, or 0 if none was recorded.
+ */
+uint64_t LatencyHistogram::min() const {
+    return count() > 0 ? minimum.load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * @brief Returns the largest recorded latency in nanoseconds.
+ */
+uint64_t LatencyHistogram::max() const {
+    return maximum.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the mean of the recorded latencies in nanoseconds.
+ */
+double LatencyHistogram::mean() const {
+    uint64_t values = count();
+    return values > 0 ? static_cast<double>(sum.load(std::memory_order_relaxed)) / values : 0.0;
+}
+
+/**
+ * @brief Returns a percentile of the recorded latencies.
+ * 
+ * @param percent The percentile, between 0 and 100 (e.g. 99.9 for the p999).
+ * @return The highest value of the bucket holding the percentile, in nanoseconds, or 0 if
+ *         nothing was recorded.
+ */
+uint64_t LatencyHistogram::percentile(double percent) const {
+    uint64_t values = count();
+    if (values == 0) {
+        return 0;
+    }
+    percent = std::min(std::max(percent, 0.0), 100.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percent / 100.0 * values)));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // The bucket bound can exceed every recorded value; the maximum is exact
+            return std::min(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+/**
+ * @brief Adds the latencies recorded by another histogram.
+ * 
+ * @param other The other histogram.
+ */
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.count() == 0) {
+        return;
+    }
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t values = other.buckets[i].load(std::memory_order_relaxed);
+        if (values > 0) {
+            buckets[i].fetch_add(values, std::memory_order_relaxed);
+        }
+    }
+    total.fetch_add(other.count(), std::memory_order_relaxed);
+    sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    uint64_t otherMinimum = other.minimum.load(std::memory_order_relaxed);
+    uint64_t current = minimum.load(std::memory_order_relaxed);
+    while (otherMinimum < current && !minimum.compare_exchange_weak(current, otherMinimum, std::memory_order_relaxed)) {
+    }
+    uint64_t otherMaximum = other.max();
+    current = maximum.load(std::memory_order_relaxed);
+    while (otherMaximum > current && !maximum.compare_exchange_weak(current, otherMaximum, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Forgets every recorded latency.
+ */
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    minimum.store(UINT64_MAX, std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @struct Registry
+ * @brief The named histograms and counters, in name order for stable reports.
+ */
+struct Registry {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms;
+    std::map<std::string, std::unique_ptr<std::atomic<uint64_t>>> counters;
+};
+
+/**
+ * @brief Returns the process-wide registry, created on first use.
+ */
+static Registry& registry() {
+    // Never destroyed, so instrumented code may still run during static destruction
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+/**
+ * @brief Returns the histogram with the given name, creating it if needed.
+ * 
+ * @param name The name of the measured operation, e.g. "get" or "http.round_trip".
+ * @return The histogram.
+ */
+LatencyHistogram& PerformanceRegistry::histogram(const std::string& name) {
+    Registry& instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    std::unique_ptr<LatencyHistogram>& histogram = instance.histograms[name];
+    if (!histogram) {
+        histogram.reset(new LatencyHistogram());
+    }
+    return *histogram;
+}
+
+/**
+ * @brief Returns the counter with the given name, creating it if needed.
+ * 
+ * @param name The name of the counted event.
+ * @return The counter.
+ */
+std::atomic<uint64_t>& PerformanceRegistry::counter(const std::string& name) {
+    Registry& instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    std::unique_ptr<std::atomic<uint64_t>>& counter = instance.counters[name];
+    if (!counter) {
+        counter.reset(new std::atomic<uint64_t>(0));
+    }
+    return *counter;
+}
+
+/**
+ * @brief Formats a latency with a unit that keeps it short.
+ * 
+ * @param nanoseconds The latency in nanoseconds.
+ * @return e.g. "850 ns", "12.5 us" or "3.21 ms".
+ */
+static std::string formatLatency(double nanoseconds) {
+    static const char* units[] = {"ns", "us", "ms", "s"};
+    size_t unit = 0;
+    while (nanoseconds >= 1000.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        nanoseconds /= 1000.0;
+        ++unit;
+    }
+    std::ostringstream text;
+    text << std::setprecision(3) << nanoseconds << " " << units[unit];
+    return text.str();
+}
+
+/**
+ * @brief Prints count, mean, p50, p99, p999 and max of every histogram, then every counter.
+ * 
+ * @param out The stream to print to.
+ */
+void PerformanceRegistry::report(std::ostream& out) {
+    Registry& instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    for (const auto& entry : instance.histograms) {
+        const LatencyHistogram& histogram = *entry.second;
+        if (histogram.count() == 0) {
+            continue;
+        }
+        out << entry.first << ": count " << histogram.count()
+            << ", mean " << formatLatency(histogram.mean())
+            << ", p50 " << formatLatency(static_cast<double>(histogram.percentile(50)))
+            << ", p99 " << formatLatency(static_cast<double>(histogram.percentile(99)))
+            << ", p999 " << formatLatency(static_cast<double>(histogram.percentile(99.9)))
+            << ", max " << formatLatency(static_cast<double>(histogram.max())) << std::endl;
+    }
+    for (const auto& entry : instance.counters) {
+        out << entry.first << ": " << entry.second->load(std::memory_order_relaxed) << std::endl;
+    }
+}
+
+/**
+ * @brief Clears every histogram and counter.
+ */
+void PerformanceRegistry::reset() {
+    Registry& instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    for (const auto& entry : instance.histograms) {
+        entry.second->reset();
+    }
+    for (const auto& entry : instance.counters) {
+        entry.second->store(0, std::memory_order_relaxed);
+    }
+}